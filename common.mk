@@ -3,7 +3,7 @@
 AM_CPPFLAGS = -DASIO_SEPARATE_COMPILATION=1 -DSQLITE_OMIT_LOAD_EXTENSION=1
 AM_CPPFLAGS += -I"$(top_srcdir)" -I"$(top_srcdir)/src" -I"$(top_builddir)/src"
 AM_CPPFLAGS += $(libsodium_CFLAGS) $(xdrpp_CFLAGS) $(libmedida_CFLAGS)	\
-	$(soci_CFLAGS) $(sqlite3_CFLAGS)
+	$(soci_CFLAGS) $(sqlite3_CFLAGS) $(zlib_CFLAGS)
 AM_CPPFLAGS += -I"$(top_srcdir)/lib"			\
 	-I"$(top_srcdir)/lib/autocheck/include"		\
 	-I"$(top_srcdir)/lib/cereal/include"		\
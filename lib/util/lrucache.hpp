@@ -99,6 +99,14 @@ namespace cache {
             }
         }
 
+        // visits entries from the most to the least recently used
+        template<typename F>
+        void for_each(const F &f) const {
+            for (auto const& kv : _cache_items_list) {
+                f(kv.first, kv.second);
+            }
+        }
+
         void clear() {
             _cache_items_map.clear();
             _cache_items_list.clear();
@@ -31,7 +31,9 @@
 #include "util/XDRStream.h"
 #include "util/make_unique.h"
 #include "xdrpp/message.h"
+#include <algorithm>
 #include <cassert>
+#include <functional>
 #include <future>
 
 namespace stellar
@@ -64,6 +66,14 @@ Bucket::getFilename() const
     return mFilename;
 }
 
+BucketIndex const&
+Bucket::getIndex() const
+{
+    std::call_once(mIndexBuilt,
+                   [this]() { mIndex = make_unique<BucketIndex>(*this); });
+    return *mIndex;
+}
+
 bool
 Bucket::containsBucketIdentity(BucketEntry const& id) const
 {
@@ -139,6 +149,8 @@ Bucket::fresh(BucketManager& bucketManager,
 
     std::sort(dead.begin(), dead.end(), BucketEntryIdCmp());
 
+    // fresh buckets are only merged into level 0 and can be rebuilt from the
+    // ledger, so they are not worth an fsync on the ledger close path
     BucketOutputIterator liveOut(bucketManager.getTmpDir(), true);
     BucketOutputIterator deadOut(bucketManager.getTmpDir(), true);
     for (auto const& e : live)
@@ -155,13 +167,60 @@ Bucket::fresh(BucketManager& bucketManager,
     return Bucket::merge(bucketManager, liveBucket, deadBucket);
 }
 
+// Merges with less input than this write through the page cache even with
+// Config::BUCKET_MERGE_DIRECT_IO: their output is small, and soon read again.
+static size_t const kDirectIOMergeBytes = 64 * 1024 * 1024;
+
+// Inputs smaller than this are read in the merging thread: a helper thread
+// to read them ahead costs more than it saves.
+static size_t const kPrefetchBytes = 1024 * 1024;
+
+// Bucket::mergeAll reads ahead at most this many of its inputs, the largest
+// ones: it can be handed every bucket of the list at once.
+static size_t const kMaxPrefetchedInputs = 4;
+
+static size_t
+fileSize(Bucket const& b)
+{
+    if (b.getFilename().empty())
+    {
+        return 0;
+    }
+    std::ifstream in(b.getFilename(),
+                     std::ifstream::ate | std::ifstream::binary);
+    return in ? static_cast<size_t>(in.tellg()) : 0;
+}
+
 inline void
 maybePut(BucketOutputIterator& out, BucketEntry const& entry,
-         std::vector<BucketInputIterator>& shadowIterators)
+         std::vector<BucketInputIterator>& shadowIterators,
+         std::vector<BucketIndex const*> const& shadowIndexes)
 {
     BucketEntryIdCmp cmp;
-    for (auto& si : shadowIterators)
+    for (size_t i = 0; i < shadowIterators.size(); ++i)
     {
+        auto& si = shadowIterators[i];
+        auto const& index = *shadowIndexes[i];
+
+        // Most entries are in no shadow at all, and the bloom filter says so
+        // without touching the shadow's file. The iterator is left where it
+        // is; it only ever moves forward, so it catches up on a later call.
+        if (!index.mayContain(entry))
+        {
+            continue;
+        }
+
+        // Everything before the page that would hold entry sorts below it,
+        // so skip straight there rather than reading through it.
+        if (si)
+        {
+            auto offset = index.pageOffset(entry);
+            if (offset > si.pos())
+            {
+                si.seek(offset);
+            }
+        }
+
         // Advance the shadowIterator while it's less than the candidate
         while (si && cmp(*si, entry))
         {
@@ -197,14 +256,26 @@ Bucket::merge(BucketManager& bucketManager,
     assert(oldBucket);
     assert(newBucket);
 
-    BucketInputIterator oi(oldBucket);
-    BucketInputIterator ni(newBucket);
+    // Shadows are mostly skipped with their indexes, but both inputs are read
+    // all the way through; large ones are read ahead on helper threads.
+    auto oldSize = fileSize(*oldBucket);
+    auto newSize = fileSize(*newBucket);
+    BucketInputIterator oi(oldBucket, oldSize >= kPrefetchBytes);
+    BucketInputIterator ni(newBucket, newSize >= kPrefetchBytes);
 
     std::vector<BucketInputIterator> shadowIterators(shadows.begin(),
                                                      shadows.end());
+    std::vector<BucketIndex const*> shadowIndexes;
+    for (auto const& s : shadows)
+    {
+        shadowIndexes.emplace_back(&s->getIndex());
+    }
 
     auto timer = bucketManager.getMergeTimer().TimeScope();
-    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries);
+    bool directIO = bucketManager.getMergeDirectIO() &&
+                    oldSize + newSize >= kDirectIOMergeBytes;
+    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries,
+                             bucketManager.getFsyncBucketFiles(), directIO);
 
     BucketEntryIdCmp cmp;
     while (oi || ni)
@@ -212,31 +283,31 @@ Bucket::merge(BucketManager& bucketManager,
         if (!ni)
         {
             // Out of new entries, take old entries.
-            maybePut(out, *oi, shadowIterators);
+            maybePut(out, *oi, shadowIterators, shadowIndexes);
             ++oi;
         }
         else if (!oi)
         {
             // Out of old entries, take new entries.
-            maybePut(out, *ni, shadowIterators);
+            maybePut(out, *ni, shadowIterators, shadowIndexes);
             ++ni;
         }
         else if (cmp(*oi, *ni))
         {
             // Next old-entry has smaller key, take it.
-            maybePut(out, *oi, shadowIterators);
+            maybePut(out, *oi, shadowIterators, shadowIndexes);
             ++oi;
         }
         else if (cmp(*ni, *oi))
         {
             // Next new-entry has smaller key, take it.
-            maybePut(out, *ni, shadowIterators);
+            maybePut(out, *ni, shadowIterators, shadowIndexes);
             ++ni;
         }
         else
         {
             // Old and new are for the same key, take new.
-            maybePut(out, *ni, shadowIterators);
+            maybePut(out, *ni, shadowIterators, shadowIndexes);
             ++oi;
             ++ni;
         }
@@ -244,6 +315,77 @@ Bucket::merge(BucketManager& bucketManager,
     return out.getBucket(bucketManager);
 }
 
+std::shared_ptr<Bucket>
+Bucket::mergeAll(BucketManager& bucketManager,
+                 std::vector<std::shared_ptr<Bucket const>> const& buckets)
+{
+    std::vector<size_t> sizes;
+    for (auto const& b : buckets)
+    {
+        assert(b);
+        sizes.emplace_back(fileSize(*b));
+    }
+    auto sorted = sizes;
+    std::sort(sorted.begin(), sorted.end(), std::greater<size_t>());
+    size_t prefetchFrom = kPrefetchBytes;
+    if (sorted.size() > kMaxPrefetchedInputs)
+    {
+        prefetchFrom = std::max(prefetchFrom, sorted[kMaxPrefetchedInputs] + 1);
+    }
+
+    std::vector<std::unique_ptr<BucketInputIterator>> iters;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        iters.emplace_back(make_unique<BucketInputIterator>(
+            buckets[i], sizes[i] >= prefetchFrom));
+    }
+
+    auto timer = bucketManager.getMergeTimer().TimeScope();
+    BucketOutputIterator out(bucketManager.getTmpDir(), true,
+                             bucketManager.getFsyncBucketFiles());
+
+    BucketEntryIdCmp cmp;
+    std::vector<size_t> least;
+    for (;;)
+    {
+        // Find the iterators sitting on the smallest key; their order is
+        // that of the buckets, oldest first.
+        least.clear();
+        for (size_t i = 0; i < iters.size(); ++i)
+        {
+            auto& it = *iters[i];
+            if (!it)
+            {
+                continue;
+            }
+            if (!least.empty() && cmp(*iters[least.front()], *it))
+            {
+                continue;
+            }
+            if (!least.empty() && cmp(*it, *iters[least.front()]))
+            {
+                least.clear();
+            }
+            least.emplace_back(i);
+        }
+        if (least.empty())
+        {
+            break;
+        }
+        // BucketOutputIterator keeps the last of keywise-equal entries put
+        // into it, so putting them oldest first leaves the newest.
+        for (auto i : least)
+        {
+            out.put(**iters[i]);
+        }
+        for (auto i : least)
+        {
+            ++*iters[i];
+        }
+    }
+    return out.getBucket(bucketManager);
+}
+
 static void
 compareSizes(std::string const& objType, uint64_t inDatabase,
              uint64_t inBucketlist)
@@ -4,11 +4,14 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/BucketIndex.h"
 #include "bucket/LedgerCmp.h"
 #include "crypto/Hex.h"
 #include "overlay/StellarXDR.h"
 #include "util/NonCopyable.h"
 #include "util/XDRStream.h"
+#include <memory>
+#include <mutex>
 #include <string>
 
 namespace medida
@@ -41,6 +44,9 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     std::string const mFilename;
     Hash const mHash;
 
+    mutable std::once_flag mIndexBuilt;
+    mutable std::unique_ptr<BucketIndex> mIndex;
+
   public:
     // Create an empty bucket. The empty bucket has hash '000000...' and its
     // filename is the empty string.
@@ -54,6 +60,10 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     Hash const& getHash() const;
     std::string const& getFilename() const;
 
+    // Returns the bucket's key index, reading through the file to build it on
+    // first use. Safe to call from several merges at once.
+    BucketIndex const& getIndex() const;
+
     // Returns true if a BucketEntry that is key-wise identical to the given
     // BucketEntry exists in the bucket. For testing.
     bool containsBucketIdentity(BucketEntry const& id) const;
@@ -87,6 +97,14 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
           std::vector<std::shared_ptr<Bucket>> const& shadows =
               std::vector<std::shared_ptr<Bucket>>(),
           bool keepDeadEntries = true);
+
+    // Merge any number of buckets, given oldest first, into a fresh one in a
+    // single pass. Of keywise-equal entries, the one from the newest bucket
+    // holding the key wins. Dead entries are kept, so that the result can be
+    // applied in place of applying each of the buckets in turn.
+    static std::shared_ptr<Bucket>
+    mergeAll(BucketManager& bucketManager,
+             std::vector<std::shared_ptr<Bucket const>> const& buckets);
 };
 
 void checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
@@ -5,6 +5,8 @@
 #include "util/asio.h"
 #include "bucket/BucketApplicator.h"
 #include "bucket/Bucket.h"
+#include "bucket/BucketIndex.h"
+#include "ledger/EntryFrame.h"
 #include "ledger/LedgerDelta.h"
 #include "util/Logging.h"
 
@@ -13,7 +15,7 @@ namespace stellar
 
 BucketApplicator::BucketApplicator(Database& db,
                                    std::shared_ptr<const Bucket> bucket)
-    : mDb(db), mBucketIter(bucket)
+    : mDb(db), mBucketIter(bucket, true)
 {
 }
 
@@ -57,4 +59,57 @@ BucketApplicator::advance()
             << "Bucket-apply: committed " << mSize << " entries";
     }
 }
+
+BucketShardApplicator::BucketShardApplicator(
+    soci::session& sess, bool inlineSigners,
+    std::shared_ptr<const Bucket> bucket, size_t shard, size_t shardCount)
+    : mSess(sess)
+    , mInlineSigners(inlineSigners)
+    , mBucketIter(bucket)
+    , mShard(shard)
+    , mShardCount(shardCount)
+{
+    assert(shard < shardCount);
+}
+
+BucketShardApplicator::operator bool() const
+{
+    return (bool)mBucketIter;
+}
+
+void
+BucketShardApplicator::advance()
+{
+    soci::transaction sqlTx(mSess);
+    // the shards write disjoint sets of rows; serializable transactions would
+    // still make them fail against each other over their predicate locks
+    mSess << "SET TRANSACTION ISOLATION LEVEL READ COMMITTED";
+    size_t n = 0;
+    for (; mBucketIter && n < 0x1000; ++mBucketIter)
+    {
+        auto const& entry = *mBucketIter;
+        if (BucketIndex::keyHash(entry) % mShardCount != mShard)
+        {
+            continue;
+        }
+        if (entry.type() == LIVEENTRY)
+        {
+            EntryFrame::bulkReplace(mSess, entry.liveEntry(), mInlineSigners);
+        }
+        else
+        {
+            EntryFrame::bulkDelete(mSess, entry.deadEntry(), mInlineSigners);
+        }
+        ++n;
+    }
+    sqlTx.commit();
+    mSize += n;
+
+    if (!mBucketIter)
+    {
+        CLOG(INFO, "Bucket") << "Bucket-apply: shard " << mShard << " of "
+                             << mShardCount << " committed " << mSize
+                             << " entries";
+    }
+}
 }
@@ -30,4 +30,28 @@ class BucketApplicator
     operator bool() const;
     void advance();
 };
+
+// Applies the entries of a bucket that fall in one of `shardCount` shards,
+// by key hash, through `sess`: a Postgres session of the connection pool.
+// One of these per shard, each on a worker thread, apply a bucket together.
+// Entries are written with the EntryFrame bulk helpers, so once every shard
+// is done, the entry cache has to be cleared and the inflation votes
+// rebuilt on the main thread.
+class BucketShardApplicator
+{
+    soci::session& mSess;
+    bool mInlineSigners;
+    BucketInputIterator mBucketIter;
+    size_t mShard;
+    size_t mShardCount;
+    size_t mSize{0};
+
+  public:
+    BucketShardApplicator(soci::session& sess, bool inlineSigners,
+                          std::shared_ptr<const Bucket> bucket, size_t shard,
+                          size_t shardCount);
+    operator bool() const;
+    // applies the next few thousand entries of the shard in one transaction
+    void advance();
+};
 }
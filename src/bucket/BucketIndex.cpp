@@ -0,0 +1,226 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketIndex.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketInputIterator.h"
+#include "bucket/LedgerCmp.h"
+#include "ledger/EntryFrame.h"
+#include <algorithm>
+#include <cstring>
+
+namespace stellar
+{
+
+namespace
+{
+
+// ~10 bits and 7 probes per key give a false positive rate a little under 1%
+size_t const kBloomBitsPerKey = 10;
+size_t const kBloomProbes = 7;
+
+uint64_t
+fmix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t
+mixIn(uint64_t h, uint64_t v)
+{
+    return fmix64(h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+}
+
+uint64_t
+mixBytes(uint64_t h, uint8_t const* data, size_t size)
+{
+    while (size >= 8)
+    {
+        uint64_t v;
+        std::memcpy(&v, data, 8);
+        h = mixIn(h, v);
+        data += 8;
+        size -= 8;
+    }
+    uint64_t tail = size;
+    for (size_t i = 0; i < size; ++i)
+    {
+        tail = (tail << 8) | data[i];
+    }
+    return mixIn(h, tail);
+}
+
+uint64_t
+mixAccount(uint64_t h, AccountID const& id)
+{
+    auto const& key = id.ed25519();
+    return mixBytes(h, key.data(), key.size());
+}
+
+uint64_t
+mixAsset(uint64_t h, Asset const& asset)
+{
+    h = mixIn(h, asset.type());
+    switch (asset.type())
+    {
+    case ASSET_TYPE_CREDIT_ALPHANUM4:
+        h = mixBytes(h, asset.alphaNum4().assetCode.data(),
+                     asset.alphaNum4().assetCode.size());
+        return mixAccount(h, asset.alphaNum4().issuer);
+    case ASSET_TYPE_CREDIT_ALPHANUM12:
+        h = mixBytes(h, asset.alphaNum12().assetCode.data(),
+                     asset.alphaNum12().assetCode.size());
+        return mixAccount(h, asset.alphaNum12().issuer);
+    default:
+        return h;
+    }
+}
+
+// Hashes the identity of a LedgerEntry's data or of a LedgerKey -- the same
+// fields LedgerEntryIdCmp compares -- so an entry and its key hash alike.
+template <typename T>
+uint64_t
+identityHash(T const& t)
+{
+    uint64_t h = mixIn(0, t.type());
+    switch (t.type())
+    {
+    case ACCOUNT:
+        return mixAccount(h, t.account().accountID);
+    case TRUSTLINE:
+        h = mixAccount(h, t.trustLine().accountID);
+        return mixAsset(h, t.trustLine().asset);
+    case OFFER:
+        h = mixAccount(h, t.offer().sellerID);
+        return mixIn(h, t.offer().offerID);
+    case DATA:
+    {
+        h = mixAccount(h, t.data().accountID);
+        auto const& name = t.data().dataName;
+        return mixBytes(h, reinterpret_cast<uint8_t const*>(name.data()),
+                        name.size());
+    }
+    }
+    return h;
+}
+
+uint64_t
+identityHash(BucketEntry const& e)
+{
+    return e.type() == LIVEENTRY ? identityHash(e.liveEntry().data)
+                                 : identityHash(e.deadEntry());
+}
+
+LedgerKey
+identityKey(BucketEntry const& e)
+{
+    return e.type() == LIVEENTRY ? LedgerEntryKey(e.liveEntry())
+                                 : e.deadEntry();
+}
+
+// LedgerEntryIdCmp between a page key and an entry, either way round
+struct PageKeyCmp
+{
+    bool
+    operator()(BucketEntry const& e, LedgerKey const& k) const
+    {
+        return e.type() == LIVEENTRY
+                   ? LedgerEntryIdCmp{}(e.liveEntry().data, k)
+                   : LedgerEntryIdCmp{}(e.deadEntry(), k);
+    }
+};
+}
+
+uint64_t
+BucketIndex::keyHash(BucketEntry const& e)
+{
+    return identityHash(e);
+}
+
+BucketIndex::BucketIndex(Bucket const& bucket)
+{
+    if (bucket.getFilename().empty())
+    {
+        return;
+    }
+
+    std::vector<uint64_t> keyHashes;
+    for (BucketInputIterator iter(bucket.shared_from_this()); iter; ++iter)
+    {
+        if (mEntries % kPageSize == 0)
+        {
+            mPageKeys.emplace_back(identityKey(*iter));
+            mPageOffsets.emplace_back(iter.pos());
+        }
+        keyHashes.emplace_back(identityHash(*iter));
+        ++mEntries;
+    }
+
+    size_t bits = std::max<size_t>(64, mEntries * kBloomBitsPerKey);
+    mBloomBits.assign((bits + 63) / 64, 0);
+    for (auto h : keyHashes)
+    {
+        addToBloom(h);
+    }
+}
+
+void
+BucketIndex::addToBloom(uint64_t keyHash)
+{
+    // double hashing: probe i looks at h1 + i * h2
+    uint64_t nbits = mBloomBits.size() * 64;
+    uint64_t h2 = fmix64(keyHash) | 1;
+    for (size_t i = 0; i < kBloomProbes; ++i)
+    {
+        uint64_t bit = (keyHash + i * h2) % nbits;
+        mBloomBits[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool
+BucketIndex::mayContain(BucketEntry const& e) const
+{
+    if (mEntries == 0)
+    {
+        return false;
+    }
+    uint64_t keyHash = identityHash(e);
+    uint64_t nbits = mBloomBits.size() * 64;
+    uint64_t h2 = fmix64(keyHash) | 1;
+    for (size_t i = 0; i < kBloomProbes; ++i)
+    {
+        uint64_t bit = (keyHash + i * h2) % nbits;
+        if ((mBloomBits[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::streamoff
+BucketIndex::pageOffset(BucketEntry const& e) const
+{
+    // the last page starting at or before e
+    auto it = std::upper_bound(mPageKeys.begin(), mPageKeys.end(), e,
+                               PageKeyCmp{});
+    if (it == mPageKeys.begin())
+    {
+        return -1;
+    }
+    return mPageOffsets[(it - mPageKeys.begin()) - 1];
+}
+
+size_t
+BucketIndex::memoryBytes() const
+{
+    return sizeof(*this) + mBloomBits.size() * sizeof(uint64_t) +
+           mPageKeys.size() * (sizeof(LedgerKey) + sizeof(std::streamoff));
+}
+}
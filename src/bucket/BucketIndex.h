@@ -0,0 +1,63 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "xdr/Stellar-ledger.h"
+
+#include <cstdint>
+#include <ios>
+#include <vector>
+
+namespace stellar
+{
+
+class Bucket;
+
+/**
+ * In-memory summary of the keys in a bucket, used by Bucket::merge to check
+ * whether an entry is shadowed without reading through the shadow bucket.
+ *
+ * It holds a bloom filter over the identities of the bucket's entries, which
+ * answers most "is this key here?" questions with a definite no, and a sparse
+ * index of every kPageSize-th key with its file offset, so that the few maybes
+ * can seek straight to the only page that could hold the key.
+ */
+class BucketIndex
+{
+  public:
+    static size_t const kPageSize = 64;
+
+    // Builds the index by reading through the bucket's file once.
+    explicit BucketIndex(Bucket const& bucket);
+
+    // Hash of the identity of `e`, which is the same for an entry and for its
+    // dead entry.
+    static uint64_t keyHash(BucketEntry const& e);
+
+    // False if the bucket surely has no entry with the identity of `e`.
+    bool mayContain(BucketEntry const& e) const;
+
+    // Offset of the page that would hold an entry with the identity of `e`,
+    // or -1 if `e` sorts before every entry of the bucket.
+    std::streamoff pageOffset(BucketEntry const& e) const;
+
+    size_t
+    size() const
+    {
+        return mEntries;
+    }
+
+    // Rough memory footprint, for logging.
+    size_t memoryBytes() const;
+
+  private:
+    std::vector<uint64_t> mBloomBits;
+    std::vector<LedgerKey> mPageKeys;
+    std::vector<std::streamoff> mPageOffsets;
+    size_t mEntries{0};
+
+    void addToBloom(uint64_t keyHash);
+};
+}
@@ -4,9 +4,179 @@
 
 #include "bucket/BucketInputIterator.h"
 #include "bucket/Bucket.h"
+#include "util/make_unique.h"
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace stellar
 {
+
+/**
+ * Reads a bucket file on a thread of its own, decoding entries into batches
+ * that the iterator takes one at a time. At most kMaxBatches are kept ready,
+ * so the reader runs at most that far ahead of the consumer.
+ *
+ * Alongside, it asks the kernel to read the next kReadaheadBytes of the file
+ * into the page cache, so that the reader itself rarely waits on the disk.
+ */
+class BucketInputIterator::Prefetcher
+{
+    static size_t const kBatchSize = 256;
+    static size_t const kMaxBatches = 4;
+    static std::streamoff const kReadaheadBytes = 8 * 1024 * 1024;
+
+    XDRInputFileStream mIn;
+    int mAdviceFd{-1};
+    std::streamoff mAdvisedUpTo{0};
+
+    std::mutex mMutex;
+    std::condition_variable mReadyChanged;
+    std::deque<std::vector<BucketEntry>> mReady;
+    std::vector<std::vector<BucketEntry>> mSpare;
+    bool mDone{false};
+    bool mStop{false};
+    std::exception_ptr mError;
+
+    std::thread mThread;
+
+    void
+    adviseReadahead()
+    {
+#ifdef POSIX_FADV_WILLNEED
+        if (mAdviceFd == -1)
+        {
+            return;
+        }
+        auto pos = mIn.pos();
+        if (pos >= 0 && pos + kReadaheadBytes / 2 >= mAdvisedUpTo)
+        {
+            auto from = std::max(pos, mAdvisedUpTo);
+            posix_fadvise(mAdviceFd, from, pos + kReadaheadBytes - from,
+                          POSIX_FADV_WILLNEED);
+            mAdvisedUpTo = pos + kReadaheadBytes;
+        }
+#endif
+    }
+
+    void
+    run()
+    {
+        try
+        {
+            for (;;)
+            {
+                std::vector<BucketEntry> batch;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mReadyChanged.wait(lock, [this]() {
+                        return mStop || mReady.size() < kMaxBatches;
+                    });
+                    if (mStop)
+                    {
+                        return;
+                    }
+                    if (!mSpare.empty())
+                    {
+                        batch = std::move(mSpare.back());
+                        mSpare.pop_back();
+                    }
+                }
+
+                adviseReadahead();
+                batch.resize(kBatchSize);
+                size_t n = 0;
+                while (n < kBatchSize && mIn.readOne(batch[n]))
+                {
+                    ++n;
+                }
+                batch.resize(n);
+
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (n != 0)
+                {
+                    mReady.emplace_back(std::move(batch));
+                }
+                mDone = n < kBatchSize;
+                mReadyChanged.notify_all();
+                if (mDone)
+                {
+                    return;
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mError = std::current_exception();
+            mDone = true;
+            mReadyChanged.notify_all();
+        }
+    }
+
+  public:
+    explicit Prefetcher(std::string const& filename)
+    {
+        mIn.open(filename);
+#ifdef POSIX_FADV_WILLNEED
+        mAdviceFd = ::open(filename.c_str(), O_RDONLY);
+#endif
+        mThread = std::thread([this]() { run(); });
+    }
+
+    ~Prefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+            mReadyChanged.notify_all();
+        }
+        mThread.join();
+#ifndef _WIN32
+        if (mAdviceFd != -1)
+        {
+            ::close(mAdviceFd);
+        }
+#endif
+    }
+
+    // Replaces batch with the next one, keeping the old one's storage for
+    // reuse. Returns false at the end of the file, and rethrows whatever
+    // stopped the reader early.
+    bool
+    next(std::vector<BucketEntry>& batch)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (batch.capacity() != 0)
+        {
+            mSpare.emplace_back(std::move(batch));
+            batch.clear();
+        }
+        mReadyChanged.wait(lock, [this]() { return !mReady.empty() || mDone; });
+        if (mReady.empty())
+        {
+            if (mError)
+            {
+                std::rethrow_exception(mError);
+            }
+            return false;
+        }
+        batch = std::move(mReady.front());
+        mReady.pop_front();
+        mReadyChanged.notify_all();
+        return true;
+    }
+};
+
 /**
  * Helper class that reads from the file underlying a bucket, keeping the bucket
  * alive for the duration of its existence.
@@ -14,8 +184,11 @@ namespace stellar
 void
 BucketInputIterator::loadEntry()
 {
-    if (mIn.readOne(mEntry))
+    mEntryPos = mNextPos;
+    size_t bytesRead = 0;
+    if (mIn.readOne(mEntry, &bytesRead))
     {
+        mNextPos += bytesRead;
         mEntryPtr = &mEntry;
     }
     else
@@ -24,6 +197,13 @@ BucketInputIterator::loadEntry()
     }
 }
 
+void
+BucketInputIterator::loadBatch()
+{
+    mBatchPos = 0;
+    mEntryPtr = mPrefetcher->next(mBatch) ? &mBatch[0] : nullptr;
+}
+
 BucketInputIterator::operator bool() const
 {
     return mEntryPtr != nullptr;
@@ -34,15 +214,24 @@ BucketEntry const& BucketInputIterator::operator*()
     return *mEntryPtr;
 }
 
-BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket)
+BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket,
+                                         bool prefetch)
     : mBucket(bucket), mEntryPtr(nullptr)
 {
     if (!mBucket->getFilename().empty())
     {
         CLOG(TRACE, "Bucket") << "BucketInputIterator opening file to read: "
                               << mBucket->getFilename();
-        mIn.open(mBucket->getFilename());
-        loadEntry();
+        if (prefetch)
+        {
+            mPrefetcher = make_unique<Prefetcher>(mBucket->getFilename());
+            loadBatch();
+        }
+        else
+        {
+            mIn.open(mBucket->getFilename());
+            loadEntry();
+        }
     }
 }
 
@@ -53,7 +242,22 @@ BucketInputIterator::~BucketInputIterator()
 
 BucketInputIterator& BucketInputIterator::operator++()
 {
-    if (mIn)
+    if (mPrefetcher)
+    {
+        if (!mEntryPtr)
+        {
+            return *this;
+        }
+        if (++mBatchPos < mBatch.size())
+        {
+            mEntryPtr = &mBatch[mBatchPos];
+        }
+        else
+        {
+            loadBatch();
+        }
+    }
+    else if (mIn)
     {
         loadEntry();
     }
@@ -63,4 +267,20 @@ BucketInputIterator& BucketInputIterator::operator++()
     }
     return *this;
 }
+
+std::streamoff
+BucketInputIterator::pos() const
+{
+    assert(!mPrefetcher);
+    return mEntryPos;
+}
+
+void
+BucketInputIterator::seek(std::streamoff offset)
+{
+    assert(!mPrefetcher);
+    mIn.seek(offset);
+    mNextPos = offset;
+    loadEntry();
+}
 }
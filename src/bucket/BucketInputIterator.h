@@ -9,6 +9,7 @@
 #include "xdr/Stellar-ledger.h"
 
 #include <memory>
+#include <vector>
 
 namespace stellar
 {
@@ -18,26 +19,51 @@ class Bucket;
 // Helper class that reads through the entries in a bucket.
 class BucketInputIterator
 {
+    class Prefetcher;
+
     std::shared_ptr<Bucket const> mBucket;
 
     // Validity and current-value of the iterator is funneled into a
     // pointer. If
-    // non-null, it points to mEntry.
+    // non-null, it points to mEntry, or into mBatch when prefetching.
     BucketEntry const* mEntryPtr;
     XDRInputFileStream mIn;
     BucketEntry mEntry;
+    // Offsets of the current entry and of the next one, kept from the record
+    // sizes rather than asked of the stream.
+    std::streamoff mEntryPos{0};
+    std::streamoff mNextPos{0};
+
+    // When prefetching, entries are read and decoded on mPrefetcher's thread
+    // and handed over a batch at a time.
+    std::unique_ptr<Prefetcher> mPrefetcher;
+    std::vector<BucketEntry> mBatch;
+    size_t mBatchPos{0};
 
     void loadEntry();
+    void loadBatch();
 
   public:
     operator bool() const;
 
     BucketEntry const& operator*();
 
-    BucketInputIterator(std::shared_ptr<Bucket const> bucket);
+    // With prefetch set, a helper thread reads and decodes entries a few
+    // hundred ahead of the iterator, and has the kernel read the file ahead
+    // of itself, so that the consumer's own work overlaps with the I/O.
+    // pos() and seek() can not be used on such an iterator.
+    BucketInputIterator(std::shared_ptr<Bucket const> bucket,
+                        bool prefetch = false);
 
     ~BucketInputIterator();
 
     BucketInputIterator& operator++();
+
+    // File offset of the current entry.
+    std::streamoff pos() const;
+
+    // Moves to the entry at `offset`, which has to be one returned by pos()
+    // on an iterator over the same bucket, or a BucketIndex page offset.
+    void seek(std::streamoff offset);
 };
 }
@@ -56,6 +56,13 @@ class BucketManager : NonMovableOrCopyable
 
     virtual medida::Timer& getMergeTimer() = 0;
 
+    // Whether new bucket files are fsynced before they are adopted, see
+    // Config::DISABLE_XDR_FSYNC.
+    virtual bool getFsyncBucketFiles() const = 0;
+    // Whether large merges write their output with direct I/O, see
+    // Config::BUCKET_MERGE_DIRECT_IO.
+    virtual bool getMergeDirectIO() const = 0;
+
     // Get a reference to a persistent bucket (in the BucketManager's bucket
     // directory), from the BucketManager's shared bucket-set.
     //
@@ -74,12 +81,22 @@ class BucketManager : NonMovableOrCopyable
     // Return a bucket by hash if we have it, else return nullptr.
     virtual std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) = 0;
 
-    // Forget any buckets not referenced by the current BucketList. This will
-    // not immediately cause the buckets to delete themselves, if someone else
-    // is using them via a shared_ptr<>, but the BucketManager will no longer
-    // independently keep them alive.
+    // Forget any buckets nobody holds a reference to: neither a shared_ptr<>
+    // (from the BucketList's levels, a FutureBucket, a running merge...) nor
+    // a retainBuckets() call. This will not immediately cause the buckets to
+    // delete themselves, if someone else is using them via a shared_ptr<>,
+    // but the BucketManager will no longer independently keep them alive.
+    // Files of forgotten buckets are removed on a worker thread.
     virtual void forgetUnreferencedBuckets() = 0;
 
+    // Keep the buckets named by `hashes` (hex, as in a HAS) from being
+    // forgotten until a matching releaseBuckets(), counting one reference
+    // per occurrence. This is how the publish queue, which only knows its
+    // buckets by hash, keeps them around; they do not have to be loaded, or
+    // even present on disk yet.
+    virtual void retainBuckets(std::vector<std::string> const& hashes) = 0;
+    virtual void releaseBuckets(std::vector<std::string> const& hashes) = 0;
+
     // Feed a new batch of entries to the bucket list.
     virtual void addBatch(Application& app, uint32_t currLedger,
                           std::vector<LedgerEntry> const& liveEntries,
@@ -86,6 +86,16 @@ isBucketFile(std::string const& name)
     return std::regex_match(name, re);
 };
 
+// suffix of files of forgotten buckets waiting to be removed
+char const* const kDoomedSuffix = ".deleting";
+
+bool
+isDoomedBucketFile(std::string const& name)
+{
+    static std::regex re("^bucket-[a-z0-9]{64}\\.xdr(\\.gz)?\\.deleting$");
+    return std::regex_match(name, re);
+};
+
 uint256
 extractFromFilename(std::string const& name)
 {
@@ -160,6 +170,18 @@ BucketManagerImpl::getMergeTimer()
     return mBucketSnapMerge;
 }
 
+bool
+BucketManagerImpl::getFsyncBucketFiles() const
+{
+    return !mApp.getConfig().DISABLE_XDR_FSYNC;
+}
+
+bool
+BucketManagerImpl::getMergeDirectIO() const
+{
+    return mApp.getConfig().BUCKET_MERGE_DIRECT_IO;
+}
+
 std::shared_ptr<Bucket>
 BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
                                      uint256 const& hash, size_t nObjects,
@@ -244,13 +266,14 @@ BucketManagerImpl::getReferencedBuckets() const
     }
 
     // Implicitly retain any buckets that are referenced by a state in
-    // the publish queue.
+    // the publish queue. Asking for them also has the history manager load
+    // the publish queue and retainBuckets() them, if it has not yet.
     auto pub = mApp.getHistoryManager().getBucketsReferencedByPublishQueue();
     {
         for (auto const& h : pub)
         {
             CLOG(DEBUG, "Bucket")
-                << "BucketManager::forgetUnreferencedBuckets: " << h
+                << "BucketManager::cleanupStaleFiles: " << h
                 << " referenced by publish queue";
             referenced.insert(hexToBin256(h));
         }
@@ -266,7 +289,7 @@ BucketManagerImpl::cleanupStaleFiles()
     auto referenced = getReferencedBuckets();
     std::transform(std::begin(mSharedBuckets), std::end(mSharedBuckets),
                    std::inserter(referenced, std::end(referenced)),
-                   [](std::pair<Hash, std::shared_ptr<Bucket>> const& p) {
+                   [](std::pair<Hash const, std::shared_ptr<Bucket>> const& p) {
                        return p.first;
                    });
 
@@ -282,49 +305,104 @@ BucketManagerImpl::cleanupStaleFiles()
             std::remove(fullName.c_str());
         }
     }
+
+    // files forgotten just before the last shutdown that the worker thread
+    // did not get to
+    for (auto f : fs::findfiles(getBucketDir(), isDoomedBucketFile))
+    {
+        auto fullName = getBucketDir() + "/" + f;
+        std::remove(fullName.c_str());
+    }
 }
 
 void
 BucketManagerImpl::forgetUnreferencedBuckets()
 {
     std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
-    auto referenced = getReferencedBuckets();
+    std::vector<std::string> doomed;
 
     for (auto i = mSharedBuckets.begin(); i != mSharedBuckets.end();)
     {
-        // Standard says map iterators other than the one you're erasing remain
-        // valid.
-        auto j = i;
-        ++i;
-
         // Only drop buckets if the bucketlist has forgotten them _and_
         // no other in-progress structures (worker threads, shadow lists)
-        // have references to them, just us. It's ok to retain a few too
-        // many buckets, a little longer than necessary.
+        // have references to them, just us. Everything that needs a bucket
+        // holds a shared_ptr<> to it, except for the publish queue, which
+        // retains its buckets by hash; so there is nothing to walk to find
+        // out what is still in use. It's ok to retain a few too many
+        // buckets, a little longer than necessary.
         //
         // This conservatism is important because we want to enforce that only
         // one bucket ever exists in memory with a given filename, and that
         // we're the first and last to know about it. Otherwise buckets might
         // race on deleting the underlying file from one another.
 
-        if (referenced.find(j->first) == referenced.end() &&
-            j->second.use_count() == 1)
+        if (i->second.use_count() != 1 ||
+            mRetainedBuckets.find(i->first) != mRetainedBuckets.end())
         {
-            auto filename = j->second->getFilename();
-            CLOG(TRACE, "Bucket")
-                << "BucketManager::forgetUnreferencedBuckets dropping "
-                << filename;
-            if (!filename.empty())
+            ++i;
+            continue;
+        }
+
+        auto filename = i->second->getFilename();
+        CLOG(TRACE, "Bucket")
+            << "BucketManager::forgetUnreferencedBuckets dropping " << filename;
+        if (!filename.empty())
+        {
+            // Move the files out of the way now, so that a bucket with the
+            // same hash adopted before the worker gets to them is not
+            // affected; unlinking a large file can take a while, so that
+            // part happens off the main thread.
+            for (auto const& name : {filename, filename + ".gz"})
             {
-                CLOG(TRACE, "Bucket") << "removing bucket file: " << filename;
-                std::remove(filename.c_str());
-                auto gzfilename = filename + ".gz";
-                std::remove(gzfilename.c_str());
+                auto doomedName = name + kDoomedSuffix;
+                if (rename(name.c_str(), doomedName.c_str()) == 0)
+                {
+                    doomed.emplace_back(std::move(doomedName));
+                }
             }
-            mSharedBuckets.erase(j);
         }
+        i = mSharedBuckets.erase(i);
     }
     mSharedBucketsSize.set_count(mSharedBuckets.size());
+
+    if (!doomed.empty())
+    {
+        mApp.getWorkerIOService().post([doomed]() {
+            for (auto const& name : doomed)
+            {
+                CLOG(TRACE, "Bucket") << "removing bucket file: " << name;
+                std::remove(name.c_str());
+            }
+        });
+    }
+}
+
+void
+BucketManagerImpl::retainBuckets(std::vector<std::string> const& hashes)
+{
+    std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
+    for (auto const& h : hashes)
+    {
+        auto hash = hexToBin256(h);
+        if (!isZero(hash))
+        {
+            ++mRetainedBuckets[hash];
+        }
+    }
+}
+
+void
+BucketManagerImpl::releaseBuckets(std::vector<std::string> const& hashes)
+{
+    std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
+    for (auto const& h : hashes)
+    {
+        auto i = mRetainedBuckets.find(hexToBin256(h));
+        if (i != mRetainedBuckets.end() && --i->second == 0)
+        {
+            mRetainedBuckets.erase(i);
+        }
+    }
 }
 
 void
@@ -334,6 +412,20 @@ BucketManagerImpl::addBatch(Application& app, uint32_t currLedger,
 {
     auto timer = mBucketAddBatch.TimeScope();
     mBucketList.addBatch(app, currLedger, liveEntries, deadEntries);
+    syncBucketDir();
+}
+
+void
+BucketManagerImpl::syncBucketDir()
+{
+    // bucket files are synced by whoever writes them, but their renames into
+    // the bucket directory are only made durable here, once for every bucket
+    // adopted since the last time, before a new state referencing them is
+    // stored
+    if (getFsyncBucketFiles())
+    {
+        fs::syncDirectory(getBucketDir());
+    }
 }
 
 // updates the given LedgerHeader to reflect the current state of the bucket
@@ -402,6 +494,7 @@ BucketManagerImpl::assumeState(HistoryArchiveState const& has)
         mBucketList.getLevel(i).setNext(has.currentBuckets.at(i).next);
     }
 
+    syncBucketDir();
     mBucketList.restartMerges(mApp);
     cleanupStaleFiles();
 }
@@ -3,12 +3,13 @@
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "overlay/StellarXDR.h"
+#include "util/HashOfHash.h"
 
-#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 // Copyright 2015 Stellar Development Foundation and contributors. Licensed
 // under the Apache License, Version 2.0. See the COPYING file at the root
@@ -37,7 +38,8 @@ class BucketManagerImpl : public BucketManager
     Application& mApp;
     BucketList mBucketList;
     std::unique_ptr<TmpDir> mWorkDir;
-    std::map<Hash, std::shared_ptr<Bucket>> mSharedBuckets;
+    std::unordered_map<Hash, std::shared_ptr<Bucket>> mSharedBuckets;
+    std::unordered_map<Hash, int> mRetainedBuckets;
     mutable std::recursive_mutex mBucketMutex;
     std::unique_ptr<std::string> mLockedBucketDir;
     medida::Meter& mBucketObjectInsert;
@@ -48,6 +50,7 @@ class BucketManagerImpl : public BucketManager
 
     std::set<Hash> getReferencedBuckets() const;
     void cleanupStaleFiles();
+    void syncBucketDir();
 
   protected:
     void calculateSkipValues(LedgerHeader& currentHeader);
@@ -61,6 +64,8 @@ class BucketManagerImpl : public BucketManager
     std::string const& getBucketDir() override;
     BucketList& getBucketList() override;
     medida::Timer& getMergeTimer() override;
+    bool getFsyncBucketFiles() const override;
+    bool getMergeDirectIO() const override;
     std::shared_ptr<Bucket> adoptFileAsBucket(std::string const& filename,
                                               uint256 const& hash,
                                               size_t nObjects,
@@ -68,6 +73,8 @@ class BucketManagerImpl : public BucketManager
     std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) override;
 
     void forgetUnreferencedBuckets() override;
+    void retainBuckets(std::vector<std::string> const& hashes) override;
+    void releaseBuckets(std::vector<std::string> const& hashes) override;
     void addBatch(Application& app, uint32_t currLedger,
                   std::vector<LedgerEntry> const& liveEntries,
                   std::vector<LedgerKey> const& deadEntries) override;
@@ -34,15 +34,17 @@ randomBucketName(std::string const& tmpDir)
  * hashes them while writing to either destination. Produces a Bucket when done.
  */
 BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
-                                           bool keepDeadEntries)
+                                           bool keepDeadEntries, bool fsync,
+                                           bool directIO)
     : mFilename(randomBucketName(tmpDir))
     , mBuf(nullptr)
     , mHasher(SHA256::create())
     , mKeepDeadEntries(keepDeadEntries)
+    , mFsync(fsync)
 {
     CLOG(TRACE, "Bucket") << "BucketOutputIterator opening file to write: "
                           << mFilename;
-    mOut.open(mFilename);
+    mOut.open(mFilename, false, directIO);
 }
 
 void
@@ -88,7 +90,16 @@ BucketOutputIterator::getBucket(BucketManager& bucketManager)
         mBuf.reset();
     }
 
-    mOut.close();
+    if (mFsync && mObjectsPut != 0)
+    {
+        // the file is about to be renamed into the bucket directory, which
+        // the BucketManager syncs once per batch
+        mOut.durableClose(false);
+    }
+    else
+    {
+        mOut.close();
+    }
     if (mObjectsPut == 0 || mBytesPut == 0)
     {
         assert(mObjectsPut == 0);
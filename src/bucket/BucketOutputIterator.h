@@ -29,9 +29,13 @@ class BucketOutputIterator
     size_t mBytesPut{0};
     size_t mObjectsPut{0};
     bool mKeepDeadEntries{true};
+    bool mFsync{false};
 
   public:
-    BucketOutputIterator(std::string const& tmpDir, bool keepDeadEntries);
+    // With fsync set the file is synced before it is handed to the
+    // BucketManager; directIO is passed on to XDROutputFileStream::open.
+    BucketOutputIterator(std::string const& tmpDir, bool keepDeadEntries,
+                         bool fsync = false, bool directIO = false);
 
     void put(BucketEntry const& e);
 
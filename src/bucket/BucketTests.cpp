@@ -22,6 +22,7 @@
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
+#include "test/Microbench.h"
 #include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Fs.h"
@@ -31,9 +32,16 @@
 #include "util/types.h"
 #include "xdrpp/autocheck.h"
 #include <algorithm>
+#include <chrono>
 #include <future>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace stellar;
+using xdr::operator==;
 
 namespace BucketTests
 {
@@ -83,6 +91,21 @@ countEntries(std::shared_ptr<Bucket> bucket)
     return pair.first + pair.second;
 }
 
+// Drops a bucket's file from the page cache, where the platform allows it,
+// so that a benchmark reads it from disk.
+static void
+evictFromPageCache(std::shared_ptr<Bucket> bucket)
+{
+#ifdef POSIX_FADV_DONTNEED
+    int fd = open(bucket->getFilename().c_str(), O_RDONLY);
+    if (fd != -1)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
+
 void
 checkBucketSizeAndBounds(BucketList& bl, uint32_t ledgerSeq, uint32_t level,
                          bool isCurr)
@@ -596,6 +619,203 @@ TEST_CASE("merging bucket entries", "[bucket]")
     }
 }
 
+TEST_CASE("merging many buckets at once", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    // entries come back in later buckets, changed or deleted, or not at all
+    std::vector<LedgerEntry> pool =
+        LedgerTestUtils::generateValidLedgerEntries(300);
+    autocheck::generator<uint8_t> pick;
+    std::vector<std::shared_ptr<Bucket>> buckets;
+    for (uint32_t ledger = 1; ledger <= 5; ++ledger)
+    {
+        std::vector<LedgerEntry> live;
+        std::vector<LedgerKey> dead;
+        for (auto const& e : pool)
+        {
+            auto p = pick() % 4;
+            if (p == 0)
+            {
+                live.emplace_back(e);
+                live.back().lastModifiedLedgerSeq = ledger;
+            }
+            else if (p == 1)
+            {
+                dead.emplace_back(LedgerEntryKey(e));
+            }
+        }
+        buckets.emplace_back(Bucket::fresh(bm, live, dead));
+    }
+    buckets.emplace_back(std::make_shared<Bucket>());
+
+    // the same as merging them two at a time, oldest first
+    auto folded = buckets.front();
+    for (size_t i = 1; i < buckets.size(); ++i)
+    {
+        folded = Bucket::merge(bm, folded, buckets[i]);
+    }
+    auto merged = Bucket::mergeAll(
+        bm, std::vector<std::shared_ptr<Bucket const>>(buckets.begin(),
+                                                       buckets.end()));
+    REQUIRE(merged->getHash() == folded->getHash());
+    REQUIRE(Bucket::mergeAll(bm, {})->getHash() == Bucket().getHash());
+}
+
+TEST_CASE("prefetching bucket iterator", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    // several batches' worth, and a last one that is not full
+    std::vector<LedgerEntry> live =
+        LedgerTestUtils::generateValidLedgerEntries(2000);
+    std::vector<LedgerKey> dead;
+    std::shared_ptr<Bucket> b =
+        Bucket::fresh(app->getBucketManager(), live, dead);
+
+    SECTION("reads the same entries as a plain iterator")
+    {
+        BucketInputIterator plain(b);
+        BucketInputIterator prefetching(b, true);
+        size_t n = 0;
+        for (; plain; ++plain, ++prefetching, ++n)
+        {
+            REQUIRE(prefetching);
+            REQUIRE(*plain == *prefetching);
+        }
+        REQUIRE(!prefetching);
+        REQUIRE(n == countEntries(b));
+        ++prefetching;
+        REQUIRE(!prefetching);
+    }
+
+    SECTION("can be dropped part way")
+    {
+        for (size_t stop : {0, 1, 300, 1000})
+        {
+            BucketInputIterator prefetching(b, true);
+            for (size_t i = 0; i < stop && prefetching; ++i)
+            {
+                ++prefetching;
+            }
+            REQUIRE(prefetching);
+        }
+    }
+
+    SECTION("empty bucket")
+    {
+        BucketInputIterator prefetching(std::make_shared<Bucket>(), true);
+        REQUIRE(!prefetching);
+    }
+}
+
+TEST_CASE("bucket index finds every entry", "[bucket][bucketindex]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    // enough entries for several index pages
+    size_t const n = 10 * BucketIndex::kPageSize;
+    std::vector<LedgerEntry> live =
+        LedgerTestUtils::generateValidLedgerEntries(n);
+    std::vector<LedgerKey> dead;
+    std::shared_ptr<Bucket> b =
+        Bucket::fresh(app->getBucketManager(), live, dead);
+    auto const& index = b->getIndex();
+    REQUIRE(index.size() == countEntries(b));
+    REQUIRE(&index == &b->getIndex());
+
+    BucketEntryIdCmp cmp;
+    BucketInputIterator seeker(b);
+    for (BucketInputIterator iter(b); iter; ++iter)
+    {
+        REQUIRE(index.mayContain(*iter));
+        auto offset = index.pageOffset(*iter);
+        REQUIRE(offset >= 0);
+        REQUIRE(offset <= iter.pos());
+        seeker.seek(offset);
+        while (seeker && cmp(*seeker, *iter))
+        {
+            ++seeker;
+        }
+        REQUIRE(seeker);
+        REQUIRE(!cmp(*iter, *seeker));
+    }
+
+    BucketEntry first = *BucketInputIterator(b);
+    BucketEntry smaller;
+    smaller.type(DEADENTRY);
+    smaller.deadEntry().type(ACCOUNT);
+    if (cmp(smaller, first))
+    {
+        REQUIRE(index.pageOffset(smaller) == -1);
+    }
+
+    std::shared_ptr<Bucket> empty = std::make_shared<Bucket>();
+    REQUIRE(empty->getIndex().size() == 0);
+    REQUIRE(!empty->getIndex().mayContain(first));
+}
+
+TEST_CASE("merging with shadows drops exactly the shadowed entries",
+          "[bucket][bucketindex]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+    autocheck::generator<bool> flip;
+
+    std::set<LedgerKey, LedgerEntryIdCmp> keys;
+    std::vector<LedgerEntry> oldLive, newLive, shadowLive;
+    std::vector<LedgerKey> dead;
+    for (auto const& e : LedgerTestUtils::generateValidLedgerEntries(2000))
+    {
+        if (!keys.insert(LedgerEntryKey(e)).second)
+        {
+            continue;
+        }
+        (flip() ? oldLive : newLive).emplace_back(e);
+        if (flip() && flip())
+        {
+            shadowLive.emplace_back(e);
+        }
+    }
+    // unrelated entries that only make the shadow bigger
+    for (auto const& e : LedgerTestUtils::generateValidLedgerEntries(1000))
+    {
+        if (keys.insert(LedgerEntryKey(e)).second)
+        {
+            shadowLive.emplace_back(e);
+        }
+    }
+
+    auto oldBucket = Bucket::fresh(bm, oldLive, dead);
+    auto newBucket = Bucket::fresh(bm, newLive, dead);
+    auto shadow = Bucket::fresh(bm, shadowLive, dead);
+    auto merged = Bucket::merge(bm, oldBucket, newBucket, {shadow});
+
+    size_t shadowed = 0;
+    for (auto const* v : {&oldLive, &newLive})
+    {
+        for (auto const& e : *v)
+        {
+            BucketEntry be;
+            be.type(LIVEENTRY);
+            be.liveEntry() = e;
+            bool inShadow = shadow->containsBucketIdentity(be);
+            shadowed += inShadow ? 1 : 0;
+            CHECK(merged->containsBucketIdentity(be) == !inShadow);
+        }
+    }
+    CHECK(countEntries(merged) == oldLive.size() + newLive.size() - shadowed);
+}
+
 static void
 clearFutures(Application::pointer app, BucketList& bl)
 {
@@ -702,6 +922,42 @@ TEST_CASE("bucketmanager ownership", "[bucket]")
     CHECK(!fs::exists(filename));
 }
 
+TEST_CASE("bucketmanager retains buckets by hash", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    std::vector<LedgerEntry> live(
+        LedgerTestUtils::generateValidLedgerEntries(10));
+    std::vector<LedgerKey> dead{};
+    std::shared_ptr<Bucket> b = Bucket::fresh(bm, live, dead);
+    std::string filename = b->getFilename();
+    std::vector<std::string> hashes{binToHex(b->getHash())};
+
+    // retained twice, as by two publish queue states naming the same bucket
+    bm.retainBuckets(hashes);
+    bm.retainBuckets(hashes);
+    b.reset();
+    bm.forgetUnreferencedBuckets();
+    CHECK(fs::exists(filename));
+
+    bm.releaseBuckets(hashes);
+    bm.forgetUnreferencedBuckets();
+    CHECK(fs::exists(filename));
+
+    bm.releaseBuckets(hashes);
+    bm.forgetUnreferencedBuckets();
+    CHECK(!fs::exists(filename));
+
+    // the same contents come back under the same name straight away, the
+    // forgotten bucket's file having been moved aside before its removal
+    b = Bucket::fresh(bm, live, dead);
+    CHECK(b->getFilename() == filename);
+    CHECK(fs::exists(filename));
+}
+
 TEST_CASE("single entry bubbling up", "[bucket][bucketbubble]")
 {
     VirtualClock clock;
@@ -1143,3 +1399,177 @@ TEST_CASE("bucket apply bench", "[bucketbench][hide]")
     }
 }
 #endif
+
+TEST_CASE("bucket entry microbenchmarks", "[bucket][microbench][bench][hide]")
+{
+    Microbench mb("bucket");
+
+    size_t const n = 1000;
+    auto entries = LedgerTestUtils::generateValidLedgerEntries(n);
+    std::vector<BucketEntry> bucketEntries(n);
+    std::vector<xdr::opaque_vec<>> encoded;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bucketEntries[i].type(LIVEENTRY);
+        bucketEntries[i].liveEntry() = entries[i];
+        encoded.emplace_back(xdr::xdr_to_opaque(bucketEntries[i]));
+    }
+
+    size_t i = 0;
+    mb.run("xdr_to_opaque/BucketEntry", 100000, [&]() {
+        Microbench::keep(xdr::xdr_to_opaque(bucketEntries[i++ % n]));
+    });
+    BucketEntry decoded;
+    mb.run("xdr_from_opaque/BucketEntry", 100000, [&]() {
+        xdr::xdr_from_opaque(encoded[i++ % n], decoded);
+        Microbench::keep(decoded);
+    });
+
+    // compare neighbours, so that most comparisons are between entries of
+    // the same type and have to look at the keys
+    std::sort(entries.begin(), entries.end(), LedgerEntryIdCmp{});
+    std::sort(bucketEntries.begin(), bucketEntries.end(), BucketEntryIdCmp{});
+    mb.run("LedgerEntryIdCmp", 1000000, [&]() {
+        auto j = i++ % (n - 1);
+        Microbench::keep(LedgerEntryIdCmp{}(entries[j], entries[j + 1]));
+    });
+    mb.run("BucketEntryIdCmp", 1000000, [&]() {
+        auto j = i++ % (n - 1);
+        Microbench::keep(
+            BucketEntryIdCmp{}(bucketEntries[j], bucketEntries[j + 1]));
+    });
+}
+
+TEST_CASE("bucket registry microbenchmarks",
+          "[bucket][microbench][bench][hide]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+    Microbench mb("bucket-registry", 1, 5);
+
+    // a bucket directory far larger than a BucketList ever holds at once,
+    // everything still in use
+    size_t const n = 20000;
+    std::vector<LedgerKey> dead{};
+    std::vector<std::shared_ptr<Bucket>> held;
+    std::vector<Hash> hashes;
+    size_t filenameBytes = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        held.emplace_back(Bucket::fresh(
+            bm, LedgerTestUtils::generateValidLedgerEntries(1), dead));
+        hashes.emplace_back(held.back()->getHash());
+        filenameBytes += held.back()->getFilename().capacity();
+    }
+
+    // what the registry itself costs per bucket: the Bucket object, its
+    // filename and a hash table node
+    size_t perBucket = sizeof(Bucket) + sizeof(std::shared_ptr<Bucket>) +
+                       sizeof(Hash) + 2 * sizeof(void*);
+    CLOG(INFO, "Bucket") << "Registry of " << n << " buckets: about "
+                         << (n * perBucket + filenameBytes) / 1024 << " KiB";
+
+    // the per-ledger cost, when nothing is to be dropped
+    mb.run("forgetUnreferencedBuckets/20000 held", 10,
+           [&]() { bm.forgetUnreferencedBuckets(); });
+
+    size_t i = 0;
+    mb.run("getBucketByHash/20000 held", 100000, [&]() {
+        Microbench::keep(bm.getBucketByHash(hashes[i++ % n]));
+    });
+
+    // and when a few buckets a ledger fall out of use, as at a spill
+    mb.run("forgetUnreferencedBuckets/drop 4", 1, [&]() {
+        for (int k = 0; k < 4 && !held.empty(); ++k)
+        {
+            held.pop_back();
+        }
+        bm.forgetUnreferencedBuckets();
+    });
+}
+
+TEST_CASE("bucket merge microbenchmarks", "[bucket][microbench][bench][hide]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+    Microbench mb("bucket-merge", 1, 5);
+
+    // a mid-level merge against the larger buckets above it, roughly in the
+    // proportions of a BucketList a few levels deep
+    std::vector<LedgerKey> dead;
+    auto makeBucket = [&](size_t n) {
+        return Bucket::fresh(
+            bm, LedgerTestUtils::generateValidLedgerEntries(n), dead);
+    };
+    auto oldBucket = makeBucket(4000);
+    auto newBucket = makeBucket(1000);
+    std::vector<std::shared_ptr<Bucket>> shadows{
+        makeBucket(1000), makeBucket(4000), makeBucket(16000),
+        makeBucket(64000)};
+
+    for (auto const& s : shadows)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto const& index = s->getIndex();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        CLOG(INFO, "Bucket")
+            << "Index of " << index.size() << " entries: "
+            << index.memoryBytes() / 1024 << " KiB, built in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+                   .count()
+            << " ms";
+    }
+
+    mb.run("merge/no shadows", 1, [&]() {
+        Microbench::keep(Bucket::merge(bm, oldBucket, newBucket));
+    });
+    mb.run("merge/4 shadows", 1, [&]() {
+        Microbench::keep(Bucket::merge(bm, oldBucket, newBucket, shadows));
+    });
+}
+
+TEST_CASE("bucket read-ahead microbenchmarks",
+          "[bucket][microbench][bench][hide]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+    Microbench mb("bucket-readahead", 1, 5);
+
+    // inputs the size of a merge a few levels down, and read from disk each
+    // time: the cache is dropped at the start of every timed run
+    std::vector<LedgerKey> dead;
+    auto oldBucket = Bucket::fresh(
+        bm, LedgerTestUtils::generateValidLedgerEntries(100000), dead);
+    auto newBucket = Bucket::fresh(
+        bm, LedgerTestUtils::generateValidLedgerEntries(25000), dead);
+
+    // a consumer with work of its own per entry, as a merge has
+    auto consume = [&](bool prefetch) {
+        evictFromPageCache(oldBucket);
+        auto hasher = SHA256::create();
+        for (BucketInputIterator iter(oldBucket, prefetch); iter; ++iter)
+        {
+            hasher->add(xdr::xdr_to_opaque(*iter));
+        }
+        Microbench::keep(hasher->finish());
+    };
+    mb.run("read+hash/cold", 1, [&]() { consume(false); });
+    mb.run("read+hash/cold prefetch", 1, [&]() { consume(true); });
+
+    mb.run("merge/cold", 1, [&]() {
+        evictFromPageCache(oldBucket);
+        evictFromPageCache(newBucket);
+        Microbench::keep(Bucket::merge(bm, oldBucket, newBucket));
+    });
+
+    mb.run("apply/cold", 1, [&]() {
+        evictFromPageCache(newBucket);
+        newBucket->apply(app->getDatabase());
+    });
+}
@@ -341,4 +341,28 @@ FutureBucket::getHashes() const
     }
     return hashes;
 }
+
+std::string
+FutureBucket::getCompletedOutputHash() const
+{
+    assert(isMerging());
+    assert(mergeComplete());
+    return binToHex(mOutputBucket.get()->getHash());
+}
+
+bool
+FutureBucket::adoptOutputHash(std::vector<std::string> const& inputHashes,
+                              std::string const& outputHash)
+{
+    checkState();
+    if (mState != FB_HASH_INPUTS || getHashes() != inputHashes)
+    {
+        return false;
+    }
+    clearInputs();
+    mOutputBucketHash = outputHash;
+    mState = FB_HASH_OUTPUT;
+    checkState();
+    return true;
+}
 }
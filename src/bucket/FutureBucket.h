@@ -120,6 +120,17 @@ class FutureBucket
     // Return all hashes referenced by this future.
     std::vector<std::string> getHashes() const;
 
+    // Precondition: isMerging() and mergeComplete(); returns the hash of the
+    // merged bucket without resolving the merge.
+    std::string getCompletedOutputHash() const;
+
+    // If this future is in FB_HASH_INPUTS state with exactly `inputHashes`
+    // (as returned by getHashes()), transitions it to FB_HASH_OUTPUT with
+    // `outputHash`: the result of that merge from an earlier run, so that
+    // makeLive doesn't redo it. Returns whether it did.
+    bool adoptOutputHash(std::vector<std::string> const& inputHashes,
+                         std::string const& outputHash);
+
     template <class Archive>
     void
     load(Archive& ar)
@@ -18,10 +18,12 @@
 #include "ledger/OfferFrame.h"
 #include "ledger/TrustFrame.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "util/format.h"
 #include "util/make_unique.h"
 #include <medida/meter.h>
 #include <medida/metrics_registry.h>
+#include <thread>
 
 namespace stellar
 {
@@ -35,6 +37,9 @@ ApplyBucketsWork::ApplyBucketsWork(
     , mApplyState(applyState)
     , mApplying(false)
     , mLevel(BucketList::kNumLevels - 1)
+    , mMerging(false)
+    , mMergeFromSnap(false)
+    , mApplyingShards(false)
     , mBucketApplyStart(app.getMetrics().NewMeter(
           {"history", "bucket-apply", "start"}, "event"))
     , mBucketApplySuccess(app.getMetrics().NewMeter(
@@ -46,6 +51,7 @@ ApplyBucketsWork::ApplyBucketsWork(
 
 ApplyBucketsWork::~ApplyBucketsWork()
 {
+    cancelShards();
     clearChildren();
 }
 
@@ -75,11 +81,184 @@ ApplyBucketsWork::onReset()
     mCurrBucket.reset();
     mSnapApplicator.reset();
     mCurrApplicator.reset();
+    mMerging = false;
+    mMergeFromSnap = false;
+    mMergedBucket.reset();
+    mMergedApplicator.reset();
+    cancelShards();
+    mApplyingShards = false;
+}
+
+void
+ApplyBucketsWork::deleteEntriesModifiedOnOrAfter(uint32_t oldestLedger)
+{
+    AccountFrame::deleteAccountsModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                        oldestLedger);
+    TrustFrame::deleteTrustLinesModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                        oldestLedger);
+    OfferFrame::deleteOffersModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                    oldestLedger);
+    DataFrame::deleteDataModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                 oldestLedger);
+}
+
+void
+ApplyBucketsWork::startMerge()
+{
+    // Everything from the oldest bucket that differs on, up to level 0's
+    // curr, is applied, so that is what gets merged, oldest first.
+    std::vector<std::shared_ptr<Bucket const>> buckets;
+    for (uint32_t n = BucketList::kNumLevels; n-- != 0;)
+    {
+        auto& level = getBucketLevel(n);
+        HistoryStateBucket const& i = mApplyState.currentBuckets.at(n);
+        bool applySnap = !buckets.empty() ||
+                         i.snap != binToHex(level.getSnap()->getHash());
+        bool applyCurr =
+            applySnap || i.curr != binToHex(level.getCurr()->getHash());
+        if (buckets.empty() && applyCurr)
+        {
+            mLevel = n;
+            mMergeFromSnap = applySnap;
+        }
+        if (applySnap)
+        {
+            buckets.emplace_back(getBucket(i.snap));
+        }
+        if (applyCurr)
+        {
+            buckets.emplace_back(getBucket(i.curr));
+        }
+    }
+
+    if (buckets.empty())
+    {
+        CLOG(DEBUG, "History") << "ApplyBuckets : nothing to apply";
+        mLevel = 0;
+        return;
+    }
+
+    deleteEntriesModifiedOnOrAfter(
+        mMergeFromSnap
+            ? BucketList::oldestLedgerInSnap(mApplyState.currentLedger, mLevel)
+            : BucketList::oldestLedgerInCurr(mApplyState.currentLedger,
+                                             mLevel));
+
+    CLOG(INFO, "History") << "ApplyBuckets : merging " << buckets.size()
+                          << " buckets, from level[" << mLevel << "]."
+                          << (mMergeFromSnap ? "snap" : "curr");
+    mMerging = true;
+    mBucketApplyStart.Mark();
+
+    std::weak_ptr<ApplyBucketsWork> weak(
+        std::static_pointer_cast<ApplyBucketsWork>(shared_from_this()));
+    auto handler = callComplete();
+    Application& app = mApp;
+    app.getWorkerIOService().post([&app, weak, handler, buckets]() {
+        asio::error_code ec;
+        std::shared_ptr<Bucket const> merged;
+        try
+        {
+            merged = Bucket::mergeAll(app.getBucketManager(), buckets);
+        }
+        catch (std::exception& e)
+        {
+            CLOG(WARNING, "History")
+                << "Failed to merge buckets to apply: " << e.what();
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        app.getClock().getIOService().post([weak, handler, merged, ec]() {
+            auto self = weak.lock();
+            if (self)
+            {
+                self->mMergedBucket = merged;
+            }
+            handler(ec);
+        });
+    });
+}
+
+void
+ApplyBucketsWork::startShardedApply()
+{
+    auto& db = mApp.getDatabase();
+    // creating the pool is not thread-safe, make sure it exists before the
+    // shards start leasing sessions from it
+    auto& pool = db.getPool();
+    bool inlineSigners = db.inlineAccountSigners();
+    size_t shardCount = std::max(1U, std::thread::hardware_concurrency());
+
+    CLOG(DEBUG, "History") << "ApplyBuckets : applying merged bucket "
+                           << binToHex(mMergedBucket->getHash()) << " in "
+                           << shardCount << " shards";
+    mApplyingShards = true;
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    mShardsCancelled = cancelled;
+
+    auto remaining = std::make_shared<std::atomic<size_t>>(shardCount);
+    auto failed = std::make_shared<std::atomic<bool>>(false);
+    auto handler = callComplete();
+    auto bucket = mMergedBucket;
+    Application& app = mApp;
+    for (size_t shard = 0; shard < shardCount; ++shard)
+    {
+        app.getWorkerIOService().post([&app, &pool, inlineSigners, bucket,
+                                       shard, shardCount, cancelled,
+                                       remaining, failed, handler]() {
+            try
+            {
+                soci::session sess(pool);
+                BucketShardApplicator applicator(sess, inlineSigners, bucket,
+                                                 shard, shardCount);
+                while (applicator && !*cancelled && !*failed)
+                {
+                    applicator.advance();
+                }
+            }
+            catch (std::exception& e)
+            {
+                CLOG(WARNING, "History") << "Failed to apply bucket shard "
+                                         << shard << ": " << e.what();
+                *failed = true;
+            }
+            if (--*remaining != 0)
+            {
+                return;
+            }
+            asio::error_code ec;
+            if (*failed)
+            {
+                ec = std::make_error_code(std::errc::io_error);
+            }
+            app.getClock().getIOService().post([cancelled, handler, ec]() {
+                if (!*cancelled)
+                {
+                    handler(ec);
+                }
+            });
+        });
+    }
+}
+
+void
+ApplyBucketsWork::cancelShards()
+{
+    if (mShardsCancelled)
+    {
+        *mShardsCancelled = true;
+        mShardsCancelled.reset();
+    }
 }
 
 void
 ApplyBucketsWork::onStart()
 {
+    if (mApp.getConfig().CATCHUP_MERGE_BUCKETS)
+    {
+        startMerge();
+        return;
+    }
+
     auto& level = getBucketLevel(mLevel);
     HistoryStateBucket const& i = mApplyState.currentBuckets.at(mLevel);
 
@@ -92,14 +271,7 @@ ApplyBucketsWork::onStart()
                                           mApplyState.currentLedger, mLevel)
                                     : BucketList::oldestLedgerInCurr(
                                           mApplyState.currentLedger, mLevel);
-        AccountFrame::deleteAccountsModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                            oldestLedger);
-        TrustFrame::deleteTrustLinesModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                            oldestLedger);
-        OfferFrame::deleteOffersModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                        oldestLedger);
-        DataFrame::deleteDataModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                     oldestLedger);
+        deleteEntriesModifiedOnOrAfter(oldestLedger);
     }
 
     if (mApplying || applySnap)
@@ -127,6 +299,22 @@ ApplyBucketsWork::onStart()
 void
 ApplyBucketsWork::onRun()
 {
+    if (mMerging || mApplyingShards)
+    {
+        // Do nothing: the merge spawned in onStart(), or the shards applying
+        // its result, complete this work.
+        return;
+    }
+    if (mMergedApplicator)
+    {
+        if (*mMergedApplicator)
+        {
+            mMergedApplicator->advance();
+        }
+        scheduleSuccess();
+        return;
+    }
+
     // The structure of these if statements is motivated by the following:
     // 1. mCurrApplicator should never be advanced if mSnapApplicator is
     //    not false. Otherwise it is possible for curr to modify the
@@ -155,6 +343,44 @@ ApplyBucketsWork::onSuccess()
 {
     mApp.getCatchupManager().logAndUpdateCatchupStatus(true);
 
+    if (mMerging)
+    {
+        mMerging = false;
+        // SQLite takes one writer at a time, so only Postgres gets shards
+        if (!mApp.getDatabase().isSqlite())
+        {
+            startShardedApply();
+            return WORK_RUNNING;
+        }
+        mMergedApplicator =
+            make_unique<BucketApplicator>(mApp.getDatabase(), mMergedBucket);
+        CLOG(DEBUG, "History") << "ApplyBuckets : applying merged bucket "
+                               << binToHex(mMergedBucket->getHash());
+        return WORK_RUNNING;
+    }
+    if (mMergedBucket)
+    {
+        if (mMergedApplicator && *mMergedApplicator)
+        {
+            return WORK_RUNNING;
+        }
+        if (mApplyingShards)
+        {
+            // the shards wrote around the main session's entry cache and
+            // inflation vote tally
+            mApplyingShards = false;
+            mShardsCancelled.reset();
+            mApp.getDatabase().getEntryCache().clear();
+            AccountFrame::rebuildInflationVotes(mApp.getDatabase());
+        }
+        mApp.getInvariantManager().checkOnMergedBucketApply(
+            mMergedBucket, mApplyState.currentLedger, mLevel, mMergeFromSnap);
+        mMergedApplicator.reset();
+        mMergedBucket.reset();
+        mBucketApplySuccess.Mark();
+        mLevel = 0;
+    }
+
     if (mSnapApplicator)
     {
         if (*mSnapApplicator)
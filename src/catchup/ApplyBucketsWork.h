@@ -5,6 +5,7 @@
 #pragma once
 
 #include "work/Work.h"
+#include <atomic>
 
 namespace medida
 {
@@ -33,12 +34,30 @@ class ApplyBucketsWork : public Work
     std::unique_ptr<BucketApplicator> mSnapApplicator;
     std::unique_ptr<BucketApplicator> mCurrApplicator;
 
+    // With Config::CATCHUP_MERGE_BUCKETS, the buckets from mLevel's snap (or
+    // curr, if !mMergeFromSnap) up to level 0's curr are merged into
+    // mMergedBucket, which is then applied in their place.
+    bool mMerging;
+    bool mMergeFromSnap;
+    std::shared_ptr<Bucket const> mMergedBucket;
+    std::unique_ptr<BucketApplicator> mMergedApplicator;
+
+    // On Postgres, mMergedBucket is applied in shards by key hash, each
+    // through its own session of the connection pool on a worker thread.
+    // mShardsCancelled tells the shards of a reset or destroyed work to stop.
+    bool mApplyingShards;
+    std::shared_ptr<std::atomic<bool>> mShardsCancelled;
+
     medida::Meter& mBucketApplyStart;
     medida::Meter& mBucketApplySuccess;
     medida::Meter& mBucketApplyFailure;
 
     std::shared_ptr<Bucket const> getBucket(std::string const& bucketHash);
     BucketLevel& getBucketLevel(uint32_t level);
+    void deleteEntriesModifiedOnOrAfter(uint32_t oldestLedger);
+    void startMerge();
+    void startShardedApply();
+    void cancelShards();
 
   public:
     ApplyBucketsWork(
@@ -6,12 +6,19 @@
 #include "crypto/KeyUtils.h"
 #include "crypto/Random.h"
 #include "crypto/SHA.h"
+#include "crypto/SHA256Block.h"
 #include "crypto/SecretKey.h"
 #include "crypto/StrKey.h"
 #include "lib/catch.hpp"
+#include "test/Microbench.h"
 #include "test/test.h"
+#include "util/HashOfHash.h"
 #include "util/Logging.h"
+#include "util/Math.h"
 #include "util/basen.h"
+#include "util/crc16.h"
+#include "util/format.h"
+#include <algorithm>
 #include <autocheck/autocheck.hpp>
 #include <map>
 #include <regex>
@@ -63,6 +70,35 @@ TEST_CASE("hex tests", "[crypto]")
         20);
 }
 
+TEST_CASE("hex matches libsodium", "[crypto]")
+{
+    for (size_t size = 0; size < 100; ++size)
+    {
+        auto bin = randomBytes(size);
+        std::vector<char> ref(size * 2 + 1);
+        sodium_bin2hex(ref.data(), ref.size(), bin.data(), bin.size());
+        auto hex = binToHex(bin);
+        REQUIRE(hex == std::string(ref.data()));
+
+        std::vector<uint8_t> refBin(size);
+        REQUIRE(sodium_hex2bin(refBin.data(), refBin.size(), hex.data(),
+                               hex.size(), nullptr, nullptr, nullptr) == 0);
+        REQUIRE(hexToBin(hex) == refBin);
+
+        std::string upper(hex);
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        REQUIRE(hexToBin(upper) == refBin);
+
+        if (size != 0)
+        {
+            auto bad = hex;
+            bad[rand_uniform<size_t>(0, bad.size() - 1)] = 'g';
+            REQUIRE_THROWS_AS(hexToBin(bad), std::runtime_error);
+            REQUIRE_THROWS_AS(hexToBin(hex.substr(1)), std::runtime_error);
+        }
+    }
+}
+
 static std::map<std::string, std::string> sha256TestVectors = {
     {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
 
@@ -100,6 +136,99 @@ TEST_CASE("Stateful SHA256 tests", "[crypto]")
     }
 }
 
+TEST_CASE("SHA256 implementations match libsodium", "[crypto]")
+{
+    LOG(INFO) << "SHA256 implementation: " << sha256Implementation();
+
+    // every length around the one- and two-block padding boundaries, and
+    // some longer ones
+    std::vector<std::vector<uint8_t>> msgs;
+    for (size_t size = 0; size < 300; ++size)
+    {
+        msgs.emplace_back(randomBytes(size));
+    }
+    for (size_t i = 0; i < 20; ++i)
+    {
+        msgs.emplace_back(randomBytes(rand_uniform<size_t>(300, 10000)));
+    }
+
+    std::vector<ByteSlice> slices(msgs.begin(), msgs.end());
+    std::vector<uint256> expected;
+    for (auto const& msg : msgs)
+    {
+        uint256 out;
+        crypto_hash_sha256(out.data(), msg.data(), msg.size());
+        expected.emplace_back(out);
+    }
+
+    SECTION("sha256")
+    {
+        for (size_t i = 0; i < msgs.size(); ++i)
+        {
+            REQUIRE(sha256(msgs[i]) == expected[i]);
+        }
+    }
+
+    SECTION("SHA256 fed in random pieces")
+    {
+        auto hasher = SHA256::create();
+        for (size_t i = 0; i < msgs.size(); ++i)
+        {
+            hasher->reset();
+            size_t pos = 0;
+            while (pos < msgs[i].size())
+            {
+                size_t n = std::min(rand_uniform<size_t>(0, 150),
+                                    msgs[i].size() - pos);
+                hasher->add(ByteSlice(msgs[i].data() + pos, n));
+                pos += n;
+            }
+            REQUIRE(hasher->finish() == expected[i]);
+        }
+    }
+
+    SECTION("sha256Batch")
+    {
+        REQUIRE(sha256Batch(slices) == expected);
+        REQUIRE(sha256Batch({}).empty());
+        REQUIRE(sha256Batch({slices[3]}) == std::vector<uint256>{expected[3]});
+    }
+
+    SECTION("SHA-NI")
+    {
+        if (!sha256block::haveShaNi())
+        {
+            LOG(INFO) << "No SHA-NI on this CPU, skipping";
+            return;
+        }
+        for (size_t i = 0; i < msgs.size(); ++i)
+        {
+            sha256block::ShaNiState state;
+            uint256 out;
+            state.add(msgs[i].data(), msgs[i].size());
+            state.finish(out.data());
+            REQUIRE(out == expected[i]);
+        }
+    }
+
+    SECTION("AVX2 multi-buffer")
+    {
+        if (!sha256block::haveAvx2())
+        {
+            LOG(INFO) << "No AVX2 on this CPU, skipping";
+            return;
+        }
+        // fewer messages than lanes, and lanes finishing out of step
+        for (size_t n : {size_t(1), size_t(7), slices.size()})
+        {
+            std::vector<uint256> out(n);
+            sha256block::hashAvx2x8(slices.data(), n, out.data());
+            REQUIRE(out == std::vector<uint256>(expected.begin(),
+                                                expected.begin() + n));
+        }
+    }
+}
+
 TEST_CASE("HMAC test vector", "[crypto]")
 {
     HmacSha256Key k;
@@ -114,6 +243,32 @@ TEST_CASE("HMAC test vector", "[crypto]")
     REQUIRE(hmacSha256Verify(v, k, s));
 }
 
+TEST_CASE("pre-keyed HMAC matches one-shot HMAC", "[crypto]")
+{
+    HmacSha256Key k;
+    k.key[0] = 'k';
+    k.key[1] = 'e';
+    k.key[2] = 'y';
+    auto keyed = HmacSha256::create(k);
+    auto s = "The quick brown fox jumps over the lazy dog";
+    auto h = hexToBin256(
+        "f7bc83f430538424b13298e6aa6fb143ef4d59a14946175997479dbc2d1a3cd8");
+    // Twice, to check the keyed state is not consumed by the first use.
+    REQUIRE(keyed->mac(s).mac == h);
+    REQUIRE(keyed->mac(s).mac == h);
+    REQUIRE(keyed->verify(hmacSha256(k, s), s));
+
+    for (size_t i = 0; i < 100; ++i)
+    {
+        auto msg = randomBytes(i * 7);
+        auto v = keyed->mac(msg);
+        REQUIRE(v == hmacSha256(k, msg));
+        REQUIRE(keyed->verify(v, msg));
+        v.mac[i % v.mac.size()] ^= 1;
+        REQUIRE(!keyed->verify(v, msg));
+    }
+}
+
 TEST_CASE("HKDF test vector", "[crypto]")
 {
     auto ikm = hexToBin("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b");
@@ -207,6 +362,91 @@ TEST_CASE("sign and verify benchmarking", "[crypto-bench][bench][hide]")
     }
 }
 
+TEST_CASE("crypto microbenchmarks", "[crypto][microbench][bench][hide]")
+{
+    Microbench mb("crypto");
+
+    // hashes and ids, transaction-sized blobs and bucket IO buffers
+    for (size_t size : {32, 256, 4096})
+    {
+        auto bytes = randomBytes(size);
+        mb.run(fmt::format("sha256/{}B", size), 10000,
+               [&]() { Microbench::keep(sha256(bytes)); });
+    }
+    {
+        auto bytes = randomBytes(4096);
+        auto hasher = SHA256::create();
+        mb.run("SHA256::add/4096B-in-128B", 10000, [&]() {
+            for (size_t i = 0; i < bytes.size(); i += 128)
+            {
+                hasher->add(ByteSlice(bytes.data() + i, 128));
+            }
+        });
+        Microbench::keep(hasher->finish());
+    }
+    {
+        // bucket-file sized input, fed the way the XDR streams feed it
+        auto bytes = randomBytes(1 << 20);
+        auto hasher = SHA256::create();
+        mb.run("SHA256::add/1MiB-in-64KiB", 100, [&]() {
+            hasher->reset();
+            for (size_t i = 0; i < bytes.size(); i += 65536)
+            {
+                hasher->add(ByteSlice(bytes.data() + i, 65536));
+            }
+            Microbench::keep(hasher->finish());
+        });
+    }
+    {
+        // a txset's worth of envelope-sized messages
+        std::vector<std::vector<uint8_t>> msgs;
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            msgs.emplace_back(randomBytes(rand_uniform<size_t>(150, 400)));
+        }
+        std::vector<ByteSlice> slices(msgs.begin(), msgs.end());
+        mb.run("sha256/1000-envelopes", 100, [&]() {
+            for (auto const& msg : slices)
+            {
+                Microbench::keep(sha256(msg));
+            }
+        });
+        mb.run("sha256Batch/1000-envelopes", 100,
+               [&]() { Microbench::keep(sha256Batch(slices)); });
+    }
+
+    auto key = SecretKey::random();
+    auto pub = key.getPublicKey();
+    auto msg = randomBytes(256);
+    auto sig = key.sign(msg);
+    mb.run("sign/256B", 1000, [&]() { Microbench::keep(key.sign(msg)); });
+    mb.run("verifySig/256B/uncached", 1000, [&]() {
+        PubKeyUtils::clearVerifySigCache();
+        Microbench::keep(PubKeyUtils::verifySig(pub, sig, msg));
+    });
+    mb.run("verifySig/256B/cached", 100000, [&]() {
+        Microbench::keep(PubKeyUtils::verifySig(pub, sig, msg));
+    });
+
+    auto strKey = KeyUtils::toStrKey(pub);
+    mb.run("KeyUtils::toStrKey", 100000,
+           [&]() { Microbench::keep(KeyUtils::toStrKey(pub)); });
+    mb.run("KeyUtils::fromStrKey", 100000, [&]() {
+        Microbench::keep(KeyUtils::fromStrKey<PublicKey>(strKey));
+    });
+
+    auto hash = sha256(msg);
+    mb.run("binToHex/32B", 100000,
+           [&]() { Microbench::keep(binToHex(hash)); });
+    auto hex = binToHex(hash);
+    mb.run("hexToBin256", 100000,
+           [&]() { Microbench::keep(hexToBin256(hex)); });
+    mb.run("bn::encode_b64/256B", 100000,
+           [&]() { Microbench::keep(bn::encode_b64(msg)); });
+    mb.run("HashOfHash", 1000000,
+           [&]() { Microbench::keep(std::hash<uint256>()(hash)); });
+}
+
 TEST_CASE("StrKey tests", "[crypto]")
 {
     std::regex b32("^([A-Z2-7])+$");
@@ -325,6 +565,41 @@ TEST_CASE("StrKey tests", "[crypto]")
     REQUIRE(detectionRate > 98.0);
 }
 
+TEST_CASE("StrKey matches generic base32", "[crypto]")
+{
+    for (size_t size = 0; size < 70; ++size)
+    {
+        uint8_t version = static_cast<uint8_t>(rand_uniform(0, 31));
+        auto bin = randomBytes(size);
+
+        std::vector<uint8_t> ref;
+        ref.push_back(static_cast<uint8_t>(version << 3));
+        ref.insert(ref.end(), bin.begin(), bin.end());
+        uint16_t crc = crc16((char*)ref.data(), (int)ref.size());
+        ref.push_back(static_cast<uint8_t>(crc & 0xFF));
+        ref.push_back(static_cast<uint8_t>(crc >> 8));
+        auto refStr = bn::encode_b32(ref);
+
+        auto str = strKey::toStrKey(version, bin).value;
+        REQUIRE(str == refStr);
+
+        uint8_t outVersion;
+        std::vector<uint8_t> decoded;
+        REQUIRE(strKey::fromStrKey(str, outVersion, decoded));
+        REQUIRE(outVersion == version);
+        REQUIRE(decoded == bin);
+
+        // characters the generic decoder skips over must still be skipped,
+        // whether or not the length is a whole number of groups
+        for (auto const& padded : {" " + str + "\n", " " + str + "\n      "})
+        {
+            decoded.clear();
+            REQUIRE(strKey::fromStrKey(padded, outVersion, decoded));
+            REQUIRE(decoded == bin);
+        }
+    }
+}
+
 TEST_CASE("base64 tests", "[crypto]")
 {
     autocheck::generator<std::vector<uint8_t>> input;
@@ -3,27 +3,109 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "crypto/Hex.h"
-#include <sodium.h>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// binToHex is behind every EntryFrame cache key and most log lines, so both
+// directions avoid sodium_bin2hex / sodium_hex2bin, which are written to be
+// constant-time rather than fast; nothing encoded here is secret.
 
 namespace stellar
 {
 
+namespace
+{
+
+struct HexTables
+{
+    // "000102...ff": two output characters per input byte
+    char mEncode[512];
+    // value of a hex digit (either case), or -1
+    int8_t mDecode[256];
+
+    HexTables()
+    {
+        static char const digits[] = "0123456789abcdef";
+        for (int i = 0; i < 256; ++i)
+        {
+            mEncode[2 * i] = digits[i >> 4];
+            mEncode[2 * i + 1] = digits[i & 0xf];
+            mDecode[i] = -1;
+        }
+        for (int i = 0; i < 10; ++i)
+        {
+            mDecode['0' + i] = static_cast<int8_t>(i);
+        }
+        for (int i = 0; i < 6; ++i)
+        {
+            mDecode['a' + i] = static_cast<int8_t>(10 + i);
+            mDecode['A' + i] = static_cast<int8_t>(10 + i);
+        }
+    }
+};
+
+HexTables const&
+hexTables()
+{
+    static HexTables const tables;
+    return tables;
+}
+
+#if defined(__SSE2__)
+// SSE2 is part of the x86-64 baseline, so this needs no runtime dispatch.
+// Encodes 16 bytes per iteration; returns how many bytes it handled.
+size_t
+binToHexSSE2(uint8_t const* in, size_t n, char* out)
+{
+    __m128i const lowNibble = _mm_set1_epi8(0x0f);
+    __m128i const nine = _mm_set1_epi8(9);
+    __m128i const zero = _mm_set1_epi8('0');
+    __m128i const letters = _mm_set1_epi8('a' - '0' - 10);
+
+    auto toAscii = [&](__m128i v) {
+        __m128i isLetter = _mm_cmpgt_epi8(v, nine);
+        return _mm_add_epi8(_mm_add_epi8(v, zero),
+                            _mm_and_si128(isLetter, letters));
+    };
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), lowNibble);
+        __m128i lo = _mm_and_si128(v, lowNibble);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i),
+                         toAscii(_mm_unpacklo_epi8(hi, lo)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16),
+                         toAscii(_mm_unpackhi_epi8(hi, lo)));
+    }
+    return i;
+}
+#endif
+}
+
 std::string
 binToHex(ByteSlice const& bin)
 {
-    // NB: C++ standard says we can't go modifying the contents of a std::string
-    // just by const_cast'ing away const on .data(), so we use a vector<char> to
-    // write to.
     if (bin.empty())
         return "";
-    std::vector<char> hex(bin.size() * 2 + 1, '\0');
-    if (sodium_bin2hex(hex.data(), hex.size(), bin.data(), bin.size()) !=
-        hex.data())
+    std::string hex(bin.size() * 2, '\0');
+    auto in = bin.data();
+    auto out = &hex[0];
+    size_t i = 0;
+#if defined(__SSE2__)
+    i = binToHexSSE2(in, bin.size(), out);
+#endif
+    auto const& encode = hexTables().mEncode;
+    for (; i < bin.size(); ++i)
     {
-        throw std::runtime_error(
-            "error in stellar::binToHex(std::vector<uint8_t>)");
+        memcpy(out + 2 * i, encode + 2 * in[i], 2);
     }
-    return std::string(hex.begin(), hex.end() - 1);
+    return hex;
 }
 
 std::string
@@ -40,12 +122,24 @@ hexAbbrev(ByteSlice const& bin)
 std::vector<uint8_t>
 hexToBin(std::string const& hex)
 {
-    std::vector<uint8_t> bin(hex.size() / 2, 0);
-    if (sodium_hex2bin(bin.data(), bin.size(), hex.data(), hex.size(), NULL,
-                       NULL, NULL) != 0)
+    if (hex.size() % 2 != 0)
     {
         throw std::runtime_error("error in stellar::hexToBin(std::string)");
     }
+    std::vector<uint8_t> bin(hex.size() / 2, 0);
+    auto in = reinterpret_cast<uint8_t const*>(hex.data());
+    auto const& decode = hexTables().mDecode;
+    for (size_t i = 0; i < bin.size(); ++i)
+    {
+        int hi = decode[in[2 * i]];
+        int lo = decode[in[2 * i + 1]];
+        if ((hi | lo) < 0)
+        {
+            throw std::runtime_error(
+                "error in stellar::hexToBin(std::string)");
+        }
+        bin[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
     return bin;
 }
 
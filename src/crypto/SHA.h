@@ -7,6 +7,7 @@
 #include "crypto/ByteSlice.h"
 #include "xdr/Stellar-types.h"
 #include <memory>
+#include <vector>
 
 namespace stellar
 {
@@ -14,6 +15,14 @@ namespace stellar
 // Plain SHA256
 uint256 sha256(ByteSlice const& bin);
 
+// SHA256 of each of a batch of independent messages, in input order. Worth
+// using over a loop of sha256() when there are many short messages, as it
+// can hash several of them at once in the lanes of vector registers.
+std::vector<uint256> sha256Batch(std::vector<ByteSlice> const& bins);
+
+// Which implementation sha256() and SHA256 picked for this CPU, for logs.
+char const* sha256Implementation();
+
 // SHA256 in incremental mode, for large inputs.
 class SHA256
 {
@@ -28,6 +37,20 @@ class SHA256
 // HMAC-SHA256 (keyed)
 HmacSha256Mac hmacSha256(HmacSha256Key const& key, ByteSlice const& bin);
 
+// HMAC-SHA256 with the inner and outer key pads absorbed once, at creation.
+// Each mac/verify call then only copies the pre-keyed state, so this is the
+// one to hold on to when many messages are MAC'ed under the same key.
+class HmacSha256
+{
+  public:
+    static std::unique_ptr<HmacSha256> create(HmacSha256Key const& key);
+    virtual ~HmacSha256(){};
+    virtual HmacSha256Mac mac(ByteSlice const& bin) const = 0;
+    // Constant-time comparison, like hmacSha256Verify.
+    virtual bool verify(HmacSha256Mac const& hmac,
+                        ByteSlice const& bin) const = 0;
+};
+
 // Use this rather than HMAC-output ==, to avoid timing leaks.
 bool hmacSha256Verify(HmacSha256Mac const& hmac, HmacSha256Key const& key,
                       ByteSlice const& bin);
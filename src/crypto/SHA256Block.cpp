@@ -0,0 +1,436 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SHA256Block.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define STELLAR_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace stellar
+{
+namespace sha256block
+{
+
+namespace
+{
+
+uint32_t const kInitialState[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                   0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                   0x1f83d9ab, 0x5be0cd19};
+
+uint32_t const kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#ifdef STELLAR_SHA256_X86
+
+uint32_t
+loadBigEndian32(uint8_t const* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+           (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+void
+storeBigEndian32(uint8_t* p, uint32_t v)
+{
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+}
+
+// Writes the 0x80 terminator, zero fill and 64-bit bit length that follow
+// a message of totalBytes bytes whose last tailLen bytes are already at the
+// start of tail. Returns the number of bytes of tail in use: 64 or 128.
+size_t
+padTail(uint8_t* tail, size_t tailLen, uint64_t totalBytes)
+{
+    size_t padded = (tailLen + 9 <= 64) ? 64 : 128;
+    tail[tailLen] = 0x80;
+    std::memset(tail + tailLen + 1, 0, padded - tailLen - 9);
+    uint64_t bits = totalBytes * 8;
+    storeBigEndian32(tail + padded - 8, uint32_t(bits >> 32));
+    storeBigEndian32(tail + padded - 4, uint32_t(bits));
+    return padded;
+}
+
+struct CpuFeatures
+{
+    bool mShaNi = false;
+    bool mAvx2 = false;
+
+    CpuFeatures()
+    {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        {
+            return;
+        }
+        bool ssse3 = (ecx & (1u << 9)) != 0;
+        bool sse41 = (ecx & (1u << 19)) != 0;
+        bool osxsave = (ecx & (1u << 27)) != 0;
+        bool avx = (ecx & (1u << 28)) != 0;
+
+        // the OS has to save the YMM registers on context switch as well
+        bool ymmEnabled = false;
+        if (osxsave && avx)
+        {
+            uint32_t xcr0Lo, xcr0Hi;
+            __asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+            ymmEnabled = (xcr0Lo & 0x6) == 0x6;
+        }
+
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        {
+            return;
+        }
+        mShaNi = ssse3 && sse41 && (ebx & (1u << 29)) != 0;
+        mAvx2 = ymmEnabled && (ebx & (1u << 5)) != 0;
+    }
+};
+
+CpuFeatures const&
+cpuFeatures()
+{
+    static CpuFeatures const features;
+    return features;
+}
+
+// Intel's SHA extensions keep the state as ABEF/CDGH register pairs and do
+// two rounds per sha256rnds2; the message schedule for the next four words
+// comes from sha256msg1/sha256msg2 over the previous sixteen.
+__attribute__((target("sha,sse4.1"))) void
+compressShaNi(uint32_t* h, uint8_t const* data, size_t nblocks)
+{
+    __m128i const byteSwap =
+        _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<__m128i const*>(h));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(h + 4));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; nblocks != 0; --nblocks, data += 64)
+    {
+        __m128i const abefSave = state0;
+        __m128i const cdghSave = state1;
+        __m128i w[4];
+
+        for (int i = 0; i < 16; ++i)
+        {
+            __m128i& wi = w[i & 3];
+            if (i < 4)
+            {
+                wi = _mm_shuffle_epi8(
+                    _mm_loadu_si128(
+                        reinterpret_cast<__m128i const*>(data + 16 * i)),
+                    byteSwap);
+            }
+            else
+            {
+                __m128i const& w1 = w[(i - 1) & 3];
+                __m128i const& w2 = w[(i - 2) & 3];
+                __m128i x = _mm_sha256msg1_epu32(wi, w[(i - 3) & 3]);
+                x = _mm_add_epi32(x, _mm_alignr_epi8(w1, w2, 4));
+                wi = _mm_sha256msg2_epu32(x, w1);
+            }
+            __m128i msg = _mm_add_epi32(
+                wi, _mm_loadu_si128(reinterpret_cast<__m128i const*>(
+                        kRoundConstants + 4 * i)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h + 4), state1);
+}
+
+template <int N>
+__attribute__((target("avx2"))) inline __m256i
+rotr(__m256i x)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, N),
+                           _mm256_slli_epi32(x, 32 - N));
+}
+
+__attribute__((target("avx2"))) inline __m256i
+add3(__m256i a, __m256i b, __m256i c)
+{
+    return _mm256_add_epi32(_mm256_add_epi32(a, b), c);
+}
+
+// One block for each of eight independent messages; word j of lane i's
+// state lives at state[j][i], so each state word loads as one register.
+__attribute__((target("avx2"))) void
+compressAvx2x8(uint32_t (*state)[8], uint8_t const* const* blocks)
+{
+    __m256i s[8];
+    for (int j = 0; j < 8; ++j)
+    {
+        s[j] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(state[j]));
+    }
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+    __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+    __m256i w[16];
+    for (int t = 0; t < 64; ++t)
+    {
+        __m256i& wt = w[t & 15];
+        if (t < 16)
+        {
+            wt = _mm256_setr_epi32(
+                loadBigEndian32(blocks[0] + 4 * t),
+                loadBigEndian32(blocks[1] + 4 * t),
+                loadBigEndian32(blocks[2] + 4 * t),
+                loadBigEndian32(blocks[3] + 4 * t),
+                loadBigEndian32(blocks[4] + 4 * t),
+                loadBigEndian32(blocks[5] + 4 * t),
+                loadBigEndian32(blocks[6] + 4 * t),
+                loadBigEndian32(blocks[7] + 4 * t));
+        }
+        else
+        {
+            __m256i const w15 = w[(t - 15) & 15];
+            __m256i const w2 = w[(t - 2) & 15];
+            __m256i sigma0 = _mm256_xor_si256(
+                _mm256_xor_si256(rotr<7>(w15), rotr<18>(w15)),
+                _mm256_srli_epi32(w15, 3));
+            __m256i sigma1 = _mm256_xor_si256(
+                _mm256_xor_si256(rotr<17>(w2), rotr<19>(w2)),
+                _mm256_srli_epi32(w2, 10));
+            wt = _mm256_add_epi32(add3(wt, sigma0, w[(t - 7) & 15]), sigma1);
+        }
+
+        __m256i bigSigma1 = _mm256_xor_si256(
+            _mm256_xor_si256(rotr<6>(e), rotr<11>(e)), rotr<25>(e));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f),
+                                      _mm256_andnot_si256(e, g));
+        __m256i t1 =
+            add3(add3(h, bigSigma1, ch),
+                 _mm256_set1_epi32(static_cast<int>(kRoundConstants[t])), wt);
+        __m256i bigSigma0 = _mm256_xor_si256(
+            _mm256_xor_si256(rotr<2>(a), rotr<13>(a)), rotr<22>(a));
+        __m256i maj = _mm256_xor_si256(
+            _mm256_and_si256(a, b),
+            _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+        __m256i t2 = _mm256_add_epi32(bigSigma0, maj);
+
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i const out[8] = {a, b, c, d, e, f, g, h};
+    for (int j = 0; j < 8; ++j)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[j]),
+                            _mm256_add_epi32(s[j], out[j]));
+    }
+}
+
+#endif
+}
+
+bool
+haveShaNi()
+{
+#ifdef STELLAR_SHA256_X86
+    return cpuFeatures().mShaNi;
+#else
+    return false;
+#endif
+}
+
+bool
+haveAvx2()
+{
+#ifdef STELLAR_SHA256_X86
+    return cpuFeatures().mAvx2;
+#else
+    return false;
+#endif
+}
+
+ShaNiState::ShaNiState()
+{
+    reset();
+}
+
+void
+ShaNiState::reset()
+{
+    std::memcpy(mH, kInitialState, sizeof(mH));
+    mBufLen = 0;
+    mTotal = 0;
+}
+
+void
+ShaNiState::add(uint8_t const* data, size_t size)
+{
+#ifdef STELLAR_SHA256_X86
+    mTotal += size;
+    if (mBufLen != 0)
+    {
+        size_t n = std::min(size, sizeof(mBuf) - mBufLen);
+        std::memcpy(mBuf + mBufLen, data, n);
+        mBufLen += n;
+        data += n;
+        size -= n;
+        if (mBufLen < sizeof(mBuf))
+        {
+            return;
+        }
+        compressShaNi(mH, mBuf, 1);
+        mBufLen = 0;
+    }
+    if (size >= 64)
+    {
+        compressShaNi(mH, data, size / 64);
+        data += size & ~size_t(63);
+        size &= 63;
+    }
+    std::memcpy(mBuf, data, size);
+    mBufLen = size;
+#else
+    throw std::runtime_error("SHA-NI is not available in this build");
+#endif
+}
+
+void
+ShaNiState::finish(uint8_t* out)
+{
+#ifdef STELLAR_SHA256_X86
+    uint8_t tail[128];
+    std::memcpy(tail, mBuf, mBufLen);
+    size_t padded = padTail(tail, mBufLen, mTotal);
+    compressShaNi(mH, tail, padded / 64);
+    for (int j = 0; j < 8; ++j)
+    {
+        storeBigEndian32(out + 4 * j, mH[j]);
+    }
+#else
+    throw std::runtime_error("SHA-NI is not available in this build");
+#endif
+}
+
+void
+hashAvx2x8(ByteSlice const* msgs, size_t n, uint256* out)
+{
+#ifdef STELLAR_SHA256_X86
+    // Each lane walks one message block by block, reading whole blocks in
+    // place and the padded last one or two from its own tail buffer. When a
+    // lane finishes it picks up the next message; idle lanes hash a dummy
+    // block whose result is thrown away.
+    struct Lane
+    {
+        size_t mMsg;
+        size_t mBlock;
+        size_t mFullBlocks;
+        size_t mTotalBlocks;
+        uint8_t mTail[128];
+    };
+
+    Lane lanes[8];
+    bool active[8] = {};
+    uint32_t state[8][8];
+    uint8_t const* blocks[8];
+    static uint8_t const dummy[64] = {};
+    size_t next = 0;
+
+    for (;;)
+    {
+        bool any = false;
+        for (int i = 0; i < 8; ++i)
+        {
+            if (!active[i] && next < n)
+            {
+                Lane& lane = lanes[i];
+                ByteSlice const& msg = msgs[next];
+                lane.mMsg = next++;
+                lane.mBlock = 0;
+                lane.mFullBlocks = msg.size() / 64;
+                size_t tailLen = msg.size() % 64;
+                std::memcpy(lane.mTail, msg.data() + lane.mFullBlocks * 64,
+                            tailLen);
+                lane.mTotalBlocks =
+                    lane.mFullBlocks +
+                    padTail(lane.mTail, tailLen, msg.size()) / 64;
+                for (int j = 0; j < 8; ++j)
+                {
+                    state[j][i] = kInitialState[j];
+                }
+                active[i] = true;
+            }
+            if (active[i])
+            {
+                Lane const& lane = lanes[i];
+                blocks[i] = (lane.mBlock < lane.mFullBlocks)
+                                ? msgs[lane.mMsg].data() + lane.mBlock * 64
+                                : lane.mTail +
+                                      (lane.mBlock - lane.mFullBlocks) * 64;
+                any = true;
+            }
+            else
+            {
+                blocks[i] = dummy;
+            }
+        }
+        if (!any)
+        {
+            break;
+        }
+
+        compressAvx2x8(state, blocks);
+
+        for (int i = 0; i < 8; ++i)
+        {
+            if (active[i] && ++lanes[i].mBlock == lanes[i].mTotalBlocks)
+            {
+                uint8_t* digest = out[lanes[i].mMsg].data();
+                for (int j = 0; j < 8; ++j)
+                {
+                    storeBigEndian32(digest + 4 * j, state[j][i]);
+                }
+                active[i] = false;
+            }
+        }
+    }
+#else
+    throw std::runtime_error("AVX2 is not available in this build");
+#endif
+}
+}
+}
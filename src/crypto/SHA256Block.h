@@ -0,0 +1,48 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/ByteSlice.h"
+#include "xdr/Stellar-types.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace stellar
+{
+
+// CPU-specific SHA256 block functions behind sha256(), SHA256 and
+// sha256Batch() in crypto/SHA.h. Callers outside crypto/ should not need
+// these; they are exposed so the tests can check each path against
+// libsodium regardless of which one the running CPU would pick.
+namespace sha256block
+{
+
+// Feature checks, evaluated once from CPUID. Both are false on non-x86
+// builds and on compilers without the needed intrinsics.
+bool haveShaNi();
+bool haveAvx2();
+
+// Streaming SHA256 on top of the SHA-NI compression function. Only valid
+// to use when haveShaNi() is true.
+class ShaNiState
+{
+    uint32_t mH[8];
+    uint8_t mBuf[64];
+    size_t mBufLen;
+    uint64_t mTotal;
+
+  public:
+    ShaNiState();
+    void reset();
+    void add(uint8_t const* data, size_t size);
+    void finish(uint8_t* out);
+};
+
+// Hashes n independent messages, eight at a time in the lanes of AVX2
+// registers, writing the i-th digest to out[i]. Only valid to use when
+// haveAvx2() is true.
+void hashAvx2x8(ByteSlice const* msgs, size_t n, uint256* out);
+}
+}
@@ -279,6 +279,30 @@ KeyFunctions<PublicKey>::getKeyValue(PublicKey const& key)
     }
 }
 
+std::vector<std::pair<Hash, bool>>
+PubKeyUtils::getVerifySigCacheContents()
+{
+    std::vector<std::pair<Hash, bool>> contents;
+    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
+    contents.reserve(gVerifySigCache.size());
+    gVerifySigCache.for_each([&](Hash const& k, bool v) {
+        contents.emplace_back(k, v);
+    });
+    return contents;
+}
+
+void
+PubKeyUtils::seedVerifySigCache(
+    std::vector<std::pair<Hash, bool>> const& contents)
+{
+    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
+    // insert least recently used first to preserve the order
+    for (auto it = contents.rbegin(); it != contents.rend(); ++it)
+    {
+        gVerifySigCache.put(it->first, it->second);
+    }
+}
+
 bool
 PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
                        ByteSlice const& bin)
@@ -289,18 +313,19 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
         return false;
     }
 
-    auto cacheKey = verifySigCacheKey(key, signature, bin);
-
+    Hash cacheKey;
     {
+        // gHasher is shared as well: this may run on worker threads
         std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
+        cacheKey = verifySigCacheKey(key, signature, bin);
         if (gVerifySigCache.exists(cacheKey))
         {
             ++gVerifyCacheHit;
             return gVerifySigCache.get(cacheKey);
         }
+        ++gVerifyCacheMiss;
     }
 
-    ++gVerifyCacheMiss;
     bool ok =
         (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
                                      key.ed25519().data()) == 0);
@@ -10,6 +10,8 @@
 #include <array>
 #include <functional>
 #include <ostream>
+#include <utility>
+#include <vector>
 
 namespace stellar
 {
@@ -104,6 +106,11 @@ bool verifySig(PublicKey const& key, Signature const& signature,
 void clearVerifySigCache();
 void flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses);
 
+// Copy out / seed the contents of the verification cache, most recently used
+// entries first; used to carry the cache over a restart.
+std::vector<std::pair<Hash, bool>> getVerifySigCacheContents();
+void seedVerifySigCache(std::vector<std::pair<Hash, bool>> const& contents);
+
 PublicKey random();
 }
 
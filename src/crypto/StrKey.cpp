@@ -6,11 +6,91 @@
 #include "util/SecretValue.h"
 #include "util/basen.h"
 #include "util/crc16.h"
+#include <cstdint>
 
 namespace stellar
 {
 namespace strKey
 {
+
+namespace
+{
+
+// Every StrKey encodes 35 bytes (version, 32-byte key, crc) into 56
+// characters without padding, so whole 5-byte / 8-character groups are
+// converted directly here; anything else goes through bn::, which these
+// give identical results to.
+
+char const kBase32Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+struct Base32DecodeTable
+{
+    int8_t mValue[256];
+    Base32DecodeTable()
+    {
+        for (auto& v : mValue)
+        {
+            v = -1;
+        }
+        for (int i = 0; i < 32; ++i)
+        {
+            mValue[static_cast<uint8_t>(kBase32Alphabet[i])] =
+                static_cast<int8_t>(i);
+        }
+    }
+};
+
+std::string
+encodeBase32Groups(std::vector<uint8_t> const& bin)
+{
+    std::string res(bin.size() / 5 * 8, '\0');
+    auto out = &res[0];
+    for (size_t i = 0; i < bin.size(); i += 5, out += 8)
+    {
+        uint64_t group = 0;
+        for (size_t j = 0; j < 5; ++j)
+        {
+            group = (group << 8) | bin[i + j];
+        }
+        for (int j = 7; j >= 0; --j, group >>= 5)
+        {
+            out[j] = kBase32Alphabet[group & 0x1f];
+        }
+    }
+    return res;
+}
+
+// returns false if `str` contains anything but base32 digits
+bool
+decodeBase32Groups(std::string const& str, std::vector<uint8_t>& decoded)
+{
+    static Base32DecodeTable const table;
+    decoded.resize(str.size() / 8 * 5);
+    auto in = reinterpret_cast<uint8_t const*>(str.data());
+    auto out = decoded.data();
+    for (size_t i = 0; i < str.size(); i += 8, out += 5)
+    {
+        uint64_t group = 0;
+        int bad = 0;
+        for (size_t j = 0; j < 8; ++j)
+        {
+            int v = table.mValue[in[i + j]];
+            bad |= v;
+            group = (group << 5) | static_cast<uint64_t>(v & 0x1f);
+        }
+        if (bad < 0)
+        {
+            return false;
+        }
+        out[0] = static_cast<uint8_t>(group >> 32);
+        out[1] = static_cast<uint8_t>(group >> 24);
+        out[2] = static_cast<uint8_t>(group >> 16);
+        out[3] = static_cast<uint8_t>(group >> 8);
+        out[4] = static_cast<uint8_t>(group);
+    }
+    return true;
+}
+}
 // Encode a version byte and ByteSlice into StrKey
 SecretValue
 toStrKey(uint8_t ver, ByteSlice const& bin)
@@ -27,7 +107,14 @@ toStrKey(uint8_t ver, ByteSlice const& bin)
     toEncode.emplace_back(static_cast<uint8_t>(crc & 0xFF));
 
     std::string res;
-    res = bn::encode_b32(toEncode);
+    if (toEncode.size() % 5 == 0)
+    {
+        res = encodeBase32Groups(toEncode);
+    }
+    else
+    {
+        res = bn::encode_b32(toEncode);
+    }
     return SecretValue{res};
 }
 
@@ -42,7 +129,12 @@ bool
 fromStrKey(std::string const& strKey, uint8_t& outVersion,
            std::vector<uint8_t>& decoded)
 {
-    bn::decode_b32(strKey, decoded);
+    if (strKey.size() % 8 != 0 || !decodeBase32Groups(strKey, decoded))
+    {
+        // padding, whitespace or invalid characters: the generic decoder
+        // skips over those
+        bn::decode_b32(strKey, decoded);
+    }
     if (decoded.size() < 3)
     {
         return false;
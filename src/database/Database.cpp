@@ -31,6 +31,8 @@
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
 
+#include "soci-sqlite3.h"
+
 #include <sstream>
 #include <stdexcept>
 #include <thread>
@@ -53,7 +55,7 @@ using namespace std;
 
 bool Database::gDriversRegistered = false;
 
-static unsigned long const SCHEMA_VERSION = 6;
+static unsigned long const SCHEMA_VERSION = 10;
 
 static void
 setSerializable(soci::session& sess)
@@ -62,6 +64,93 @@ setSerializable(soci::session& sess)
             "SERIALIZABLE";
 }
 
+// Binary key columns cross soci's string interface as hex, through
+// decode(:v, 'hex') on the way in and encode(col, 'hex') on the way out.
+// postgres has both built in; these are the sqlite equivalents, for the
+// 'hex' format only.
+static void
+sqliteDecode(sqlite_api::sqlite3_context* ctx, int,
+             sqlite_api::sqlite3_value** argv)
+{
+    using namespace sqlite_api;
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+    {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    auto format = reinterpret_cast<char const*>(sqlite3_value_text(argv[1]));
+    if (!format || std::string(format) != "hex")
+    {
+        sqlite3_result_error(ctx, "decode: unsupported format", -1);
+        return;
+    }
+    auto text = reinterpret_cast<char const*>(sqlite3_value_text(argv[0]));
+    try
+    {
+        auto bin = hexToBin(std::string(text, sqlite3_value_bytes(argv[0])));
+        if (bin.empty())
+        {
+            // sqlite3_result_blob would turn a null data pointer into NULL
+            sqlite3_result_zeroblob(ctx, 0);
+        }
+        else
+        {
+            sqlite3_result_blob(ctx, bin.data(), static_cast<int>(bin.size()),
+                                SQLITE_TRANSIENT);
+        }
+    }
+    catch (std::exception& e)
+    {
+        sqlite3_result_error(ctx, e.what(), -1);
+    }
+}
+
+static void
+sqliteEncode(sqlite_api::sqlite3_context* ctx, int,
+             sqlite_api::sqlite3_value** argv)
+{
+    using namespace sqlite_api;
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+    {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    auto format = reinterpret_cast<char const*>(sqlite3_value_text(argv[1]));
+    if (!format || std::string(format) != "hex")
+    {
+        sqlite3_result_error(ctx, "encode: unsupported format", -1);
+        return;
+    }
+    auto hex = binToHex(ByteSlice(sqlite3_value_blob(argv[0]),
+                                  sqlite3_value_bytes(argv[0])));
+    sqlite3_result_text(ctx, hex.data(), static_cast<int>(hex.size()),
+                        SQLITE_TRANSIENT);
+}
+
+static void
+registerSqliteFunctions(soci::session& sess)
+{
+    using namespace sqlite_api;
+    auto backend =
+        dynamic_cast<soci::sqlite3_session_backend*>(sess.get_backend());
+    if (!backend)
+    {
+        return;
+    }
+    int flags = SQLITE_UTF8;
+#ifdef SQLITE_DETERMINISTIC
+    flags |= SQLITE_DETERMINISTIC;
+#endif
+    if (sqlite3_create_function(backend->conn_, "decode", 2, flags, nullptr,
+                                &sqliteDecode, nullptr,
+                                nullptr) != SQLITE_OK ||
+        sqlite3_create_function(backend->conn_, "encode", 2, flags, nullptr,
+                                &sqliteEncode, nullptr, nullptr) != SQLITE_OK)
+    {
+        throw std::runtime_error("Could not register sqlite functions");
+    }
+}
+
 void
 Database::registerDrivers()
 {
@@ -99,6 +188,7 @@ Database::Database(Application& app)
         // busy_timeout gives room for external processes
         // that may lock the database for some time
         mSession << "PRAGMA busy_timeout = 10000";
+        registerSqliteFunctions(mSession);
     }
     else
     {
@@ -143,6 +233,31 @@ Database::applySchemaUpgrade(unsigned long vers)
     case 6:
         mSession << "ALTER TABLE peers ADD flags INT NOT NULL DEFAULT 0";
         break;
+    case 7:
+        HerderPersistence::dropSCPState(*this);
+        break;
+    case 8:
+        AccountFrame::upgradeToBinaryKeys(*this);
+        break;
+    case 9:
+        try
+        {
+            mSession << "ALTER TABLE accounts ADD packedsigners BYTEA";
+        }
+        catch (soci::soci_error& e)
+        {
+            // already there when the accounts table was recreated by the
+            // upgrade to version 8
+            if (std::string(e.what()).find("packedsigners") ==
+                std::string::npos)
+            {
+                throw;
+            }
+        }
+        break;
+    case 10:
+        AccountFrame::rebuildInflationVotes(*this);
+        break;
     default:
         throw std::runtime_error("Unknown DB schema version");
         break;
@@ -169,6 +284,30 @@ Database::upgradeToCurrentSchema()
         putSchemaVersion(vers);
     }
     assert(vers == SCHEMA_VERSION);
+    applyAccountSignerStorage();
+}
+
+void
+Database::applyAccountSignerStorage()
+{
+    auto& ps = mApp.getPersistentState();
+    bool stored =
+        ps.getState(PersistentState::kAccountSignerStorage) == "inline";
+    bool wanted = inlineAccountSigners();
+    if (stored == wanted)
+    {
+        return;
+    }
+
+    CLOG(INFO, "Database") << "Moving account signers "
+                           << (wanted ? "into the accounts table"
+                                      : "into the signers table");
+    clearPreparedStatementCache();
+    soci::transaction tx(mSession);
+    AccountFrame::moveSigners(*this, wanted);
+    ps.setState(PersistentState::kAccountSignerStorage,
+                wanted ? "inline" : "table");
+    tx.commit();
 }
 
 void
@@ -204,44 +343,48 @@ Database::getAppSchemaVersion()
     return SCHEMA_VERSION;
 }
 
-medida::TimerContext
-Database::getInsertTimer(std::string const& entityName)
+LatencyHistogram::Scope
+Database::getQueryTimer(QueryType type, std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    static char const* const names[QUERY_TYPE_COUNT] = {"insert", "select",
+                                                        "delete", "update"};
+    LatencyHistogram* timer;
+    {
+        std::lock_guard<std::mutex> lock(mEntityTimersMutex);
+        auto& timers = mEntityTimers[entityName];
+        if (!timers[type])
+        {
+            timers[type] = &mApp.getLatencyMetrics().NewHistogram(
+                {"database", names[type], entityName});
+        }
+        timer = timers[type];
+    }
     mQueryMeter.Mark();
-    return mApp.getMetrics()
-        .NewTimer({"database", "insert", entityName})
-        .TimeScope();
+    return timer->TimeScope();
+}
+
+LatencyHistogram::Scope
+Database::getInsertTimer(std::string const& entityName)
+{
+    return getQueryTimer(QUERY_INSERT, entityName);
 }
 
-medida::TimerContext
+LatencyHistogram::Scope
 Database::getSelectTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
-    mQueryMeter.Mark();
-    return mApp.getMetrics()
-        .NewTimer({"database", "select", entityName})
-        .TimeScope();
+    return getQueryTimer(QUERY_SELECT, entityName);
 }
 
-medida::TimerContext
+LatencyHistogram::Scope
 Database::getDeleteTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
-    mQueryMeter.Mark();
-    return mApp.getMetrics()
-        .NewTimer({"database", "delete", entityName})
-        .TimeScope();
+    return getQueryTimer(QUERY_DELETE, entityName);
 }
 
-medida::TimerContext
+LatencyHistogram::Scope
 Database::getUpdateTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
-    mQueryMeter.Mark();
-    return mApp.getMetrics()
-        .NewTimer({"database", "update", entityName})
-        .TimeScope();
+    return getQueryTimer(QUERY_UPDATE, entityName);
 }
 
 void
@@ -263,6 +406,12 @@ Database::isSqlite() const
            std::string::npos;
 }
 
+bool
+Database::inlineAccountSigners() const
+{
+    return mApp.getConfig().INLINE_ACCOUNT_SIGNERS;
+}
+
 bool
 Database::canUsePool() const
 {
@@ -333,7 +482,11 @@ Database::getPool()
             LOG(DEBUG) << "Opening pool entry " << i;
             soci::session& sess = mPool->at(i);
             sess.open(c.value);
-            if (!isSqlite())
+            if (isSqlite())
+            {
+                registerSqliteFunctions(sess);
+            }
+            else
             {
                 setSerializable(sess);
             }
@@ -421,17 +574,16 @@ Database::getQueryMeter()
 std::chrono::nanoseconds
 Database::totalQueryTime() const
 {
-    std::vector<std::string> qtypes = {"insert", "delete", "select", "update"};
     std::chrono::nanoseconds nsq(0);
-    for (auto const& q : qtypes)
+    std::lock_guard<std::mutex> lock(mEntityTimersMutex);
+    for (auto const& kv : mEntityTimers)
     {
-        for (auto const& e : mEntityTypes)
+        for (auto timer : kv.second)
         {
-            auto& timer = mApp.getMetrics().NewTimer({"database", q, e});
-            uint64_t sumns = static_cast<uint64_t>(
-                timer.sum() *
-                static_cast<double>(timer.duration_unit().count()));
-            nsq += std::chrono::nanoseconds(sumns);
+            if (timer)
+            {
+                nsq += timer->sum();
+            }
         }
     }
     return nsq;
@@ -4,13 +4,15 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
-#include "medida/timer_context.h"
 #include "overlay/StellarXDR.h"
+#include "util/LatencyHistogram.h"
 #include "util/NonCopyable.h"
 #include "util/SociNoWarnings.h"
 #include "util/Timer.h"
 #include "util/lrucache.hpp"
-#include <set>
+#include <array>
+#include <map>
+#include <mutex>
 #include <string>
 
 namespace medida
@@ -95,9 +97,21 @@ class Database : NonMovableOrCopyable
     cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
         mEntryCache;
 
-    // Helpers for maintaining the total query time and calculating
-    // idle percentage.
-    std::set<std::string> mEntityTypes;
+    // The query timers of each entity type, by QueryType, also used to
+    // maintain the total query time and calculate idle percentage. They are
+    // also taken from worker threads writing history snapshots, hence the
+    // lock.
+    enum QueryType
+    {
+        QUERY_INSERT,
+        QUERY_SELECT,
+        QUERY_DELETE,
+        QUERY_UPDATE,
+        QUERY_TYPE_COUNT
+    };
+    std::map<std::string, std::array<LatencyHistogram*, QUERY_TYPE_COUNT>>
+        mEntityTimers;
+    mutable std::mutex mEntityTimersMutex;
     std::chrono::nanoseconds mExcludedQueryTime;
     std::chrono::nanoseconds mExcludedTotalTime;
     std::chrono::nanoseconds mLastIdleQueryTime;
@@ -105,7 +119,11 @@ class Database : NonMovableOrCopyable
 
     static bool gDriversRegistered;
     static void registerDrivers();
+
+    LatencyHistogram::Scope getQueryTimer(QueryType type,
+                                          std::string const& entityName);
     void applySchemaUpgrade(unsigned long vers);
+    void applyAccountSignerStorage();
 
   public:
     // Instantiate object and connect to app.getConfig().DATABASE;
@@ -149,10 +167,10 @@ class Database : NonMovableOrCopyable
     // Return metric-gathering timers for various families of SQL operation.
     // These timers automatically count the time they are alive for,
     // so only acquire them immediately before executing an SQL statement.
-    medida::TimerContext getInsertTimer(std::string const& entityName);
-    medida::TimerContext getSelectTimer(std::string const& entityName);
-    medida::TimerContext getDeleteTimer(std::string const& entityName);
-    medida::TimerContext getUpdateTimer(std::string const& entityName);
+    LatencyHistogram::Scope getInsertTimer(std::string const& entityName);
+    LatencyHistogram::Scope getSelectTimer(std::string const& entityName);
+    LatencyHistogram::Scope getDeleteTimer(std::string const& entityName);
+    LatencyHistogram::Scope getUpdateTimer(std::string const& entityName);
 
     // If possible (i.e. "on postgres") issue an SQL pragma that marks
     // the current transaction as read-only. The effects of this last
@@ -162,6 +180,10 @@ class Database : NonMovableOrCopyable
     // Return true if the Database target is SQLite, otherwise false.
     bool isSqlite() const;
 
+    // Return true if account signers are kept packed in the accounts table
+    // rather than in the signers table, per Config::INLINE_ACCOUNT_SIGNERS.
+    bool inlineAccountSigners() const;
+
     // Return true if a connection pool is available for worker threads
     // to read from the database through, otherwise false.
     bool canUsePool() const;
@@ -179,7 +201,8 @@ class Database : NonMovableOrCopyable
     // Get current schema version of running application.
     unsigned long getAppSchemaVersion();
 
-    // Check schema version and apply any upgrades if necessary.
+    // Check schema version and apply any upgrades if necessary, then move
+    // account signers to the configured storage if they are elsewhere.
     void upgradeToCurrentSchema();
 
     // Access the underlying SOCI session object
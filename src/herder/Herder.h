@@ -111,6 +111,10 @@ class Herder
     // We are learning about a new envelope.
     virtual EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) = 0;
 
+    // We are learning about a new envelope from the network: its signature
+    // gets checked off the main thread before it goes to recvSCPEnvelope.
+    virtual void recvUnverifiedSCPEnvelope(SCPEnvelope const& envelope) = 0;
+
     // We are learning about a new fully-fetched envelope.
     virtual EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
                                            const SCPQuorumSet& qset,
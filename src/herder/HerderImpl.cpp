@@ -6,6 +6,7 @@
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
 #include "crypto/SHA.h"
+#include "database/Database.h"
 #include "herder/HerderPersistence.h"
 #include "herder/HerderUtils.h"
 #include "herder/LedgerCloseData.h"
@@ -24,8 +25,10 @@
 #include "util/make_unique.h"
 
 #include "medida/counter.h"
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "util/XDRStream.h"
 #include "util/basen.h"
 #include "xdrpp/marshal.h"
@@ -52,6 +55,20 @@ HerderImpl::SCPMetrics::SCPMetrics(Application& app)
           app.getMetrics().NewMeter({"scp", "envelope", "emit"}, "envelope"))
     , mEnvelopeReceive(
           app.getMetrics().NewMeter({"scp", "envelope", "receive"}, "envelope"))
+    , mSCPStateBytes(
+          app.getMetrics().NewHistogram({"herder", "scp-state", "bytes"}))
+    , mSCPStateWrite(
+          app.getMetrics().NewTimer({"herder", "scp-state", "write"}))
+    , mEmitLatency(
+          app.getMetrics().NewTimer({"herder", "scp-state", "emit-latency"}))
+    , mCandidatePrepare(
+          app.getMetrics().NewTimer({"herder", "candidate", "prepare"}))
+    , mCandidateReady(app.getMetrics().NewMeter(
+          {"herder", "candidate", "ready"}, "txset"))
+    , mCandidateStale(app.getMetrics().NewMeter(
+          {"herder", "candidate", "stale"}, "txset"))
+    , mNominationStart(
+          app.getMetrics().NewTimer({"herder", "nomination", "start"}))
 
     , mKnownSlotsSize(
           app.getMetrics().NewCounter({"scp", "memory", "known-slots"}))
@@ -74,8 +91,12 @@ HerderImpl::HerderImpl(Application& app)
     , mPendingEnvelopes(app, *this)
     , mHerderSCPDriver(app, *this, mUpgrades, mPendingEnvelopes)
     , mLastSlotSaved(0)
+    , mSCPStateBytes(0)
     , mTrackingTimer(app)
+    , mEmitTimer(app)
     , mTriggerTimer(app)
+    , mCandidateTimer(app)
+    , mCandidateRefreshPending(false)
     , mRebroadcastTimer(app)
     , mApp(app)
     , mLedgerManager(app.getLedgerManager())
@@ -186,6 +207,10 @@ HerderImpl::valueExternalized(uint64 slotIndex, StellarValue const& value)
     // and there is no point in taking a position after the round is over
     mTriggerTimer.cancel();
 
+    // the ledger is about to close, don't leave our last statements waiting
+    // for the end of the crank
+    sendEmittedEnvelopes();
+
     // save the SCP messages in the database
     mApp.getHerderPersistence().saveSCPHistory(
         static_cast<uint32>(slotIndex),
@@ -274,9 +299,41 @@ HerderImpl::emitEnvelope(SCPEnvelope const& envelope)
             << " s:" << envelope.statement.pledges.type() << " i:" << slotIndex
             << " a:" << mApp.getStateHuman();
 
-    persistSCPState(slotIndex);
+    mPendingEmits.emplace_back(envelope, mApp.getClock().now());
+    if (mPendingEmits.size() == 1)
+    {
+        mEmitTimer.expires_from_now(std::chrono::seconds(0));
+        mEmitTimer.async_wait(
+            std::bind(&HerderImpl::sendEmittedEnvelopes, this),
+            &VirtualTimer::onFailureNoop);
+    }
+}
+
+void
+HerderImpl::sendEmittedEnvelopes()
+{
+    if (mPendingEmits.empty())
+    {
+        return;
+    }
+
+    std::vector<SCPEnvelope> envs;
+    for (auto const& p : mPendingEmits)
+    {
+        envs.emplace_back(p.first);
+    }
+
+    // envelopes must be on disk before we send them out: after a restart
+    // we have to pick up from where we were, or we may contradict ourselves
+    persistSCPState(envs);
 
-    broadcast(envelope);
+    auto now = mApp.getClock().now();
+    for (auto const& p : mPendingEmits)
+    {
+        broadcast(p.first);
+        mSCPMetrics.mEmitLatency.Update(now - p.second);
+    }
+    mPendingEmits.clear();
 
     // this resets the re-broadcast timer
     startRebroadcastTimer();
@@ -356,6 +413,21 @@ HerderImpl::recvTransaction(TransactionFramePtr tx)
     auto txmap = findOrAdd(mPendingTransactions[0], acc);
     txmap->addTx(tx);
 
+    // folds new transactions into the candidate set in the background, so
+    // that little is left to validate when the trigger fires
+    if (mCandidateTxSet)
+    {
+        mCandidateStaleAccounts.insert(acc);
+        if (!mCandidateRefreshPending)
+        {
+            mCandidateRefreshPending = true;
+            mCandidateTimer.expires_from_now(std::chrono::seconds(1));
+            mCandidateTimer.async_wait(
+                std::bind(&HerderImpl::prepareCandidateTxSet, this),
+                &VirtualTimer::onFailureNoop);
+        }
+    }
+
     return TX_STATUS_PENDING;
 }
 
@@ -423,6 +495,31 @@ HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope)
     return status;
 }
 
+void
+HerderImpl::recvUnverifiedSCPEnvelope(SCPEnvelope const& envelope)
+{
+    // don't spend a signature check on what recvSCPEnvelope drops anyway
+    if (mApp.getConfig().MANUAL_CLOSE ||
+        envelope.statement.nodeID == getSCP().getLocalNode()->getNodeID())
+    {
+        return;
+    }
+    mHerderSCPDriver.verifyEnvelopeAsync(envelope);
+}
+
+void
+HerderImpl::recvVerifiedSCPEnvelope(SCPEnvelope const& envelope, bool valid)
+{
+    if (!valid)
+    {
+        CLOG(DEBUG, "Herder")
+            << "recvSCPEnvelope: invalid signature from "
+            << mApp.getConfig().toShortString(envelope.statement.nodeID);
+        return;
+    }
+    recvSCPEnvelope(envelope);
+}
+
 Herder::EnvelopeStatus
 HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope,
                             const SCPQuorumSet& qset, TxSetFrame txset)
@@ -531,6 +628,8 @@ HerderImpl::ledgerClosed()
     CLOG(TRACE, "Herder") << "HerderImpl::ledgerClosed";
 
     mPendingEnvelopes.slotClosed(mHerderSCPDriver.lastConsensusLedgerIndex());
+    mHerderSCPDriver.purgeTxSetValidity(
+        mHerderSCPDriver.lastConsensusLedgerIndex());
 
     mApp.getOverlayManager().ledgerClosed(
         mHerderSCPDriver.lastConsensusLedgerIndex());
@@ -563,6 +662,14 @@ HerderImpl::ledgerClosed()
         return;
     }
 
+    // start building the candidate for the next ledger now rather than when
+    // the trigger fires
+    mCandidateRefreshPending = true;
+    mCandidateTimer.expires_from_now(std::chrono::seconds(0));
+    mCandidateTimer.async_wait(
+        std::bind(&HerderImpl::prepareCandidateTxSet, this),
+        &VirtualTimer::onFailureNoop);
+
     auto seconds = Herder::EXP_LEDGER_TIMESPAN_SECONDS;
     if (mApp.getConfig().ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING)
     {
@@ -724,29 +831,28 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger)
     }
     updateSCPCounters();
 
+    auto nominationStart = mSCPMetrics.mNominationStart.TimeScope();
+
     // our first choice for this round's set is all the tx we have collected
     // during last ledger close
     auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
-    auto proposedSet = std::make_shared<TxSetFrame>(lcl.hash);
-
-    for (auto const& m : mPendingTransactions)
-    {
-        for (auto const& pair : m)
-        {
-            for (auto const& tx : pair.second->mTransactions)
-            {
-                proposedSet->add(tx.second);
-            }
-        }
-    }
-
-    std::vector<TransactionFramePtr> removed;
-    proposedSet->trimInvalid(mApp, removed);
-    removeReceivedTxs(removed);
-
-    proposedSet->surgePricingFilter(mLedgerManager, mApp);
-
-    if (!proposedSet->checkValid(mApp))
+    bool ready = mCandidateTxSet &&
+                 mCandidateTxSet->previousLedgerHash() == lcl.hash &&
+                 mCandidateStaleAccounts.empty();
+    (ready ? mSCPMetrics.mCandidateReady : mSCPMetrics.mCandidateStale).Mark();
+
+    auto proposedSet = makeCandidateTxSet();
+    mCandidateTxSet.reset();
+    mCandidateTimer.cancel();
+    mCandidateRefreshPending = false;
+
+    std::set<AccountID> surged;
+    proposedSet->surgePricingFilter(mLedgerManager, mApp, &surged);
+
+    // a ready candidate is known to be valid: only the accounts surge pricing
+    // removed transactions from need to be checked again. Otherwise the set
+    // is checked as a whole
+    if (!proposedSet->checkValid(mApp, ready ? &surged : nullptr))
     {
         throw std::runtime_error("wanting to emit an invalid txSet");
     }
@@ -799,10 +905,75 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger)
         }
     }
 
+    nominationStart.Stop();
+
     mHerderSCPDriver.nominate(slotIndex, newProposedValue, proposedSet,
                               lcl.header.scpValue);
 }
 
+void
+HerderImpl::prepareCandidateTxSet()
+{
+    mCandidateRefreshPending = false;
+    if (!mHerderSCPDriver.trackingSCP() || !mLedgerManager.isSynced())
+    {
+        mCandidateTxSet.reset();
+        return;
+    }
+
+    auto timer = mSCPMetrics.mCandidatePrepare.TimeScope();
+    mCandidateTxSet = makeCandidateTxSet();
+}
+
+TxSetFramePtr
+HerderImpl::makeCandidateTxSet()
+{
+    auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
+    auto txSet = std::make_shared<TxSetFrame>(lcl.hash);
+
+    // validity of the candidate only holds against the ledger it was built on
+    bool reuse = mCandidateTxSet &&
+                 mCandidateTxSet->previousLedgerHash() == lcl.hash;
+    auto isStale = [&](AccountID const& acc) {
+        return mCandidateStaleAccounts.find(acc) !=
+               mCandidateStaleAccounts.end();
+    };
+
+    if (reuse)
+    {
+        for (auto const& tx : mCandidateTxSet->mTransactions)
+        {
+            if (!isStale(tx->getSourceID()))
+            {
+                txSet->add(tx);
+            }
+        }
+    }
+
+    for (auto const& m : mPendingTransactions)
+    {
+        for (auto const& pair : m)
+        {
+            if (reuse && !isStale(pair.first))
+            {
+                continue;
+            }
+            for (auto const& tx : pair.second->mTransactions)
+            {
+                txSet->add(tx.second);
+            }
+        }
+    }
+
+    std::vector<TransactionFramePtr> removed;
+    txSet->trimInvalid(mApp, removed,
+                       reuse ? &mCandidateStaleAccounts : nullptr);
+    removeReceivedTxs(removed);
+    mCandidateStaleAccounts.clear();
+
+    return txSet;
+}
+
 void
 HerderImpl::setUpgrades(Upgrades::UpgradeParameters const& upgrades)
 {
@@ -890,60 +1061,106 @@ HerderImpl::dumpQuorumInfo(Json::Value& ret, NodeID const& id, bool summary,
 }
 
 void
-HerderImpl::persistSCPState(uint64 slot)
+HerderImpl::persistSCPState(std::vector<SCPEnvelope> const& envs)
 {
-    if (slot < mLastSlotSaved)
+    // only the most recent slot is needed to restore our state
+    std::map<uint64, std::vector<SCPEnvelope>> envsBySlot;
+    for (auto const& e : envs)
+    {
+        if (e.statement.slotIndex >= mLastSlotSaved)
+        {
+            envsBySlot[e.statement.slotIndex].emplace_back(e);
+        }
+    }
+    if (envsBySlot.empty())
     {
         return;
     }
 
-    mLastSlotSaved = slot;
-
-    // saves SCP messages and related data (transaction sets, quorum sets)
-    xdr::xvector<SCPEnvelope> latestEnvs;
-    std::map<Hash, TxSetFramePtr> txSets;
-    std::map<Hash, SCPQuorumSetPtr> quorumSets;
+    auto& persistence = mApp.getHerderPersistence();
+    auto timer = mSCPMetrics.mSCPStateWrite.TimeScope();
+    soci::transaction txscope(mApp.getDatabase().getSession());
 
-    for (auto const& e : getSCP().getLatestMessagesSend(slot))
+    for (auto const& slotEnvs : envsBySlot)
     {
-        latestEnvs.emplace_back(e);
-
-        // saves transaction sets referred by the statement
-        for (auto const& h : getTxSetHashes(e))
+        uint64 slot = slotEnvs.first;
+        if (slot > mLastSlotSaved)
         {
-            auto txSet = mPendingEnvelopes.getTxSet(h);
-            if (txSet)
+            if (mSCPStateBytes != 0)
             {
-                txSets.insert(std::make_pair(h, txSet));
+                mSCPMetrics.mSCPStateBytes.Update(mSCPStateBytes);
+            }
+            mSCPStateBytes = 0;
+            mLastSlotSaved = slot;
+
+            persistence.purgeSCPState(slot);
+            for (auto it = mSCPStateItems.begin();
+                 it != mSCPStateItems.end();)
+            {
+                if (it->second < slot)
+                {
+                    it = mSCPStateItems.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
             }
         }
-        Hash qsHash = Slot::getCompanionQuorumSetHashFromStatement(e.statement);
-        SCPQuorumSetPtr qSet = mPendingEnvelopes.getQSet(qsHash);
-        if (qSet)
+
+        // saves transaction sets and quorum sets referred by the statements,
+        // unless they are already in the log
+        std::vector<TxSetFramePtr> txSets;
+        std::vector<SCPQuorumSetPtr> quorumSets;
+        std::vector<Hash> reusedItems;
+        auto needsWrite = [&](Hash const& h) {
+            auto it = mSCPStateItems.find(h);
+            if (it == mSCPStateItems.end())
+            {
+                return true;
+            }
+            if (it->second < slot)
+            {
+                it->second = slot;
+                reusedItems.emplace_back(h);
+            }
+            return false;
+        };
+
+        for (auto const& e : slotEnvs.second)
         {
-            quorumSets.insert(std::make_pair(qsHash, qSet));
+            for (auto const& h : getTxSetHashes(e))
+            {
+                if (!needsWrite(h))
+                {
+                    continue;
+                }
+                auto txSet = mPendingEnvelopes.getTxSet(h);
+                if (txSet)
+                {
+                    txSets.emplace_back(txSet);
+                    mSCPStateItems.emplace(h, slot);
+                }
+            }
+            Hash qsHash =
+                Slot::getCompanionQuorumSetHashFromStatement(e.statement);
+            if (!needsWrite(qsHash))
+            {
+                continue;
+            }
+            SCPQuorumSetPtr qSet = mPendingEnvelopes.getQSet(qsHash);
+            if (qSet)
+            {
+                quorumSets.emplace_back(qSet);
+                mSCPStateItems.emplace(qsHash, slot);
+            }
         }
-    }
 
-    xdr::xvector<TransactionSet> latestTxSets;
-    for (auto it : txSets)
-    {
-        latestTxSets.emplace_back();
-        it.second->toXDR(latestTxSets.back());
-    }
-
-    xdr::xvector<SCPQuorumSet> latestQSets;
-    for (auto it : quorumSets)
-    {
-        latestQSets.emplace_back(*it.second);
+        mSCPStateBytes += persistence.appendSCPState(
+            slot, slotEnvs.second, txSets, quorumSets, reusedItems);
     }
 
-    auto latestSCPData =
-        xdr::xdr_to_opaque(latestEnvs, latestTxSets, latestQSets);
-    std::string scpState;
-    scpState = bn::encode_b64(latestSCPData);
-
-    mApp.getPersistentState().setState(PersistentState::kLastSCPData, scpState);
+    txscope.commit();
 }
 
 void
@@ -955,25 +1172,21 @@ HerderImpl::restoreSCPState()
 
     trackingHeartBeat();
 
-    // load saved state from database
-    auto latest64 =
-        mApp.getPersistentState().getState(PersistentState::kLastSCPData);
-
-    if (latest64.empty())
-    {
-        return;
-    }
-
-    std::vector<uint8_t> buffer;
-    bn::decode_b64(latest64, buffer);
-
-    xdr::xvector<SCPEnvelope> latestEnvs;
-    xdr::xvector<TransactionSet> latestTxSets;
-    xdr::xvector<SCPQuorumSet> latestQSets;
+    std::vector<SCPEnvelope> latestEnvs;
+    std::vector<TransactionSet> latestTxSets;
+    std::vector<SCPQuorumSet> latestQSets;
 
     try
     {
-        xdr::xdr_from_opaque(buffer, latestEnvs, latestTxSets, latestQSets);
+        mApp.getHerderPersistence().loadSCPState(latestEnvs, latestTxSets,
+                                                 latestQSets);
+        // items that are not in the log yet get written with the next
+        // envelope that refers to them
+        bool inLog = !latestEnvs.empty();
+        if (!inLog)
+        {
+            restoreLegacySCPState(latestEnvs, latestTxSets, latestQSets);
+        }
 
         for (auto const& txset : latestTxSets)
         {
@@ -981,20 +1194,51 @@ HerderImpl::restoreSCPState()
                 make_shared<TxSetFrame>(mApp.getNetworkID(), txset);
             Hash h = cur->getContentsHash();
             mPendingEnvelopes.addTxSet(h, 0, cur);
+            if (inLog)
+            {
+                mSCPStateItems.emplace(h, 0);
+            }
         }
         for (auto const& qset : latestQSets)
         {
             Hash hash = sha256(xdr::xdr_to_opaque(qset));
             mPendingEnvelopes.addSCPQuorumSet(hash, qset);
+            if (inLog)
+            {
+                mSCPStateItems.emplace(hash, 0);
+            }
         }
+
+        // the log has every envelope we sent, only the last nomination and
+        // the last ballot statement of each slot define our state
+        std::map<std::pair<uint64, bool>, SCPEnvelope const*> lastEnvs;
         for (auto const& e : latestEnvs)
         {
-            getSCP().setStateFromEnvelope(e.statement.slotIndex, e);
+            bool nominate =
+                e.statement.pledges.type() == SCPStatementType::SCP_ST_NOMINATE;
+            lastEnvs[std::make_pair(e.statement.slotIndex, nominate)] = &e;
+            mLastSlotSaved = std::max(mLastSlotSaved, e.statement.slotIndex);
+        }
+        for (auto const& e : lastEnvs)
+        {
+            getSCP().setStateFromEnvelope(e.first.first, *e.second);
+        }
+        for (auto& item : mSCPStateItems)
+        {
+            item.second = mLastSlotSaved;
+        }
+
+        if (!inLog && !latestEnvs.empty())
+        {
+            // move the legacy state into the log, else it would be replayed
+            // again whenever the log is empty
+            persistSCPState(latestEnvs);
+            mApp.getPersistentState().setState(PersistentState::kLastSCPData,
+                                               "");
         }
 
         if (latestEnvs.size() != 0)
         {
-            mLastSlotSaved = latestEnvs.back().statement.slotIndex;
             startRebroadcastTimer();
         }
     }
@@ -1008,6 +1252,33 @@ HerderImpl::restoreSCPState()
     }
 }
 
+void
+HerderImpl::restoreLegacySCPState(std::vector<SCPEnvelope>& latestEnvs,
+                                  std::vector<TransactionSet>& latestTxSets,
+                                  std::vector<SCPQuorumSet>& latestQSets)
+{
+    // state saved by versions that did not have the SCP state log
+    auto latest64 =
+        mApp.getPersistentState().getState(PersistentState::kLastSCPData);
+
+    if (latest64.empty())
+    {
+        return;
+    }
+
+    std::vector<uint8_t> buffer;
+    bn::decode_b64(latest64, buffer);
+
+    xdr::xvector<SCPEnvelope> envs;
+    xdr::xvector<TransactionSet> txSets;
+    xdr::xvector<SCPQuorumSet> qSets;
+    xdr::xdr_from_opaque(buffer, envs, txSets, qSets);
+
+    latestEnvs.assign(envs.begin(), envs.end());
+    latestTxSets.assign(txSets.begin(), txSets.end());
+    latestQSets.assign(qSets.begin(), qSets.end());
+}
+
 void
 HerderImpl::persistUpgrades()
 {
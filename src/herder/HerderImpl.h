@@ -10,6 +10,8 @@
 #include "herder/Upgrades.h"
 #include "util/Timer.h"
 #include <deque>
+#include <map>
+#include <set>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -18,6 +20,7 @@ namespace medida
 {
 class Meter;
 class Counter;
+class Histogram;
 class Timer;
 }
 
@@ -62,6 +65,9 @@ class HerderImpl : public Herder
     TransactionSubmitStatus recvTransaction(TransactionFramePtr tx) override;
 
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) override;
+    void recvUnverifiedSCPEnvelope(SCPEnvelope const& envelope) override;
+    // called back by HerderSCPDriver::verifyEnvelopeAsync
+    void recvVerifiedSCPEnvelope(SCPEnvelope const& envelope, bool valid);
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
                                    const SCPQuorumSet& qset,
                                    TxSetFrame txset) override;
@@ -133,13 +139,34 @@ class HerderImpl : public Herder
     // only keep track of the most recent slot
     uint64 mLastSlotSaved;
 
+    // envelopes emitted since the last call to sendEmittedEnvelopes, with
+    // the time they were emitted at
+    std::vector<std::pair<SCPEnvelope, VirtualClock::time_point>>
+        mPendingEmits;
+
+    // transaction sets and quorum sets already written to the SCP state log
+    // and the latest slot they are recorded for
+    std::map<Hash, uint64> mSCPStateItems;
+
+    // bytes written to the SCP state log for mLastSlotSaved
+    size_t mSCPStateBytes;
+
     // timer that detects that we're stuck on an SCP slot
     VirtualTimer mTrackingTimer;
 
-    // saves the SCP messages that the instance sent out last
-    void persistSCPState(uint64 slot);
+    // fires sendEmittedEnvelopes once the current crank is done
+    VirtualTimer mEmitTimer;
+
+    // persists then broadcasts the envelopes emitted during the last crank,
+    // so that they share a single database commit
+    void sendEmittedEnvelopes();
+    // appends the SCP messages that the instance sends out to the log
+    void persistSCPState(std::vector<SCPEnvelope> const& envs);
     // restores SCP state based on the last messages saved on disk
     void restoreSCPState();
+    void restoreLegacySCPState(std::vector<SCPEnvelope>& latestEnvs,
+                               std::vector<TransactionSet>& latestTxSets,
+                               std::vector<SCPQuorumSet>& latestQSets);
 
     // saves upgrade parameters
     void persistUpgrades();
@@ -152,6 +179,20 @@ class HerderImpl : public Herder
 
     VirtualTimer mTriggerTimer;
 
+    // candidate transaction set for the next ledger, built ahead of
+    // triggerNextLedger so that nomination doesn't wait on validation
+    TxSetFramePtr mCandidateTxSet;
+    // accounts that submitted transactions since mCandidateTxSet was built
+    std::set<AccountID> mCandidateStaleAccounts;
+    VirtualTimer mCandidateTimer;
+    bool mCandidateRefreshPending;
+
+    // (re)builds mCandidateTxSet from the pending transactions
+    void prepareCandidateTxSet();
+    // builds a valid transaction set from the pending transactions, reusing
+    // the validation done for mCandidateTxSet when possible
+    TxSetFramePtr makeCandidateTxSet();
+
     VirtualTimer mRebroadcastTimer;
 
     Application& mApp;
@@ -166,6 +207,20 @@ class HerderImpl : public Herder
         medida::Meter& mEnvelopeEmit;
         medida::Meter& mEnvelopeReceive;
 
+        // SCP state log: bytes written per ledger, time spent committing
+        // and time between emitting an envelope and sending it
+        medida::Histogram& mSCPStateBytes;
+        medida::Timer& mSCPStateWrite;
+        medida::Timer& mEmitLatency;
+
+        // candidate transaction sets: time spent building them ahead of the
+        // trigger, whether the trigger could use them as is, and time from
+        // the trigger to the start of nomination
+        medida::Timer& mCandidatePrepare;
+        medida::Meter& mCandidateReady;
+        medida::Meter& mCandidateStale;
+        medida::Timer& mNominationStart;
+
         // Counters for stuff in parent class (SCP)
         // that we monitor on a best-effort basis from
         // here.
@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "xdr/Stellar-types.h"
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -17,8 +18,11 @@ namespace stellar
 {
 class Application;
 class Database;
+class TxSetFrame;
 class XDROutputFileStream;
 struct SCPEnvelope;
+struct SCPQuorumSet;
+struct TransactionSet;
 
 class HerderPersistence
 {
@@ -32,11 +36,32 @@ class HerderPersistence
     virtual void saveSCPHistory(uint32_t seq,
                                 std::vector<SCPEnvelope> const& envs) = 0;
 
+    // Append-only log of the SCP messages emitted by this node, replayed on
+    // startup. Transaction sets and quorum sets referenced by the envelopes
+    // are stored once per hash; `reusedItems` only moves already stored
+    // items forward to `slot` so that they survive purgeSCPState.
+    // Returns the number of bytes written.
+    // Callers are expected to batch appends in a single transaction.
+    virtual size_t
+    appendSCPState(uint64_t slot, std::vector<SCPEnvelope> const& envs,
+                   std::vector<std::shared_ptr<TxSetFrame>> const& txSets,
+                   std::vector<std::shared_ptr<SCPQuorumSet>> const& qSets,
+                   std::vector<Hash> const& reusedItems) = 0;
+
+    // loads the log, envelopes are returned in the order they were appended
+    virtual void loadSCPState(std::vector<SCPEnvelope>& envs,
+                              std::vector<TransactionSet>& txSets,
+                              std::vector<SCPQuorumSet>& qSets) = 0;
+
+    // removes everything recorded for slots below `slot`
+    virtual void purgeSCPState(uint64_t slot) = 0;
+
     static size_t copySCPHistoryToStream(Database& db, soci::session& sess,
                                          uint32_t ledgerSeq,
                                          uint32_t ledgerCount,
                                          XDROutputFileStream& scpHistory);
     static void dropAll(Database& db);
+    static void dropSCPState(Database& db);
     static void deleteOldEntries(Database& db, uint32_t ledgerSeq,
                                  uint32_t count);
 };
@@ -4,9 +4,11 @@
 
 #include "herder/HerderPersistenceImpl.h"
 #include "crypto/Hex.h"
+#include "crypto/SHA.h"
 #include "database/Database.h"
 #include "database/DatabaseUtils.h"
 #include "herder/Herder.h"
+#include "herder/TxSetFrame.h"
 #include "main/Application.h"
 #include "scp/Slot.h"
 #include "util/SociNoWarnings.h"
@@ -24,7 +26,8 @@ HerderPersistence::create(Application& app)
     return make_unique<HerderPersistenceImpl>(app);
 }
 
-HerderPersistenceImpl::HerderPersistenceImpl(Application& app) : mApp(app)
+HerderPersistenceImpl::HerderPersistenceImpl(Application& app)
+    : mApp(app), mNextSCPStateSeq(0), mSCPStateSeqLoaded(false)
 {
 }
 
@@ -139,6 +142,212 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
     txscope.commit();
 }
 
+// kinds of items stored in scpstateitems
+static int const SCP_STATE_TXSET = 0;
+static int const SCP_STATE_QSET = 1;
+
+size_t
+HerderPersistenceImpl::insertSCPStateItem(uint64_t slot, Hash const& h,
+                                          int kind,
+                                          std::vector<uint8_t> const& bytes)
+{
+    auto& db = mApp.getDatabase();
+    std::string hashHex = binToHex(h);
+    std::string encoded = bn::encode_b64(bytes);
+    int64_t slotIndex = static_cast<int64_t>(slot);
+
+    auto prep = db.getPreparedStatement(
+        "INSERT INTO scpstateitems (itemhash, slotindex, kind, item) "
+        "VALUES (:h, :s, :k, :v)");
+    auto& st = prep.statement();
+    st.exchange(soci::use(hashHex));
+    st.exchange(soci::use(slotIndex));
+    st.exchange(soci::use(kind));
+    st.exchange(soci::use(encoded));
+    st.define_and_bind();
+    {
+        auto timer = db.getInsertTimer("scpstateitems");
+        st.execute(true);
+    }
+    if (st.get_affected_rows() != 1)
+    {
+        throw std::runtime_error("Could not update data in SQL");
+    }
+    return encoded.size();
+}
+
+size_t
+HerderPersistenceImpl::appendSCPState(
+    uint64_t slot, std::vector<SCPEnvelope> const& envs,
+    std::vector<std::shared_ptr<TxSetFrame>> const& txSets,
+    std::vector<std::shared_ptr<SCPQuorumSet>> const& qSets,
+    std::vector<Hash> const& reusedItems)
+{
+    auto& db = mApp.getDatabase();
+    int64_t slotIndex = static_cast<int64_t>(slot);
+    size_t bytes = 0;
+
+    if (!mSCPStateSeqLoaded)
+    {
+        soci::indicator maxIndicator;
+        int64_t maxSeq = 0;
+        auto prep =
+            db.getPreparedStatement("SELECT MAX(seq) FROM scpstatelog");
+        auto& st = prep.statement();
+        st.exchange(soci::into(maxSeq, maxIndicator));
+        st.define_and_bind();
+        {
+            auto timer = db.getSelectTimer("scpstatelog");
+            st.execute(true);
+        }
+        if (st.got_data() && maxIndicator == soci::i_ok)
+        {
+            mNextSCPStateSeq = maxSeq + 1;
+        }
+        mSCPStateSeqLoaded = true;
+    }
+
+    for (auto const& txSet : txSets)
+    {
+        TransactionSet xdrTxSet;
+        txSet->toXDR(xdrTxSet);
+        bytes += insertSCPStateItem(slot, txSet->getContentsHash(),
+                                    SCP_STATE_TXSET,
+                                    xdr::xdr_to_opaque(xdrTxSet));
+    }
+    for (auto const& qSet : qSets)
+    {
+        auto qSetBytes(xdr::xdr_to_opaque(*qSet));
+        bytes += insertSCPStateItem(slot, sha256(qSetBytes), SCP_STATE_QSET,
+                                    qSetBytes);
+    }
+
+    for (auto const& h : reusedItems)
+    {
+        std::string hashHex = binToHex(h);
+        auto prep = db.getPreparedStatement(
+            "UPDATE scpstateitems SET slotindex = :s WHERE itemhash = :h");
+        auto& st = prep.statement();
+        st.exchange(soci::use(slotIndex));
+        st.exchange(soci::use(hashHex));
+        st.define_and_bind();
+        {
+            auto timer = db.getUpdateTimer("scpstateitems");
+            st.execute(true);
+        }
+    }
+
+    for (auto const& e : envs)
+    {
+        std::string envelopeEncoded = bn::encode_b64(xdr::xdr_to_opaque(e));
+        int64_t seq = mNextSCPStateSeq++;
+
+        auto prep = db.getPreparedStatement(
+            "INSERT INTO scpstatelog (seq, slotindex, envelope) "
+            "VALUES (:q, :s, :e)");
+        auto& st = prep.statement();
+        st.exchange(soci::use(seq));
+        st.exchange(soci::use(slotIndex));
+        st.exchange(soci::use(envelopeEncoded));
+        st.define_and_bind();
+        {
+            auto timer = db.getInsertTimer("scpstatelog");
+            st.execute(true);
+        }
+        if (st.get_affected_rows() != 1)
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
+        bytes += envelopeEncoded.size();
+    }
+
+    return bytes;
+}
+
+void
+HerderPersistenceImpl::loadSCPState(std::vector<SCPEnvelope>& envs,
+                                    std::vector<TransactionSet>& txSets,
+                                    std::vector<SCPQuorumSet>& qSets)
+{
+    auto& db = mApp.getDatabase();
+    auto& sess = db.getSession();
+
+    {
+        std::string item64;
+        int kind;
+
+        auto timer = db.getSelectTimer("scpstateitems");
+        soci::statement st =
+            (sess.prepare << "SELECT kind, item FROM scpstateitems",
+             soci::into(kind), soci::into(item64));
+        st.execute(true);
+        while (st.got_data())
+        {
+            std::vector<uint8_t> itemBytes;
+            bn::decode_b64(item64, itemBytes);
+            if (kind == SCP_STATE_TXSET)
+            {
+                txSets.emplace_back();
+                xdr::xdr_from_opaque(itemBytes, txSets.back());
+            }
+            else if (kind == SCP_STATE_QSET)
+            {
+                qSets.emplace_back();
+                xdr::xdr_from_opaque(itemBytes, qSets.back());
+            }
+            st.fetch();
+        }
+    }
+
+    {
+        std::string env64;
+        int64_t seq;
+
+        auto timer = db.getSelectTimer("scpstatelog");
+        soci::statement st =
+            (sess.prepare << "SELECT seq, envelope FROM scpstatelog "
+                             "ORDER BY seq",
+             soci::into(seq), soci::into(env64));
+        st.execute(true);
+        while (st.got_data())
+        {
+            std::vector<uint8_t> envBytes;
+            bn::decode_b64(env64, envBytes);
+            envs.emplace_back();
+            xdr::xdr_from_opaque(envBytes, envs.back());
+            mNextSCPStateSeq = std::max(mNextSCPStateSeq, seq + 1);
+            st.fetch();
+        }
+        mSCPStateSeqLoaded = true;
+    }
+}
+
+void
+HerderPersistenceImpl::purgeSCPState(uint64_t slot)
+{
+    auto& db = mApp.getDatabase();
+    int64_t slotIndex = static_cast<int64_t>(slot);
+
+    {
+        auto prep = db.getPreparedStatement(
+            "DELETE FROM scpstatelog WHERE slotindex < :s");
+        auto& st = prep.statement();
+        st.exchange(soci::use(slotIndex));
+        st.define_and_bind();
+        auto timer = db.getDeleteTimer("scpstatelog");
+        st.execute(true);
+    }
+    {
+        auto prep = db.getPreparedStatement(
+            "DELETE FROM scpstateitems WHERE slotindex < :s");
+        auto& st = prep.statement();
+        st.exchange(soci::use(slotIndex));
+        st.define_and_bind();
+        auto timer = db.getDeleteTimer("scpstateitems");
+        st.execute(true);
+    }
+}
+
 size_t
 HerderPersistence::copySCPHistoryToStream(Database& db, soci::session& sess,
                                           uint32_t ledgerSeq,
@@ -266,6 +475,29 @@ HerderPersistence::dropAll(Database& db)
                        ")";
 }
 
+void
+HerderPersistence::dropSCPState(Database& db)
+{
+    db.getSession() << "DROP TABLE IF EXISTS scpstatelog";
+
+    db.getSession() << "DROP TABLE IF EXISTS scpstateitems";
+
+    db.getSession() << "CREATE TABLE scpstatelog ("
+                       "seq         BIGINT NOT NULL,"
+                       "slotindex   BIGINT NOT NULL CHECK (slotindex >= 0),"
+                       "envelope    TEXT NOT NULL,"
+                       "PRIMARY KEY (seq)"
+                       ")";
+
+    db.getSession() << "CREATE TABLE scpstateitems ("
+                       "itemhash    CHARACTER(64) NOT NULL,"
+                       "slotindex   BIGINT NOT NULL CHECK (slotindex >= 0),"
+                       "kind        INT NOT NULL,"
+                       "item        TEXT NOT NULL,"
+                       "PRIMARY KEY (itemhash)"
+                       ")";
+}
+
 void
 HerderPersistence::deleteOldEntries(Database& db, uint32_t ledgerSeq,
                                     uint32_t count)
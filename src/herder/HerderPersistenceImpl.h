@@ -20,7 +20,24 @@ class HerderPersistenceImpl : public HerderPersistence
     void saveSCPHistory(uint32_t seq,
                         std::vector<SCPEnvelope> const& envs) override;
 
+    size_t
+    appendSCPState(uint64_t slot, std::vector<SCPEnvelope> const& envs,
+                   std::vector<std::shared_ptr<TxSetFrame>> const& txSets,
+                   std::vector<std::shared_ptr<SCPQuorumSet>> const& qSets,
+                   std::vector<Hash> const& reusedItems) override;
+    void loadSCPState(std::vector<SCPEnvelope>& envs,
+                      std::vector<TransactionSet>& txSets,
+                      std::vector<SCPQuorumSet>& qSets) override;
+    void purgeSCPState(uint64_t slot) override;
+
   private:
     Application& mApp;
+
+    // next sequence number in scpstatelog, loaded lazily
+    int64_t mNextSCPStateSeq;
+    bool mSCPStateSeqLoaded;
+
+    size_t insertSCPStateItem(uint64_t slot, Hash const& h, int kind,
+                              std::vector<uint8_t> const& bytes);
 };
 }
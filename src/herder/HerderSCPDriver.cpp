@@ -16,12 +16,17 @@
 #include "util/make_unique.h"
 #include "xdr/Stellar-SCP.h"
 #include "xdr/Stellar-ledger-entries.h"
+#include <medida/histogram.h>
 #include <medida/metrics_registry.h>
+#include <medida/timer.h>
 #include <xdrpp/marshal.h>
 
 namespace stellar
 {
 
+// Number of envelope signature verdicts remembered.
+static size_t const ENVELOPE_VERIFY_CACHE_SIZE = 0x4000;
+
 HerderSCPDriver::SCPMetrics::SCPMetrics(Application& app)
     : mEnvelopeSign(
           app.getMetrics().NewMeter({"scp", "envelope", "sign"}, "envelope"))
@@ -29,9 +34,20 @@ HerderSCPDriver::SCPMetrics::SCPMetrics(Application& app)
           {"scp", "envelope", "validsig"}, "envelope"))
     , mEnvelopeInvalidSig(app.getMetrics().NewMeter(
           {"scp", "envelope", "invalidsig"}, "envelope"))
+    , mEnvelopeVerifyCached(app.getMetrics().NewMeter(
+          {"scp", "envelope", "verify-cached"}, "envelope"))
+    , mEnvelopeVerifySig(app.getMetrics().NewMeter(
+          {"scp", "envelope", "verify-sig"}, "envelope"))
+    , mEnvelopeVerifyAsync(
+          app.getMetrics().NewTimer({"scp", "envelope", "verify-async"}))
     , mValueValid(app.getMetrics().NewMeter({"scp", "value", "valid"}, "value"))
     , mValueInvalid(
           app.getMetrics().NewMeter({"scp", "value", "invalid"}, "value"))
+    , mTxSetValidate(app.getMetrics().NewTimer({"scp", "txset", "validate"}))
+    , mTxSetValidateCached(app.getMetrics().NewMeter(
+          {"scp", "txset", "validate-cached"}, "txset"))
+    , mTxSetValidationsPerSlot(app.getMetrics().NewHistogram(
+          {"scp", "txset", "validations-per-slot"}))
     , mValueExternalize(
           app.getMetrics().NewMeter({"scp", "value", "externalize"}, "value"))
     , mQuorumHeard(
@@ -68,6 +84,8 @@ HerderSCPDriver::HerderSCPDriver(Application& app, HerderImpl& herder,
            mApp.getConfig().NODE_IS_VALIDATOR, mApp.getConfig().QUORUM_SET)
     , mSCPMetrics{mApp}
     , mLastStateChange{mApp.getClock().now()}
+    , mVerifiedEnvelopes{ENVELOPE_VERIFY_CACHE_SIZE}
+    , mVerificationQueues{std::make_shared<VerificationQueues>()}
 {
 }
 
@@ -137,6 +155,14 @@ HerderSCPDriver::signEnvelope(SCPEnvelope& envelope)
 bool
 HerderSCPDriver::verifyEnvelope(SCPEnvelope const& envelope)
 {
+    auto hash = sha256(xdr::xdr_to_opaque(envelope));
+    if (mVerifiedEnvelopes.exists(hash))
+    {
+        mSCPMetrics.mEnvelopeVerifyCached.Mark();
+        return mVerifiedEnvelopes.get(hash);
+    }
+
+    mSCPMetrics.mEnvelopeVerifySig.Mark();
     auto b = PubKeyUtils::verifySig(
         envelope.statement.nodeID, envelope.signature,
         xdr::xdr_to_opaque(mApp.getNetworkID(), ENVELOPE_TYPE_SCP,
@@ -149,10 +175,115 @@ HerderSCPDriver::verifyEnvelope(SCPEnvelope const& envelope)
     {
         mSCPMetrics.mEnvelopeInvalidSig.Mark();
     }
+    mVerifiedEnvelopes.put(hash, b);
 
     return b;
 }
 
+void
+HerderSCPDriver::verifyEnvelopeAsync(SCPEnvelope const& envelope)
+{
+    auto slotIndex = envelope.statement.slotIndex;
+    auto pending = std::make_shared<PendingVerification>();
+    pending->mEnvelope = envelope;
+    pending->mHash = sha256(xdr::xdr_to_opaque(envelope));
+    pending->mQueuedAt = mApp.getClock().now();
+    pending->mDone = false;
+    pending->mValid = false;
+    (*mVerificationQueues)[slotIndex].emplace_back(pending);
+
+    if (mVerifiedEnvelopes.exists(pending->mHash))
+    {
+        mSCPMetrics.mEnvelopeVerifyCached.Mark();
+        pending->mDone = true;
+        pending->mValid = mVerifiedEnvelopes.get(pending->mHash);
+        handBackVerified(slotIndex);
+        return;
+    }
+
+    auto inFlight = mInFlightVerifications.find(pending->mHash);
+    if (inFlight != mInFlightVerifications.end())
+    {
+        mSCPMetrics.mEnvelopeVerifyCached.Mark();
+        inFlight->second.emplace_back(pending);
+        return;
+    }
+    mInFlightVerifications[pending->mHash].emplace_back(pending);
+
+    auto payload = xdr::xdr_to_opaque(mApp.getNetworkID(), ENVELOPE_TYPE_SCP,
+                                      envelope.statement);
+    std::weak_ptr<VerificationQueues> alive = mVerificationQueues;
+    Application& app = mApp;
+    auto& verifySig = mSCPMetrics.mEnvelopeVerifySig;
+    app.getWorkerIOService().post([this, &app, &verifySig, alive, pending,
+                                   payload]() {
+        verifySig.Mark();
+        bool valid = PubKeyUtils::verifySig(pending->mEnvelope.statement.nodeID,
+                                            pending->mEnvelope.signature,
+                                            payload);
+        app.getClock().getIOService().post([this, alive, pending, valid]() {
+            if (!alive.lock())
+            {
+                return;
+            }
+            verifiedAsync(pending->mHash, valid);
+        });
+    });
+}
+
+void
+HerderSCPDriver::verifiedAsync(Hash const& hash, bool valid)
+{
+    auto it = mInFlightVerifications.find(hash);
+    if (it == mInFlightVerifications.end())
+    {
+        return;
+    }
+    auto waiting = std::move(it->second);
+    mInFlightVerifications.erase(it);
+
+    mVerifiedEnvelopes.put(hash, valid);
+    if (valid)
+    {
+        mSCPMetrics.mEnvelopeValidSig.Mark();
+    }
+    else
+    {
+        mSCPMetrics.mEnvelopeInvalidSig.Mark();
+    }
+
+    // copies of an envelope all belong to the same slot
+    for (auto& pending : waiting)
+    {
+        pending->mDone = true;
+        pending->mValid = valid;
+    }
+    handBackVerified(waiting.front()->mEnvelope.statement.slotIndex);
+}
+
+void
+HerderSCPDriver::handBackVerified(uint64_t slotIndex)
+{
+    auto it = mVerificationQueues->find(slotIndex);
+    while (it != mVerificationQueues->end() && !it->second.empty() &&
+           it->second.front()->mDone)
+    {
+        auto pending = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty())
+        {
+            mVerificationQueues->erase(it);
+        }
+
+        mSCPMetrics.mEnvelopeVerifyAsync.Update(mApp.getClock().now() -
+                                                pending->mQueuedAt);
+
+        // may re-enter verifyEnvelopeAsync (and this), look the slot up again
+        mHerder.recvVerifiedSCPEnvelope(pending->mEnvelope, pending->mValid);
+        it = mVerificationQueues->find(slotIndex);
+    }
+}
+
 void
 HerderSCPDriver::emitEnvelope(SCPEnvelope const& envelope)
 {
@@ -174,6 +305,49 @@ HerderSCPDriver::isSlotCompatibleWithCurrentState(uint64_t slotIndex) const
     return res;
 }
 
+bool
+HerderSCPDriver::checkTxSetValid(uint64_t slotIndex, TxSetFramePtr txSet,
+                                 uint64_t closeTime) const
+{
+    auto key = std::make_tuple(
+        slotIndex, mLedgerManager.getLastClosedLedgerHeader().hash,
+        txSet->getContentsHash(),
+        closeTime / Herder::EXP_LEDGER_TIMESPAN_SECONDS.count());
+    auto it = mTxSetValidity.find(key);
+    if (it != mTxSetValidity.end())
+    {
+        mSCPMetrics.mTxSetValidateCached.Mark();
+        return it->second;
+    }
+
+    bool valid;
+    {
+        auto timer = mSCPMetrics.mTxSetValidate.TimeScope();
+        valid = txSet->checkValid(mApp);
+    }
+    ++mTxSetValidations;
+    mTxSetValidity.emplace(key, valid);
+    return valid;
+}
+
+void
+HerderSCPDriver::purgeTxSetValidity(uint64_t slotIndex)
+{
+    mSCPMetrics.mTxSetValidationsPerSlot.Update(mTxSetValidations);
+    mTxSetValidations = 0;
+    for (auto it = mTxSetValidity.begin(); it != mTxSetValidity.end();)
+    {
+        if (std::get<0>(it->first) <= slotIndex)
+        {
+            it = mTxSetValidity.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
 SCPDriver::ValidationLevel
 HerderSCPDriver::validateValueHelper(uint64_t slotIndex,
                                      StellarValue const& b) const
@@ -251,7 +425,7 @@ HerderSCPDriver::validateValueHelper(uint64_t slotIndex,
 
         res = SCPDriver::kInvalidValue;
     }
-    else if (!txSet->checkValid(mApp))
+    else if (!checkTxSetValid(slotIndex, txSet, b.closeTime))
     {
         if (Logging::logDebug("Herder"))
             CLOG(DEBUG, "Herder") << "HerderSCPDriver::validateValue"
@@ -7,11 +7,21 @@
 #include "herder/Herder.h"
 #include "herder/TxSetFrame.h"
 #include "scp/SCPDriver.h"
+#include "util/HashOfHash.h"
+#include "util/Timer.h"
+#include "util/lrucache.hpp"
 #include "xdr/Stellar-ledger.h"
 
+#include <deque>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
 namespace medida
 {
 class Counter;
+class Histogram;
 class Meter;
 class Timer;
 }
@@ -66,6 +76,10 @@ class HerderSCPDriver : public SCPDriver
 
     void restoreSCPState(uint64_t index, StellarValue const& value);
 
+    // Forget memoized txset validation results for slots up to
+    // `slotIndex`; called when a ledger closes.
+    void purgeTxSetValidity(uint64_t slotIndex);
+
     // the ledger index that was last externalized
     uint32
     lastConsensusLedgerIndex() const
@@ -90,6 +104,14 @@ class HerderSCPDriver : public SCPDriver
     // envelope handling
     void signEnvelope(SCPEnvelope& envelope) override;
     bool verifyEnvelope(SCPEnvelope const& envelope) override;
+    // Checks the signature of `envelope` on a worker thread, then hands it
+    // back to HerderImpl::recvVerifiedSCPEnvelope on the main thread.
+    // Envelopes of a slot are handed back in the order they were queued.
+    // Verdicts are cached by envelope hash, and copies arriving while the
+    // first is still being checked share its check, so rebroadcasts (and the
+    // later verifyEnvelope call from SCP) never verify the same envelope
+    // twice.
+    void verifyEnvelopeAsync(SCPEnvelope const& envelope);
     void emitEnvelope(SCPEnvelope const& envelope) override;
 
     // value validation
@@ -145,10 +167,17 @@ class HerderSCPDriver : public SCPDriver
         medida::Meter& mEnvelopeSign;
         medida::Meter& mEnvelopeValidSig;
         medida::Meter& mEnvelopeInvalidSig;
+        medida::Meter& mEnvelopeVerifyCached;
+        medida::Meter& mEnvelopeVerifySig;
+        medida::Timer& mEnvelopeVerifyAsync;
 
         medida::Meter& mValueValid;
         medida::Meter& mValueInvalid;
 
+        medida::Timer& mTxSetValidate;
+        medida::Meter& mTxSetValidateCached;
+        medida::Histogram& mTxSetValidationsPerSlot;
+
         medida::Meter& mValueExternalize;
 
         // listeners
@@ -191,6 +220,43 @@ class HerderSCPDriver : public SCPDriver
 
     void stateChanged();
 
+    // signature verdicts, by envelope hash
+    cache::lru_cache<Hash, bool> mVerifiedEnvelopes;
+
+    struct PendingVerification
+    {
+        SCPEnvelope mEnvelope;
+        Hash mHash;
+        VirtualClock::time_point mQueuedAt;
+        bool mDone;
+        bool mValid;
+    };
+    using PendingVerificationPtr = std::shared_ptr<PendingVerification>;
+    // envelopes queued for (or done with) verification, per slot in arrival
+    // order; shared so that worker hand-backs can tell if we are still alive
+    using VerificationQueues =
+        std::map<uint64_t, std::deque<PendingVerificationPtr>>;
+    std::shared_ptr<VerificationQueues> mVerificationQueues;
+    // envelopes whose signature is being checked on a worker thread, by
+    // hash; copies arriving meanwhile wait on the same check
+    std::map<Hash, std::vector<PendingVerificationPtr>> mInFlightVerifications;
+
+    // records the verdict of a worker check, for every copy waiting on it
+    void verifiedAsync(Hash const& hash, bool valid);
+    // hands back the verified envelopes at the head of `slotIndex`'s queue
+    void handBackVerified(uint64_t slotIndex);
+
+    // TxSetFrame::checkValid results, keyed by (slot, LCL hash, txset hash,
+    // close time bucket): within a slot the same txset is seen in many
+    // statements from many validators, but only needs checking once.
+    using TxSetValidityKey = std::tuple<uint64_t, Hash, Hash, uint64_t>;
+    mutable std::map<TxSetValidityKey, bool> mTxSetValidity;
+    // full validations since the last purge
+    mutable int64_t mTxSetValidations{0};
+
+    bool checkTxSetValid(uint64_t slotIndex, TxSetFramePtr txSet,
+                         uint64_t closeTime) const;
+
     SCPDriver::ValidationLevel
     validateValueHelper(uint64_t slotIndex, StellarValue const& sv) const;
 
@@ -5,6 +5,7 @@
 #include "herder/HerderImpl.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "main/PersistentState.h"
 #include "scp/SCP.h"
 #include "simulation/Simulation.h"
 #include "test/TestAccount.h"
@@ -14,16 +15,24 @@
 
 #include "crypto/SHA.h"
 #include "database/Database.h"
+#include "herder/HerderPersistence.h"
+#include "herder/TxSetFrame.h"
 #include "ledger/DataFrame.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
+#include "lib/json/json.h"
 #include "main/CommandHandler.h"
 #include "main/Whitelist.h"
 #include "overlay/OverlayManager.h"
 #include "simulation/Simulation.h"
 #include "test/TxTests.h"
+#include "util/Logging.h"
+#include "util/basen.h"
 
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "xdrpp/marshal.h"
 
 using namespace stellar;
@@ -144,6 +153,76 @@ TEST_CASE("standalone", "[herder]")
     }
 }
 
+TEST_CASE("candidate txset", "[herder]")
+{
+    SIMULATION_CREATE_NODE(0);
+
+    Config cfg(getTestConfig());
+
+    cfg.NODE_SEED = v0SecretKey;
+
+    cfg.QUORUM_SET.threshold = 1;
+    cfg.QUORUM_SET.validators.clear();
+    cfg.QUORUM_SET.validators.push_back(v0NodeID);
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    app->start();
+
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = TestAccount{*app, getAccount("A")};
+    auto b1 = TestAccount{*app, getAccount("B")};
+    const int64_t paymentAmount = app->getLedgerManager().getMinBalance(0);
+
+    auto& lm = app->getLedgerManager();
+    auto& ready =
+        app->getMetrics().NewMeter({"herder", "candidate", "ready"}, "txset");
+    auto& prepare =
+        app->getMetrics().NewTimer({"herder", "candidate", "prepare"});
+    auto& nominationStart =
+        app->getMetrics().NewTimer({"herder", "nomination", "start"});
+
+    auto closeLedger = [&]() {
+        auto next = lm.getLastClosedLedgerNum() + 1;
+        while (lm.getLastClosedLedgerNum() < next)
+        {
+            app->getClock().crank(true);
+        }
+    };
+
+    closeLedger();
+    auto readyBefore = ready.count();
+    auto prepareBefore = prepare.count();
+
+    // the candidate for the next ledger gets built right after the close
+    while (prepare.count() == prepareBefore)
+    {
+        app->getClock().crank(true);
+    }
+    prepareBefore = prepare.count();
+
+    // transactions received mid-ledger are folded into the candidate before
+    // the trigger fires
+    REQUIRE(app->getHerder().recvTransaction(root.tx(
+                {createAccount(a1, paymentAmount)})) ==
+            Herder::TX_STATUS_PENDING);
+    REQUIRE(app->getHerder().recvTransaction(root.tx(
+                {createAccount(b1, paymentAmount)})) ==
+            Herder::TX_STATUS_PENDING);
+
+    closeLedger();
+
+    REQUIRE(prepare.count() > prepareBefore);
+    REQUIRE(ready.count() == readyBefore + 1);
+    REQUIRE(nominationStart.count() > 0);
+
+    REQUIRE(loadAccount(a1.getPublicKey(), *app)->getBalance() ==
+            paymentAmount);
+    REQUIRE(loadAccount(b1.getPublicKey(), *app)->getBalance() ==
+            paymentAmount);
+}
+
 // see if we flood at the right times
 //  invalid tx
 //  normal tx
@@ -1115,13 +1194,17 @@ TEST_CASE("surge", "[herder]")
             txSet->add(tx);
         }
         txSet->sortForHash();
-        txSet->surgePricingFilter(lm, *app);
+        std::set<AccountID> trimmed;
+        txSet->surgePricingFilter(lm, *app, &trimmed);
         REQUIRE(txSet->mTransactions.size() == 5);
         REQUIRE(txSet->checkValid(*app));
+        REQUIRE(txSet->checkValid(*app, &trimmed));
         for (auto& tx : txSet->mTransactions)
         {
             REQUIRE(tx->getSourceID() == accountB.getPublicKey());
         }
+        REQUIRE(trimmed == std::set<AccountID>{root.getPublicKey(),
+                                               accountB.getPublicKey()});
     }
 
     SECTION("one account paying more except for one tx")
@@ -1258,6 +1341,39 @@ TEST_CASE("SCP Driver", "[herder]")
         REQUIRE(sv.txSetHash == txSet1->getContentsHash());
     }
 
+    SECTION("validates each txset once per slot")
+    {
+        auto& herder = static_cast<HerderImpl&>(app->getHerder());
+        auto& driver = herder.getHerderSCPDriver();
+        auto slotIndex = herder.getCurrentLedgerSeq();
+
+        auto p = makeTxPair(makeTransactions(lcl.hash, 0), app->timeNow() + 1);
+        REQUIRE(herder.recvSCPEnvelope(makeEnvelope(p, {}, slotIndex)) ==
+                Herder::ENVELOPE_STATUS_FETCHING);
+        REQUIRE(herder.recvTxSet(p.second->getContentsHash(), *p.second));
+
+        auto& validate =
+            app->getMetrics().NewTimer({"scp", "txset", "validate"});
+        auto& cached = app->getMetrics().NewMeter(
+            {"scp", "txset", "validate-cached"}, "txset");
+        auto validateBefore = validate.count();
+        auto cachedBefore = cached.count();
+
+        for (int i = 0; i < 10; ++i)
+        {
+            REQUIRE(driver.validateValue(slotIndex, p.first, i % 2 == 0) ==
+                    SCPDriver::kFullyValidatedValue);
+        }
+        REQUIRE(validate.count() == validateBefore + 1);
+        REQUIRE(cached.count() == cachedBefore + 9);
+
+        // a new slot validates again
+        driver.purgeTxSetValidity(slotIndex);
+        REQUIRE(driver.validateValue(slotIndex, p.first, false) ==
+                SCPDriver::kFullyValidatedValue);
+        REQUIRE(validate.count() == validateBefore + 2);
+    }
+
     SECTION("accept qset and txset")
     {
         auto makePublicKey = [](int i) {
@@ -1581,6 +1697,111 @@ TEST_CASE("SCP State", "[herder]")
     }
 }
 
+TEST_CASE("SCP state log", "[herder]")
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto simulation =
+        std::make_shared<Simulation>(Simulation::OVER_LOOPBACK, networkID);
+
+    auto validatorKey = SecretKey::fromSeed(sha256("validator"));
+    SCPQuorumSet qSet;
+    qSet.threshold = 1;
+    qSet.validators.push_back(validatorKey.getPublicKey());
+
+    auto cfg = getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE);
+    auto validator = simulation->addNode(validatorKey, qSet, &cfg);
+    simulation->startAllNodes();
+
+    simulation->crankUntil(
+        [&]() {
+            return validator->getLedgerManager().getLastClosedLedgerNum() >= 4;
+        },
+        10 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    std::vector<SCPEnvelope> envs;
+    std::vector<TransactionSet> txSets;
+    std::vector<SCPQuorumSet> qSets;
+    validator->getHerderPersistence().loadSCPState(envs, txSets, qSets);
+
+    // only the last slot is kept, with every statement emitted for it
+    REQUIRE(!envs.empty());
+    auto slot = envs.back().statement.slotIndex;
+    for (auto const& e : envs)
+    {
+        REQUIRE(e.statement.slotIndex == slot);
+    }
+
+    auto& herder = static_cast<HerderImpl&>(validator->getHerder());
+    auto latest = herder.getSCP().getLatestMessagesSend(slot);
+    REQUIRE(envs.size() >= latest.size());
+
+    // each item is written once
+    REQUIRE(qSets.size() == 1);
+    std::set<Hash> txSetHashes;
+    for (auto const& txSet : txSets)
+    {
+        TxSetFrame frame(networkID, txSet);
+        REQUIRE(txSetHashes.insert(frame.getContentsHash()).second);
+    }
+
+    // restart the node, it picks up from the log
+    cfg = validator->getConfig();
+    simulation.reset();
+    simulation =
+        std::make_shared<Simulation>(Simulation::OVER_LOOPBACK, networkID);
+    auto restarted = simulation->addNode(validatorKey, qSet, &cfg, false);
+    restarted->start();
+
+    auto& restartedHerder = static_cast<HerderImpl&>(restarted->getHerder());
+    auto restored = restartedHerder.getSCP().getLatestMessagesSend(slot);
+    REQUIRE(restored.size() == latest.size());
+    for (size_t i = 0; i < latest.size(); i++)
+    {
+        REQUIRE(xdr::xdr_to_opaque(restored[i]) ==
+                xdr::xdr_to_opaque(latest[i]));
+    }
+
+    // replace the log with the state saved by versions without it: it is
+    // restored once and moved into the log
+    xdr::xvector<SCPEnvelope> legacyEnvs;
+    xdr::xvector<TransactionSet> legacyTxSets;
+    xdr::xvector<SCPQuorumSet> legacyQSets;
+    legacyEnvs.assign(latest.begin(), latest.end());
+    legacyTxSets.assign(txSets.begin(), txSets.end());
+    legacyQSets.assign(qSets.begin(), qSets.end());
+    restarted->getPersistentState().setState(
+        PersistentState::kLastSCPData,
+        bn::encode_b64(
+            xdr::xdr_to_opaque(legacyEnvs, legacyTxSets, legacyQSets)));
+    HerderPersistence::dropSCPState(restarted->getDatabase());
+
+    cfg = restarted->getConfig();
+    simulation.reset();
+    simulation =
+        std::make_shared<Simulation>(Simulation::OVER_LOOPBACK, networkID);
+    auto upgraded = simulation->addNode(validatorKey, qSet, &cfg, false);
+    upgraded->start();
+
+    auto& upgradedHerder = static_cast<HerderImpl&>(upgraded->getHerder());
+    restored = upgradedHerder.getSCP().getLatestMessagesSend(slot);
+    REQUIRE(restored.size() == latest.size());
+    for (size_t i = 0; i < latest.size(); i++)
+    {
+        REQUIRE(xdr::xdr_to_opaque(restored[i]) ==
+                xdr::xdr_to_opaque(latest[i]));
+    }
+    REQUIRE(upgraded->getPersistentState()
+                .getState(PersistentState::kLastSCPData)
+                .empty());
+
+    envs.clear();
+    txSets.clear();
+    qSets.clear();
+    upgraded->getHerderPersistence().loadSCPState(envs, txSets, qSets);
+    REQUIRE(envs.size() == latest.size());
+    REQUIRE(qSets.size() == 1);
+}
+
 TEST_CASE("quick restart", "[herder][quickRestart]")
 {
     auto mode = Simulation::OVER_LOOPBACK;
@@ -1695,3 +1916,201 @@ TEST_CASE("quick restart", "[herder][quickRestart]")
 
     simulation->stopAllNodes();
 }
+
+TEST_CASE("SCP envelope verification", "[herder]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+
+    auto& herder = static_cast<HerderImpl&>(app->getHerder());
+    auto& scp = herder.getSCP();
+    auto const& lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+    uint64_t slotIndex = lcl.header.ledgerSeq + 1;
+
+    auto txSet = std::make_shared<TxSetFrame>(lcl.hash);
+    txSet->sortForHash();
+    auto value = xdr::xdr_to_opaque(
+        StellarValue{txSet->getContentsHash(), 1, emptyUpgradeSteps, 0});
+
+    auto makeKey = [](size_t i) {
+        return SecretKey::fromSeed(sha256("validator-" + std::to_string(i)));
+    };
+    SCPQuorumSet qSet;
+    qSet.threshold = 1;
+    qSet.validators.push_back(makeKey(0).getPublicKey());
+    auto qSetHash = sha256(xdr::xdr_to_opaque(qSet));
+
+    auto makeEnvelope = [&](size_t i) {
+        auto key = makeKey(i);
+        SCPEnvelope e;
+        e.statement.nodeID = key.getPublicKey();
+        e.statement.slotIndex = slotIndex;
+        e.statement.pledges.type(SCP_ST_NOMINATE);
+        auto& nom = e.statement.pledges.nominate();
+        nom.quorumSetHash = qSetHash;
+        nom.votes.emplace_back(value);
+        e.signature = key.sign(xdr::xdr_to_opaque(
+            app->getNetworkID(), ENVELOPE_TYPE_SCP, e.statement));
+        return e;
+    };
+
+    // the first envelope gets the herder to fetch the quorum set and txset,
+    // so that the next ones reach SCP as soon as they are handed back
+    REQUIRE(herder.recvSCPEnvelope(makeEnvelope(0)) ==
+            Herder::ENVELOPE_STATUS_FETCHING);
+    REQUIRE(herder.recvSCPQuorumSet(qSetHash, qSet));
+    REQUIRE(herder.recvTxSet(txSet->getContentsHash(), *txSet));
+    REQUIRE(scp.getCumulativeStatemtCount() == 1);
+
+    auto& handedBack =
+        app->getMetrics().NewTimer({"scp", "envelope", "verify-async"});
+    auto& verifySig = app->getMetrics().NewMeter(
+        {"scp", "envelope", "verify-sig"}, "envelope");
+    auto& invalidSig = app->getMetrics().NewMeter(
+        {"scp", "envelope", "invalidsig"}, "envelope");
+    auto& received =
+        app->getMetrics().NewMeter({"scp", "envelope", "receive"}, "envelope");
+    auto verifySigBefore = verifySig.count();
+    auto invalidSigBefore = invalidSig.count();
+    auto receivedBefore = received.count();
+
+    auto recvUnverified = [&](std::vector<SCPEnvelope> const& envelopes) {
+        auto before = handedBack.count();
+        for (auto const& e : envelopes)
+        {
+            herder.recvUnverifiedSCPEnvelope(e);
+        }
+        while (handedBack.count() < before + envelopes.size())
+        {
+            clock.crank(false);
+        }
+    };
+    // statements SCP processed for the slot, in order
+    auto processed = [&]() {
+        Json::Value info;
+        scp.dumpInfo(info, 1);
+        std::vector<std::string> res;
+        for (auto const& st : info["slots"][std::to_string(slotIndex)]
+                                  ["statements"])
+        {
+            res.emplace_back(st[1].asString());
+        }
+        return res;
+    };
+
+    SECTION("handed back in arrival order")
+    {
+        std::vector<SCPEnvelope> envelopes;
+        for (size_t i = 20; i > 0; --i)
+        {
+            envelopes.emplace_back(makeEnvelope(i));
+        }
+        recvUnverified(envelopes);
+
+        auto statements = processed();
+        REQUIRE(statements.size() == envelopes.size() + 1);
+        for (size_t i = 0; i < envelopes.size(); ++i)
+        {
+            REQUIRE(statements[i + 1] ==
+                    scp.envToStr(envelopes[i].statement));
+        }
+        REQUIRE(verifySig.count() == verifySigBefore + envelopes.size());
+        REQUIRE(received.count() == receivedBefore + envelopes.size());
+    }
+
+    SECTION("bad signature is dropped before SCP")
+    {
+        auto bad = makeEnvelope(1);
+        bad.signature[0] ^= 1;
+        auto good = makeEnvelope(2);
+        recvUnverified({bad, good});
+
+        REQUIRE(invalidSig.count() == invalidSigBefore + 1);
+        REQUIRE(received.count() == receivedBefore + 1);
+        auto statements = processed();
+        REQUIRE(statements.size() == 2);
+        REQUIRE(statements[1] == scp.envToStr(good.statement));
+    }
+
+    SECTION("in-flight duplicates share one check")
+    {
+        auto e = makeEnvelope(1);
+        recvUnverified(std::vector<SCPEnvelope>(5, e));
+
+        REQUIRE(verifySig.count() == verifySigBefore + 1);
+        REQUIRE(received.count() == receivedBefore + 5);
+        REQUIRE(processed().size() == 2);
+    }
+}
+
+TEST_CASE("SCP envelope verification benchmarking",
+          "[herder][bench][hide]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+
+    auto& herder = static_cast<HerderImpl&>(app->getHerder());
+    auto slotIndex = herder.getCurrentLedgerSeq();
+
+    // 100 validators, each nominating a few values; every envelope also
+    // arrives a second time, as rebroadcast by another peer
+    size_t const nValidators = 100;
+    size_t const nPerValidator = 20;
+    std::vector<SCPEnvelope> envelopes;
+    for (size_t i = 0; i < nValidators; ++i)
+    {
+        auto key =
+            SecretKey::fromSeed(sha256("validator-" + std::to_string(i)));
+        SCPQuorumSet qSet;
+        qSet.threshold = 1;
+        qSet.validators.push_back(key.getPublicKey());
+        for (size_t j = 0; j < nPerValidator; ++j)
+        {
+            SCPEnvelope e;
+            e.statement.nodeID = key.getPublicKey();
+            e.statement.slotIndex = slotIndex;
+            e.statement.pledges.type(SCP_ST_NOMINATE);
+            auto& nom = e.statement.pledges.nominate();
+            nom.quorumSetHash = sha256(xdr::xdr_to_opaque(qSet));
+            nom.votes.emplace_back(
+                xdr::xdr_to_opaque(sha256(std::to_string(j))));
+            e.signature = key.sign(xdr::xdr_to_opaque(
+                app->getNetworkID(), ENVELOPE_TYPE_SCP, e.statement));
+            envelopes.emplace_back(e);
+        }
+    }
+
+    auto& handedBack =
+        app->getMetrics().NewTimer({"scp", "envelope", "verify-async"});
+    auto& verified = app->getMetrics().NewMeter(
+        {"scp", "envelope", "verify-sig"}, "envelope");
+    auto before = handedBack.count();
+    auto verifiedBefore = verified.count();
+    size_t const n = 2 * envelopes.size();
+
+    LOG(INFO) << "Benchmarking " << n << " envelopes from " << nValidators
+              << " validators";
+    auto start = std::chrono::steady_clock::now();
+    {
+        TIMED_SCOPE(timerBlkObj, "envelope verification");
+        for (int round = 0; round < 2; ++round)
+        {
+            for (auto const& e : envelopes)
+            {
+                herder.recvUnverifiedSCPEnvelope(e);
+            }
+        }
+        while (handedBack.count() < before + n)
+        {
+            clock.crank(false);
+        }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    LOG(INFO) << "Envelopes/sec: " << (n / elapsed.count());
+
+    // rebroadcasts were not verified again, even those that arrived while
+    // the first copy was still being checked
+    REQUIRE(verified.count() - verifiedBefore == envelopes.size());
+}
@@ -54,6 +54,7 @@ HashTxSorter(TransactionFramePtr const& tx1, TransactionFramePtr const& tx2)
 void
 TxSetFrame::sortForHash()
 {
+    TransactionFrame::computeFullHashes(mTransactions);
     std::sort(mTransactions.begin(), mTransactions.end(), HashTxSorter);
     mHashIsValid = false;
 }
@@ -175,7 +176,8 @@ struct SurgeSorter
 };
 
 void
-TxSetFrame::surgePricingFilter(LedgerManager const& lm, Application& app)
+TxSetFrame::surgePricingFilter(LedgerManager const& lm, Application& app,
+                               std::set<AccountID>* trimmed)
 {
     /*
 	Sorting in a whitelisted world:
@@ -241,6 +243,8 @@ TxSetFrame::surgePricingFilter(LedgerManager const& lm, Application& app)
             for (auto iter = whitelisted.begin() + (max - reserveCapacity);
                  iter != whitelisted.end(); iter++)
             {
+                if (trimmed)
+                    trimmed->insert((*iter)->getSourceID());
                 removeTx(*iter);
             }
 
@@ -265,6 +269,8 @@ TxSetFrame::surgePricingFilter(LedgerManager const& lm, Application& app)
         for (auto iter = tempList.begin() + totalCapacity;
              iter != tempList.end(); iter++)
         {
+            if (trimmed)
+                trimmed->insert((*iter)->getSourceID());
             removeTx(*iter);
         }
     }
@@ -276,10 +282,12 @@ TxSetFrame::checkOrTrim(
     std::function<bool(TransactionFramePtr, SequenceNumber)>
         processInvalidTxLambda,
     std::function<bool(std::vector<TransactionFramePtr> const&)>
-        processInsufficientBalance)
+        processInsufficientBalance,
+    std::set<AccountID> const* accounts)
 {
     map<AccountID, vector<TransactionFramePtr>> accountTxMap;
 
+    TransactionFrame::computeFullHashes(mTransactions);
     Hash lastHash;
     for (auto& tx : mTransactions)
     {
@@ -296,6 +304,11 @@ TxSetFrame::checkOrTrim(
 
     for (auto& item : accountTxMap)
     {
+        if (accounts && accounts->find(item.first) == accounts->end())
+        {
+            continue;
+        }
+
         // order by sequence number
         std::sort(item.second.begin(), item.second.end(), SeqSorter);
 
@@ -335,7 +348,8 @@ TxSetFrame::checkOrTrim(
 
 void
 TxSetFrame::trimInvalid(Application& app,
-                        std::vector<TransactionFramePtr>& trimmed)
+                        std::vector<TransactionFramePtr>& trimmed,
+                        std::set<AccountID> const* accounts)
 {
     // Establish read-only transaction for duration of trimInvalid
     soci::transaction sqltx(app.getDatabase().getSession());
@@ -370,14 +384,15 @@ TxSetFrame::trimInvalid(Application& app,
             return true;
         };
 
-    checkOrTrim(app, processInvalidTxLambda, processInsufficientBalance);
+    checkOrTrim(app, processInvalidTxLambda, processInsufficientBalance,
+                accounts);
 }
 
 // need to make sure every account that is submitting a tx has enough to pay
 // the fees of all the tx it has submitted in this set
 // check seq num
 bool
-TxSetFrame::checkValid(Application& app)
+TxSetFrame::checkValid(Application& app, std::set<AccountID> const* accounts)
 {
     // Establish read-only transaction for duration of checkValid
     soci::transaction sqltx(app.getDatabase().getSession());
@@ -422,7 +437,8 @@ TxSetFrame::checkValid(Application& app)
 
             return false;
         };
-    return checkOrTrim(app, processInvalidTxLambda, processInsufficientBalance);
+    return checkOrTrim(app, processInvalidTxLambda, processInsufficientBalance,
+                       accounts);
 }
 
 void
@@ -6,6 +6,7 @@
 
 #include "overlay/StellarXDR.h"
 #include "transactions/TransactionFrame.h"
+#include <set>
 
 namespace stellar
 {
@@ -26,7 +27,8 @@ class TxSetFrame
                 std::function<bool(TransactionFramePtr, SequenceNumber)>
                     processInvalidTxLambda,
                 std::function<bool(std::vector<TransactionFramePtr> const&)>
-                    processLastInvalidTxLambda);
+                    processLastInvalidTxLambda,
+                std::set<AccountID> const* accounts = nullptr);
 
   public:
     std::vector<TransactionFramePtr> mTransactions;
@@ -48,10 +50,17 @@ class TxSetFrame
 
     std::vector<TransactionFramePtr> sortForApply();
 
-    bool checkValid(Application& app);
+    // when `accounts` is set, only transactions from these accounts are
+    // checked: the others are known to be valid already
+    bool checkValid(Application& app,
+                    std::set<AccountID> const* accounts = nullptr);
     void trimInvalid(Application& app,
-                     std::vector<TransactionFramePtr>& trimmed);
-    void surgePricingFilter(LedgerManager const& lm, Application& app);
+                     std::vector<TransactionFramePtr>& trimmed,
+                     std::set<AccountID> const* accounts = nullptr);
+    // when `trimmed` is set, the source accounts of the transactions removed
+    // from the set are added to it
+    void surgePricingFilter(LedgerManager const& lm, Application& app,
+                            std::set<AccountID>* trimmed = nullptr);
 
     void removeTx(TransactionFramePtr tx);
 
@@ -26,6 +26,7 @@
 #include "main/Config.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/StellarXDR.h"
 #include "process/ProcessManager.h"
 #include "util/Logging.h"
@@ -217,6 +218,7 @@ HistoryManagerImpl::HistoryManagerImpl(Application& app)
           app.getMetrics().NewMeter({"history", "publish", "success"}, "event"))
     , mPublishFailure(
           app.getMetrics().NewMeter({"history", "publish", "failure"}, "event"))
+    , mPublishTime(app.getMetrics().NewTimer({"history", "publish", "time"}))
 {
 }
 
@@ -480,6 +482,9 @@ HistoryManagerImpl::maybeQueueHistoryCheckpoint()
 void
 HistoryManagerImpl::queueCurrentHistory()
 {
+    // before the new state is in the database, or it would be counted twice
+    fillPublishQueueBuckets();
+
     auto has = getLastClosedHistoryArchiveState();
 
     auto ledger = has.currentLedger;
@@ -503,7 +508,9 @@ HistoryManagerImpl::queueCurrentHistory()
     // merges-in-progress, avoid restarting them.
 
     mPublishQueue.Mark();
-    mPublishQueueBuckets.addBuckets(has.allBuckets());
+    auto buckets = has.allBuckets();
+    mPublishQueueBuckets.addBuckets(buckets);
+    mApp.getBucketManager().retainBuckets(buckets);
     takeSnapshotAndPublish(has);
 }
 
@@ -519,6 +526,7 @@ HistoryManagerImpl::takeSnapshotAndPublish(HistoryArchiveState const& has)
     CLOG(DEBUG, "History") << "Activating publish for ledger " << ledgerSeq;
     auto snap = std::make_shared<StateSnapshot>(mApp, has);
 
+    mPublishStartTime = mApp.getClock().now();
     mPublishWork = mApp.getWorkManager().addWork<PublishWork>(snap);
     mApp.getWorkManager().advanceChildren();
 }
@@ -582,14 +590,28 @@ HistoryManagerImpl::loadBucketsReferencedByPublishQueue()
     return result;
 }
 
-std::vector<std::string>
-HistoryManagerImpl::getBucketsReferencedByPublishQueue()
+void
+HistoryManagerImpl::fillPublishQueueBuckets()
 {
-    if (!mPublishQueueBucketsFilled)
+    if (mPublishQueueBucketsFilled)
+    {
+        return;
+    }
+    auto buckets = loadBucketsReferencedByPublishQueue();
+    std::vector<std::string> references;
+    for (auto const& b : buckets)
     {
-        mPublishQueueBuckets.setBuckets(loadBucketsReferencedByPublishQueue());
-        mPublishQueueBucketsFilled = true;
+        references.insert(references.end(), b.second, b.first);
     }
+    mApp.getBucketManager().retainBuckets(references);
+    mPublishQueueBuckets.setBuckets(buckets);
+    mPublishQueueBucketsFilled = true;
+}
+
+std::vector<std::string>
+HistoryManagerImpl::getBucketsReferencedByPublishQueue()
+{
+    fillPublishQueueBuckets();
 
     std::vector<std::string> buckets;
     for (auto const& s : mPublishQueueBuckets.map())
@@ -618,9 +640,12 @@ HistoryManagerImpl::historyPublished(
     uint32_t ledgerSeq, std::vector<std::string> const& originalBuckets,
     bool success)
 {
+    // before the state leaves the database, or it would never be counted
+    fillPublishQueueBuckets();
     if (success)
     {
         this->mPublishSuccess.Mark();
+        mPublishTime.Update(mApp.getClock().now() - mPublishStartTime);
         auto timer = mApp.getDatabase().getDeleteTimer("publishqueue");
         auto prep = mApp.getDatabase().getPreparedStatement(
             "DELETE FROM publishqueue WHERE ledger = :lg;");
@@ -630,6 +655,7 @@ HistoryManagerImpl::historyPublished(
         st.execute(true);
 
         mPublishQueueBuckets.removeBuckets(originalBuckets);
+        mApp.getBucketManager().releaseBuckets(originalBuckets);
     }
     else
     {
@@ -6,12 +6,14 @@
 
 #include "bucket/PublishQueueBuckets.h"
 #include "history/HistoryManager.h"
+#include "util/Timer.h"
 #include "util/TmpDir.h"
 #include <memory>
 
 namespace medida
 {
 class Meter;
+class Timer;
 }
 
 namespace stellar
@@ -35,7 +37,14 @@ class HistoryManagerImpl : public HistoryManager
     medida::Meter& mPublishSuccess;
     medida::Meter& mPublishFailure;
 
+    // wall time from taking a checkpoint's snapshot to its being published
+    medida::Timer& mPublishTime;
+    VirtualClock::time_point mPublishStartTime;
+
     PublishQueueBuckets::BucketCount loadBucketsReferencedByPublishQueue();
+    // Loads mPublishQueueBuckets from the database the first time round and
+    // retains those buckets in the BucketManager.
+    void fillPublishQueueBuckets();
 
   public:
     HistoryManagerImpl(Application& app);
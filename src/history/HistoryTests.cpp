@@ -2,14 +2,18 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/Bucket.h"
+#include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "catchup/CatchupWorkTests.h"
+#include "crypto/SHA.h"
 #include "history/HistoryManager.h"
 #include "history/HistoryTestsUtils.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
 #include "historywork/GunzipFileWork.h"
 #include "historywork/GzipFileWork.h"
 #include "historywork/PutHistoryArchiveStateWork.h"
+#include "ledger/AccountFrame.h"
 #include "ledger/LedgerManager.h"
 #include "main/ExternalQueue.h"
 #include "main/PersistentState.h"
@@ -17,10 +21,13 @@
 #include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Fs.h"
+#include "util/XDRStream.h"
 #include "work/WorkManager.h"
 
 #include <lib/catch.hpp>
 #include <lib/util/format.h>
+#include <medida/metrics_registry.h>
+#include <medida/timer.h>
 
 using namespace stellar;
 using namespace historytestutils;
@@ -68,6 +75,46 @@ TEST_CASE("HistoryManager::compress", "[history]")
     REQUIRE(!fs::exists(compressed));
 }
 
+TEST_CASE("XDROutputFileStream gzip", "[history]")
+{
+    CatchupSimulation catchupSimulation{};
+
+    std::vector<Hash> hashes;
+    for (int i = 0; i < 1000; ++i)
+    {
+        hashes.emplace_back(sha256(std::to_string(i)));
+    }
+
+    HistoryManager& hm = catchupSimulation.getApp().getHistoryManager();
+    std::string fname = hm.localFilename("gzipme");
+    std::string compressed = fname + ".gz";
+    {
+        XDROutputFileStream out;
+        out.open(compressed, true);
+        for (auto const& h : hashes)
+        {
+            REQUIRE(out.writeOne(h));
+        }
+        out.close();
+    }
+
+    auto& wm = catchupSimulation.getApp().getWorkManager();
+    auto u = wm.executeWork<GunzipFileWork>(true, compressed);
+    REQUIRE(u->getState() == Work::WORK_SUCCESS);
+    REQUIRE(fs::exists(fname));
+
+    XDRInputFileStream in;
+    in.open(fname);
+    Hash h;
+    size_t n = 0;
+    while (in.readOne(h))
+    {
+        REQUIRE(n < hashes.size());
+        REQUIRE(h == hashes[n++]);
+    }
+    REQUIRE(n == hashes.size());
+}
+
 TEST_CASE("HistoryArchiveState::get_put", "[history]")
 {
     CatchupSimulation catchupSimulation{};
@@ -98,6 +145,16 @@ TEST_CASE("History publish", "[history]")
     CatchupSimulation catchupSimulation{};
 
     catchupSimulation.generateAndPublishInitialHistory(1);
+
+    auto& metrics = catchupSimulation.getApp().getMetrics();
+    auto& publishTime = metrics.NewTimer({"history", "publish", "time"});
+    REQUIRE(publishTime.count() ==
+            catchupSimulation.getApp()
+                .getHistoryManager()
+                .getPublishSuccessCount());
+    REQUIRE(
+        metrics.NewTimer({"history", "snapshot", "main-thread"}).count() >=
+        publishTime.count());
 }
 
 static std::string
@@ -166,6 +223,66 @@ TEST_CASE("Full history catchup", "[history][historycatchup]")
     }
 }
 
+TEST_CASE("History catchup with merged bucket apply",
+          "[history][historycatchup]")
+{
+    CatchupSimulation catchupSimulation{};
+
+    catchupSimulation.generateAndPublishInitialHistory(3);
+
+    uint32_t initLedger =
+        catchupSimulation.getApp().getLedgerManager().getLastClosedLedgerNum();
+
+    std::vector<Config::TestDbMode> dbModes = {Config::TESTDB_IN_MEMORY_SQLITE};
+#ifdef USE_POSTGRES
+    // where the merged bucket is applied in shards
+    if (!force_sqlite)
+        dbModes.push_back(Config::TESTDB_POSTGRESQL);
+#endif
+
+    int instance = 0;
+    for (auto dbMode : dbModes)
+    {
+        auto catchup = [&](bool mergeBuckets) {
+            auto cfg = getTestConfig(++instance, dbMode);
+            cfg.CATCHUP_MERGE_BUCKETS = mergeBuckets;
+            auto app = createTestApplication(
+                catchupSimulation.getClock(),
+                catchupSimulation.getHistoryConfigurator().configure(cfg,
+                                                                     false));
+            app->start();
+            REQUIRE(catchupSimulation.catchupApplication(initLedger, 0, false,
+                                                         app));
+            return app;
+        };
+
+        auto perLevel = catchup(false);
+        auto merged = catchup(true);
+
+        // everything that was applied was applied at once
+        auto& applied = merged->getMetrics().NewMeter(
+            {"history", "bucket-apply", "success"}, "event");
+        REQUIRE(applied.count() == 1);
+
+        // to the same state as a level by level apply
+        REQUIRE(merged->getLedgerManager().getLastClosedLedgerHeader().hash ==
+                perLevel->getLedgerManager().getLastClosedLedgerHeader().hash);
+        REQUIRE(merged->getBucketManager().getBucketList().getHash() ==
+                perLevel->getBucketManager().getBucketList().getHash());
+        for (auto app : {perLevel, merged})
+        {
+            REQUIRE_NOTHROW(checkDBAgainstBuckets(
+                app->getMetrics(), app->getBucketManager(),
+                app->getDatabase(), app->getBucketManager().getBucketList()));
+        }
+        auto votes = AccountFrame::loadInflationVotes(merged->getDatabase());
+        REQUIRE(votes ==
+                AccountFrame::tallyInflationVotes(merged->getDatabase()));
+        REQUIRE(votes ==
+                AccountFrame::loadInflationVotes(perLevel->getDatabase()));
+    }
+}
+
 TEST_CASE("History publish queueing", "[history][historydelay][historycatchup]")
 {
     CatchupSimulation catchupSimulation{};
@@ -24,6 +24,10 @@
 #include "medida/counter.h"
 #include "medida/metrics_registry.h"
 
+#include <exception>
+#include <functional>
+#include <future>
+
 namespace stellar
 {
 
@@ -60,67 +64,118 @@ StateSnapshot::makeLive()
     }
 }
 
+namespace
+{
+// Runs job over a session of its own from the pool on a new thread, or, with
+// no pool available, over the main session when the result is asked for.
+std::future<size_t>
+runSnapshotJob(Database& db, std::function<size_t(soci::session&)> job)
+{
+    if (!db.canUsePool())
+    {
+        return std::async(std::launch::deferred, [&db, job]() {
+            soci::transaction tx(db.getSession());
+            return job(db.getSession());
+        });
+    }
+    auto& pool = db.getPool();
+    return std::async(std::launch::async, [&pool, job]() {
+        soci::session sess(pool);
+        soci::transaction tx(sess);
+        return job(sess);
+    });
+}
+}
+
 bool
-StateSnapshot::writeHistoryBlocks() const
+StateSnapshot::writeHistoryBlocks()
 {
-    std::unique_ptr<soci::session> snapSess(
-        mApp.getDatabase().canUsePool()
-            ? make_unique<soci::session>(mApp.getDatabase().getPool())
-            : nullptr);
-    soci::session& sess(snapSess ? *snapSess : mApp.getDatabase().getSession());
-    soci::transaction tx(sess);
+    auto& db = mApp.getDatabase();
 
     // The current "history block" is stored in _four_ files, one just ledger
     // headers, one TransactionHistoryEntry (which contain txSets),
     // one TransactionHistoryResultEntry containing transaction set results and
     // one (optional) SCPHistoryEntry containing the SCP messages used to close.
-    // All files are streamed out of the database, entry-by-entry.
-    size_t nbSCPMessages;
-    uint32_t begin, count;
-    size_t nHeaders;
+    // All files are streamed out of the database entry-by-entry and gzipped
+    // on the way to disk. Transactions and their results come out of
+    // the same rows so they share a job; the rest each get their own.
+    //
+    // 'mLocalState' describes the LCL, so its currentLedger will usually be
+    // 63, 127, 191, etc. We want to start our snapshot at 64-before the
+    // _next_ ledger: 0, 64, 128, etc. In cases where we're forcibly
+    // checkpointed early, we still want to round-down to the previous
+    // checkpoint ledger.
+    auto& hm = mApp.getHistoryManager();
+    uint32_t begin = hm.prevCheckpointLedger(mLocalState.currentLedger);
+    uint32_t count = (mLocalState.currentLedger - begin) + 1;
+    CLOG(DEBUG, "History") << "Streaming " << count
+                           << " ledgers worth of history, from " << begin;
+
+    auto headersJob = runSnapshotJob(db, [&](soci::session& sess) {
+        XDROutputFileStream ledgerOut;
+        ledgerOut.open(mLedgerSnapFile->localPath_gz(), true);
+        auto n = LedgerHeaderFrame::copyLedgerHeadersToStream(
+            db, sess, begin, count, ledgerOut);
+        ledgerOut.close();
+        return n;
+    });
+    auto txJob = runSnapshotJob(db, [&](soci::session& sess) {
+        XDROutputFileStream txOut, txResultOut;
+        txOut.open(mTransactionSnapFile->localPath_gz(), true);
+        txResultOut.open(mTransactionResultSnapFile->localPath_gz(), true);
+        auto n = TransactionFrame::copyTransactionsToStream(
+            mApp.getNetworkID(), db, sess, begin, count, txOut, txResultOut);
+        txOut.close();
+        txResultOut.close();
+        return n;
+    });
+    auto scpJob = runSnapshotJob(db, [&](soci::session& sess) {
+        XDROutputFileStream scpHistory;
+        scpHistory.open(mSCPHistorySnapFile->localPath_gz(), true);
+        auto n = HerderPersistence::copySCPHistoryToStream(db, sess, begin,
+                                                           count, scpHistory);
+        scpHistory.close();
+        return n;
+    });
+
+    // every job has to be waited for before any error is let out, as they
+    // all refer to this frame
+    std::exception_ptr error;
+    auto finish = [&error](std::future<size_t>& job) -> size_t {
+        try
+        {
+            return job.get();
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            return 0;
+        }
+    };
+    size_t nHeaders = finish(headersJob);
+    size_t nTxs = finish(txJob);
+    size_t nbSCPMessages = finish(scpJob);
+    if (error)
     {
-        XDROutputFileStream ledgerOut, txOut, txResultOut, scpHistory;
-        ledgerOut.open(mLedgerSnapFile->localPath_nogz());
-        txOut.open(mTransactionSnapFile->localPath_nogz());
-        txResultOut.open(mTransactionResultSnapFile->localPath_nogz());
-        scpHistory.open(mSCPHistorySnapFile->localPath_nogz());
-
-        // 'mLocalState' describes the LCL, so its currentLedger will usually be
-        // 63,
-        // 127, 191, etc. We want to start our snapshot at 64-before the _next_
-        // ledger: 0, 64, 128, etc. In cases where we're forcibly checkpointed
-        // early, we still want to round-down to the previous checkpoint ledger.
-        begin = mApp.getHistoryManager().prevCheckpointLedger(
-            mLocalState.currentLedger);
-
-        count = (mLocalState.currentLedger - begin) + 1;
-        CLOG(DEBUG, "History") << "Streaming " << count
-                               << " ledgers worth of history, from " << begin;
-
-        nHeaders = LedgerHeaderFrame::copyLedgerHeadersToStream(
-            mApp.getDatabase(), sess, begin, count, ledgerOut);
-        size_t nTxs = TransactionFrame::copyTransactionsToStream(
-            mApp.getNetworkID(), mApp.getDatabase(), sess, begin, count, txOut,
-            txResultOut);
-        CLOG(DEBUG, "History") << "Wrote " << nHeaders << " ledger headers to "
-                               << mLedgerSnapFile->localPath_nogz();
-        CLOG(DEBUG, "History")
-            << "Wrote " << nTxs << " transactions to "
-            << mTransactionSnapFile->localPath_nogz() << " and "
-            << mTransactionResultSnapFile->localPath_nogz();
-
-        nbSCPMessages = HerderPersistence::copySCPHistoryToStream(
-            mApp.getDatabase(), sess, begin, count, scpHistory);
-
-        CLOG(DEBUG, "History")
-            << "Wrote " << nbSCPMessages << " SCP messages to "
-            << mSCPHistorySnapFile->localPath_nogz();
+        std::rethrow_exception(error);
     }
 
+    CLOG(DEBUG, "History") << "Wrote " << nHeaders << " ledger headers to "
+                           << mLedgerSnapFile->localPath_gz();
+    CLOG(DEBUG, "History") << "Wrote " << nTxs << " transactions to "
+                           << mTransactionSnapFile->localPath_gz() << " and "
+                           << mTransactionResultSnapFile->localPath_gz();
+    CLOG(DEBUG, "History") << "Wrote " << nbSCPMessages
+                           << " SCP messages to "
+                           << mSCPHistorySnapFile->localPath_gz();
+
     if (nbSCPMessages == 0)
     {
         // don't upload empty files
-        std::remove(mSCPHistorySnapFile->localPath_nogz().c_str());
+        std::remove(mSCPHistorySnapFile->localPath_gz().c_str());
     }
 
     // When writing checkpoint 0x3f (63) we will have written 63 headers because
@@ -137,7 +192,7 @@ StateSnapshot::writeHistoryBlocks() const
     {
         CLOG(WARNING, "History")
             << "Only wrote " << nHeaders << " ledger headers for "
-            << mLedgerSnapFile->localPath_nogz() << ", expecting " << count
+            << mLedgerSnapFile->localPath_gz() << ", expecting " << count
             << ", will retry";
         return false;
     }
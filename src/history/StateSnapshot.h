@@ -29,6 +29,11 @@ struct StateSnapshot : public std::enable_shared_from_this<StateSnapshot>
 
     StateSnapshot(Application& app, HistoryArchiveState const& state);
     void makeLive();
-    bool writeHistoryBlocks() const;
+
+    // Writes the ledger header, transaction, result and SCP history files
+    // for the checkpoint, already gzipped. Each stream is read over its own
+    // pooled session on a thread of its own; only when there is no pool
+    // (in-memory sqlite) do they run one after another on the main session.
+    bool writeHistoryBlocks();
 };
 }
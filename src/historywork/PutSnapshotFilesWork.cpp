@@ -74,13 +74,23 @@ PutSnapshotFilesWork::onSuccess()
         }
         for (auto f : files)
         {
-            if (f && fs::exists(f->localPath_nogz()))
+            if (!f)
+            {
+                continue;
+            }
+            // history files come out of WriteSnapshotWork already gzipped,
+            // buckets still need a gzip run of their own
+            bool unzipped = fs::exists(f->localPath_nogz());
+            if (unzipped || fs::exists(f->localPath_gz()))
             {
                 auto put = mPutFilesWork->addWork<PutRemoteFileWork>(
                     f->localPath_gz(), f->remoteName(), mArchive);
                 auto mkdir =
                     put->addWork<MakeRemoteDirWork>(f->remoteDir(), mArchive);
-                mkdir->addWork<GzipFileWork>(f->localPath_nogz(), true);
+                if (unzipped)
+                {
+                    mkdir->addWork<GzipFileWork>(f->localPath_nogz(), true);
+                }
             }
         }
         return WORK_PENDING;
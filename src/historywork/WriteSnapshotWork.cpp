@@ -8,7 +8,10 @@
 #include "historywork/Progress.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "main/Application.h"
+#include "util/Logging.h"
 #include "util/XDRStream.h"
+#include <medida/metrics_registry.h>
+#include <medida/timer.h>
 
 namespace stellar
 {
@@ -28,12 +31,28 @@ WriteSnapshotWork::~WriteSnapshotWork()
 void
 WriteSnapshotWork::onStart()
 {
+    // Only the hand-off is normally spent on the main thread; the whole
+    // write is when there is no connection pool to write from.
+    auto mainThreadTime =
+        mApp.getMetrics()
+            .NewTimer({"history", "snapshot", "main-thread"})
+            .TimeScope();
+
     auto handler = callComplete();
     auto snap = mSnapshot;
     auto work = [handler, snap]() {
         asio::error_code ec;
-        if (!snap->writeHistoryBlocks())
+        try
+        {
+            if (!snap->writeHistoryBlocks())
+            {
+                ec = std::make_error_code(std::errc::io_error);
+            }
+        }
+        catch (std::exception& e)
         {
+            CLOG(WARNING, "History")
+                << "Failed to write history snapshot: " << e.what();
             ec = std::make_error_code(std::errc::io_error);
         }
         snap->mApp.getClock().getIOService().post(
@@ -44,6 +63,9 @@ WriteSnapshotWork::onStart()
     // otherwise run on main thread.
     if (mApp.getDatabase().canUsePool())
     {
+        // creating the pool is not thread-safe, make sure it exists before
+        // the writer threads start leasing sessions from it
+        mApp.getDatabase().getPool();
         mApp.getWorkerIOService().post(work);
     }
     else
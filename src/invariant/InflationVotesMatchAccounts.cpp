@@ -0,0 +1,117 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "invariant/InflationVotesMatchAccounts.h"
+#include "crypto/KeyUtils.h"
+#include "crypto/SecretKey.h"
+#include "invariant/InvariantManager.h"
+#include "ledger/AccountFrame.h"
+#include "ledger/LedgerDelta.h"
+#include "lib/util/format.h"
+#include "main/Application.h"
+#include <unordered_set>
+
+namespace stellar
+{
+
+namespace
+{
+void
+addDestination(std::unordered_set<AccountID>& dests,
+               EntryFrame::pointer const& entry)
+{
+    if (entry && entry->mEntry.data.type() == ACCOUNT &&
+        entry->mEntry.data.account().inflationDest)
+    {
+        dests.insert(*entry->mEntry.data.account().inflationDest);
+    }
+}
+
+std::string
+compareVotes(AccountID const& dest, int64 tallied, int64 counted)
+{
+    if (tallied == counted)
+    {
+        return {};
+    }
+    return fmt::format(
+        "Inflation votes for {} are {} but its voters' balances add up to {}",
+        KeyUtils::toStrKey(dest), tallied, counted);
+}
+}
+
+std::shared_ptr<Invariant>
+InflationVotesMatchAccounts::registerInvariant(Application& app)
+{
+    return app.getInvariantManager()
+        .registerInvariant<InflationVotesMatchAccounts>(app.getDatabase());
+}
+
+InflationVotesMatchAccounts::InflationVotesMatchAccounts(Database& db)
+    : Invariant(false), mDb{db}
+{
+}
+
+std::string
+InflationVotesMatchAccounts::getName() const
+{
+    return "InflationVotesMatchAccounts";
+}
+
+std::string
+InflationVotesMatchAccounts::checkOnOperationApply(
+    Operation const& operation, OperationResult const& result,
+    LedgerDelta const& delta)
+{
+    if (operation.body.type() == INFLATION)
+    {
+        auto tallied = AccountFrame::loadInflationVotes(mDb);
+        auto counted = AccountFrame::tallyInflationVotes(mDb);
+        for (auto const& c : counted)
+        {
+            auto it = tallied.find(c.first);
+            auto s = compareVotes(c.first, it == tallied.end() ? 0 : it->second,
+                                  c.second);
+            if (!s.empty())
+            {
+                return s;
+            }
+        }
+        for (auto const& t : tallied)
+        {
+            if (counted.find(t.first) == counted.end())
+            {
+                return compareVotes(t.first, t.second, 0);
+            }
+        }
+        return {};
+    }
+
+    std::unordered_set<AccountID> dests;
+    for (auto const& entry : delta.added())
+    {
+        addDestination(dests, entry.current);
+    }
+    for (auto const& entry : delta.modified())
+    {
+        addDestination(dests, entry.current);
+        addDestination(dests, entry.previous);
+    }
+    for (auto const& entry : delta.deleted())
+    {
+        addDestination(dests, entry.previous);
+    }
+
+    for (auto const& d : dests)
+    {
+        auto s = compareVotes(d, AccountFrame::loadInflationVotes(mDb, d),
+                              AccountFrame::tallyInflationVotes(mDb, d));
+        if (!s.empty())
+        {
+            return s;
+        }
+    }
+    return {};
+}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "invariant/Invariant.h"
+#include <memory>
+
+namespace stellar
+{
+
+class Application;
+class Database;
+class LedgerDelta;
+
+// This Invariant is used to validate that the inflationvotes table, which
+// AccountFrame updates as accounts are stored, agrees with the votes summed
+// over the accounts table. After each operation the destinations of the
+// accounts it touched are checked; after an inflation operation every
+// destination is.
+class InflationVotesMatchAccounts : public Invariant
+{
+  public:
+    static std::shared_ptr<Invariant> registerInvariant(Application& app);
+
+    explicit InflationVotesMatchAccounts(Database& db);
+
+    virtual std::string getName() const override;
+
+    virtual std::string
+    checkOnOperationApply(Operation const& operation,
+                          OperationResult const& result,
+                          LedgerDelta const& delta) override;
+
+  private:
+    Database& mDb;
+};
+}
@@ -0,0 +1,126 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/Hex.h"
+#include "crypto/SecretKey.h"
+#include "database/Database.h"
+#include "invariant/InvariantDoesNotHold.h"
+#include "invariant/InvariantManager.h"
+#include "invariant/InvariantTestUtils.h"
+#include "ledger/AccountFrame.h"
+#include "ledger/LedgerDelta.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+#include <algorithm>
+#include <random>
+
+using namespace stellar;
+using namespace stellar::InvariantTestUtils;
+
+static EntryFrame::pointer
+makeVoter(LedgerEntry le, AccountID const& dest, int64_t balance)
+{
+    le.data.account().inflationDest.activate() = dest;
+    le.data.account().balance = balance;
+    return EntryFrame::FromXDR(le);
+}
+
+TEST_CASE("Inflation votes follow account changes",
+          "[invariant][inflationvotesmatchaccounts]")
+{
+    Config cfg = getTestConfig(0);
+    cfg.INVARIANT_CHECKS = {"InflationVotesMatchAccounts"};
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& db = app->getDatabase();
+
+    std::default_random_engine gen;
+    std::uniform_int_distribution<int64_t> balances(0, 5000000000);
+    std::vector<AccountID> dests;
+    for (int i = 0; i < 3; ++i)
+    {
+        dests.emplace_back(SecretKey::random().getPublicKey());
+    }
+
+    std::vector<LedgerEntry> accounts;
+    std::vector<EntryFrame::pointer> current;
+    for (int i = 0; i < 30; ++i)
+    {
+        accounts.emplace_back(generateRandomAccount(2));
+        current.emplace_back(
+            makeVoter(accounts.back(), dests[i % 3], balances(gen)));
+        REQUIRE(store(*app, makeUpdateList(current.back(), nullptr)));
+    }
+
+    for (int round = 0; round < 3; ++round)
+    {
+        for (size_t i = 0; i < accounts.size(); ++i)
+        {
+            auto next = makeVoter(accounts[i], dests[(i + round) % 3],
+                                  balances(gen));
+            REQUIRE(store(*app, makeUpdateList(next, current[i])));
+            current[i] = next;
+        }
+    }
+    REQUIRE(AccountFrame::loadInflationVotes(db) ==
+            AccountFrame::tallyInflationVotes(db));
+
+    std::vector<EntryFrame::pointer> live;
+    for (size_t i = 0; i < accounts.size(); ++i)
+    {
+        if (i % 2 == 0)
+        {
+            REQUIRE(store(*app, makeUpdateList(nullptr, current[i])));
+        }
+        else
+        {
+            live.emplace_back(current[i]);
+        }
+    }
+    REQUIRE(AccountFrame::loadInflationVotes(db) ==
+            AccountFrame::tallyInflationVotes(db));
+
+    SECTION("tally out of step with the accounts")
+    {
+        REQUIRE(AccountFrame::loadInflationVotes(db, dests[1]) > 0);
+        std::string dest = binToHex(dests[1].ed25519());
+        db.getSession() << "UPDATE inflationvotes SET votes = votes + 1 "
+                           "WHERE inflationdest = decode(:d, 'hex')",
+            soci::use(dest);
+
+        SECTION("on a change to one of its voters")
+        {
+            auto voter = std::find_if(
+                live.begin(), live.end(), [&](EntryFrame::pointer const& e) {
+                    return *e->mEntry.data.account().inflationDest ==
+                           dests[1];
+                });
+            REQUIRE(voter != live.end());
+            auto next = EntryFrame::FromXDR((*voter)->mEntry);
+            REQUIRE(!store(*app, makeUpdateList(next, *voter)));
+        }
+
+        SECTION("on inflation")
+        {
+            LedgerHeader lh(app->getLedgerManager().getCurrentLedgerHeader());
+            LedgerDelta ld(lh, db, false);
+            Operation op;
+            op.body.type(INFLATION);
+            OperationResult res;
+            REQUIRE_THROWS_AS(
+                app->getInvariantManager().checkOnOperationApply(op, res, ld),
+                InvariantDoesNotHold);
+        }
+    }
+
+    SECTION("tally rebuilt from the accounts")
+    {
+        auto tallied = AccountFrame::loadInflationVotes(db);
+        AccountFrame::rebuildInflationVotes(db);
+        REQUIRE(AccountFrame::loadInflationVotes(db) == tallied);
+    }
+}
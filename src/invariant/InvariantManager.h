@@ -38,6 +38,13 @@ class InvariantManager
                                     uint32_t ledger, uint32_t level,
                                     bool isCurr) = 0;
 
+    // Like checkOnBucketApply, for a bucket that Bucket::mergeAll made of
+    // every bucket from level[level].snap (or .curr, if !fromSnap) up to
+    // level[0].curr.
+    virtual void checkOnMergedBucketApply(std::shared_ptr<Bucket const> bucket,
+                                          uint32_t ledger, uint32_t level,
+                                          bool fromSnap) = 0;
+
     virtual void checkOnOperationApply(Operation const& operation,
                                        OperationResult const& opres,
                                        LedgerDelta const& delta) = 0;
@@ -84,6 +84,34 @@ InvariantManagerImpl::checkOnBucketApply(std::shared_ptr<Bucket const> bucket,
     }
 }
 
+void
+InvariantManagerImpl::checkOnMergedBucketApply(
+    std::shared_ptr<Bucket const> bucket, uint32_t ledger, uint32_t level,
+    bool fromSnap)
+{
+    uint32_t oldestLedger =
+        fromSnap ? BucketList::oldestLedgerInSnap(ledger, level)
+                 : BucketList::oldestLedgerInCurr(ledger, level);
+    uint32_t newestLedger = BucketList::oldestLedgerInCurr(ledger, 0) - 1 +
+                            BucketList::sizeOfCurr(ledger, 0);
+    for (auto invariant : mEnabled)
+    {
+        auto result =
+            invariant->checkOnBucketApply(bucket, oldestLedger, newestLedger);
+        if (result.empty())
+        {
+            continue;
+        }
+
+        auto message = fmt::format(
+            R"(invariant "{}" does not hold on buckets {}[{}] to Curr[0] )"
+            R"(merged = {}: {})",
+            invariant->getName(), fromSnap ? "Snap" : "Curr", level,
+            binToHex(bucket->getHash()), result);
+        onInvariantFailure(invariant, message, ledger);
+    }
+}
+
 void
 InvariantManagerImpl::checkOnOperationApply(Operation const& operation,
                                             OperationResult const& opres,
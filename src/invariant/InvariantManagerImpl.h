@@ -43,6 +43,10 @@ class InvariantManagerImpl : public InvariantManager
                                     uint32_t ledger, uint32_t level,
                                     bool isCurr) override;
 
+    virtual void checkOnMergedBucketApply(std::shared_ptr<Bucket const> bucket,
+                                          uint32_t ledger, uint32_t level,
+                                          bool fromSnap) override;
+
     virtual void
     registerInvariant(std::shared_ptr<Invariant> invariant) override;
 
@@ -12,9 +12,11 @@
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerRange.h"
 #include "lib/util/format.h"
+#include "util/Logging.h"
 #include "util/basen.h"
 #include "util/types.h"
 #include <algorithm>
+#include <tuple>
 
 using namespace soci;
 using namespace std;
@@ -23,25 +25,31 @@ namespace stellar
 {
 using xdr::operator<;
 
+// Account ids and inflation destinations are the raw 32-byte ed25519 keys,
+// thresholds their 4 raw bytes and signer keys the XDR of the SignerKey.
+// All of them are bound and read as hex, see accountIDToHex and friends.
+// packedsigners holds the XDR of the whole signer list when
+// INLINE_ACCOUNT_SIGNERS is set, and is NULL when the signers table is used.
 const char* AccountFrame::kSQLCreateStatement1 =
     "CREATE TABLE accounts"
     "("
-    "accountid       VARCHAR(56)  PRIMARY KEY,"
+    "accountid       BYTEA        PRIMARY KEY,"
     "balance         BIGINT       NOT NULL CHECK (balance >= 0),"
     "seqnum          BIGINT       NOT NULL,"
     "numsubentries   INT          NOT NULL CHECK (numsubentries >= 0),"
-    "inflationdest   VARCHAR(56),"
+    "inflationdest   BYTEA,"
     "homedomain      VARCHAR(32)  NOT NULL,"
-    "thresholds      TEXT         NOT NULL,"
+    "thresholds      BYTEA        NOT NULL,"
     "flags           INT          NOT NULL,"
-    "lastmodified    INT          NOT NULL"
+    "lastmodified    INT          NOT NULL,"
+    "packedsigners   BYTEA"
     ");";
 
 const char* AccountFrame::kSQLCreateStatement2 =
     "CREATE TABLE signers"
     "("
-    "accountid       VARCHAR(56) NOT NULL,"
-    "publickey       VARCHAR(56) NOT NULL,"
+    "accountid       BYTEA       NOT NULL,"
+    "publickey       BYTEA       NOT NULL,"
     "weight          INT         NOT NULL,"
     "PRIMARY KEY (accountid, publickey)"
     ");";
@@ -53,6 +61,115 @@ const char* AccountFrame::kSQLCreateStatement4 = "CREATE INDEX accountbalances "
                                                  "ON accounts (balance) WHERE "
                                                  "balance >= 1000000000";
 
+// Running total of the balances voting for each inflation destination, that
+// is of accounts with at least INFLATION_VOTE_MIN_BALANCE. Destinations whose
+// voters all went away stay behind with 0 votes.
+const char* AccountFrame::kSQLCreateStatement5 =
+    "CREATE TABLE inflationvotes"
+    "("
+    "inflationdest   BYTEA        PRIMARY KEY,"
+    "votes           BIGINT       NOT NULL CHECK (votes >= 0)"
+    ");";
+
+const char* AccountFrame::kSQLCreateStatement6 =
+    "CREATE INDEX inflationvotesbyvotes ON inflationvotes (votes)";
+
+namespace
+{
+// Keys cross soci's string interface as lowercase hex and are converted to
+// and from bytes in the SQL, with decode(:v, 'hex') and encode(col, 'hex').
+std::string
+accountIDToHex(AccountID const& id)
+{
+    return binToHex(id.ed25519());
+}
+
+AccountID
+accountIDFromHex(std::string const& hex)
+{
+    AccountID id;
+    id.type(PUBLIC_KEY_TYPE_ED25519);
+    id.ed25519() = hexToBin256(hex);
+    return id;
+}
+
+std::string
+signerKeyToHex(SignerKey const& key)
+{
+    return binToHex(xdr::xdr_to_opaque(key));
+}
+
+SignerKey
+signerKeyFromHex(std::string const& hex)
+{
+    SignerKey key;
+    xdr::xdr_from_opaque(hexToBin(hex), key);
+    return key;
+}
+
+std::string
+signersToHex(xdr::xvector<Signer, 20> const& signers)
+{
+    return binToHex(xdr::xdr_to_opaque(signers));
+}
+
+xdr::xvector<Signer, 20>
+signersFromHex(std::string const& hex)
+{
+    xdr::xvector<Signer, 20> signers;
+    xdr::xdr_from_opaque(hexToBin(hex), signers);
+    return signers;
+}
+
+int64 const INFLATION_VOTE_MIN_BALANCE = 1000000000;
+
+// takes back the votes of the account as currently stored, if it has any
+void
+removeInflationVotes(Database& db, std::string const& actIDHex)
+{
+    auto prep = db.getPreparedStatement(
+        "UPDATE inflationvotes SET votes = votes - "
+        "(SELECT balance FROM accounts WHERE accountid = decode(:v1, 'hex')) "
+        "WHERE inflationdest = (SELECT inflationdest FROM accounts "
+        "WHERE accountid = decode(:v2, 'hex') AND balance >= 1000000000)");
+    auto& st = prep.statement();
+    st.exchange(use(actIDHex));
+    st.exchange(use(actIDHex));
+    st.define_and_bind();
+    auto timer = db.getUpdateTimer("inflationvotes");
+    st.execute(true);
+}
+
+void
+addInflationVotes(Database& db, std::string const& destHex, int64 votes)
+{
+    {
+        auto prep = db.getPreparedStatement(
+            "UPDATE inflationvotes SET votes = votes + :v1 "
+            "WHERE inflationdest = decode(:v2, 'hex')");
+        auto& st = prep.statement();
+        st.exchange(use(votes));
+        st.exchange(use(destHex));
+        st.define_and_bind();
+        auto timer = db.getUpdateTimer("inflationvotes");
+        st.execute(true);
+        if (st.get_affected_rows() == 1)
+        {
+            return;
+        }
+    }
+    auto prep = db.getPreparedStatement(
+        "INSERT INTO inflationvotes (inflationdest, votes) "
+        "VALUES (decode(:v1, 'hex'), :v2)");
+    auto& st = prep.statement();
+    st.exchange(use(destHex));
+    st.exchange(use(votes));
+    st.define_and_bind();
+    auto timer = db.getInsertTimer("inflationvotes");
+    st.execute(true);
+}
+}
+
 AccountFrame::AccountFrame()
     : EntryFrame(ACCOUNT), mAccountEntry(mEntry.data.account())
 {
@@ -219,20 +336,19 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
         return p ? std::make_shared<AccountFrame>(*p) : nullptr;
     }
 
-    std::string actIDStrKey = KeyUtils::toStrKey(accountID);
+    std::string actIDHex = accountIDToHex(accountID);
 
-    std::string publicKey, inflationDest, creditAuthKey;
-    std::string homeDomain, thresholds;
-    soci::indicator inflationDestInd;
+    std::string inflationDest, homeDomain, thresholds, packedSigners;
+    soci::indicator inflationDestInd, packedSignersInd;
 
     AccountFrame::pointer res = make_shared<AccountFrame>(accountID);
     AccountEntry& account = res->getAccount();
 
-    auto prep =
-        db.getPreparedStatement("SELECT balance, seqnum, numsubentries, "
-                                "inflationdest, homedomain, thresholds, "
-                                "flags, lastmodified "
-                                "FROM accounts WHERE accountid=:v1");
+    auto prep = db.getPreparedStatement(
+        "SELECT balance, seqnum, numsubentries, "
+        "encode(inflationdest, 'hex'), homedomain, encode(thresholds, 'hex'), "
+        "flags, lastmodified, encode(packedsigners, 'hex') "
+        "FROM accounts WHERE accountid = decode(:v1, 'hex')");
     auto& st = prep.statement();
     st.exchange(into(account.balance));
     st.exchange(into(account.seqNum));
@@ -242,7 +358,8 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     st.exchange(into(thresholds));
     st.exchange(into(account.flags));
     st.exchange(into(res->getLastModified()));
-    st.exchange(use(actIDStrKey));
+    st.exchange(into(packedSigners, packedSignersInd));
+    st.exchange(use(actIDHex));
     st.define_and_bind();
     {
         auto timer = db.getSelectTimer("account");
@@ -257,20 +374,28 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
 
     account.homeDomain = homeDomain;
 
-    bn::decode_b64(thresholds.begin(), thresholds.end(),
-                   res->mAccountEntry.thresholds.begin());
+    auto thresholdBytes = hexToBin(thresholds);
+    if (thresholdBytes.size() != account.thresholds.size())
+    {
+        throw std::runtime_error("Invalid thresholds in SQL");
+    }
+    std::copy(thresholdBytes.begin(), thresholdBytes.end(),
+              account.thresholds.begin());
 
     if (inflationDestInd == soci::i_ok)
     {
-        account.inflationDest.activate() =
-            KeyUtils::fromStrKey<PublicKey>(inflationDest);
+        account.inflationDest.activate() = accountIDFromHex(inflationDest);
     }
 
     account.signers.clear();
 
-    if (account.numSubEntries != 0)
+    if (packedSignersInd == soci::i_ok)
+    {
+        account.signers = signersFromHex(packedSigners);
+    }
+    else if (account.numSubEntries != 0)
     {
-        auto signers = loadSigners(db, actIDStrKey);
+        auto signers = loadSigners(db, actIDHex);
         account.signers.insert(account.signers.begin(), signers.begin(),
                                signers.end());
     }
@@ -283,16 +408,17 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
 }
 
 std::vector<Signer>
-AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
+AccountFrame::loadSigners(Database& db, std::string const& actIDHex)
 {
     std::vector<Signer> res;
     string pubKey;
     Signer signer;
 
-    auto prep2 = db.getPreparedStatement("SELECT publickey, weight FROM "
-                                         "signers WHERE accountid =:id");
+    auto prep2 = db.getPreparedStatement(
+        "SELECT encode(publickey, 'hex'), weight FROM "
+        "signers WHERE accountid = decode(:id, 'hex')");
     auto& st2 = prep2.statement();
-    st2.exchange(use(actIDStrKey));
+    st2.exchange(use(actIDHex));
     st2.exchange(into(pubKey));
     st2.exchange(into(signer.weight));
     st2.define_and_bind();
@@ -302,7 +428,7 @@ AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
     }
     while (st2.got_data())
     {
-        signer.key = KeyUtils::fromStrKey<SignerKey>(pubKey);
+        signer.key = signerKeyFromHex(pubKey);
         res.push_back(signer);
         st2.fetch();
     }
@@ -320,15 +446,15 @@ AccountFrame::exists(Database& db, LedgerKey const& key)
         return true;
     }
 
-    std::string actIDStrKey = KeyUtils::toStrKey(key.account().accountID);
+    std::string actIDHex = accountIDToHex(key.account().accountID);
     int exists = 0;
     {
         auto timer = db.getSelectTimer("account-exists");
-        auto prep =
-            db.getPreparedStatement("SELECT EXISTS (SELECT NULL FROM accounts "
-                                    "WHERE accountid=:v1)");
+        auto prep = db.getPreparedStatement(
+            "SELECT EXISTS (SELECT NULL FROM accounts "
+            "WHERE accountid = decode(:v1, 'hex'))");
         auto& st = prep.statement();
-        st.exchange(use(actIDStrKey));
+        st.exchange(use(actIDHex));
         st.exchange(into(exists));
         st.define_and_bind();
         st.execute(true);
@@ -364,6 +490,28 @@ AccountFrame::deleteAccountsModifiedOnOrAfterLedger(Database& db,
                    le->lastModifiedLedgerSeq >= oldestLedger;
         });
 
+    {
+        std::vector<std::pair<std::string, int64>> removed;
+        std::string dest;
+        int64 votes;
+        soci::statement st =
+            (db.getSession().prepare
+                 << "SELECT encode(inflationdest, 'hex'), sum(balance) "
+                    "FROM accounts WHERE lastmodified >= :v1 AND "
+                    "inflationdest IS NOT NULL AND balance >= 1000000000 "
+                    "GROUP BY inflationdest",
+             into(dest), into(votes), use(oldestLedger));
+        st.execute(true);
+        while (st.got_data())
+        {
+            removed.emplace_back(dest, votes);
+            st.fetch();
+        }
+        for (auto const& r : removed)
+        {
+            addInflationVotes(db, r.first, -r.second);
+        }
+    }
     {
         auto prep = db.getPreparedStatement(
             "DELETE FROM signers WHERE accountid IN"
@@ -395,28 +543,91 @@ AccountFrame::storeDelete(LedgerDelta& delta, Database& db,
 {
     flushCachedEntry(key, db);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(key.account().accountID);
+    std::string actIDHex = accountIDToHex(key.account().accountID);
+    removeInflationVotes(db, actIDHex);
     {
         auto timer = db.getDeleteTimer("account");
         auto prep = db.getPreparedStatement(
-            "DELETE from accounts where accountid= :v1");
+            "DELETE from accounts where accountid = decode(:v1, 'hex')");
         auto& st = prep.statement();
-        st.exchange(soci::use(actIDStrKey));
+        st.exchange(soci::use(actIDHex));
         st.define_and_bind();
         st.execute(true);
     }
+    if (!db.inlineAccountSigners())
     {
         auto timer = db.getDeleteTimer("signer");
-        auto prep =
-            db.getPreparedStatement("DELETE from signers where accountid= :v1");
+        auto prep = db.getPreparedStatement(
+            "DELETE from signers where accountid = decode(:v1, 'hex')");
         auto& st = prep.statement();
-        st.exchange(soci::use(actIDStrKey));
+        st.exchange(soci::use(actIDHex));
         st.define_and_bind();
         st.execute(true);
     }
     delta.deleteEntry(key);
 }
 
+void
+AccountFrame::bulkDelete(soci::session& sess, LedgerKey const& key,
+                         bool inlineSigners)
+{
+    std::string actIDHex = accountIDToHex(key.account().accountID);
+    sess << "DELETE FROM accounts WHERE accountid = decode(:v1, 'hex')",
+        use(actIDHex);
+    if (!inlineSigners)
+    {
+        sess << "DELETE FROM signers WHERE accountid = decode(:v1, 'hex')",
+            use(actIDHex);
+    }
+}
+
+void
+AccountFrame::bulkInsert(soci::session& sess, LedgerEntry const& entry,
+                         bool inlineSigners)
+{
+    auto const& account = entry.data.account();
+    std::string actIDHex = accountIDToHex(account.accountID);
+
+    soci::indicator inflationInd = soci::i_null;
+    std::string inflationDestHex;
+    if (account.inflationDest)
+    {
+        inflationDestHex = accountIDToHex(*account.inflationDest);
+        inflationInd = soci::i_ok;
+    }
+    std::string homeDomain(account.homeDomain);
+    std::string thresholds(binToHex(account.thresholds));
+    soci::indicator packedSignersInd = soci::i_null;
+    std::string packedSigners;
+    if (inlineSigners)
+    {
+        packedSigners = signersToHex(account.signers);
+        packedSignersInd = soci::i_ok;
+    }
+
+    sess << "INSERT INTO accounts ( accountid, balance, seqnum, "
+            "numsubentries, inflationdest, homedomain, thresholds, flags, "
+            "lastmodified, packedsigners ) "
+            "VALUES ( decode(:id, 'hex'), :v1, :v2, :v3, decode(:v4, 'hex'), "
+            ":v5, decode(:v6, 'hex'), :v7, :v8, decode(:v9, 'hex') )",
+        use(actIDHex), use(account.balance), use(account.seqNum),
+        use(account.numSubEntries), use(inflationDestHex, inflationInd),
+        use(homeDomain), use(thresholds), use(account.flags),
+        use(entry.lastModifiedLedgerSeq),
+        use(packedSigners, packedSignersInd);
+
+    if (!inlineSigners)
+    {
+        for (auto const& signer : account.signers)
+        {
+            std::string signerHex = signerKeyToHex(signer.key);
+            sess << "INSERT INTO signers (accountid,publickey,weight) "
+                    "VALUES (decode(:v1, 'hex'),decode(:v2, 'hex'),:v3)",
+                use(actIDHex), use(signerHex), use(signer.weight);
+        }
+    }
+}
+
 void
 AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 {
@@ -424,51 +635,70 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 
     flushCachedEntry(db);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(mAccountEntry.accountID);
+    std::string actIDHex = accountIDToHex(mAccountEntry.accountID);
     std::string sql;
 
+    if (!insert)
+    {
+        removeInflationVotes(db, actIDHex);
+    }
+
     if (insert)
     {
         sql = std::string(
             "INSERT INTO accounts ( accountid, balance, seqnum, "
             "numsubentries, inflationdest, homedomain, thresholds, flags, "
-            "lastmodified ) "
-            "VALUES ( :id, :v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8 )");
+            "lastmodified, packedsigners ) "
+            "VALUES ( decode(:id, 'hex'), :v1, :v2, :v3, decode(:v4, 'hex'), "
+            ":v5, decode(:v6, 'hex'), :v7, :v8, decode(:v9, 'hex') )");
     }
     else
     {
         sql = std::string(
             "UPDATE accounts SET balance = :v1, seqnum = :v2, "
             "numsubentries = :v3, "
-            "inflationdest = :v4, homedomain = :v5, thresholds = :v6, "
-            "flags = :v7, lastmodified = :v8 WHERE accountid = :id");
+            "inflationdest = decode(:v4, 'hex'), homedomain = :v5, "
+            "thresholds = decode(:v6, 'hex'), "
+            "flags = :v7, lastmodified = :v8, "
+            "packedsigners = decode(:v9, 'hex') "
+            "WHERE accountid = decode(:id, 'hex')");
     }
 
     auto prep = db.getPreparedStatement(sql);
 
     soci::indicator inflation_ind = soci::i_null;
-    string inflationDestStrKey;
+    string inflationDestHex;
 
     if (mAccountEntry.inflationDest)
     {
-        inflationDestStrKey = KeyUtils::toStrKey(*mAccountEntry.inflationDest);
+        inflationDestHex = accountIDToHex(*mAccountEntry.inflationDest);
         inflation_ind = soci::i_ok;
     }
 
-    string thresholds(bn::encode_b64(mAccountEntry.thresholds));
+    string thresholds(binToHex(mAccountEntry.thresholds));
+
+    bool inlineSigners = db.inlineAccountSigners();
+    soci::indicator packedSignersInd = soci::i_null;
+    string packedSigners;
+    if (inlineSigners)
+    {
+        packedSigners = signersToHex(mAccountEntry.signers);
+        packedSignersInd = soci::i_ok;
+    }
 
     {
         soci::statement& st = prep.statement();
-        st.exchange(use(actIDStrKey, "id"));
+        st.exchange(use(actIDHex, "id"));
         st.exchange(use(mAccountEntry.balance, "v1"));
         st.exchange(use(mAccountEntry.seqNum, "v2"));
         st.exchange(use(mAccountEntry.numSubEntries, "v3"));
-        st.exchange(use(inflationDestStrKey, inflation_ind, "v4"));
+        st.exchange(use(inflationDestHex, inflation_ind, "v4"));
         string homeDomain(mAccountEntry.homeDomain);
         st.exchange(use(homeDomain, "v5"));
         st.exchange(use(thresholds, "v6"));
         st.exchange(use(mAccountEntry.flags, "v7"));
         st.exchange(use(getLastModified(), "v8"));
+        st.exchange(use(packedSigners, packedSignersInd, "v9"));
         st.define_and_bind();
         {
             auto timer = insert ? db.getInsertTimer("account")
@@ -490,7 +720,13 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
         }
     }
 
-    if (mUpdateSigners)
+    if (mAccountEntry.inflationDest &&
+        mAccountEntry.balance >= INFLATION_VOTE_MIN_BALANCE)
+    {
+        addInflationVotes(db, inflationDestHex, mAccountEntry.balance);
+    }
+
+    if (mUpdateSigners && !inlineSigners)
     {
         applySigners(db, insert);
     }
@@ -499,7 +735,7 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 void
 AccountFrame::applySigners(Database& db, bool insert)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(mAccountEntry.accountID);
+    std::string actIDHex = accountIDToHex(mAccountEntry.accountID);
 
     // generates a diff with the signers stored in the database
 
@@ -507,7 +743,7 @@ AccountFrame::applySigners(Database& db, bool insert)
     std::vector<Signer> signers;
     if (!insert)
     {
-        signers = loadSigners(db, actIDStrKey);
+        signers = loadSigners(db, actIDHex);
     }
 
     auto it_new = mAccountEntry.signers.begin();
@@ -539,15 +775,16 @@ AccountFrame::applySigners(Database& db, bool insert)
         {
             if (it_new->weight != it_old->weight)
             {
-                std::string signerStrKey = KeyUtils::toStrKey(it_new->key);
+                std::string signerHex = signerKeyToHex(it_new->key);
                 auto timer = db.getUpdateTimer("signer");
                 auto prep2 = db.getPreparedStatement(
                     "UPDATE signers set weight=:v1 WHERE "
-                    "accountid=:v2 AND publickey=:v3");
+                    "accountid = decode(:v2, 'hex') AND "
+                    "publickey = decode(:v3, 'hex')");
                 auto& st = prep2.statement();
                 st.exchange(use(it_new->weight));
-                st.exchange(use(actIDStrKey));
-                st.exchange(use(signerStrKey));
+                st.exchange(use(actIDHex));
+                st.exchange(use(signerHex));
                 st.define_and_bind();
                 st.execute(true);
                 if (st.get_affected_rows() != 1)
@@ -562,14 +799,14 @@ AccountFrame::applySigners(Database& db, bool insert)
         else if (added)
         {
             // signer was added
-            std::string signerStrKey = KeyUtils::toStrKey(it_new->key);
+            std::string signerHex = signerKeyToHex(it_new->key);
 
-            auto prep2 = db.getPreparedStatement("INSERT INTO signers "
-                                                 "(accountid,publickey,weight) "
-                                                 "VALUES (:v1,:v2,:v3)");
+            auto prep2 = db.getPreparedStatement(
+                "INSERT INTO signers (accountid,publickey,weight) "
+                "VALUES (decode(:v1, 'hex'),decode(:v2, 'hex'),:v3)");
             auto& st = prep2.statement();
-            st.exchange(use(actIDStrKey));
-            st.exchange(use(signerStrKey));
+            st.exchange(use(actIDHex));
+            st.exchange(use(signerHex));
             st.exchange(use(it_new->weight));
             st.define_and_bind();
             st.execute(true);
@@ -584,14 +821,15 @@ AccountFrame::applySigners(Database& db, bool insert)
         else
         {
             // signer was deleted
-            std::string signerStrKey = KeyUtils::toStrKey(it_old->key);
+            std::string signerHex = signerKeyToHex(it_old->key);
 
-            auto prep2 = db.getPreparedStatement("DELETE from signers WHERE "
-                                                 "accountid=:v2 AND "
-                                                 "publickey=:v3");
+            auto prep2 = db.getPreparedStatement(
+                "DELETE from signers WHERE "
+                "accountid = decode(:v2, 'hex') AND "
+                "publickey = decode(:v3, 'hex')");
             auto& st = prep2.statement();
-            st.exchange(use(actIDStrKey));
-            st.exchange(use(signerStrKey));
+            st.exchange(use(actIDHex));
+            st.exchange(use(signerHex));
             st.define_and_bind();
             {
                 auto timer = db.getDeleteTimer("signer");
@@ -632,31 +870,148 @@ AccountFrame::processForInflation(
     std::function<bool(AccountFrame::InflationVotes const&)> inflationProcessor,
     int maxWinners, Database& db)
 {
+    if (maxWinners <= 0)
+    {
+        return;
+    }
     soci::session& session = db.getSession();
 
+    // Winners are ranked by votes, then by destination in descending StrKey
+    // order. Destinations are stored as raw bytes, which do not sort like
+    // their StrKey, so SQL only finds the vote total of the last winner and
+    // the tie-break among everything at or above it happens here. Both
+    // queries read the inflationvotes tally through its index on votes.
+    int64 cutoff = 1;
+    int offset = maxWinners - 1;
+    session << "SELECT votes FROM inflationvotes WHERE votes > 0"
+               " ORDER BY votes DESC LIMIT 1 OFFSET :off",
+        into(cutoff), use(offset);
+
+    std::vector<std::pair<InflationVotes, std::string>> candidates;
     InflationVotes v;
     std::string inflationDest;
 
     soci::statement st =
-        (session.prepare
-             << "SELECT"
-                " sum(balance) AS votes, inflationdest FROM accounts WHERE"
-                " inflationdest IS NOT NULL"
-                " AND balance >= 1000000000 GROUP BY inflationdest"
-                " ORDER BY votes DESC, inflationdest DESC LIMIT :lim",
-         into(v.mVotes), into(inflationDest), use(maxWinners));
+        (session.prepare << "SELECT votes, encode(inflationdest, 'hex')"
+                            " FROM inflationvotes WHERE votes >= :cutoff",
+         into(v.mVotes), into(inflationDest), use(cutoff));
 
     st.execute(true);
 
     while (st.got_data())
     {
-        v.mInflationDest = KeyUtils::fromStrKey<PublicKey>(inflationDest);
-        if (!inflationProcessor(v))
+        v.mInflationDest = accountIDFromHex(inflationDest);
+        candidates.emplace_back(v, KeyUtils::toStrKey(v.mInflationDest));
+        st.fetch();
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](std::pair<InflationVotes, std::string> const& l,
+                 std::pair<InflationVotes, std::string> const& r) {
+                  if (l.first.mVotes != r.first.mVotes)
+                  {
+                      return l.first.mVotes > r.first.mVotes;
+                  }
+                  return l.second > r.second;
+              });
+    if (candidates.size() > static_cast<size_t>(maxWinners))
+    {
+        candidates.resize(maxWinners);
+    }
+
+    for (auto const& c : candidates)
+    {
+        if (!inflationProcessor(c.first))
         {
             break;
         }
+    }
+}
+
+std::unordered_map<AccountID, int64>
+AccountFrame::loadInflationVotes(Database& db)
+{
+    std::unordered_map<AccountID, int64> res;
+    std::string dest;
+    int64 votes;
+    soci::statement st =
+        (db.getSession().prepare
+             << "SELECT encode(inflationdest, 'hex'), votes "
+                "FROM inflationvotes WHERE votes > 0",
+         into(dest), into(votes));
+    st.execute(true);
+    while (st.got_data())
+    {
+        res.emplace(accountIDFromHex(dest), votes);
         st.fetch();
     }
+    return res;
+}
+
+int64
+AccountFrame::loadInflationVotes(Database& db, AccountID const& dest)
+{
+    std::string destHex = accountIDToHex(dest);
+    int64 votes = 0;
+    auto prep = db.getPreparedStatement(
+        "SELECT votes FROM inflationvotes "
+        "WHERE inflationdest = decode(:v1, 'hex')");
+    auto& st = prep.statement();
+    st.exchange(use(destHex));
+    st.exchange(into(votes));
+    st.define_and_bind();
+    {
+        auto timer = db.getSelectTimer("inflationvotes");
+        st.execute(true);
+    }
+    return st.got_data() ? votes : 0;
+}
+
+std::unordered_map<AccountID, int64>
+AccountFrame::tallyInflationVotes(Database& db)
+{
+    std::unordered_map<AccountID, int64> res;
+    std::string dest;
+    int64 votes;
+    soci::statement st =
+        (db.getSession().prepare
+             << "SELECT encode(inflationdest, 'hex'), sum(balance) "
+                "FROM accounts WHERE inflationdest IS NOT NULL "
+                "AND balance >= 1000000000 GROUP BY inflationdest",
+         into(dest), into(votes));
+    st.execute(true);
+    while (st.got_data())
+    {
+        res.emplace(accountIDFromHex(dest), votes);
+        st.fetch();
+    }
+    return res;
+}
+
+int64
+AccountFrame::tallyInflationVotes(Database& db, AccountID const& dest)
+{
+    std::string destHex = accountIDToHex(dest);
+    int64 votes = 0;
+    soci::indicator votesInd;
+    db.getSession() << "SELECT sum(balance) FROM accounts "
+                       "WHERE inflationdest = decode(:v1, 'hex') "
+                       "AND balance >= 1000000000",
+        into(votes, votesInd), use(destHex);
+    return votesInd == soci::i_ok ? votes : 0;
+}
+
+void
+AccountFrame::rebuildInflationVotes(Database& db)
+{
+    auto& sess = db.getSession();
+    sess << "DROP TABLE IF EXISTS inflationvotes;";
+    sess << kSQLCreateStatement5;
+    sess << kSQLCreateStatement6;
+    sess << "INSERT INTO inflationvotes (inflationdest, votes) "
+            "SELECT inflationdest, sum(balance) FROM accounts "
+            "WHERE inflationdest IS NOT NULL AND balance >= 1000000000 "
+            "GROUP BY inflationdest";
 }
 
 std::unordered_map<AccountID, AccountFrame::pointer>
@@ -666,13 +1021,13 @@ AccountFrame::checkDB(Database& db)
     {
         std::string id;
         soci::statement st =
-            (db.getSession().prepare << "select accountid from accounts",
+            (db.getSession().prepare
+                 << "select encode(accountid, 'hex') from accounts",
              soci::into(id));
         st.execute(true);
         while (st.got_data())
         {
-            state.insert(
-                std::make_pair(KeyUtils::fromStrKey<PublicKey>(id), nullptr));
+            state.insert(std::make_pair(accountIDFromHex(id), nullptr));
             st.fetch();
         }
     }
@@ -687,27 +1042,53 @@ AccountFrame::checkDB(Database& db)
         size_t n;
         // sanity check signers state
         soci::statement st =
-            (db.getSession().prepare << "select count(*), accountid from "
-                                        "signers group by accountid",
+            (db.getSession().prepare
+                 << "select count(*), encode(accountid, 'hex') from "
+                    "signers group by accountid",
              soci::into(n), soci::into(id));
         st.execute(true);
         while (st.got_data())
         {
-            AccountID aid(KeyUtils::fromStrKey<PublicKey>(id));
+            AccountID aid(accountIDFromHex(id));
             auto it = state.find(aid);
             if (it == state.end())
             {
                 throw std::runtime_error(fmt::format(
-                    "Found extra signers in database for account {}", id));
+                    "Found extra signers in database for account {}",
+                    KeyUtils::toStrKey(aid)));
             }
             else if (n != it->second->mAccountEntry.signers.size())
             {
                 throw std::runtime_error(
-                    fmt::format("Mismatch signers for account {}", id));
+                    fmt::format("Mismatch signers for account {}",
+                                KeyUtils::toStrKey(aid)));
             }
             st.fetch();
         }
     }
+    {
+        std::string id;
+        // an account's signers live in exactly one place
+        soci::statement st =
+            (db.getSession().prepare
+                 << "select encode(accountid, 'hex') from accounts where "
+                    "packedsigners is not null and accountid in "
+                    "(select accountid from signers)",
+             soci::into(id));
+        st.execute(true);
+        if (st.got_data())
+        {
+            throw std::runtime_error(
+                fmt::format("Found both packed and table signers for "
+                            "account {}",
+                            KeyUtils::toStrKey(accountIDFromHex(id))));
+        }
+    }
+    if (loadInflationVotes(db) != tallyInflationVotes(db))
+    {
+        throw std::runtime_error(
+            "Inflation votes do not match the balances of their voters");
+    }
     return state;
 }
 
@@ -721,5 +1102,260 @@ AccountFrame::dropAll(Database& db)
     db.getSession() << kSQLCreateStatement2;
     db.getSession() << kSQLCreateStatement3;
     db.getSession() << kSQLCreateStatement4;
+    rebuildInflationVotes(db);
+}
+
+void
+AccountFrame::upgradeToBinaryKeys(Database& db)
+{
+    auto& sess = db.getSession();
+    soci::transaction tx(sess);
+
+    // park the StrKey rows in plain copies, so that the real tables and
+    // their indexes can be recreated under their usual names
+    sess << "CREATE TABLE accounts_strkey AS SELECT * FROM accounts";
+    sess << "CREATE TABLE signers_strkey AS SELECT * FROM signers";
+    // the copies carry no keys: index them for the batched range scans below,
+    // which would otherwise scan and sort a whole copy per batch
+    sess << "CREATE INDEX accountsstrkeyid ON accounts_strkey (accountid)";
+    sess << "CREATE INDEX signersstrkeyid ON signers_strkey "
+            "(accountid, publickey)";
+    sess << "DROP TABLE accounts";
+    sess << "DROP TABLE signers";
+    sess << kSQLCreateStatement1;
+    sess << kSQLCreateStatement2;
+    sess << kSQLCreateStatement3;
+    sess << kSQLCreateStatement4;
+
+    // copied in key order, a batch at a time, so neither backend has to
+    // hold a whole table's result set
+    int const batchSize = 1000;
+    size_t copied = 0;
+
+    {
+        struct Row
+        {
+            std::string mID;
+            int64 mBalance;
+            int64 mSeqNum;
+            uint32 mNumSubEntries;
+            std::string mInflationDest;
+            soci::indicator mInflationDestInd;
+            std::string mHomeDomain;
+            std::string mThresholds;
+            uint32 mFlags;
+            uint32 mLastModified;
+        };
+        Row row;
+        std::vector<Row> batch;
+        std::string last;
+
+        soci::statement sel =
+            (sess.prepare << "SELECT accountid, balance, seqnum, "
+                             "numsubentries, inflationdest, homedomain, "
+                             "thresholds, flags, lastmodified "
+                             "FROM accounts_strkey WHERE accountid > :last "
+                             "ORDER BY accountid LIMIT :n",
+             into(row.mID), into(row.mBalance), into(row.mSeqNum),
+             into(row.mNumSubEntries),
+             into(row.mInflationDest, row.mInflationDestInd),
+             into(row.mHomeDomain), into(row.mThresholds), into(row.mFlags),
+             into(row.mLastModified), use(last), use(batchSize));
+        soci::statement ins =
+            (sess.prepare << "INSERT INTO accounts ( accountid, balance, "
+                             "seqnum, numsubentries, inflationdest, "
+                             "homedomain, thresholds, flags, lastmodified ) "
+                             "VALUES ( decode(:id, 'hex'), :v1, :v2, :v3, "
+                             "decode(:v4, 'hex'), :v5, decode(:v6, 'hex'), "
+                             ":v7, :v8 )",
+             use(row.mID), use(row.mBalance), use(row.mSeqNum),
+             use(row.mNumSubEntries),
+             use(row.mInflationDest, row.mInflationDestInd),
+             use(row.mHomeDomain), use(row.mThresholds), use(row.mFlags),
+             use(row.mLastModified));
+
+        do
+        {
+            batch.clear();
+            sel.execute(true);
+            while (sel.got_data())
+            {
+                batch.emplace_back(row);
+                sel.fetch();
+            }
+            for (auto const& r : batch)
+            {
+                row = r;
+                row.mID =
+                    accountIDToHex(KeyUtils::fromStrKey<PublicKey>(r.mID));
+                if (row.mInflationDestInd == soci::i_ok)
+                {
+                    row.mInflationDest = accountIDToHex(
+                        KeyUtils::fromStrKey<PublicKey>(r.mInflationDest));
+                }
+                Thresholds thresholds;
+                bn::decode_b64(r.mThresholds.begin(), r.mThresholds.end(),
+                               thresholds.begin());
+                row.mThresholds = binToHex(thresholds);
+                ins.execute(true);
+            }
+            if (!batch.empty())
+            {
+                last = batch.back().mID;
+                copied += batch.size();
+                CLOG(INFO, "Database") << "Converted " << copied << " accounts";
+            }
+        } while (batch.size() == static_cast<size_t>(batchSize));
+    }
+
+    {
+        std::string accountID, publicKey;
+        int32_t weight;
+        std::vector<std::tuple<std::string, std::string, int32_t>> batch;
+        std::string lastAccount, lastKey;
+
+        soci::statement sel =
+            (sess.prepare << "SELECT accountid, publickey, weight "
+                             "FROM signers_strkey WHERE "
+                             "(accountid, publickey) > (:a, :k) "
+                             "ORDER BY accountid, publickey LIMIT :n",
+             into(accountID), into(publicKey), into(weight), use(lastAccount),
+             use(lastKey), use(batchSize));
+        soci::statement ins =
+            (sess.prepare << "INSERT INTO signers (accountid,publickey,weight) "
+                             "VALUES (decode(:v1, 'hex'),decode(:v2, 'hex'),"
+                             ":v3)",
+             use(accountID), use(publicKey), use(weight));
+
+        do
+        {
+            batch.clear();
+            sel.execute(true);
+            while (sel.got_data())
+            {
+                batch.emplace_back(accountID, publicKey, weight);
+                sel.fetch();
+            }
+            for (auto const& r : batch)
+            {
+                accountID = accountIDToHex(
+                    KeyUtils::fromStrKey<PublicKey>(std::get<0>(r)));
+                publicKey = signerKeyToHex(
+                    KeyUtils::fromStrKey<SignerKey>(std::get<1>(r)));
+                weight = std::get<2>(r);
+                ins.execute(true);
+            }
+            if (!batch.empty())
+            {
+                lastAccount = std::get<0>(batch.back());
+                lastKey = std::get<1>(batch.back());
+            }
+        } while (batch.size() == static_cast<size_t>(batchSize));
+    }
+
+    sess << "DROP TABLE accounts_strkey";
+    sess << "DROP TABLE signers_strkey";
+    tx.commit();
+}
+
+void
+AccountFrame::moveSigners(Database& db, bool toInline)
+{
+    auto& sess = db.getSession();
+    db.getEntryCache().clear();
+
+    // accounts are visited in key order, a batch at a time; the caller holds
+    // the transaction
+    int const batchSize = 1000;
+    std::string last, id, packed;
+    size_t moved = 0;
+
+    if (toInline)
+    {
+        soci::statement sel =
+            (sess.prepare << "SELECT encode(accountid, 'hex') FROM accounts "
+                             "WHERE accountid > decode(:last, 'hex') "
+                             "ORDER BY accountid LIMIT :n",
+             into(id), use(last), use(batchSize));
+        soci::statement upd =
+            (sess.prepare << "UPDATE accounts SET "
+                             "packedsigners = decode(:p, 'hex') "
+                             "WHERE accountid = decode(:id, 'hex')",
+             use(packed), use(id));
+        std::vector<std::string> batch;
+        do
+        {
+            batch.clear();
+            sel.execute(true);
+            while (sel.got_data())
+            {
+                batch.emplace_back(id);
+                sel.fetch();
+            }
+            for (auto const& b : batch)
+            {
+                id = b;
+                xdr::xvector<Signer, 20> signers;
+                auto loaded = loadSigners(db, id);
+                signers.insert(signers.begin(), loaded.begin(), loaded.end());
+                packed = signersToHex(signers);
+                upd.execute(true);
+            }
+            if (!batch.empty())
+            {
+                last = batch.back();
+                moved += batch.size();
+                CLOG(INFO, "Database") << "Packed signers of " << moved
+                                       << " accounts";
+            }
+        } while (batch.size() == static_cast<size_t>(batchSize));
+        sess << "DELETE FROM signers";
+    }
+    else
+    {
+        std::string signerHex;
+        int32_t weight;
+        soci::statement sel =
+            (sess.prepare << "SELECT encode(accountid, 'hex'), "
+                             "encode(packedsigners, 'hex') FROM accounts "
+                             "WHERE packedsigners IS NOT NULL AND "
+                             "accountid > decode(:last, 'hex') "
+                             "ORDER BY accountid LIMIT :n",
+             into(id), into(packed), use(last), use(batchSize));
+        soci::statement ins =
+            (sess.prepare << "INSERT INTO signers (accountid,publickey,weight) "
+                             "VALUES (decode(:v1, 'hex'),decode(:v2, 'hex'),"
+                             ":v3)",
+             use(id), use(signerHex), use(weight));
+        std::vector<std::pair<std::string, std::string>> batch;
+        do
+        {
+            batch.clear();
+            sel.execute(true);
+            while (sel.got_data())
+            {
+                batch.emplace_back(id, packed);
+                sel.fetch();
+            }
+            for (auto const& b : batch)
+            {
+                id = b.first;
+                for (auto const& signer : signersFromHex(b.second))
+                {
+                    signerHex = signerKeyToHex(signer.key);
+                    weight = signer.weight;
+                    ins.execute(true);
+                }
+            }
+            if (!batch.empty())
+            {
+                last = batch.back().first;
+                moved += batch.size();
+                CLOG(INFO, "Database") << "Unpacked signers of " << moved
+                                       << " accounts";
+            }
+        } while (batch.size() == static_cast<size_t>(batchSize));
+        sess << "UPDATE accounts SET packedsigners = NULL";
+    }
 }
 }
@@ -33,7 +33,7 @@ class AccountFrame : public EntryFrame
     void normalize();
 
     static std::vector<Signer> loadSigners(Database& db,
-                                           std::string const& actIDStrKey);
+                                           std::string const& actIDHex);
     void applySigners(Database& db, bool insert);
 
   public:
@@ -125,6 +125,12 @@ class AccountFrame : public EntryFrame
     static void deleteAccountsModifiedOnOrAfterLedger(Database& db,
                                                       uint32_t oldestLedger);
 
+    // Bulk-load helpers, see EntryFrame::bulkReplace.
+    static void bulkDelete(soci::session& sess, LedgerKey const& key,
+                           bool inlineSigners);
+    static void bulkInsert(soci::session& sess, LedgerEntry const& entry,
+                           bool inlineSigners);
+
     // database utilities
     static AccountFrame::pointer
     loadAccount(LedgerDelta& delta, AccountID const& accountID, Database& db);
@@ -147,16 +153,41 @@ class AccountFrame : public EntryFrame
         std::function<bool(InflationVotes const&)> inflationProcessor,
         int maxWinners, Database& db);
 
+    // votes per inflation destination, as kept in the inflationvotes table by
+    // storeAdd, storeChange and storeDelete
+    static std::unordered_map<AccountID, int64>
+    loadInflationVotes(Database& db);
+    static int64 loadInflationVotes(Database& db, AccountID const& dest);
+
+    // the same, summed over the accounts table (slow!)
+    static std::unordered_map<AccountID, int64>
+    tallyInflationVotes(Database& db);
+    static int64 tallyInflationVotes(Database& db, AccountID const& dest);
+
+    // recreates the inflationvotes table from the accounts table, also schema
+    // upgrade 10
+    static void rebuildInflationVotes(Database& db);
+
     // loads all accounts from database and checks for consistency (slow!)
     static std::unordered_map<AccountID, AccountFrame::pointer>
     checkDB(Database& db);
 
     static void dropAll(Database& db);
 
+    // schema upgrade 8: rewrites accounts and signers from StrKey and base64
+    // text columns to binary ones
+    static void upgradeToBinaryKeys(Database& db);
+
+    // moves every account's signers into its packedsigners column (toInline)
+    // or back into the signers table, see Config::INLINE_ACCOUNT_SIGNERS
+    static void moveSigners(Database& db, bool toInline);
+
   private:
     static const char* kSQLCreateStatement1;
     static const char* kSQLCreateStatement2;
     static const char* kSQLCreateStatement3;
     static const char* kSQLCreateStatement4;
+    static const char* kSQLCreateStatement5;
+    static const char* kSQLCreateStatement6;
 };
 }
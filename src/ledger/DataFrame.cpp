@@ -249,6 +249,30 @@ DataFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     delta.deleteEntry(key);
 }
 
+void
+DataFrame::bulkDelete(soci::session& sess, LedgerKey const& key)
+{
+    std::string actIDStrKey = KeyUtils::toStrKey(key.data().accountID);
+    std::string dataName = key.data().dataName;
+    sess << "DELETE FROM accountdata WHERE accountid=:id AND dataname=:s",
+        use(actIDStrKey), use(dataName);
+}
+
+void
+DataFrame::bulkInsert(soci::session& sess, LedgerEntry const& entry)
+{
+    auto const& data = entry.data.data();
+    std::string actIDStrKey = KeyUtils::toStrKey(data.accountID);
+    std::string dataName = data.dataName;
+    std::string dataValue = bn::encode_b64(data.dataValue);
+
+    sess << "INSERT INTO accountdata "
+            "(accountid,dataname,datavalue,lastmodified)"
+            " VALUES (:aid,:dn,:dv,:lm)",
+        use(actIDStrKey), use(dataName), use(dataValue),
+        use(entry.lastModifiedLedgerSeq);
+}
+
 void
 DataFrame::storeChange(LedgerDelta& delta, Database& db)
 {
@@ -74,6 +74,10 @@ class DataFrame : public EntryFrame
     static void deleteDataModifiedOnOrAfterLedger(Database& db,
                                                   uint32_t oldestLedger);
 
+    // Bulk-load helpers, see EntryFrame::bulkReplace.
+    static void bulkDelete(soci::session& sess, LedgerKey const& key);
+    static void bulkInsert(soci::session& sess, LedgerEntry const& entry);
+
     // database utilities
     static pointer loadData(AccountID const& accountID, std::string dataName,
                             Database& db);
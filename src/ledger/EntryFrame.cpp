@@ -246,6 +246,49 @@ EntryFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     }
 }
 
+void
+EntryFrame::bulkReplace(soci::session& sess, LedgerEntry const& entry,
+                        bool inlineSigners)
+{
+    bulkDelete(sess, LedgerEntryKey(entry), inlineSigners);
+    switch (entry.data.type())
+    {
+    case ACCOUNT:
+        AccountFrame::bulkInsert(sess, entry, inlineSigners);
+        break;
+    case TRUSTLINE:
+        TrustFrame::bulkInsert(sess, entry);
+        break;
+    case OFFER:
+        OfferFrame::bulkInsert(sess, entry);
+        break;
+    case DATA:
+        DataFrame::bulkInsert(sess, entry);
+        break;
+    }
+}
+
+void
+EntryFrame::bulkDelete(soci::session& sess, LedgerKey const& key,
+                       bool inlineSigners)
+{
+    switch (key.type())
+    {
+    case ACCOUNT:
+        AccountFrame::bulkDelete(sess, key, inlineSigners);
+        break;
+    case TRUSTLINE:
+        TrustFrame::bulkDelete(sess, key);
+        break;
+    case OFFER:
+        OfferFrame::bulkDelete(sess, key);
+        break;
+    case DATA:
+        DataFrame::bulkDelete(sess, key);
+        break;
+    }
+}
+
 LedgerKey
 LedgerEntryKey(LedgerEntry const& e)
 {
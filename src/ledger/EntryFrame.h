@@ -15,6 +15,11 @@ Parent of AccountFrame, TrustFrame, OfferFrame
 These just hold the xdr LedgerEntry objects and have some associated functions
 */
 
+namespace soci
+{
+class session;
+}
+
 namespace stellar
 {
 class Database;
@@ -79,6 +84,16 @@ class EntryFrame : public NonMovableOrCopyable
     static bool exists(Database& db, LedgerKey const& key);
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+
+    // Bulk-load helpers, for applying buckets through sessions of the
+    // connection pool: replace the stored entry with `entry`, or delete the
+    // one with `key`, through `sess`. Unlike the store methods above, they
+    // bypass the entry cache, the delta and the inflation vote tally, which
+    // the caller has to clear and rebuild once done.
+    static void bulkReplace(soci::session& sess, LedgerEntry const& entry,
+                            bool inlineSigners);
+    static void bulkDelete(soci::session& sess, LedgerKey const& key,
+                           bool inlineSigners);
 };
 
 // static helper for getting a LedgerKey from a LedgerEntry.
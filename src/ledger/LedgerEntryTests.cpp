@@ -6,18 +6,25 @@
 #include "LedgerDelta.h"
 #include "OfferFrame.h"
 #include "TrustFrame.h"
+#include "crypto/Hex.h"
+#include "crypto/KeyUtils.h"
+#include "crypto/Random.h"
 #include "crypto/SecretKey.h"
+#include "crypto/SignerKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTestUtils.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
+#include "test/Microbench.h"
 #include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
+#include "util/basen.h"
 #include "xdrpp/autocheck.h"
 #include "xdrpp/marshal.h"
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 #include <utility>
@@ -274,4 +281,376 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
         app->getLedgerManager().checkDbState();
     }
 }
+
+TEST_CASE("account tables upgrade from StrKey columns", "[ledgerentry]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+    Database& db = app->getDatabase();
+    auto& sess = db.getSession();
+
+    // enough rows for both tables to take more than one batch
+    std::vector<AccountEntry> accounts;
+    for (size_t i = 0; i < 1500; ++i)
+    {
+        accounts.emplace_back(LedgerTestUtils::generateValidAccountEntry(5));
+    }
+    std::sort(accounts.begin(), accounts.end(),
+              [](AccountEntry const& l, AccountEntry const& r) {
+                  return l.accountID < r.accountID;
+              });
+    accounts.erase(std::unique(accounts.begin(), accounts.end(),
+                               [](AccountEntry const& l,
+                                  AccountEntry const& r) {
+                                   return l.accountID == r.accountID;
+                               }),
+                   accounts.end());
+
+    // recreate the schema 7 tables and fill them the way it stored rows
+    db.clearPreparedStatementCache();
+    sess << "DROP TABLE accounts";
+    sess << "DROP TABLE signers";
+    sess << "CREATE TABLE accounts (accountid VARCHAR(56) PRIMARY KEY, "
+            "balance BIGINT NOT NULL CHECK (balance >= 0), "
+            "seqnum BIGINT NOT NULL, "
+            "numsubentries INT NOT NULL CHECK (numsubentries >= 0), "
+            "inflationdest VARCHAR(56), homedomain VARCHAR(32) NOT NULL, "
+            "thresholds TEXT NOT NULL, flags INT NOT NULL, "
+            "lastmodified INT NOT NULL)";
+    sess << "CREATE TABLE signers (accountid VARCHAR(56) NOT NULL, "
+            "publickey VARCHAR(56) NOT NULL, weight INT NOT NULL, "
+            "PRIMARY KEY (accountid, publickey))";
+    size_t numSigners = 0;
+    for (auto const& a : accounts)
+    {
+        std::string id = KeyUtils::toStrKey(a.accountID);
+        std::string inflationDest;
+        soci::indicator inflationDestInd = soci::i_null;
+        if (a.inflationDest)
+        {
+            inflationDest = KeyUtils::toStrKey(*a.inflationDest);
+            inflationDestInd = soci::i_ok;
+        }
+        std::string homeDomain(a.homeDomain);
+        std::string thresholds(bn::encode_b64(a.thresholds));
+        uint32_t lastModified = 1;
+        sess << "INSERT INTO accounts VALUES (:id, :b, :s, :n, :i, :h, :t, "
+                ":f, :l)",
+            soci::use(id), soci::use(a.balance), soci::use(a.seqNum),
+            soci::use(a.numSubEntries),
+            soci::use(inflationDest, inflationDestInd), soci::use(homeDomain),
+            soci::use(thresholds), soci::use(a.flags), soci::use(lastModified);
+        for (auto const& signer : a.signers)
+        {
+            std::string key = KeyUtils::toStrKey(signer.key);
+            sess << "INSERT INTO signers VALUES (:a, :k, :w)", soci::use(id),
+                soci::use(key), soci::use(signer.weight);
+            ++numSigners;
+        }
+    }
+    REQUIRE(numSigners > 1000);
+
+    AccountFrame::upgradeToBinaryKeys(db);
+    db.clearPreparedStatementCache();
+    db.getEntryCache().clear();
+
+    for (auto const& a : accounts)
+    {
+        auto fromDb = AccountFrame::loadAccount(a.accountID, db);
+        REQUIRE(fromDb);
+        REQUIRE(fromDb->getAccount() == a);
+    }
+    size_t signerRows = 0;
+    sess << "SELECT COUNT(*) FROM signers", soci::into(signerRows);
+    REQUIRE(signerRows == numSigners);
+}
+
+TEST_CASE("inflation winners tie-break on StrKey order", "[ledgerentry]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+    Database& db = app->getDatabase();
+
+    LedgerHeader lh;
+    LedgerDelta delta(lh, db, false);
+    auto addVoter = [&](AccountID const& dest) {
+        AccountFrame voter(SecretKey::random().getPublicKey());
+        voter.getAccount().balance = 1000000000;
+        voter.getAccount().inflationDest.activate() = dest;
+        voter.storeAdd(delta, db);
+    };
+
+    // one destination with two votes, then eight tied with one each
+    auto top = SecretKey::random().getPublicKey();
+    addVoter(top);
+    addVoter(top);
+    std::vector<std::string> tied;
+    for (int i = 0; i < 8; ++i)
+    {
+        auto dest = SecretKey::random().getPublicKey();
+        addVoter(dest);
+        tied.emplace_back(KeyUtils::toStrKey(dest));
+    }
+    std::sort(tied.rbegin(), tied.rend());
+
+    std::vector<std::string> winners;
+    AccountFrame::processForInflation(
+        [&](AccountFrame::InflationVotes const& v) {
+            winners.emplace_back(KeyUtils::toStrKey(v.mInflationDest));
+            return true;
+        },
+        4, db);
+
+    REQUIRE(winners == std::vector<std::string>{KeyUtils::toStrKey(top),
+                                                tied[0], tied[1], tied[2]});
+}
+
+TEST_CASE("account signers packed in the account row", "[ledgerentry]")
+{
+    Config cfg(getTestConfig());
+    cfg.INLINE_ACCOUNT_SIGNERS = true;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+    Database& db = app->getDatabase();
+    auto& sess = db.getSession();
+
+    LedgerHeader lh;
+    LedgerDelta delta(lh, db, false);
+    std::unordered_map<AccountID, AccountEntry> accounts;
+    size_t numSigners = 0;
+    for (int i = 0; i < 50; ++i)
+    {
+        LedgerEntry le;
+        le.data.type(ACCOUNT);
+        le.data.account() = LedgerTestUtils::generateValidAccountEntry(5);
+        auto const& a = le.data.account();
+        if (accounts.emplace(a.accountID, a).second)
+        {
+            AccountFrame af(le);
+            af.storeAdd(delta, db);
+            numSigners += a.signers.size();
+        }
+    }
+    REQUIRE(numSigners > 0);
+
+    auto checkAccounts = [&]() {
+        db.getEntryCache().clear();
+        for (auto const& a : accounts)
+        {
+            auto fromDb = AccountFrame::loadAccount(a.first, db);
+            REQUIRE(fromDb);
+            REQUIRE(fromDb->getAccount() == a.second);
+        }
+        app->getLedgerManager().checkDbState();
+    };
+    auto countRows = [&](std::string const& sql) {
+        size_t n = 0;
+        sess << sql, soci::into(n);
+        return n;
+    };
+
+    SECTION("stored inline")
+    {
+        checkAccounts();
+        REQUIRE(countRows("SELECT COUNT(*) FROM signers") == 0);
+
+        for (auto& a : accounts)
+        {
+            auto af = AccountFrame::loadAccount(a.first, db);
+            af->getAccount().signers.clear();
+            af->getAccount().numSubEntries = 0;
+            af->storeChange(delta, db);
+            a.second.signers.clear();
+            a.second.numSubEntries = 0;
+        }
+        checkAccounts();
+    }
+
+    SECTION("moved to the signers table and back")
+    {
+        db.clearPreparedStatementCache();
+        AccountFrame::moveSigners(db, false);
+        REQUIRE(countRows("SELECT COUNT(*) FROM signers") == numSigners);
+        REQUIRE(countRows("SELECT COUNT(*) FROM accounts WHERE "
+                          "packedsigners IS NOT NULL") == 0);
+        checkAccounts();
+
+        db.clearPreparedStatementCache();
+        AccountFrame::moveSigners(db, true);
+        REQUIRE(countRows("SELECT COUNT(*) FROM signers") == 0);
+        REQUIRE(countRows("SELECT COUNT(*) FROM accounts WHERE "
+                          "packedsigners IS NOT NULL") == accounts.size());
+        checkAccounts();
+    }
+
+    SECTION("checkDB rejects signers stored in both places")
+    {
+        auto const& a = *std::find_if(
+            accounts.begin(), accounts.end(),
+            [](std::pair<AccountID const, AccountEntry> const& p) {
+                return !p.second.signers.empty();
+            });
+        std::string id = binToHex(a.first.ed25519());
+        std::string key = binToHex(xdr::xdr_to_opaque(a.second.signers[0].key));
+        sess << "INSERT INTO signers VALUES (decode(:a, 'hex'), "
+                "decode(:k, 'hex'), 1)",
+            soci::use(id), soci::use(key);
+        REQUIRE_THROWS_AS(AccountFrame::checkDB(db), std::runtime_error);
+    }
+}
+
+static void
+benchAccountStore(Microbench& mb, Config cfg, std::string const& backend,
+                  bool inlineSigners)
+{
+    cfg.INLINE_ACCOUNT_SIGNERS = inlineSigners;
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+    Database& db = app->getDatabase();
+    auto& sess = db.getSession();
+    std::string suffix =
+        "/" + backend + (inlineSigners ? "/inline-signers" : "/signers-table");
+
+    size_t const n = 1000;
+    LedgerHeader lh;
+    LedgerDelta delta(lh, db, false);
+    std::vector<AccountFrame::pointer> frames;
+    for (size_t i = 0; i < n; ++i)
+    {
+        LedgerEntry le;
+        le.data.type(ACCOUNT);
+        le.data.account() = LedgerTestUtils::generateValidAccountEntry(5);
+        auto af = std::make_shared<AccountFrame>(le);
+        if (!AccountFrame::exists(db, af->getKey()))
+        {
+            af->storeAdd(delta, db);
+            frames.emplace_back(af);
+        }
+    }
+
+    size_t i = 0;
+    mb.run("AccountFrame::loadAccount/uncached" + suffix, 10000, [&]() {
+        auto const& af = frames[i++ % frames.size()];
+        EntryFrame::flushCachedEntry(af->getKey(), db);
+        Microbench::keep(AccountFrame::loadAccount(af->getID(), db));
+    });
+    mb.run("AccountFrame::storeChange" + suffix, 10000, [&]() {
+        auto const& af = frames[i++ % frames.size()];
+        af->getAccount().balance += 1;
+        af->storeChange(delta, db);
+    });
+
+    if (!db.isSqlite() || inlineSigners)
+    {
+        return;
+    }
+    // index footprint of the same keys, as StrKey text and as raw bytes
+    auto pagesFor = [&](std::string const& type, bool binary) {
+        size_t before = 0, after = 0;
+        sess << "PRAGMA page_count", soci::into(before);
+        sess << "CREATE TABLE keysize (k " << type << " PRIMARY KEY)";
+        for (auto const& af : frames)
+        {
+            std::string k = binary ? binToHex(af->getID().ed25519())
+                                   : KeyUtils::toStrKey(af->getID());
+            sess << (binary ? "INSERT INTO keysize VALUES (decode(:k, 'hex'))"
+                            : "INSERT INTO keysize VALUES (:k)"),
+                soci::use(k);
+        }
+        sess << "PRAGMA page_count", soci::into(after);
+        sess << "DROP TABLE keysize";
+        return after - before;
+    };
+    auto textPages = pagesFor("VARCHAR(56)", false);
+    auto binaryPages = pagesFor("BYTEA", true);
+    LOG(INFO) << "Pages for " << frames.size()
+              << " account keys: " << textPages << " as StrKey, "
+              << binaryPages << " as bytes";
+}
+
+TEST_CASE("account store microbenchmarks",
+          "[ledgerentry][microbench][bench][hide]")
+{
+    Microbench mb("accounts");
+    for (bool inlineSigners : {false, true})
+    {
+        benchAccountStore(mb, getTestConfig(), "sqlite", inlineSigners);
+#ifdef USE_POSTGRES
+        benchAccountStore(mb, getTestConfig(0, Config::TESTDB_POSTGRESQL),
+                          "postgresql", inlineSigners);
+#endif
+    }
+}
+
+TEST_CASE("inflation vote microbenchmarks",
+          "[ledgerentry][microbench][bench][hide]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+    Database& db = app->getDatabase();
+    auto& sess = db.getSession();
+    Microbench mb("inflation", 1, 3);
+
+    // rows go straight in through SQL, AccountFrame would take far longer
+    size_t const nAccounts = 2000000;
+    size_t const nDests = 20000;
+    std::vector<std::string> dests;
+    for (size_t i = 0; i < nDests; ++i)
+    {
+        dests.emplace_back(binToHex(randomBytes(32)));
+    }
+    {
+        std::string id, dest, thresholds("01000000");
+        int64 balance;
+        soci::transaction tx(sess);
+        soci::statement ins =
+            (sess.prepare << "INSERT INTO accounts (accountid, balance, "
+                             "seqnum, numsubentries, inflationdest, "
+                             "homedomain, thresholds, flags, lastmodified) "
+                             "VALUES (decode(:id, 'hex'), :b, 0, 0, "
+                             "decode(:d, 'hex'), '', decode(:t, 'hex'), 0, 1)",
+             soci::use(id), soci::use(balance), soci::use(dest),
+             soci::use(thresholds));
+        for (size_t i = 0; i < nAccounts; ++i)
+        {
+            id = binToHex(randomBytes(32));
+            dest = dests[i % nDests];
+            balance = 100000000 * static_cast<int64>(1 + i % 100);
+            ins.execute(true);
+        }
+        tx.commit();
+    }
+    AccountFrame::rebuildInflationVotes(db);
+
+    std::vector<AccountFrame::InflationVotes> winners;
+    auto collect = [&](AccountFrame::InflationVotes const& v) {
+        winners.emplace_back(v);
+        return true;
+    };
+    mb.run("processForInflation/2000-winners", 1, [&]() {
+        winners.clear();
+        AccountFrame::processForInflation(collect, 2000, db);
+    });
+    mb.run("tallyInflationVotes/group-by-accounts", 1, [&]() {
+        Microbench::keep(AccountFrame::tallyInflationVotes(db));
+    });
+
+    LedgerHeader lh;
+    LedgerDelta delta(lh, db, false);
+    auto voter = std::make_shared<AccountFrame>(PubKeyUtils::random());
+    voter->getAccount().balance = 10000000000;
+    voter->getAccount().inflationDest.activate() =
+        winners.front().mInflationDest;
+    voter->storeAdd(delta, db);
+    mb.run("AccountFrame::storeChange/voter", 1000, [&]() {
+        voter->getAccount().balance += 1;
+        voter->storeChange(delta, db);
+    });
+}
 }
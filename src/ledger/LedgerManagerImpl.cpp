@@ -24,8 +24,10 @@
 #include "ledger/LedgerHeaderFrame.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "main/WarmRestart.h"
 #include "main/Whitelist.h"
 #include "overlay/OverlayManager.h"
+#include "util/LatencyHistogram.h"
 #include "util/Logging.h"
 #include "util/format.h"
 #include "util/make_unique.h"
@@ -112,9 +114,14 @@ LedgerManager::ledgerAbbrev(LedgerHeaderHistoryEntry he)
 
 LedgerManagerImpl::LedgerManagerImpl(Application& app)
     : mApp(app)
-    , mTransactionApply(
-          app.getMetrics().NewTimer({"ledger", "transaction", "apply"}))
+    , mTransactionApply(app.getLatencyMetrics().NewHistogram(
+          {"ledger", "transaction", "apply"}))
     , mLedgerClose(app.getMetrics().NewTimer({"ledger", "ledger", "close"}))
+    , mCloseFees(app.getMetrics().NewTimer({"ledger", "close", "fees"}))
+    , mCloseApply(app.getMetrics().NewTimer({"ledger", "close", "apply"}))
+    , mCloseBuckets(app.getMetrics().NewTimer({"ledger", "close", "buckets"}))
+    , mCloseCommit(app.getMetrics().NewTimer({"ledger", "close", "commit"}))
+    , mCloseCleanup(app.getMetrics().NewTimer({"ledger", "close", "cleanup"}))
     , mLedgerAgeClosed(app.getMetrics().NewTimer({"ledger", "age", "closed"}))
     , mLedgerAge(
           app.getMetrics().NewCounter({"ledger", "age", "current-seconds"}))
@@ -127,6 +134,10 @@ LedgerManagerImpl::LedgerManagerImpl(Application& app)
     , mSyncingLedgersSize(
           app.getMetrics().NewCounter({"ledger", "memory", "syncing-ledgers"}))
     , mState(LM_BOOTING_STATE)
+    , mFirstLedgerClose(
+          app.getMetrics().NewTimer({"ledger", "restart", "first-close"}))
+    , mStartTime(mApp.getClock().now())
+    , mFirstCloseRecorded(false)
 
 {
 }
@@ -257,7 +268,13 @@ LedgerManagerImpl::loadLastKnownLedger(
                 }
                 else
                 {
-                    mApp.getBucketManager().assumeState(has);
+                    auto restored = has;
+                    if (mApp.getConfig().WARM_RESTART_SNAPSHOT)
+                    {
+                        WarmRestart::adoptMerges(
+                            mApp, mCurrentLedger->getHash(), restored);
+                    }
+                    mApp.getBucketManager().assumeState(restored);
 
                     CLOG(INFO, "Ledger") << "Loaded last known ledger: "
                                          << ledgerAbbrev(mCurrentLedger);
@@ -740,12 +757,16 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     vector<TransactionFramePtr> txs = ledgerData.getTxSet()->sortForApply();
 
     // first, charge fees
+    auto feesTime = mCloseFees.TimeScope();
     processFeesSeqNums(txs, ledgerDelta);
+    feesTime.Stop();
 
     TransactionResultSet txResultSet;
     txResultSet.results.reserve(txs.size());
 
+    auto applyTime = mCloseApply.TimeScope();
     applyTransactions(txs, ledgerDelta, txResultSet);
+    applyTime.Stop();
 
     ledgerDelta.getHeader().txSetResultHash =
         sha256(xdr::xdr_to_opaque(txResultSet));
@@ -769,7 +790,9 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     }
 
     ledgerDelta.commit();
+    auto bucketsTime = mCloseBuckets.TimeScope();
     ledgerClosed(ledgerDelta);
+    bucketsTime.Stop();
 
     // The next 4 steps happen in a relatively non-obvious, subtle order.
     // This is unfortunate and it would be nice if we could make it not
@@ -793,15 +816,25 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     hm.maybeQueueHistoryCheckpoint();
 
     // step 2
+    auto commitTime = mCloseCommit.TimeScope();
     mApp.getDatabase().clearPreparedStatementCache();
     txscope.commit();
+    commitTime.Stop();
 
     // step 3
+    auto cleanupTime = mCloseCleanup.TimeScope();
     hm.publishQueuedHistory();
     hm.logAndUpdatePublishStatus();
 
     // step 4
     mApp.getBucketManager().forgetUnreferencedBuckets();
+    cleanupTime.Stop();
+
+    if (!mFirstCloseRecorded)
+    {
+        mFirstCloseRecorded = true;
+        mFirstLedgerClose.Update(mApp.getClock().now() - mStartTime);
+    }
 }
 
 void
@@ -31,6 +31,7 @@ namespace stellar
 {
 class Application;
 class Database;
+class LatencyHistogram;
 class LedgerDelta;
 
 class LedgerManagerImpl : public LedgerManager
@@ -39,8 +40,17 @@ class LedgerManagerImpl : public LedgerManager
     LedgerHeaderFrame::pointer mCurrentLedger;
 
     Application& mApp;
-    medida::Timer& mTransactionApply;
+    // timed once per transaction, so kept off medida's locked reservoirs
+    LatencyHistogram& mTransactionApply;
     medida::Timer& mLedgerClose;
+    // phases of closeLedger: fee charging, transaction application, adding
+    // the changes to the BucketList and storing the header, database commit,
+    // publish and bucket garbage collection
+    medida::Timer& mCloseFees;
+    medida::Timer& mCloseApply;
+    medida::Timer& mCloseBuckets;
+    medida::Timer& mCloseCommit;
+    medida::Timer& mCloseCleanup;
     medida::Timer& mLedgerAgeClosed;
     medida::Counter& mLedgerAge;
     medida::Counter& mLedgerStateCurrent;
@@ -68,6 +78,12 @@ class LedgerManagerImpl : public LedgerManager
 
     State mState;
 
+    // time from startup to the end of the first ledger close, to measure
+    // how long a (re)started node takes to be useful again
+    medida::Timer& mFirstLedgerClose;
+    VirtualClock::time_point mStartTime;
+    bool mFirstCloseRecorded;
+
   public:
     LedgerManagerImpl(Application& app);
 
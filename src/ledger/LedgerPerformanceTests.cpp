@@ -5,21 +5,30 @@
 #include "bucket/BucketManager.h"
 #include "database/Database.h"
 #include "herder/LedgerCloseData.h"
+#include "herder/TxSetFrame.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
+#include "lib/json/json.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "main/PersistentState.h"
 #include "simulation/Simulation.h"
+#include "test/TestAccount.h"
 #include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Math.h"
 #include "util/SociNoWarnings.h"
 #include "util/Timer.h"
+#include "util/format.h"
 #include "util/make_unique.h"
 #include "util/optional.h"
+#include "medida/stats/snapshot.h"
+#include "medida/timer.h"
+#include <fstream>
+#include <limits>
+#include <random>
 
 using namespace stellar;
 using namespace std;
@@ -223,3 +232,278 @@ TEST_CASE("ledger performance test", "[performance][hide]")
         LOG(INFO) << "done";
     }
 }
+
+namespace
+{
+
+// Reproducible ledger close benchmark: builds the same ledger state on every
+// run (accounts trusting two assets issued by one gateway, and a market maker
+// with offers between them), then closes ledgers made of fixed transaction
+// sets of a given mix and reports the closeLedger phase timings.
+class LedgerCloseBench
+{
+    static int64_t const BALANCE = 1000000000000;
+
+    Application& mApp;
+    std::mt19937 mRand;
+    uint64 mCloseTime;
+
+    TestAccount mRoot;
+    TestAccount mIssuer;
+    TestAccount mMarketMaker;
+    std::vector<TestAccount> mAccounts;
+    Asset mUSD;
+    Asset mEUR;
+
+    void
+    closeLedger(std::vector<TransactionFramePtr> const& txs)
+    {
+        auto& lm = mApp.getLedgerManager();
+        auto txSet = std::make_shared<TxSetFrame>(
+            lm.getLastClosedLedgerHeader().hash);
+        for (auto const& tx : txs)
+        {
+            txSet->add(tx);
+        }
+        txSet->sortForHash();
+        StellarValue sv(txSet->getContentsHash(), ++mCloseTime,
+                        emptyUpgradeSteps, 0);
+        LedgerCloseData ledgerData(lm.getLedgerNum(), txSet, sv);
+        lm.closeLedger(ledgerData);
+    }
+
+    // one transaction per batch of 100 operations from `source`
+    void
+    closeLedgerWithOps(TestAccount& source, std::vector<Operation> const& ops)
+    {
+        std::vector<TransactionFramePtr> txs;
+        for (size_t i = 0; i < ops.size(); i += 100)
+        {
+            auto end = std::min(ops.size(), i + 100);
+            txs.push_back(source.tx(
+                std::vector<Operation>(ops.begin() + i, ops.begin() + end)));
+        }
+        closeLedger(txs);
+    }
+
+    TestAccount&
+    pick()
+    {
+        return mAccounts[std::uniform_int_distribution<size_t>(
+            0, mAccounts.size() - 1)(mRand)];
+    }
+
+    TestAccount&
+    pickOther(TestAccount const& a)
+    {
+        for (;;)
+        {
+            auto& b = pick();
+            if (&b != &a)
+            {
+                return b;
+            }
+        }
+    }
+
+  public:
+    LedgerCloseBench(Application& app)
+        : mApp(app)
+        , mRand(0x5eed)
+        , mCloseTime(app.getLedgerManager()
+                         .getLastClosedLedgerHeader()
+                         .header.scpValue.closeTime)
+        , mRoot(TestAccount::createRoot(app))
+        , mIssuer(app, txtest::getAccount("bench-issuer"))
+        , mMarketMaker(app, txtest::getAccount("bench-market-maker"))
+        , mUSD(txtest::makeAsset(mIssuer, "USD"))
+        , mEUR(txtest::makeAsset(mIssuer, "EUR"))
+    {
+    }
+
+    void
+    setup(size_t nAccounts)
+    {
+        std::vector<Operation> ops;
+        ops.push_back(txtest::createAccount(mIssuer, BALANCE));
+        ops.push_back(txtest::createAccount(mMarketMaker, BALANCE));
+        for (size_t i = 0; i < nAccounts; ++i)
+        {
+            mAccounts.emplace_back(
+                mApp, txtest::getAccount(fmt::format("bench-{:d}", i).c_str()));
+            ops.push_back(txtest::createAccount(mAccounts.back(), BALANCE));
+        }
+        closeLedgerWithOps(mRoot, ops);
+
+        std::vector<TransactionFramePtr> txs;
+        auto limit = std::numeric_limits<int64_t>::max();
+        txs.push_back(mMarketMaker.tx({txtest::changeTrust(mUSD, limit),
+                                       txtest::changeTrust(mEUR, limit)}));
+        for (auto& a : mAccounts)
+        {
+            txs.push_back(a.tx({txtest::changeTrust(mUSD, limit),
+                                txtest::changeTrust(mEUR, limit)}));
+        }
+        closeLedger(txs);
+
+        ops.clear();
+        ops.push_back(txtest::payment(mMarketMaker, mUSD, BALANCE));
+        ops.push_back(txtest::payment(mMarketMaker, mEUR, BALANCE));
+        for (auto& a : mAccounts)
+        {
+            ops.push_back(txtest::payment(a, mUSD, BALANCE / 1000));
+            ops.push_back(txtest::payment(a, mEUR, BALANCE / 1000));
+        }
+        closeLedgerWithOps(mIssuer, ops);
+
+        Price one;
+        one.n = 1;
+        one.d = 1;
+        closeLedger(
+            {mMarketMaker.tx({txtest::manageOffer(0, mUSD, mEUR, one,
+                                                  BALANCE / 2),
+                              txtest::manageOffer(0, mEUR, mUSD, one,
+                                                  BALANCE / 2)})});
+    }
+
+    TransactionFramePtr
+    makeTx(std::string const& mix)
+    {
+        static std::vector<std::string> const kinds = {
+            "payment", "path-payment", "offer", "manage-data"};
+        auto kind = mix;
+        if (kind == "mixed")
+        {
+            kind = kinds[std::uniform_int_distribution<size_t>(
+                0, kinds.size() - 1)(mRand)];
+        }
+
+        auto& from = pick();
+        if (kind == "payment")
+        {
+            return from.tx({txtest::payment(pickOther(from), 1000)});
+        }
+        else if (kind == "path-payment")
+        {
+            return from.tx({txtest::pathPayment(pickOther(from), mUSD, 2000,
+                                                mEUR, 1000, {})});
+        }
+        else if (kind == "offer")
+        {
+            // priced away from the market maker's so that these rest on the
+            // book
+            Price price;
+            price.n = 2 + std::uniform_int_distribution<int32_t>(0, 100)(mRand);
+            price.d = 1;
+            return from.tx(
+                {txtest::manageOffer(0, mUSD, mEUR, price, 1000)});
+        }
+        else
+        {
+            DataValue value;
+            value.resize(32);
+            for (auto& b : value)
+            {
+                b = static_cast<uint8_t>(mRand());
+            }
+            auto name = fmt::format(
+                "bench-{:d}",
+                std::uniform_int_distribution<int>(0, 9)(mRand));
+            return from.tx({txtest::manageData(name, &value)});
+        }
+    }
+
+    void
+    run(std::string const& mix, size_t nLedgers, size_t nTxs)
+    {
+        for (size_t i = 0; i < nLedgers; ++i)
+        {
+            std::vector<TransactionFramePtr> txs;
+            for (size_t j = 0; j < nTxs; ++j)
+            {
+                txs.push_back(makeTx(mix));
+            }
+            closeLedger(txs);
+        }
+    }
+};
+
+Json::Value
+timerSummary(medida::Timer& timer)
+{
+    Json::Value res;
+    auto snap = timer.GetSnapshot();
+    res["count"] = static_cast<Json::UInt64>(timer.count());
+    res["mean_ms"] = timer.mean();
+    res["p50_ms"] = snap.getMedian();
+    res["p99_ms"] = snap.get99thPercentile();
+    res["max_ms"] = timer.max();
+    return res;
+}
+}
+
+TEST_CASE("ledger close benchmark", "[ledger][bench][hide]")
+{
+    size_t const nAccounts = 10000;
+    size_t const nLedgers = 20;
+    size_t const nTxsPerLedger = 500;
+    std::vector<std::string> const mixes = {
+        "payment", "path-payment", "offer", "manage-data", "mixed"};
+    std::vector<std::string> const phases = {"fees", "apply", "buckets",
+                                             "commit", "cleanup"};
+
+    auto runBench = [&](Config::TestDbMode mode, std::string const& dbName) {
+        VirtualClock clock;
+        auto cfg = getTestConfig(0, mode);
+        auto app = createTestApplication(clock, cfg);
+        app->start();
+
+        LedgerCloseBench bench(*app);
+        bench.setup(nAccounts);
+
+        Json::Value results;
+        results["database"] = dbName;
+        results["accounts"] = static_cast<Json::UInt64>(nAccounts);
+        results["ledgers"] = static_cast<Json::UInt64>(nLedgers);
+        results["txs_per_ledger"] = static_cast<Json::UInt64>(nTxsPerLedger);
+
+        auto& m = app->getMetrics();
+        auto& closeTimer = m.NewTimer({"ledger", "ledger", "close"});
+        for (auto const& mix : mixes)
+        {
+            closeTimer.Clear();
+            for (auto const& phase : phases)
+            {
+                m.NewTimer({"ledger", "close", phase}).Clear();
+            }
+
+            bench.run(mix, nLedgers, nTxsPerLedger);
+
+            auto& res = results["mixes"][mix];
+            res["close"] = timerSummary(closeTimer);
+            for (auto const& phase : phases)
+            {
+                res[phase] =
+                    timerSummary(m.NewTimer({"ledger", "close", phase}));
+            }
+        }
+
+        auto filename = fmt::format("ledger-close-bench-{}.json", dbName);
+        std::ofstream out(filename);
+        out << results.toStyledString();
+        LOG(INFO) << "Ledger close benchmark results written to " << filename
+                  << ":" << std::endl
+                  << results.toStyledString();
+    };
+
+    SECTION("sqlite")
+    {
+        runBench(Config::TESTDB_ON_DISK_SQLITE, "sqlite");
+    }
+#ifdef USE_POSTGRES
+    SECTION("postgresql")
+    {
+        runBench(Config::TESTDB_POSTGRESQL, "postgresql");
+    }
+#endif
+}
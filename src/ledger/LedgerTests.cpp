@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "LedgerTestUtils.h"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/AccountFrame.h"
 #include "ledger/EntryFrame.h"
@@ -11,8 +12,11 @@
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "main/WarmRestart.h"
 #include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
+#include "util/Fs.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include "util/types.h"
@@ -162,3 +166,56 @@ TEST_CASE("cannot close ledger with unsupported ledger version", "[ledger]")
         app->getLedgerManager(), Config::CURRENT_LEDGER_PROTOCOL_VERSION + 1);
     REQUIRE_THROWS_AS(applyEmptyLedger(), std::runtime_error);
 }
+
+TEST_CASE("warm restart snapshot", "[ledger][dbcache]")
+{
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    cfg.WARM_RESTART_SNAPSHOT = true;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+
+    auto& db = app->getDatabase();
+    auto root = txtest::getRoot(app->getNetworkID());
+    LedgerKey key(ACCOUNT);
+    key.account().accountID = root.getPublicKey();
+
+    PubKeyUtils::clearVerifySigCache();
+    db.getEntryCache().clear();
+    REQUIRE(AccountFrame::loadAccount(root.getPublicKey(), db));
+    std::string msg("warm restart");
+    ByteSlice bin(msg);
+    REQUIRE(PubKeyUtils::verifySig(root.getPublicKey(), root.sign(bin), bin));
+
+    WarmRestart::save(*app);
+    auto filename = WarmRestart::snapshotFilename(*app);
+    REQUIRE(fs::exists(filename));
+
+    PubKeyUtils::clearVerifySigCache();
+    db.getEntryCache().clear();
+    REQUIRE(!EntryFrame::cachedEntryExists(key, db));
+
+    SECTION("caches are reloaded")
+    {
+        WarmRestart::warmCaches(*app);
+        CHECK(EntryFrame::cachedEntryExists(key, db));
+        CHECK(PubKeyUtils::getVerifySigCacheContents().size() == 1);
+    }
+
+    SECTION("snapshot of another ledger is ignored")
+    {
+        auto const& lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+        auto txSet = std::make_shared<TxSetFrame>(lcl.hash);
+        StellarValue sv(txSet->getContentsHash(), 1, emptyUpgradeSteps, 0);
+        LedgerCloseData ledgerData(lcl.header.ledgerSeq + 1, txSet, sv);
+        app->getLedgerManager().closeLedger(ledgerData);
+        db.getEntryCache().clear();
+
+        WarmRestart::warmCaches(*app);
+        CHECK(!EntryFrame::cachedEntryExists(key, db));
+        CHECK(PubKeyUtils::getVerifySigCacheContents().empty());
+    }
+
+    CHECK(!fs::exists(filename));
+}
@@ -441,6 +441,61 @@ OfferFrame::storeAdd(LedgerDelta& delta, Database& db)
     storeUpdateHelper(delta, db, true);
 }
 
+// issuer and code columns of an asset, NULL for the native asset
+static soci::indicator
+getAssetFields(Asset const& asset, std::string& issuerStrKey,
+               std::string& assetCode)
+{
+    if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
+    {
+        issuerStrKey = KeyUtils::toStrKey(asset.alphaNum4().issuer);
+        assetCodeToStr(asset.alphaNum4().assetCode, assetCode);
+        return soci::i_ok;
+    }
+    else if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
+    {
+        issuerStrKey = KeyUtils::toStrKey(asset.alphaNum12().issuer);
+        assetCodeToStr(asset.alphaNum12().assetCode, assetCode);
+        return soci::i_ok;
+    }
+    return soci::i_null;
+}
+
+void
+OfferFrame::bulkDelete(soci::session& sess, LedgerKey const& key)
+{
+    sess << "DELETE FROM offers WHERE offerid=:s", use(key.offer().offerID);
+}
+
+void
+OfferFrame::bulkInsert(soci::session& sess, LedgerEntry const& entry)
+{
+    auto const& offer = entry.data.offer();
+    std::string actIDStrKey = KeyUtils::toStrKey(offer.sellerID);
+
+    unsigned int sellingType = offer.selling.type();
+    unsigned int buyingType = offer.buying.type();
+    std::string sellingIssuerStrKey, buyingIssuerStrKey;
+    std::string sellingAssetCode, buyingAssetCode;
+    soci::indicator selling_ind =
+        getAssetFields(offer.selling, sellingIssuerStrKey, sellingAssetCode);
+    soci::indicator buying_ind =
+        getAssetFields(offer.buying, buyingIssuerStrKey, buyingAssetCode);
+    double price = double(offer.price.n) / double(offer.price.d);
+
+    sess << "INSERT INTO offers (sellerid,offerid,"
+            "sellingassettype,sellingassetcode,sellingissuer,"
+            "buyingassettype,buyingassetcode,buyingissuer,"
+            "amount,pricen,priced,price,flags,lastmodified) VALUES "
+            "(:sid,:oid,:sat,:sac,:si,:bat,:bac,:bi,:a,:pn,:pd,:p,:f,:l)",
+        use(actIDStrKey), use(offer.offerID), use(sellingType),
+        use(sellingAssetCode, selling_ind),
+        use(sellingIssuerStrKey, selling_ind), use(buyingType),
+        use(buyingAssetCode, buying_ind), use(buyingIssuerStrKey, buying_ind),
+        use(offer.amount), use(offer.price.n), use(offer.price.d), use(price),
+        use(offer.flags), use(entry.lastModifiedLedgerSeq);
+}
+
 void
 OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 {
@@ -452,37 +507,10 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
     unsigned int buyingType = mOffer.buying.type();
     std::string sellingIssuerStrKey, buyingIssuerStrKey;
     std::string sellingAssetCode, buyingAssetCode;
-    soci::indicator selling_ind = soci::i_null, buying_ind = soci::i_null;
-
-    if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM4)
-    {
-        sellingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.selling.alphaNum4().issuer);
-        assetCodeToStr(mOffer.selling.alphaNum4().assetCode, sellingAssetCode);
-        selling_ind = soci::i_ok;
-    }
-    else if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM12)
-    {
-        sellingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.selling.alphaNum12().issuer);
-        assetCodeToStr(mOffer.selling.alphaNum12().assetCode, sellingAssetCode);
-        selling_ind = soci::i_ok;
-    }
-
-    if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM4)
-    {
-        buyingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.buying.alphaNum4().issuer);
-        assetCodeToStr(mOffer.buying.alphaNum4().assetCode, buyingAssetCode);
-        buying_ind = soci::i_ok;
-    }
-    else if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM12)
-    {
-        buyingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.buying.alphaNum12().issuer);
-        assetCodeToStr(mOffer.buying.alphaNum12().assetCode, buyingAssetCode);
-        buying_ind = soci::i_ok;
-    }
+    soci::indicator selling_ind =
+        getAssetFields(mOffer.selling, sellingIssuerStrKey, sellingAssetCode);
+    soci::indicator buying_ind =
+        getAssetFields(mOffer.buying, buyingIssuerStrKey, buyingAssetCode);
 
     string sql;
 
@@ -85,6 +85,10 @@ class OfferFrame : public EntryFrame
     static void deleteOffersModifiedOnOrAfterLedger(Database& db,
                                                     uint32_t oldestLedger);
 
+    // Bulk-load helpers, see EntryFrame::bulkReplace.
+    static void bulkDelete(soci::session& sess, LedgerKey const& key);
+    static void bulkInsert(soci::session& sess, LedgerEntry const& entry);
+
     // database utilities
     static pointer loadOffer(AccountID const& accountID, uint64_t offerID,
                              Database& db, LedgerDelta* delta = nullptr);
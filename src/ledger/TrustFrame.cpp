@@ -224,6 +224,33 @@ TrustFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     delta.deleteEntry(key);
 }
 
+void
+TrustFrame::bulkDelete(soci::session& sess, LedgerKey const& key)
+{
+    std::string actIDStrKey, issuerStrKey, assetCode;
+    getKeyFields(key, actIDStrKey, issuerStrKey, assetCode);
+    sess << "DELETE FROM trustlines "
+            "WHERE accountid=:v1 AND issuer=:v2 AND assetcode=:v3",
+        use(actIDStrKey), use(issuerStrKey), use(assetCode);
+}
+
+void
+TrustFrame::bulkInsert(soci::session& sess, LedgerEntry const& entry)
+{
+    auto const& line = entry.data.trustLine();
+    std::string actIDStrKey, issuerStrKey, assetCode;
+    unsigned int assetType = line.asset.type();
+    getKeyFields(LedgerEntryKey(entry), actIDStrKey, issuerStrKey, assetCode);
+
+    sess << "INSERT INTO trustlines "
+            "(accountid, assettype, issuer, assetcode, balance, tlimit, flags, "
+            "lastmodified) "
+            "VALUES (:v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8)",
+        use(actIDStrKey), use(assetType), use(issuerStrKey), use(assetCode),
+        use(line.balance), use(line.limit), use(line.flags),
+        use(entry.lastModifiedLedgerSeq);
+}
+
 void
 TrustFrame::storeChange(LedgerDelta& delta, Database& db)
 {
@@ -71,6 +71,10 @@ class TrustFrame : public EntryFrame
     static void deleteTrustLinesModifiedOnOrAfterLedger(Database& db,
                                                         uint32_t oldestLedger);
 
+    // Bulk-load helpers, see EntryFrame::bulkReplace.
+    static void bulkDelete(soci::session& sess, LedgerKey const& key);
+    static void bulkInsert(soci::session& sess, LedgerEntry const& entry);
+
     // returns the specified trustline or a generated one for issuers
     static pointer loadTrustLine(AccountID const& accountID, Asset const& asset,
                                  Database& db, LedgerDelta* delta = nullptr);
@@ -42,6 +42,7 @@ class WorkManager;
 class BanManager;
 class StatusManager;
 class Whitelist;
+class LatencyRegistry;
 
 class Application;
 void validateNetworkPassphrase(std::shared_ptr<Application> app);
@@ -179,6 +180,10 @@ class Application
     // reported through the administrative HTTP interface, see CommandHandler.
     virtual medida::MetricsRegistry& getMetrics() = 0;
 
+    // Get the latency histograms owned by this application, for timers on
+    // hot paths. They are reported along with getMetrics().
+    virtual LatencyRegistry& getLatencyMetrics() = 0;
+
     // Ensure any App-local metrics that are "current state" gauge-like counters
     // reflect the current reality as best as possible.
     virtual void syncOwnMetrics() = 0;
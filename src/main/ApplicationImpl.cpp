@@ -21,6 +21,7 @@
 #include "invariant/BucketListIsConsistentWithDatabase.h"
 #include "invariant/CacheIsConsistentWithDatabase.h"
 #include "invariant/ConservationOfLumens.h"
+#include "invariant/InflationVotesMatchAccounts.h"
 #include "invariant/InvariantManager.h"
 #include "invariant/LedgerEntryIsValid.h"
 #include "invariant/MinimumAccountBalance.h"
@@ -28,8 +29,10 @@
 #include "main/CommandHandler.h"
 #include "main/ExternalQueue.h"
 #include "main/Maintainer.h"
+#include "main/MetricsExporter.h"
 #include "main/NtpSynchronizationChecker.h"
 #include "main/StellarCoreVersion.h"
+#include "main/WarmRestart.h"
 #include "medida/counter.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
@@ -46,6 +49,7 @@
 
 #include "main/Whitelist.h"
 
+#include "util/LatencyHistogram.h"
 #include "util/Logging.h"
 #include "util/TmpDir.h"
 #include "util/make_unique.h"
@@ -68,6 +72,7 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     , mStopping(false)
     , mStoppingTimer(*this)
     , mMetrics(make_unique<medida::MetricsRegistry>())
+    , mLatencyMetrics(make_unique<LatencyRegistry>())
     , mAppStateCurrent(mMetrics->NewCounter({"app", "state", "current"}))
     , mAppStateChanges(mMetrics->NewTimer({"app", "state", "changes"}))
     , mLastStateChange(clock.now())
@@ -119,6 +124,10 @@ ApplicationImpl::initialize()
     mMaintainer = make_unique<Maintainer>(*this);
     mProcessManager = ProcessManager::create(*this);
     mCommandHandler = make_unique<CommandHandler>(*this);
+    if (mConfig.METRICS_HTTP_PORT)
+    {
+        mMetricsExporter = make_unique<MetricsExporter>(*this);
+    }
     mWorkManager = WorkManager::create(*this);
     mBanManager = BanManager::create(*this);
     mStatusManager = make_unique<StatusManager>();
@@ -129,6 +138,7 @@ ApplicationImpl::initialize()
     AccountSubEntriesCountIsValid::registerInvariant(*this);
     CacheIsConsistentWithDatabase::registerInvariant(*this);
     ConservationOfLumens::registerInvariant(*this);
+    InflationVotesMatchAccounts::registerInvariant(*this);
     LedgerEntryIsValid::registerInvariant(*this);
     MinimumAccountBalance::registerInvariant(*this);
     enableInvariantsFromConfig();
@@ -352,6 +362,10 @@ ApplicationImpl::start()
                     "Unable to restore last-known ledger state");
             }
 
+            if (mConfig.WARM_RESTART_SNAPSHOT)
+            {
+                WarmRestart::warmCaches(*this);
+            }
             // restores Herder's state before starting overlay
             mHerder->restoreState();
             // set known cursors before starting maintenance job
@@ -421,6 +435,12 @@ ApplicationImpl::gracefulStop()
     {
         mProcessManager->shutdown();
     }
+    if (mConfig.WARM_RESTART_SNAPSHOT && mBucketManager &&
+        mLedgerManager && mLedgerManager->getLastClosedLedgerNum() != 0)
+    {
+        // before the BucketManager forgets buckets not in the BucketList
+        WarmRestart::save(*this);
+    }
     if (mBucketManager)
     {
         mBucketManager->shutdown();
@@ -452,6 +472,7 @@ ApplicationImpl::joinAllThreads()
     // We never strictly stop the worker IO service, just release the work-lock
     // that keeps the worker threads alive. This gives them the chance to finish
     // any work that the main thread queued.
+    mMetricsExporter.reset();
     if (mWork)
     {
         mWork.reset();
@@ -578,6 +599,12 @@ ApplicationImpl::getMetrics()
     return *mMetrics;
 }
 
+LatencyRegistry&
+ApplicationImpl::getLatencyMetrics()
+{
+    return *mLatencyMetrics;
+}
+
 void
 ApplicationImpl::syncOwnMetrics()
 {
@@ -29,6 +29,7 @@ class ProcessManager;
 class CommandHandler;
 class Database;
 class LoadGenerator;
+class MetricsExporter;
 class NtpSynchronizationChecker;
 
 class Whitelist;
@@ -50,6 +51,7 @@ class ApplicationImpl : public Application
     virtual bool isStopping() const override;
     virtual VirtualClock& getClock() override;
     virtual medida::MetricsRegistry& getMetrics() override;
+    virtual LatencyRegistry& getLatencyMetrics() override;
     virtual void syncOwnMetrics() override;
     virtual void syncAllMetrics() override;
     virtual TmpDirManager& getTmpDirManager() override;
@@ -159,6 +161,8 @@ class ApplicationImpl : public Application
     VirtualTimer mStoppingTimer;
 
     std::unique_ptr<medida::MetricsRegistry> mMetrics;
+    std::unique_ptr<LatencyRegistry> mLatencyMetrics;
+    std::unique_ptr<MetricsExporter> mMetricsExporter;
     medida::Counter& mAppStateCurrent;
     medida::Timer& mAppStateChanges;
     VirtualClock::time_point mLastStateChange;
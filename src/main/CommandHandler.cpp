@@ -13,13 +13,14 @@
 #include "main/Application.h"
 #include "main/Config.h"
 #include "main/Maintainer.h"
+#include "main/MetricsExporter.h"
 #include "overlay/BanManager.h"
 #include "overlay/OverlayManager.h"
+#include "simulation/LoadGenerator.h"
 #include "util/Logging.h"
 #include "util/StatusManager.h"
 #include "util/make_unique.h"
 
-#include "medida/reporting/json_reporter.h"
 #include "util/basen.h"
 #include "xdrpp/marshal.h"
 #include "xdrpp/printer.h"
@@ -258,9 +259,15 @@ CommandHandler::fileNotFound(std::string const& params, std::string& retStr)
         "/droppeer?node=NODE_ID[&ban=D]</h1>"
         "drops peer identified by PEER_ID, when D is 1 the peer is also banned"
         "</p><p><h1> "
-        "/generateload[?accounts=N&txs=M&txrate=(R|auto)]</h1>"
+        "/generateload[?mode=(create|open|report)&accounts=N&txs=M&txrate=("
+        "R|auto)]</h1>"
         "artificially generate load for testing; must be used with "
-        "ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING set to true"
+        "ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING set to true.<br>"
+        "mode=open submits M pre-signed payments between the accounts "
+        "created by earlier runs at Poisson-distributed arrivals averaging R "
+        "tx/s, independently of how fast the node takes them; "
+        "mode=report returns the submit to externalize latency percentiles "
+        "of such runs"
         "</p><p><h1> /help</h1>"
         "give a list of currently supported commands"
         "</p><p><h1> /info</h1>"
@@ -415,6 +422,30 @@ CommandHandler::generateLoad(std::string const& params, std::string& retStr)
         maybeParseNumParam(map, "accounts", nAccounts);
         maybeParseNumParam(map, "txs", nTxs);
 
+        auto mode = map.find("mode");
+        if (mode != map.end() && mode->second == "report")
+        {
+            retStr = mApp.getLoadGenerator().openLoopLatencyReport(mApp);
+            return;
+        }
+        if (mode != map.end() && mode->second == "open")
+        {
+            maybeParseNumParam(map, "txrate", txRate);
+            if (mApp.getLoadGenerator().generateOpenLoopLoad(mApp, nTxs,
+                                                             txRate))
+            {
+                retStr = fmt::format(
+                    "Generating open-loop load: {:d} txs, {:d} tx/s", nTxs,
+                    txRate);
+            }
+            else
+            {
+                retStr = "Open-loop load needs accounts, create them first "
+                         "with mode=create";
+            }
+            return;
+        }
+
         {
             auto i = map.find("txrate");
             if (i != map.end() && i->second == std::string("auto"))
@@ -483,8 +514,8 @@ void
 CommandHandler::metrics(std::string const& params, std::string& retStr)
 {
     mApp.syncAllMetrics();
-    medida::reporting::JsonReporter jr(mApp.getMetrics());
-    retStr = jr.Report();
+    retStr = MetricsExporter::renderJson(mApp.getMetrics(),
+                                         mApp.getLatencyMetrics());
 }
 
 void
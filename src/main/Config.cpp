@@ -34,7 +34,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     LEDGER_PROTOCOL_VERSION = CURRENT_LEDGER_PROTOCOL_VERSION;
 
     OVERLAY_PROTOCOL_MIN_VERSION = 5;
-    OVERLAY_PROTOCOL_VERSION = 6;
+    OVERLAY_PROTOCOL_VERSION = 7;
 
     VERSION_STR = STELLAR_CORE_VERSION;
 
@@ -56,6 +56,11 @@ Config::Config() : NODE_SEED(SecretKey::random())
 
     LOG_FILE_PATH = "stellar-core.%datetime{%Y.%M.%d-%H:%m:%s}.log";
     BUCKET_DIR_PATH = "buckets";
+    WARM_RESTART_SNAPSHOT = false;
+    INLINE_ACCOUNT_SIGNERS = false;
+    DISABLE_XDR_FSYNC = false;
+    BUCKET_MERGE_DIRECT_IO = false;
+    CATCHUP_MERGE_BUCKETS = false;
 
     TESTING_UPGRADE_DESIRED_FEE = LedgerManager::GENESIS_LEDGER_BASE_FEE;
     TESTING_UPGRADE_RESERVE = LedgerManager::GENESIS_LEDGER_BASE_RESERVE;
@@ -64,6 +69,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     HTTP_PORT = DEFAULT_PEER_PORT + 1;
     PUBLIC_HTTP_PORT = false;
     HTTP_MAX_CLIENT = 128;
+    METRICS_HTTP_PORT = 0;
     PEER_PORT = DEFAULT_PEER_PORT;
     TARGET_PEER_CONNECTIONS = 8;
     MAX_ADDITIONAL_PEER_CONNECTIONS = -1;
@@ -72,6 +78,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     PEER_AUTHENTICATION_TIMEOUT = 2;
     PEER_TIMEOUT = 30;
     PREFERRED_PEERS_ONLY = false;
+    FLOOD_TX_PULL_MODE = false;
 
     MINIMUM_IDLE_PERCENT = 0;
 
@@ -262,6 +269,11 @@ Config::load(std::string const& filename)
             {
                 HTTP_MAX_CLIENT = readInt<unsigned short>(item, 0, UINT16_MAX);
             }
+            else if (item.first == "METRICS_HTTP_PORT")
+            {
+                METRICS_HTTP_PORT =
+                    readInt<unsigned short>(item, 0, UINT16_MAX);
+            }
             else if (item.first == "PUBLIC_HTTP_PORT")
             {
                 PUBLIC_HTTP_PORT = readBool(item);
@@ -342,6 +354,26 @@ Config::load(std::string const& filename)
             {
                 BUCKET_DIR_PATH = readString(item);
             }
+            else if (item.first == "WARM_RESTART_SNAPSHOT")
+            {
+                WARM_RESTART_SNAPSHOT = readBool(item);
+            }
+            else if (item.first == "INLINE_ACCOUNT_SIGNERS")
+            {
+                INLINE_ACCOUNT_SIGNERS = readBool(item);
+            }
+            else if (item.first == "DISABLE_XDR_FSYNC")
+            {
+                DISABLE_XDR_FSYNC = readBool(item);
+            }
+            else if (item.first == "BUCKET_MERGE_DIRECT_IO")
+            {
+                BUCKET_MERGE_DIRECT_IO = readBool(item);
+            }
+            else if (item.first == "CATCHUP_MERGE_BUCKETS")
+            {
+                CATCHUP_MERGE_BUCKETS = readBool(item);
+            }
             else if (item.first == "NODE_NAMES")
             {
                 auto names = readStringArray(item);
@@ -399,6 +431,10 @@ Config::load(std::string const& filename)
             {
                 PREFERRED_PEERS_ONLY = readBool(item);
             }
+            else if (item.first == "FLOOD_TX_PULL_MODE")
+            {
+                FLOOD_TX_PULL_MODE = readBool(item);
+            }
             else if (item.first == "KNOWN_PEERS")
             {
                 KNOWN_PEERS = readStringArray(item);
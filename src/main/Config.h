@@ -139,12 +139,33 @@ class Config : public std::enable_shared_from_this<Config>
     std::string VERSION_STR;
     std::string LOG_FILE_PATH;
     std::string BUCKET_DIR_PATH;
+    // On a graceful stop, save warm state (completed bucket merges, hot
+    // ledger entries, signature cache) in BUCKET_DIR_PATH, to be picked up
+    // by the next start.
+    bool WARM_RESTART_SNAPSHOT;
+    // Keep each account's signers packed in its accounts row instead of in
+    // the signers table; the database is converted at startup when this
+    // changes.
+    bool INLINE_ACCOUNT_SIGNERS;
+    // Skip fsyncing new bucket files and the bucket directory; for tests,
+    // where durability is not worth the time it takes.
+    bool DISABLE_XDR_FSYNC;
+    // Write the output of large bucket merges with direct I/O, around the
+    // page cache.
+    bool BUCKET_MERGE_DIRECT_IO;
+    // During catchup, merge the buckets to apply into one before applying
+    // it, so that each ledger entry is written to the database once; on
+    // Postgres, in parallel shards by key hash.
+    bool CATCHUP_MERGE_BUCKETS;
     uint32_t TESTING_UPGRADE_DESIRED_FEE; // in stroops
     uint32_t TESTING_UPGRADE_RESERVE;     // in stroops
     uint32_t TESTING_UPGRADE_MAX_TX_PER_LEDGER;
     unsigned short HTTP_PORT; // what port to listen for commands
     bool PUBLIC_HTTP_PORT;    // if you accept commands from not localhost
     int HTTP_MAX_CLIENT;      // maximum number of http clients, i.e backlog
+    // Port to serve metrics on in the Prometheus text format, from a thread
+    // of their own; 0 to not serve them.
+    unsigned short METRICS_HTTP_PORT;
     std::string NETWORK_PASSPHRASE; // identifier for the network
 
 	// whitelist
@@ -169,12 +190,20 @@ class Config : public std::enable_shared_from_this<Config>
     // Whether to exclude peers that are not preferred.
     bool PREFERRED_PEERS_ONLY;
 
+    // Whether to flood transactions by advertising their hashes and letting
+    // peers demand the ones they lack, instead of pushing them in full to
+    // every peer. Peers that do not support it still get full transactions.
+    // When false, the node announces an overlay version without it and
+    // ignores adverts.
+    bool FLOOD_TX_PULL_MODE;
+
     // Percentage, between 0 and 100, of system activity (measured in terms
     // of both event-loop cycles and database time) below-which the system
     // will consider itself "loaded" and attempt to shed load. Set this
     // number low and the system will be tolerant of overloading. Set it
     // high and the system will be intolerant. By default it is 0, meaning
-    // totally insensitive to overloading.
+    // totally insensitive to overloading. Below it, flooded transactions are
+    // also subject to load-dependent fee thresholds and per-peer rate limits.
     uint32_t MINIMUM_IDLE_PERCENT;
 
     // process-management config
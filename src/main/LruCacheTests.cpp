@@ -5,6 +5,8 @@
 #include "lib/catch.hpp"
 #include "lib/util/lrucache.hpp"
 
+#include <vector>
+
 namespace stellar
 {
 
@@ -129,4 +131,22 @@ TEST_CASE("erase_if removes all nodes", "[lru_cache]")
     REQUIRE(!c.exists(3));
     REQUIRE(!c.exists(4));
 }
+
+TEST_CASE("for_each visits most recently used first", "[lru_cache]")
+{
+    auto c = IntCache{3};
+    c.put(0, 0);
+    c.put(1, 1);
+    c.put(2, 2);
+    c.put(3, 3);
+    c.get(1);
+
+    std::vector<int> keys;
+    c.for_each([&](int k, int v) {
+        REQUIRE(k == v);
+        keys.push_back(k);
+    });
+
+    REQUIRE(keys == (std::vector<int>{1, 3, 2}));
+}
 }
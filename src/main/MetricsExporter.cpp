@@ -0,0 +1,253 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "main/MetricsExporter.h"
+#include "lib/http/server.hpp"
+#include "lib/json/json.h"
+#include "lib/util/format.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "medida/counter.h"
+#include "medida/histogram.h"
+#include "medida/meter.h"
+#include "medida/metric_processor.h"
+#include "medida/metrics_registry.h"
+#include "medida/reporting/json_reporter.h"
+#include "medida/timer.h"
+#include "util/LatencyHistogram.h"
+#include "util/Logging.h"
+#include "util/Timer.h"
+#include "util/make_unique.h"
+#include <cctype>
+
+namespace stellar
+{
+
+namespace
+{
+
+double const kQuantiles[] = {0.5, 0.75, 0.95, 0.99, 0.999};
+
+double
+toMilliseconds(std::chrono::nanoseconds d)
+{
+    return static_cast<double>(d.count()) / 1e6;
+}
+
+double
+toSeconds(std::chrono::nanoseconds d)
+{
+    return static_cast<double>(d.count()) / 1e9;
+}
+
+// Writes metrics as Prometheus samples: domain.type.name becomes
+// stellar_core_domain_type_name, and a scope becomes a label.
+class PrometheusWriter : public medida::MetricProcessor
+{
+    std::string& mOut;
+    std::string mName;
+    std::string mScope;
+
+    void
+    header(std::string const& suffix, char const* type)
+    {
+        mOut += fmt::format("# TYPE {}{} {}\n", mName, suffix, type);
+    }
+
+    template <typename T>
+    void
+    sample(std::string const& suffix, T value, double quantile = -1)
+    {
+        std::string labels;
+        if (!mScope.empty())
+        {
+            labels = fmt::format("scope=\"{}\"", mScope);
+        }
+        if (quantile >= 0)
+        {
+            labels += fmt::format("{}quantile=\"{}\"",
+                                  labels.empty() ? "" : ",", quantile);
+        }
+        if (!labels.empty())
+        {
+            labels = "{" + labels + "}";
+        }
+        mOut += fmt::format("{}{}{} {}\n", mName, suffix, labels, value);
+    }
+
+    template <typename GetQuantile>
+    void
+    summary(GetQuantile getQuantile, double sum, uint64_t count)
+    {
+        header("", "summary");
+        for (auto q : kQuantiles)
+        {
+            sample("", getQuantile(q), q);
+        }
+        sample("_sum", sum);
+        sample("_count", count);
+    }
+
+  public:
+    explicit PrometheusWriter(std::string& out) : mOut(out)
+    {
+    }
+
+    void
+    setName(medida::MetricName const& name)
+    {
+        mName = "stellar_core";
+        for (auto const& part : {name.domain(), name.type(), name.name()})
+        {
+            mName += '_';
+            for (char c : part)
+            {
+                mName += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+            }
+        }
+        mScope = name.scope();
+    }
+
+    void
+    Process(medida::Counter& counter) override
+    {
+        header("", "gauge");
+        sample("", counter.count());
+    }
+
+    void
+    Process(medida::Meter& meter) override
+    {
+        header("_total", "counter");
+        sample("_total", meter.count());
+    }
+
+    void
+    Process(medida::Histogram& histogram) override
+    {
+        auto snapshot = histogram.GetSnapshot();
+        summary([&](double q) { return snapshot.getValue(q); },
+                histogram.sum(), histogram.count());
+    }
+
+    void
+    Process(medida::Timer& timer) override
+    {
+        // medida keeps timings in the timer's duration unit; Prometheus
+        // wants seconds
+        double unit = toSeconds(timer.duration_unit());
+        auto snapshot = timer.GetSnapshot();
+        summary([&](double q) { return snapshot.getValue(q) * unit; },
+                timer.sum() * unit, timer.count());
+    }
+
+    void
+    processLatency(LatencyHistogram const& histogram)
+    {
+        auto snapshot = histogram.GetSnapshot();
+        summary([&](double q) { return toSeconds(snapshot.valueAt(q)); },
+                toSeconds(snapshot.sum()), snapshot.count());
+    }
+};
+}
+
+MetricsExporter::MetricsExporter(Application& app)
+    : mApp(app), mAlive(std::make_shared<bool>(true))
+{
+    auto const& cfg = mApp.getConfig();
+    std::string ipStr = cfg.PUBLIC_HTTP_PORT ? "0.0.0.0" : "127.0.0.1";
+    LOG(INFO) << "Listening on " << ipStr << ":" << cfg.METRICS_HTTP_PORT
+              << " for metrics scrapes";
+    mServer = make_unique<http::server::server>(
+        mIOService, ipStr, cfg.METRICS_HTTP_PORT, cfg.HTTP_MAX_CLIENT);
+    mServer->addRoute("metrics",
+                      [this](std::string const& params, std::string& retStr) {
+                          serve(params, retStr);
+                      });
+    mThread = std::thread([this]() { mIOService.run(); });
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    mIOService.stop();
+    mThread.join();
+    mServer.reset();
+}
+
+void
+MetricsExporter::serve(std::string const& params, std::string& retStr)
+{
+    try
+    {
+        retStr = renderPrometheus(mApp.getMetrics(), mApp.getLatencyMetrics());
+    }
+    catch (std::exception& e)
+    {
+        CLOG(ERROR, "Process") << "Failed to render metrics: " << e.what();
+        retStr.clear();
+    }
+
+    std::weak_ptr<bool> alive = mAlive;
+    Application& app = mApp;
+    app.getClock().getIOService().post([alive, &app]() {
+        if (alive.lock())
+        {
+            app.syncAllMetrics();
+        }
+    });
+}
+
+std::string
+MetricsExporter::renderJson(medida::MetricsRegistry& metrics,
+                            LatencyRegistry const& latencies)
+{
+    medida::reporting::JsonReporter jr(metrics);
+    Json::Value root;
+    Json::Reader reader;
+    auto report = jr.Report();
+    if (!reader.parse(report, root))
+    {
+        return report;
+    }
+
+    // laid out like medida's timers, less the rates, which these don't keep
+    auto& out = root["metrics"];
+    for (auto const& kv : latencies.GetAllHistograms())
+    {
+        auto snapshot = kv.second->GetSnapshot();
+        auto& m = out[kv.first.ToString()];
+        m["type"] = "timer";
+        m["count"] = static_cast<Json::UInt64>(snapshot.count());
+        m["duration_unit"] = "ms";
+        m["min"] = toMilliseconds(snapshot.min());
+        m["max"] = toMilliseconds(snapshot.max());
+        m["mean"] = toMilliseconds(snapshot.mean());
+        m["median"] = toMilliseconds(snapshot.valueAt(0.5));
+        m["75%"] = toMilliseconds(snapshot.valueAt(0.75));
+        m["95%"] = toMilliseconds(snapshot.valueAt(0.95));
+        m["99%"] = toMilliseconds(snapshot.valueAt(0.99));
+        m["99.9%"] = toMilliseconds(snapshot.valueAt(0.999));
+    }
+    return root.toStyledString();
+}
+
+std::string
+MetricsExporter::renderPrometheus(medida::MetricsRegistry& metrics,
+                                  LatencyRegistry const& latencies)
+{
+    std::string out;
+    PrometheusWriter writer(out);
+    for (auto const& kv : metrics.GetAllMetrics())
+    {
+        writer.setName(kv.first);
+        kv.second->Process(writer);
+    }
+    for (auto const& kv : latencies.GetAllHistograms())
+    {
+        writer.setName(kv.first);
+        writer.processLatency(*kv.second);
+    }
+    return out;
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+#include "util/NonCopyable.h"
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace http
+{
+namespace server
+{
+class server;
+}
+}
+
+namespace medida
+{
+class MetricsRegistry;
+}
+
+namespace stellar
+{
+
+class Application;
+class LatencyRegistry;
+
+/**
+ * Reports the application's metrics -- its medida registry along with its
+ * LatencyRegistry -- as JSON for the "metrics" command, and in the Prometheus
+ * text format at /metrics on Config::METRICS_HTTP_PORT.
+ *
+ * The Prometheus endpoint is served from a thread of its own: medida metrics
+ * and latency histograms can both be read from any thread, so scraping does
+ * not wait for, or hold up, the main thread. Gauges that the main thread keeps
+ * up to date with Application::syncAllMetrics are synced after each scrape,
+ * ready for the next one.
+ */
+class MetricsExporter : public NonMovableOrCopyable
+{
+    Application& mApp;
+    asio::io_service mIOService;
+    std::unique_ptr<http::server::server> mServer;
+    std::thread mThread;
+    // the syncs posted to the main thread check this is still around
+    std::shared_ptr<bool> mAlive;
+
+    void serve(std::string const& params, std::string& retStr);
+
+  public:
+    // Starts serving on Config::METRICS_HTTP_PORT, which must not be 0.
+    explicit MetricsExporter(Application& app);
+    ~MetricsExporter();
+
+    static std::string renderJson(medida::MetricsRegistry& metrics,
+                                  LatencyRegistry const& latencies);
+    static std::string renderPrometheus(medida::MetricsRegistry& metrics,
+                                        LatencyRegistry const& latencies);
+};
+}
@@ -0,0 +1,306 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "main/WarmRestart.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketList.h"
+#include "bucket/BucketManager.h"
+#include "crypto/Hex.h"
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
+#include "database/Database.h"
+#include "history/HistoryArchive.h"
+#include "ledger/EntryFrame.h"
+#include "ledger/LedgerManager.h"
+#include "main/Application.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include "util/types.h"
+#include <cstdio>
+#include <fstream>
+
+namespace stellar
+{
+
+uint32_t const WarmRestart::SNAPSHOT_VERSION = 1;
+
+namespace
+{
+
+// one entry per level: the merge output followed by its inputs, as returned
+// by FutureBucket::getHashes()
+typedef xdr::xvector<xdr::xvector<Hash>> MergeList;
+
+struct Snapshot
+{
+    MergeList merges;
+    xdr::xvector<LedgerKey> entryKeys;
+    xdr::xvector<Hash> validSigs;
+};
+
+template <typename T>
+void
+addToChecksum(SHA256& hasher, T const& t)
+{
+    hasher.add(xdr::xdr_to_opaque(t));
+}
+
+bool
+readSnapshot(Application& app, Hash const& lclHash, Snapshot& snap)
+{
+    auto filename = WarmRestart::snapshotFilename(app);
+    if (!fs::exists(filename))
+    {
+        return false;
+    }
+
+    try
+    {
+        XDRInputFileStream in;
+        in.open(filename);
+
+        uint32_t version = 0;
+        Hash lcl, checksum;
+        if (!in.readOne(version) || version != WarmRestart::SNAPSHOT_VERSION)
+        {
+            CLOG(WARNING, "Ledger")
+                << "Ignoring warm restart snapshot with unknown version";
+            return false;
+        }
+        if (!in.readOne(lcl) || !in.readOne(snap.merges) ||
+            !in.readOne(snap.entryKeys) || !in.readOne(snap.validSigs) ||
+            !in.readOne(checksum))
+        {
+            CLOG(WARNING, "Ledger") << "Ignoring truncated warm restart "
+                                       "snapshot";
+            return false;
+        }
+
+        auto hasher = SHA256::create();
+        addToChecksum(*hasher, version);
+        addToChecksum(*hasher, lcl);
+        addToChecksum(*hasher, snap.merges);
+        addToChecksum(*hasher, snap.entryKeys);
+        addToChecksum(*hasher, snap.validSigs);
+        if (hasher->finish() != checksum)
+        {
+            CLOG(WARNING, "Ledger")
+                << "Ignoring corrupt warm restart snapshot";
+            return false;
+        }
+        if (lcl != lclHash)
+        {
+            CLOG(INFO, "Ledger") << "Ignoring warm restart snapshot taken at "
+                                 << hexAbbrev(lcl);
+            return false;
+        }
+    }
+    catch (std::exception& e)
+    {
+        CLOG(WARNING, "Ledger")
+            << "Could not read warm restart snapshot: " << e.what();
+        return false;
+    }
+    return true;
+}
+
+bool
+bucketFileMatches(std::string const& filename, Hash const& hash)
+{
+    auto hasher = SHA256::create();
+    char buf[4096];
+    std::ifstream in(filename, std::ifstream::binary);
+    if (!in)
+    {
+        return false;
+    }
+    while (in)
+    {
+        in.read(buf, sizeof(buf));
+        hasher->add(ByteSlice(buf, in.gcount()));
+    }
+    return hasher->finish() == hash;
+}
+}
+
+std::string
+WarmRestart::snapshotFilename(Application& app)
+{
+    return app.getBucketManager().getBucketDir() + "/warm-restart.xdr";
+}
+
+void
+WarmRestart::save(Application& app)
+{
+    Snapshot snap;
+
+    auto& bl = app.getBucketManager().getBucketList();
+    for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+    {
+        auto const& next = bl.getLevel(i).getNext();
+        if (next.isMerging() && next.mergeComplete())
+        {
+            xdr::xvector<Hash> merge;
+            merge.emplace_back(hexToBin256(next.getCompletedOutputHash()));
+            for (auto const& h : next.getHashes())
+            {
+                merge.emplace_back(hexToBin256(h));
+            }
+            snap.merges.emplace_back(std::move(merge));
+        }
+    }
+
+    app.getDatabase().getEntryCache().for_each(
+        [&](std::string const& key,
+            std::shared_ptr<LedgerEntry const> const& entry) {
+            if (entry)
+            {
+                LedgerKey lk;
+                xdr::xdr_from_opaque(hexToBin(key), lk);
+                snap.entryKeys.emplace_back(std::move(lk));
+            }
+        });
+
+    for (auto const& sig : PubKeyUtils::getVerifySigCacheContents())
+    {
+        if (sig.second)
+        {
+            snap.validSigs.emplace_back(sig.first);
+        }
+    }
+
+    uint32_t version = SNAPSHOT_VERSION;
+    Hash lcl = app.getLedgerManager().getLastClosedLedgerHeader().hash;
+    auto hasher = SHA256::create();
+    addToChecksum(*hasher, version);
+    addToChecksum(*hasher, lcl);
+    addToChecksum(*hasher, snap.merges);
+    addToChecksum(*hasher, snap.entryKeys);
+    addToChecksum(*hasher, snap.validSigs);
+    Hash checksum = hasher->finish();
+
+    auto filename = snapshotFilename(app);
+    try
+    {
+        XDROutputFileStream out;
+        out.open(filename);
+        if (!(out.writeOne(version) && out.writeOne(lcl) &&
+              out.writeOne(snap.merges) && out.writeOne(snap.entryKeys) &&
+              out.writeOne(snap.validSigs) && out.writeOne(checksum)))
+        {
+            throw std::runtime_error("short write");
+        }
+        if (app.getConfig().DISABLE_XDR_FSYNC)
+        {
+            out.close();
+        }
+        else
+        {
+            out.durableClose();
+        }
+    }
+    catch (std::exception& e)
+    {
+        CLOG(WARNING, "Ledger")
+            << "Could not write warm restart snapshot: " << e.what();
+        std::remove(filename.c_str());
+        return;
+    }
+
+    CLOG(INFO, "Ledger") << "Wrote warm restart snapshot: "
+                         << snap.merges.size() << " merges, "
+                         << snap.entryKeys.size() << " entries, "
+                         << snap.validSigs.size() << " signatures";
+}
+
+void
+WarmRestart::adoptMerges(Application& app, Hash const& lclHash,
+                         HistoryArchiveState& has)
+{
+    Snapshot snap;
+    if (!readSnapshot(app, lclHash, snap))
+    {
+        return;
+    }
+
+    auto& bm = app.getBucketManager();
+    size_t adopted = 0;
+    for (auto const& merge : snap.merges)
+    {
+        if (merge.empty())
+        {
+            continue;
+        }
+        auto output = binToHex(merge[0]);
+        std::vector<std::string> inputs;
+        for (size_t j = 1; j < merge.size(); ++j)
+        {
+            inputs.emplace_back(binToHex(merge[j]));
+        }
+
+        for (auto& level : has.currentBuckets)
+        {
+            if (level.next.getHashes() != inputs)
+            {
+                continue;
+            }
+            // only trust the output if the file on disk is still the one the
+            // merge produced
+            auto filename =
+                bm.getBucketDir() + "/bucket-" + output + ".xdr";
+            if (isZero(merge[0]) || bucketFileMatches(filename, merge[0]))
+            {
+                if (level.next.adoptOutputHash(inputs, output))
+                {
+                    ++adopted;
+                }
+            }
+            break;
+        }
+    }
+
+    if (adopted != 0)
+    {
+        CLOG(INFO, "Ledger") << "Adopted " << adopted
+                             << " completed merges from warm restart snapshot";
+    }
+}
+
+void
+WarmRestart::warmCaches(Application& app)
+{
+    auto filename = snapshotFilename(app);
+    Snapshot snap;
+    if (readSnapshot(app,
+                     app.getLedgerManager().getLastClosedLedgerHeader().hash,
+                     snap))
+    {
+        // keys were saved most recently used first; load them in reverse so
+        // that the cache ends up in the same order
+        auto& db = app.getDatabase();
+        for (auto it = snap.entryKeys.rbegin(); it != snap.entryKeys.rend();
+             ++it)
+        {
+            EntryFrame::storeLoad(*it, db);
+        }
+
+        std::vector<std::pair<Hash, bool>> sigs;
+        sigs.reserve(snap.validSigs.size());
+        for (auto const& h : snap.validSigs)
+        {
+            sigs.emplace_back(h, true);
+        }
+        PubKeyUtils::seedVerifySigCache(sigs);
+
+        CLOG(INFO, "Ledger") << "Warmed caches from snapshot: "
+                             << snap.entryKeys.size() << " entries, "
+                             << sigs.size() << " signatures";
+    }
+
+    // the snapshot describes the state at shutdown, it must not be applied to
+    // a later start
+    std::remove(filename.c_str());
+}
+}
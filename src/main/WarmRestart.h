@@ -0,0 +1,50 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "xdr/Stellar-types.h"
+#include <string>
+
+namespace stellar
+{
+
+class Application;
+struct HistoryArchiveState;
+
+/**
+ * Optional snapshot of state that is expensive to rebuild after a restart,
+ * written on graceful stop when WARM_RESTART_SNAPSHOT is set:
+ *  - outputs of bucket merges that completed but were not resolved yet, so
+ *    that BucketList::restartMerges doesn't redo them,
+ *  - keys of the most recently used ledger entries, reloaded into the entry
+ *    cache,
+ *  - the signature verification cache.
+ * SCP state does not need to be in there, the herder already restores it from
+ * its own log.
+ *
+ * The snapshot is tied to the last closed ledger it was written at and
+ * checksummed; anything that doesn't check out is ignored and the node starts
+ * cold.
+ */
+class WarmRestart
+{
+  public:
+    static uint32_t const SNAPSHOT_VERSION;
+
+    static std::string snapshotFilename(Application& app);
+
+    // writes the snapshot for the current state of `app`
+    static void save(Application& app);
+
+    // replaces, in `has`, the inputs of merges that the snapshot has the
+    // (verified) output for; called before the BucketList is restored
+    static void adoptMerges(Application& app, Hash const& lclHash,
+                            HistoryArchiveState& has);
+
+    // reloads the entry cache and the signature cache from the snapshot, then
+    // deletes it
+    static void warmCaches(Application& app);
+};
+}
@@ -197,6 +197,40 @@ TEST_CASE("Flooding", "[flood][overlay]")
                 test(injectTransaction, ackedTransactions);
             }
         }
+
+        SECTION("pull mode")
+        {
+            auto pullCfgGen = [&]() {
+                Config cfg = cfgGen();
+                cfg.FLOOD_TX_PULL_MODE = true;
+                return cfg;
+            };
+            SECTION("loopback")
+            {
+                simulation = Topologies::hierarchicalQuorumSimplified(
+                    5, 10, Simulation::OVER_LOOPBACK, networkID, pullCfgGen);
+                test(injectTransaction, ackedTransactions);
+            }
+            SECTION("tcp")
+            {
+                simulation = Topologies::core(4, .666f, Simulation::OVER_TCP,
+                                              networkID, pullCfgGen);
+                test(injectTransaction, ackedTransactions);
+            }
+        }
+
+        SECTION("mixed pull and push mode")
+        {
+            int n = 0;
+            auto mixedCfgGen = [&]() {
+                Config cfg = cfgGen();
+                cfg.FLOOD_TX_PULL_MODE = (n++ % 2) == 0;
+                return cfg;
+            };
+            simulation = Topologies::hierarchicalQuorumSimplified(
+                5, 10, Simulation::OVER_LOOPBACK, networkID, mixedCfgGen);
+            test(injectTransaction, ackedTransactions);
+        }
     }
 
     SECTION("scp messages flooding")
@@ -7,6 +7,7 @@
 #include "crypto/SHA.h"
 #include "herder/Herder.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "medida/counter.h"
 #include "medida/metrics_registry.h"
 #include "overlay/OverlayManager.h"
@@ -32,6 +33,8 @@ Floodgate::Floodgate(Application& app)
           app.getMetrics().NewCounter({"overlay", "memory", "flood-map"}))
     , mSendFromBroadcast(app.getMetrics().NewMeter(
           {"overlay", "message", "send-from-broadcast"}, "message"))
+    , mAdvertFromBroadcast(app.getMetrics().NewMeter(
+          {"overlay", "message", "advert-from-broadcast"}, "message"))
     , mShuttingDown(false)
 {
 }
@@ -56,13 +59,14 @@ Floodgate::clearBelow(uint32_t currentLedger)
 }
 
 bool
-Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
+Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer,
+                     Hash& index)
 {
     if (mShuttingDown)
     {
         return false;
     }
-    Hash index = sha256(xdr::xdr_to_opaque(msg));
+    index = sha256(xdr::xdr_to_opaque(msg));
     auto result = mFloodMap.find(index);
     if (result == mFloodMap.end())
     { // we have never seen this message
@@ -78,6 +82,22 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
     }
 }
 
+bool
+Floodgate::addKnownRecord(Hash const& index, Peer::pointer peer)
+{
+    if (mShuttingDown)
+    {
+        return false;
+    }
+    auto result = mFloodMap.find(index);
+    if (result == mFloodMap.end())
+    {
+        return false;
+    }
+    result->second->mPeersTold.insert(peer);
+    return true;
+}
+
 // send message to anyone you haven't gotten it from
 void
 Floodgate::broadcast(StellarMessage const& msg, bool force)
@@ -103,13 +123,23 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
     // make a copy, in case peers gets modified
     auto peers = mApp.getOverlayManager().getAuthenticatedPeers();
 
+    bool pullMode =
+        mApp.getConfig().FLOOD_TX_PULL_MODE && msg.type() == TRANSACTION;
     for (auto peer : peers)
     {
         assert(peer.second->isAuthenticated());
         if (peersTold.find(peer.second) == peersTold.end())
         {
-            mSendFromBroadcast.Mark();
-            peer.second->sendMessage(msg);
+            if (pullMode && peer.second->supportsPullMode())
+            {
+                mAdvertFromBroadcast.Mark();
+                peer.second->queueTxAdvert(index);
+            }
+            else
+            {
+                mSendFromBroadcast.Mark();
+                peer.second->sendMessage(msg);
+            }
             peersTold.insert(peer.second);
         }
     }
@@ -117,6 +147,17 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
                            << peersTold.size();
 }
 
+optional<StellarMessage>
+Floodgate::getMessage(Hash const& index)
+{
+    auto record = mFloodMap.find(index);
+    if (record == mFloodMap.end())
+    {
+        return nullopt<StellarMessage>();
+    }
+    return make_optional<StellarMessage>(record->second->mMessage);
+}
+
 std::set<Peer::pointer>
 Floodgate::getPeersKnows(Hash const& h)
 {
@@ -6,6 +6,7 @@
 
 #include "overlay/Peer.h"
 #include "overlay/StellarXDR.h"
+#include "util/optional.h"
 #include <map>
 
 /**
@@ -48,17 +49,28 @@ class Floodgate
     Application& mApp;
     medida::Counter& mFloodMapSize;
     medida::Meter& mSendFromBroadcast;
+    medida::Meter& mAdvertFromBroadcast;
     bool mShuttingDown;
 
   public:
     Floodgate(Application& app);
     // Floodgate will be cleared after every ledger close
     void clearBelow(uint32_t currentLedger);
-    // returns true if this is a new record
-    bool addRecord(StellarMessage const& msg, Peer::pointer fromPeer);
+    // returns true if this is a new record; `msgHash` is set to the hash the
+    // message is recorded under
+    bool addRecord(StellarMessage const& msg, Peer::pointer fromPeer,
+                   Hash& msgHash);
+    // returns true if we already have a record for the message with hash
+    // `index`, in which case `fromPeer` is noted as having it
+    bool addKnownRecord(Hash const& index, Peer::pointer fromPeer);
 
+    // In pull mode (FLOOD_TX_PULL_MODE) transactions are only advertised to
+    // peers that understand FLOOD_ADVERT, and sent once they demand them.
     void broadcast(StellarMessage const& msg, bool force);
 
+    // returns the message recorded under hash `index`, if any
+    optional<StellarMessage> getMessage(Hash const& index);
+
     // returns the list of peers that sent us the item with hash `h`
     std::set<Peer::pointer> getPeersKnows(Hash const& h);
 
@@ -47,6 +47,34 @@ ItemFetcher::fetch(Hash itemHash, const SCPEnvelope& envelope)
     }
 }
 
+void
+ItemFetcher::fetchAdvertised(Hash itemHash, Peer::pointer peer,
+                             uint64 slotIndex)
+{
+    CLOG(TRACE, "Overlay") << "fetchAdvertised " << hexAbbrev(itemHash);
+    auto entryIt = mTrackers.find(itemHash);
+    if (entryIt == mTrackers.end())
+    { // not being tracked
+        TrackerPtr tracker =
+            std::make_shared<Tracker>(mApp, itemHash, mAskPeer);
+        mTrackers[itemHash] = tracker;
+        mItemMapSize.inc();
+
+        tracker->listenAdvert(peer, slotIndex);
+        tracker->tryNextPeer();
+    }
+    else
+    {
+        auto const& tracker = entryIt->second;
+        bool idle = tracker->empty() && !tracker->hasAdverts();
+        tracker->listenAdvert(peer, slotIndex);
+        if (idle)
+        {
+            tracker->tryNextPeer();
+        }
+    }
+}
+
 void
 ItemFetcher::stopFetch(Hash itemHash, const SCPEnvelope& envelope)
 {
@@ -68,6 +96,18 @@ ItemFetcher::stopFetch(Hash itemHash, const SCPEnvelope& envelope)
     }
 }
 
+bool
+ItemFetcher::isTracking(Hash const& itemHash) const
+{
+    return mTrackers.find(itemHash) != mTrackers.end();
+}
+
+size_t
+ItemFetcher::getTrackerCount() const
+{
+    return mTrackers.size();
+}
+
 uint64
 ItemFetcher::getLastSeenSlotIndex(Hash itemHash) const
 {
@@ -153,6 +193,7 @@ ItemFetcher::recv(Hash itemHash)
             mApp.getHerder().recvSCPEnvelope(tracker->pop());
         }
         // stop the timer, stop requesting the item as we have it
+        tracker->clearAdverts();
         tracker->resetLastSeenSlotIndex();
         tracker->cancel();
     }
@@ -31,7 +31,8 @@ using AskPeer = std::function<void(Peer::pointer, Hash)>;
 /**
  * @class ItemFetcher
  *
- * Manages asking for Transaction or Quorum sets from Peers
+ * Manages asking for Transaction or Quorum sets from Peers, and (in
+ * pull-mode flooding) for advertised transactions.
  *
  * The ItemFetcher keeps instances of the Tracker class. There exists exactly
  * one Tracker per item. The tracker is used to maintain the state of the
@@ -53,6 +54,13 @@ class ItemFetcher : private NonMovableOrCopyable
      */
     void fetch(Hash itemHash, const SCPEnvelope& envelope);
 
+    /**
+     * Fetch data identified by @p hash that @p peer advertised during ledger
+     * @p slotIndex. No envelope waits for it; advertising peers are asked
+     * until the data is received or the advert gets too old.
+     */
+    void fetchAdvertised(Hash itemHash, Peer::pointer peer, uint64 slotIndex);
+
     /**
      * Stops fetching data identified by @p hash for @p envelope. If other
      * envelopes requires this data, it is still being fetched, but
@@ -66,6 +74,17 @@ class ItemFetcher : private NonMovableOrCopyable
      */
     uint64 getLastSeenSlotIndex(Hash itemHash) const;
 
+    /**
+     * Return true if data identified by @p itemHash has a Tracker.
+     */
+    bool isTracking(Hash const& itemHash) const;
+
+    /**
+     * Return the number of Trackers, including those kept until the next
+     * @see stopFetchingBelow after their data was received.
+     */
+    size_t getTrackerCount() const;
+
     /**
      * Return envelopes that require data identified by @p hash.
      */
@@ -4,20 +4,44 @@
 
 #include "overlay/LoadManager.h"
 #include "database/Database.h"
+#include "ledger/LedgerManager.h"
 #include "lib/util/format.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/counter.h"
 #include "overlay/OverlayManager.h"
+#include "transactions/TransactionFrame.h"
 #include "util/Logging.h"
 #include "util/types.h"
 
+#include <algorithm>
 #include <chrono>
 
 namespace stellar
 {
 using xdr::operator<;
 
-LoadManager::LoadManager() : mPeerCosts(128)
+// How often saturation is re-estimated for transaction admission.
+static std::chrono::seconds const SATURATION_SAMPLE_PERIOD{1};
+// Fee (as a multiple of the minimum) a transaction needs to be admitted when
+// the system is fully saturated; it scales linearly from 1 at no saturation.
+static double const MAX_ADMISSION_FEE_MULTIPLIER = 10.0;
+// Transactions per second (and burst size) a peer may flood us with, when
+// saturated; the rate scales down linearly with saturation to the floor.
+static double const PEER_TX_RATE = 100.0;
+static double const PEER_TX_RATE_FLOOR = 5.0;
+
+LoadManager::LoadManager(Application& app)
+    : mPeerCosts(128)
+    , mTxBuckets(128)
+    , mTxAdmit(app.getMetrics().NewMeter(
+          {"overlay", "tx-admission", "admit"}, "transaction"))
+    , mTxShedFee(app.getMetrics().NewMeter(
+          {"overlay", "tx-admission", "shed-fee"}, "transaction"))
+    , mTxShedRate(app.getMetrics().NewMeter(
+          {"overlay", "tx-admission", "shed-rate"}, "transaction"))
+    , mSaturationPercent(app.getMetrics().NewCounter(
+          {"overlay", "tx-admission", "saturation"}))
 {
 }
 
@@ -131,6 +155,77 @@ LoadManager::maybeShedExcessLoad(Application& app)
     }
 }
 
+double
+LoadManager::getSaturation(Application& app)
+{
+    uint32_t minIdle = app.getConfig().MINIMUM_IDLE_PERCENT;
+    if (minIdle == 0)
+    {
+        return 0;
+    }
+
+    auto now = app.getClock().now();
+    if (!mSaturationSampled ||
+        now - mSaturationSampledAt >= SATURATION_SAMPLE_PERIOD)
+    {
+        uint32_t idle = std::min(app.getClock().recentIdleCrankPercent(),
+                                 app.getDatabase().recentIdleDbPercent());
+        mSaturation =
+            idle >= minIdle ? 0 : static_cast<double>(minIdle - idle) / minIdle;
+        mSaturationSampled = true;
+        mSaturationSampledAt = now;
+        mSaturationPercent.set_count(static_cast<int64_t>(mSaturation * 100));
+    }
+    return mSaturation;
+}
+
+bool
+LoadManager::admitTransaction(Application& app, NodeID const& peer,
+                              TransactionFramePtr tx)
+{
+    return admitTransactionAt(app, peer, tx, getSaturation(app));
+}
+
+bool
+LoadManager::admitTransactionAt(Application& app, NodeID const& peer,
+                                TransactionFramePtr tx, double saturation)
+{
+    if (saturation <= 0 || tx->isWhitelisted(app))
+    {
+        mTxAdmit.Mark();
+        return true;
+    }
+
+    double feeMultiplier = 1 + (MAX_ADMISSION_FEE_MULTIPLIER - 1) * saturation;
+    if (tx->getFeeRatio(app.getLedgerManager()) < feeMultiplier)
+    {
+        mTxShedFee.Mark();
+        return false;
+    }
+
+    // refill the peer's bucket at the current rate; a new bucket starts full
+    double rate =
+        std::max(PEER_TX_RATE_FLOOR, PEER_TX_RATE * (1 - saturation));
+    auto now = app.getClock().now();
+    if (!mTxBuckets.exists(peer))
+    {
+        mTxBuckets.put(peer, TxTokenBucket{rate, now});
+    }
+    auto& bucket = mTxBuckets.get(peer);
+    std::chrono::duration<double> elapsed = now - bucket.mLastRefill;
+    bucket.mTokens = std::min(rate, bucket.mTokens + elapsed.count() * rate);
+    bucket.mLastRefill = now;
+
+    if (bucket.mTokens < 1)
+    {
+        mTxShedRate.Mark();
+        return false;
+    }
+    bucket.mTokens -= 1;
+    mTxAdmit.Mark();
+    return true;
+}
+
 LoadManager::PeerCosts::PeerCosts()
     : mTimeSpent("nanoseconds")
     , mBytesSend("byte")
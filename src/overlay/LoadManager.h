@@ -10,6 +10,7 @@
 #include "util/lrucache.hpp"
 #include "xdr/Stellar-types.h"
 
+#include "medida/counter.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
@@ -20,6 +21,8 @@ namespace stellar
 {
 
 class Application;
+class TransactionFrame;
+using TransactionFramePtr = std::shared_ptr<TransactionFrame>;
 
 class LoadManager
 {
@@ -36,7 +39,7 @@ class LoadManager
     // work, or to do more harm than good, it ought to be disabled/removed.
 
   public:
-    LoadManager();
+    explicit LoadManager(Application& app);
     ~LoadManager();
     void reportLoads(std::map<NodeID, Peer::pointer> const& peers,
                      Application& app);
@@ -65,6 +68,43 @@ class LoadManager
     // according to our local per-peer accounting.
     void maybeShedExcessLoad(Application& app);
 
+    // Decide whether a transaction flooded to us by `peer` gets to the
+    // Herder at all. While the system is saturated (see MINIMUM_IDLE_PERCENT)
+    // non-whitelisted transactions have to pay a fee above a load-dependent
+    // multiple of the minimum, and each peer is held to a token bucket whose
+    // rate shrinks with load. Decisions are exported as
+    // overlay.tx-admission.* metrics.
+    bool admitTransaction(Application& app, NodeID const& peer,
+                          TransactionFramePtr tx);
+
+    // Same as admitTransaction, at the given saturation (0: idle to spare,
+    // 1: no idle at all) rather than the recently measured one.
+    bool admitTransactionAt(Application& app, NodeID const& peer,
+                            TransactionFramePtr tx, double saturation);
+
+    // Recent saturation of the main thread or the database, whichever is
+    // worse, sampled at most once per second. Always 0 when
+    // MINIMUM_IDLE_PERCENT is 0.
+    double getSaturation(Application& app);
+
+  private:
+    struct TxTokenBucket
+    {
+        double mTokens;
+        VirtualClock::time_point mLastRefill;
+    };
+    cache::lru_cache<NodeID, TxTokenBucket> mTxBuckets;
+
+    double mSaturation{0};
+    VirtualClock::time_point mSaturationSampledAt;
+    bool mSaturationSampled{false};
+
+    medida::Meter& mTxAdmit;
+    medida::Meter& mTxShedFee;
+    medida::Meter& mTxShedRate;
+    medida::Counter& mSaturationPercent;
+
+  public:
     // Context manager for doing work on behalf of a node, we push
     // one of these on the stack. When destroyed it will debit the
     // peer in question with the cost.
@@ -2,9 +2,12 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "ledger/LedgerManager.h"
+#include "overlay/LoadManager.h"
 #include "overlay/LoopbackPeer.h"
 #include "overlay/OverlayManager.h"
 #include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Timer.h"
 #include <lib/catch.hpp>
@@ -54,3 +57,62 @@ TEST_CASE("disconnect peer when overloaded", "[overlay][LoadManager]")
                 .NewMeter({"overlay", "drop", "load-shed"}, "drop")
                 .count() != 0);
 }
+
+TEST_CASE("transaction admission under load", "[overlay][LoadManager]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    auto app = createTestApplication(clock, cfg);
+    app->start();
+
+    auto& lm = app->getOverlayManager().getLoadManager();
+    auto peer = SecretKey::random().getPublicKey();
+    auto source = SecretKey::random();
+    auto baseFee = app->getLedgerManager().getTxFee();
+
+    auto makeTx = [&](uint32_t feeMultiple) {
+        auto tx = txtest::transactionFromOperations(
+            *app, source, 1, {txtest::createAccount(peer, 1)});
+        tx->getEnvelope().tx.fee = feeMultiple * baseFee;
+        return tx;
+    };
+
+    auto& shedFee = app->getMetrics().NewMeter(
+        {"overlay", "tx-admission", "shed-fee"}, "transaction");
+    auto& shedRate = app->getMetrics().NewMeter(
+        {"overlay", "tx-admission", "shed-rate"}, "transaction");
+
+    SECTION("not saturated admits everything")
+    {
+        REQUIRE(lm.getSaturation(*app) == 0);
+        for (int i = 0; i < 1000; ++i)
+        {
+            REQUIRE(lm.admitTransaction(*app, peer, makeTx(1)));
+        }
+    }
+
+    SECTION("fee threshold rises with saturation")
+    {
+        REQUIRE(lm.admitTransactionAt(*app, peer, makeTx(1), 0.0));
+        REQUIRE(!lm.admitTransactionAt(*app, peer, makeTx(1), 0.5));
+        REQUIRE(lm.admitTransactionAt(*app, peer, makeTx(6), 0.5));
+        REQUIRE(!lm.admitTransactionAt(*app, peer, makeTx(6), 1.0));
+        REQUIRE(lm.admitTransactionAt(*app, peer, makeTx(10), 1.0));
+        REQUIRE(shedFee.count() == 2);
+    }
+
+    SECTION("each peer is rate limited")
+    {
+        auto other = SecretKey::random().getPublicKey();
+        int admitted = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            admitted += lm.admitTransactionAt(*app, peer, makeTx(10), 0.5);
+        }
+        // a burst of (at most) one second worth of transactions
+        REQUIRE(admitted <= 51);
+        REQUIRE(admitted >= 50);
+        REQUIRE(shedRate.count() == 1000 - admitted);
+        REQUIRE(lm.admitTransactionAt(*app, other, makeTx(10), 0.5));
+    }
+}
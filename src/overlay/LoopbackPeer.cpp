@@ -64,11 +64,14 @@ LoopbackPeer::sendMessage(xdr::msg_ptr&& msg)
     // Damage authentication material.
     if (mDamageAuth)
     {
-        auto bytes = randomBytes(mRecvMacKey.key.size());
-        std::copy(bytes.begin(), bytes.end(), mRecvMacKey.key.begin());
+        HmacSha256Key damaged;
+        auto bytes = randomBytes(damaged.key.size());
+        std::copy(bytes.begin(), bytes.end(), damaged.key.begin());
+        setMacKeys(mSendMacKey, damaged);
     }
 
     // CLOG(TRACE, "Overlay") << "LoopbackPeer queueing message";
+    sealMessage(msg);
     mOutQueue.emplace_back(std::move(msg));
     // Possibly flush some queued messages if queue's full.
     while (mOutQueue.size() > mMaxQueueDepth && !mCorked)
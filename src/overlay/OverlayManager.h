@@ -28,11 +28,15 @@
  *  - One-way broadcast messages informing other peers of an event:
  *    TRANSACTION and SCP_MESSAGE
  *
+ *  - In pull mode, batched announcements of transaction hashes and requests
+ *    for them: FLOOD_ADVERT and FLOOD_DEMAND
+ *
  *  - Two-way anycast messages requesting a value (by hash) or providing it:
  *    GET_TX_SET, TX_SET, GET_SCP_QUORUMSET, SCP_QUORUMSET, GET_SCP_STATE
  *
  * Anycasts are initiated and serviced two instances of ItemFetcher
- * (mTxSetFetcher and mQuorumSetFetcher). Anycast messages are sent to
+ * (mTxSetFetcher and mQuorumSetFetcher); demands for advertised transactions
+ * are tracked by a third one (mTxDemandFetcher). Anycast messages are sent to
  * directly-connected peers, in sequence until satisfied. They are not
  * flooded between peers.
  *
@@ -76,6 +80,27 @@ class OverlayManager
     virtual void recvFloodedMsg(StellarMessage const& msg,
                                 Peer::pointer peer) = 0;
 
+    // Same as recvFloodedMsg, for a message identified only by the hash of
+    // its XDR. Returns false (and records nothing) if the FloodGate does not
+    // know that message yet, in which case the caller has to receive it in
+    // full.
+    virtual bool recvFloodedMsgHash(Hash const& msgHash,
+                                    Peer::pointer peer) = 0;
+
+    // Pull-mode flooding (FLOOD_TX_PULL_MODE): `peer` advertised the given
+    // flooded message hashes; demand the ones the FloodGate does not know.
+    virtual void recvFloodAdvert(FloodAdvert const& advert,
+                                 Peer::pointer peer) = 0;
+
+    // Pull-mode flooding: `peer` demands the given flooded message hashes;
+    // send each message we still have, and DONT_HAVE for the others.
+    virtual void recvFloodDemand(FloodDemand const& demand,
+                                 Peer::pointer peer) = 0;
+
+    // Pull-mode flooding: `peer` could not satisfy our demand for the
+    // transaction message with hash `msgHash`.
+    virtual void recvTxDontHave(Hash const& msgHash, Peer::pointer peer) = 0;
+
     // Return a list of random peers from the set of authenticated peers.
     virtual std::vector<Peer::pointer> getRandomAuthenticatedPeers() = 0;
 
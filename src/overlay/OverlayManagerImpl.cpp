@@ -4,8 +4,10 @@
 
 #include "overlay/OverlayManagerImpl.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "herder/Herder.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "overlay/PeerBareAddress.h"
@@ -13,6 +15,7 @@
 #include "overlay/TCPPeer.h"
 #include "util/Logging.h"
 #include "util/make_unique.h"
+#include "xdrpp/marshal.h"
 
 #include "medida/counter.h"
 #include "medida/meter.h"
@@ -52,6 +55,11 @@ using namespace std;
 
 using xdr::operator<;
 
+// Bounds on the transactions adverts get us to demand: in total, as tracked
+// by mTxDemandFetcher, and per advertising peer and ledger.
+static size_t const MAX_TX_DEMANDS = 20000;
+static size_t const MAX_TX_DEMANDS_PER_PEER = 2000;
+
 std::unique_ptr<OverlayManager>
 OverlayManager::create(Application& app)
 {
@@ -62,6 +70,7 @@ OverlayManagerImpl::OverlayManagerImpl(Application& app)
     : mApp(app)
     , mDoor(mApp)
     , mAuth(mApp)
+    , mLoad(mApp)
     , mShuttingDown(false)
     , mMessagesReceived(app.getMetrics().NewMeter(
           {"overlay", "message", "flood-receive"}, "message"))
@@ -75,12 +84,21 @@ OverlayManagerImpl::OverlayManagerImpl(Application& app)
           {"overlay", "connection", "drop"}, "connection"))
     , mConnectionsRejected(app.getMetrics().NewMeter(
           {"overlay", "connection", "reject"}, "connection"))
+    , mDemandsFulfilled(app.getMetrics().NewMeter(
+          {"overlay", "flood", "demand-fulfilled"}, "message"))
+    , mDemandsUnfulfilled(app.getMetrics().NewMeter(
+          {"overlay", "flood", "demand-unfulfilled"}, "message"))
+    , mAdvertsDropped(app.getMetrics().NewMeter(
+          {"overlay", "flood", "advert-dropped"}, "hash"))
     , mPendingPeersSize(
           app.getMetrics().NewCounter({"overlay", "memory", "pending-peers"}))
     , mAuthenticatedPeersSize(app.getMetrics().NewCounter(
           {"overlay", "memory", "authenticated-peers"}))
     , mTimer(app)
     , mFloodGate(app)
+    , mTxDemandFetcher(app, [](Peer::pointer peer, Hash hash) {
+        peer->queueTxDemand(hash);
+    })
 {
 }
 
@@ -343,6 +361,8 @@ void
 OverlayManagerImpl::ledgerClosed(uint32_t lastClosedledgerSeq)
 {
     mFloodGate.clearBelow(lastClosedledgerSeq);
+    mTxDemandFetcher.stopFetchingBelow(lastClosedledgerSeq);
+    mTxDemandsByPeer.clear();
 }
 
 void
@@ -531,7 +551,83 @@ OverlayManagerImpl::recvFloodedMsg(StellarMessage const& msg,
                                    Peer::pointer peer)
 {
     mMessagesReceived.Mark();
-    mFloodGate.addRecord(msg, peer);
+    Hash msgHash;
+    mFloodGate.addRecord(msg, peer, msgHash);
+    if (msg.type() == TRANSACTION)
+    {
+        // stop demanding it from whoever else advertised it
+        mTxDemandFetcher.recv(msgHash);
+    }
+}
+
+bool
+OverlayManagerImpl::recvFloodedMsgHash(Hash const& msgHash, Peer::pointer peer)
+{
+    if (!mFloodGate.addKnownRecord(msgHash, peer))
+    {
+        return false;
+    }
+    mMessagesReceived.Mark();
+    return true;
+}
+
+void
+OverlayManagerImpl::recvFloodAdvert(FloodAdvert const& advert,
+                                    Peer::pointer peer)
+{
+    if (!mApp.getConfig().FLOOD_TX_PULL_MODE)
+    {
+        // we did not announce pull mode, so peers should not advertise to us
+        mAdvertsDropped.Mark(advert.txHashes.size());
+        return;
+    }
+
+    auto slotIndex = mApp.getHerder().getCurrentLedgerSeq();
+    auto& demands = mTxDemandsByPeer[peer];
+    for (auto const& h : advert.txHashes)
+    {
+        if (mFloodGate.addKnownRecord(h, peer))
+        {
+            continue;
+        }
+        if (!mTxDemandFetcher.isTracking(h))
+        {
+            if (demands >= MAX_TX_DEMANDS_PER_PEER ||
+                mTxDemandFetcher.getTrackerCount() >= MAX_TX_DEMANDS)
+            {
+                mAdvertsDropped.Mark();
+                continue;
+            }
+            ++demands;
+        }
+        mTxDemandFetcher.fetchAdvertised(h, peer, slotIndex);
+    }
+}
+
+void
+OverlayManagerImpl::recvFloodDemand(FloodDemand const& demand,
+                                    Peer::pointer peer)
+{
+    for (auto const& h : demand.txHashes)
+    {
+        auto msg = mFloodGate.getMessage(h);
+        if (msg)
+        {
+            mDemandsFulfilled.Mark();
+            peer->sendMessage(*msg);
+        }
+        else
+        {
+            mDemandsUnfulfilled.Mark();
+            peer->sendDontHave(TRANSACTION, h);
+        }
+    }
+}
+
+void
+OverlayManagerImpl::recvTxDontHave(Hash const& msgHash, Peer::pointer peer)
+{
+    mTxDemandFetcher.doesntHave(msgHash, peer);
 }
 
 void
@@ -51,6 +51,9 @@ class OverlayManagerImpl : public OverlayManager
     medida::Meter& mConnectionsEstablished;
     medida::Meter& mConnectionsDropped;
     medida::Meter& mConnectionsRejected;
+    medida::Meter& mDemandsFulfilled;
+    medida::Meter& mDemandsUnfulfilled;
+    medida::Meter& mAdvertsDropped;
     medida::Counter& mPendingPeersSize;
     medida::Counter& mAuthenticatedPeersSize;
 
@@ -64,6 +67,10 @@ class OverlayManagerImpl : public OverlayManager
     friend class OverlayManagerTests;
 
     Floodgate mFloodGate;
+    ItemFetcher mTxDemandFetcher;
+    // number of transactions each peer's adverts got mTxDemandFetcher to
+    // start tracking since the last ledger closed
+    std::map<Peer::pointer, size_t> mTxDemandsByPeer;
 
   public:
     OverlayManagerImpl(Application& app);
@@ -71,6 +78,12 @@ class OverlayManagerImpl : public OverlayManager
 
     void ledgerClosed(uint32_t lastClosedledgerSeq) override;
     void recvFloodedMsg(StellarMessage const& msg, Peer::pointer peer) override;
+    bool recvFloodedMsgHash(Hash const& msgHash, Peer::pointer peer) override;
+    void recvFloodAdvert(FloodAdvert const& advert,
+                         Peer::pointer peer) override;
+    void recvFloodDemand(FloodDemand const& demand,
+                         Peer::pointer peer) override;
+    void recvTxDontHave(Hash const& msgHash, Peer::pointer peer) override;
     void broadcastMessage(StellarMessage const& msg,
                           bool force = false) override;
     void connectTo(std::string const& addr) override;
@@ -4,6 +4,7 @@
 
 #include "BanManager.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
@@ -94,6 +95,94 @@ TEST_CASE("failed auth", "[overlay]")
                 .count() != 0);
 }
 
+TEST_CASE("authenticated message round trips benchmarking",
+          "[overlay][bench][hide]")
+{
+    VirtualClock clock;
+    Config const& cfg1 = getTestConfig(0);
+    Config const& cfg2 = getTestConfig(1);
+    auto app1 = createTestApplication(clock, cfg1);
+    auto app2 = createTestApplication(clock, cfg2);
+
+    LoopbackPeerConnection conn(*app1, *app2);
+    testutil::crankSome(clock);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+
+    // Each GET_SCP_QUORUMSET for an unknown hash is answered by a DONT_HAVE,
+    // so every iteration is two MAC'ed messages, one in each direction.
+    size_t const n = 100000;
+    auto& dontHave =
+        app1->getMetrics().NewTimer({"overlay", "recv", "dont-have"});
+    auto before = dontHave.count();
+    uint256 qSetHash;
+
+    LOG(INFO) << "Benchmarking " << n << " authenticated round trips";
+    {
+        TIMED_SCOPE(timerBlkObj, "round trips");
+        for (size_t i = 0; i < n; ++i)
+        {
+            qSetHash[i % qSetHash.size()]++;
+            conn.getInitiator()->sendGetQuorumSet(qSetHash);
+        }
+        while (dontHave.count() < before + n && clock.crank(false) > 0)
+            ;
+    }
+    REQUIRE(dontHave.count() == before + n);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+}
+
+TEST_CASE("flood adverts are bounded", "[overlay][flood]")
+{
+    VirtualClock clock;
+    Config const& cfg1 = getTestConfig(0);
+    Config cfg2 = getTestConfig(1);
+    size_t const advertSize = 1000;
+    size_t dropped = 0;
+
+    SECTION("pull mode caps demands per peer")
+    {
+        cfg2.FLOOD_TX_PULL_MODE = true;
+        // 2000 demands per peer and ledger, the third advert is dropped
+        dropped = advertSize;
+    }
+    SECTION("push mode drops all adverts")
+    {
+        cfg2.FLOOD_TX_PULL_MODE = false;
+        dropped = 3 * advertSize;
+    }
+
+    auto app1 = createTestApplication(clock, cfg1);
+    auto app2 = createTestApplication(clock, cfg2);
+
+    LoopbackPeerConnection conn(*app1, *app2);
+    testutil::crankSome(clock);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+
+    auto& advertDropped = app2->getMetrics().NewMeter(
+        {"overlay", "flood", "advert-dropped"}, "hash");
+    auto before = advertDropped.count();
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        StellarMessage msg;
+        msg.type(FLOOD_ADVERT);
+        for (size_t j = 0; j < advertSize; ++j)
+        {
+            msg.floodAdvert().txHashes.push_back(
+                sha256(std::to_string(i * advertSize + j)));
+        }
+        conn.getInitiator()->sendMessage(msg);
+    }
+    testutil::crankSome(clock);
+
+    REQUIRE(advertDropped.count() == before + dropped);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+}
+
 TEST_CASE("reject non-preferred peer", "[overlay]")
 {
     VirtualClock clock;
@@ -40,6 +40,11 @@ using namespace soci;
 
 using xdr::operator<;
 
+// Overlay protocol version that introduced FLOOD_ADVERT / FLOOD_DEMAND.
+static uint32_t const FIRST_OVERLAY_VERSION_WITH_PULL_MODE = 7;
+// How long adverts and demands accumulate before going out as one message.
+static std::chrono::milliseconds const FLOOD_BATCH_PERIOD{100};
+
 medida::Meter&
 Peer::getByteReadMeter(Application& app)
 {
@@ -58,6 +63,7 @@ Peer::Peer(Application& app, PeerRole role)
     , mState(role == WE_CALLED_REMOTE ? CONNECTING : CONNECTED)
     , mRemoteOverlayVersion(0)
     , mIdleTimer(app)
+    , mFloodBatchTimer(app)
     , mLastRead(app.getClock().now())
     , mLastWrite(app.getClock().now())
 
@@ -95,6 +101,10 @@ Peer::Peer(Application& app, PeerRole role)
           app.getMetrics().NewTimer({"overlay", "recv", "scp-message"}))
     , mRecvGetSCPStateTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "get-scp-state"}))
+    , mRecvFloodAdvertTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-advert"}))
+    , mRecvFloodDemandTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-demand"}))
 
     , mRecvSCPPrepareTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "scp-prepare"}))
@@ -131,6 +141,10 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "send", "scp-message"}, "message"))
     , mSendGetSCPStateMeter(app.getMetrics().NewMeter(
           {"overlay", "send", "get-scp-state"}, "message"))
+    , mSendFloodAdvertMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-advert"}, "message"))
+    , mSendFloodDemandMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-demand"}, "message"))
     , mDropInConnectHandlerMeter(app.getMetrics().NewMeter(
           {"overlay", "drop", "connect-handler"}, "drop"))
     , mDropInRecvMessageDecodeMeter(app.getMetrics().NewMeter(
@@ -165,9 +179,80 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "drop", "recv-auth-invalid-peer"}, "drop"))
     , mDropInRecvErrorMeter(
           app.getMetrics().NewMeter({"overlay", "drop", "recv-error"}, "drop"))
+    , mSkipKnownFloodMeter(app.getMetrics().NewMeter(
+          {"overlay", "recv", "known-flood-skipped"}, "message"))
 {
     auto bytes = randomBytes(mSendNonce.size());
     std::copy(bytes.begin(), bytes.end(), mSendNonce.begin());
+    setMacKeys(mSendMacKey, mRecvMacKey);
+}
+
+void
+Peer::setMacKeys(HmacSha256Key const& sendKey, HmacSha256Key const& recvKey)
+{
+    mSendMacKey = sendKey;
+    mRecvMacKey = recvKey;
+    mSendMac = HmacSha256::create(mSendMacKey);
+    mRecvMac = HmacSha256::create(mRecvMacKey);
+}
+
+// The wire form of an AuthenticatedMessage is its 4-byte union discriminant,
+// then (sequence, message), then the MAC. The MAC covers exactly the middle
+// part, so it can be computed or checked without marshaling again.
+static size_t const AUTH_MSG_PREFIX_SIZE = 4;
+static size_t const AUTH_MSG_MAC_SIZE = 32;
+
+static ByteSlice
+macInputFromWire(ByteSlice const& wire)
+{
+    if (wire.size() < AUTH_MSG_PREFIX_SIZE + AUTH_MSG_MAC_SIZE)
+    {
+        throw std::runtime_error("authenticated message too short");
+    }
+    return ByteSlice(wire.data() + AUTH_MSG_PREFIX_SIZE,
+                     wire.size() - AUTH_MSG_PREFIX_SIZE - AUTH_MSG_MAC_SIZE);
+}
+
+static uint32_t
+readBigEndian32(unsigned char const* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+           (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+MessageType
+Peer::wireMessageType(xdr::msg_ptr const& xdrBytes)
+{
+    // discriminant, then the 8-byte sequence, then the message type
+    if (xdrBytes->size() < AUTH_MSG_PREFIX_SIZE + 8 + 4)
+    {
+        throw std::runtime_error("authenticated message too short");
+    }
+    return static_cast<MessageType>(
+        readBigEndian32(reinterpret_cast<unsigned char const*>(
+            xdrBytes->data() + AUTH_MSG_PREFIX_SIZE + 8)));
+}
+
+void
+Peer::sealMessage(xdr::msg_ptr& xdrBytes)
+{
+    auto type = wireMessageType(xdrBytes);
+    if (type == HELLO || type == ERROR_MSG)
+    {
+        return;
+    }
+    auto seq = reinterpret_cast<unsigned char*>(xdrBytes->data() +
+                                                AUTH_MSG_PREFIX_SIZE);
+    for (int i = 0; i < 8; ++i)
+    {
+        seq[i] = static_cast<unsigned char>(mSendMacSeq >> (56 - 8 * i));
+    }
+    // MAC the marshaled (sequence, message) bytes and patch the result into
+    // the trailing (zeroed) MAC field.
+    auto mac = mSendMac->mac(macInputFromWire(xdrBytes));
+    std::copy(mac.mac.begin(), mac.mac.end(),
+              xdrBytes->data() + xdrBytes->size() - AUTH_MSG_MAC_SIZE);
+    ++mSendMacSeq;
 }
 
 void
@@ -180,6 +265,15 @@ Peer::sendHello()
     elo.ledgerVersion = mApp.getConfig().LEDGER_PROTOCOL_VERSION;
     elo.overlayMinVersion = mApp.getConfig().OVERLAY_PROTOCOL_MIN_VERSION;
     elo.overlayVersion = mApp.getConfig().OVERLAY_PROTOCOL_VERSION;
+    if (!mApp.getConfig().FLOOD_TX_PULL_MODE &&
+        elo.overlayVersion >= FIRST_OVERLAY_VERSION_WITH_PULL_MODE)
+    {
+        // we drop adverts in push mode: announce the last version without
+        // pull mode, so that peers keep pushing transactions to us
+        elo.overlayVersion =
+            std::max(elo.overlayMinVersion,
+                     FIRST_OVERLAY_VERSION_WITH_PULL_MODE - 1);
+    }
     elo.versionStr = mApp.getConfig().VERSION_STR;
     elo.networkID = mApp.getNetworkID();
     elo.listeningPort = mApp.getConfig().PEER_PORT;
@@ -451,6 +545,10 @@ msgSummary(StellarMessage const& msg)
         }
     case GET_SCP_STATE:
         return "GET_SCP_STATE";
+    case FLOOD_ADVERT:
+        return "FLOODADVERT";
+    case FLOOD_DEMAND:
+        return "FLOODDEMAND";
     }
     return "UNKNOWN";
 }
@@ -507,17 +605,18 @@ Peer::sendMessage(StellarMessage const& msg)
     case GET_SCP_STATE:
         mSendGetSCPStateMeter.Mark();
         break;
+    case FLOOD_ADVERT:
+        mSendFloodAdvertMeter.Mark();
+        break;
+    case FLOOD_DEMAND:
+        mSendFloodDemandMeter.Mark();
+        break;
     };
 
     AuthenticatedMessage amsg;
     amsg.v0().message = msg;
-    if (msg.type() != HELLO && msg.type() != ERROR_MSG)
-    {
-        amsg.v0().sequence = mSendMacSeq;
-        amsg.v0().mac =
-            hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq, msg));
-        ++mSendMacSeq;
-    }
+    // The sequence number and MAC are left zero; the transport seals the
+    // message once its position in the outgoing stream is settled.
     xdr::msg_ptr xdrBytes(xdr::xdr_to_msg(amsg));
     this->sendMessage(std::move(xdrBytes));
 }
@@ -537,7 +636,7 @@ Peer::recvMessage(xdr::msg_ptr const& msg)
     {
         AuthenticatedMessage am;
         xdr::xdr_from_msg(msg, am);
-        recvMessage(am);
+        recvMessage(am, msg);
     }
     catch (xdr::xdr_runtime_error& e)
     {
@@ -566,38 +665,174 @@ Peer::shouldAbort() const
     return (mState == CLOSING) || mApp.getOverlayManager().isShuttingDown();
 }
 
-void
-Peer::recvMessage(AuthenticatedMessage const& msg)
+bool
+Peer::checkMessageAuth(uint64 sequence, MessageType type,
+                       HmacSha256Mac const& mac, ByteSlice const& macInput,
+                       std::string& error)
 {
-    if (shouldAbort())
+    if (mState >= GOT_HELLO && type != ERROR_MSG)
     {
-        return;
-    }
-
-    if (mState >= GOT_HELLO && msg.v0().message.type() != ERROR_MSG)
-    {
-        if (msg.v0().sequence != mRecvMacSeq)
+        if (sequence != mRecvMacSeq)
         {
             CLOG(ERROR, "Overlay") << "Unexpected message-auth sequence";
             mDropInRecvMessageSeqMeter.Mark();
             ++mRecvMacSeq;
-            drop(ERR_AUTH, "unexpected auth sequence");
-            return;
+            error = "unexpected auth sequence";
+            return false;
         }
 
-        if (!hmacSha256Verify(
-                msg.v0().mac, mRecvMacKey,
-                xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
+        if (!mRecvMac->verify(mac, macInput))
         {
             CLOG(ERROR, "Overlay") << "Message-auth check failed";
             mDropInRecvMessageMacMeter.Mark();
             ++mRecvMacSeq;
-            drop(ERR_AUTH, "unexpected MAC");
-            return;
+            error = "unexpected MAC";
+            return false;
         }
         ++mRecvMacSeq;
     }
-    recvMessage(msg.v0().message);
+    return true;
+}
+
+void
+Peer::recvMessage(AuthenticatedMessage const& msg, ByteSlice const& wire)
+{
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    std::string error;
+    if (checkMessageAuth(msg.v0().sequence, msg.v0().message.type(),
+                         msg.v0().mac, macInputFromWire(wire), error))
+    {
+        recvMessage(msg.v0().message);
+    }
+    else
+    {
+        drop(ERR_AUTH, error);
+    }
+}
+
+void
+Peer::recvMessages(std::vector<ByteSlice> const& wires)
+{
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    LoadManager::PeerContext loadCtx(mApp, mPeerID);
+
+    if (!isAuthenticated())
+    {
+        // Still handshaking: HELLO installs the keys for the messages that
+        // follow it, so decode and go one at a time.
+        for (auto const& wire : wires)
+        {
+            if (shouldAbort())
+            {
+                return;
+            }
+            try
+            {
+                AuthenticatedMessage am;
+                xdr::xdr_get g(wire.begin(), wire.end());
+                xdr::xdr_argpack_archive(g, am);
+                recvMessage(am, wire);
+            }
+            catch (xdr::xdr_runtime_error& e)
+            {
+                CLOG(ERROR, "Overlay") << "received corrupt xdr " << e.what();
+                mDropInRecvMessageDecodeMeter.Mark();
+                drop(ERR_DATA, "received corrupt XDR");
+                return;
+            }
+        }
+        return;
+    }
+
+    // Once authenticated every field the MAC check needs sits at a fixed
+    // offset: version, sequence and message type up front, MAC at the back.
+    // Check the whole run in one tight loop before decoding anything. As when
+    // going one at a time, the messages before a bad one are still delivered
+    // and the peer is only dropped after them.
+    size_t const headerSize = AUTH_MSG_PREFIX_SIZE + 8 + 4;
+    size_t verified = 0;
+    ErrorCode dropCode = ERR_MISC;
+    std::string dropReason;
+    for (; verified < wires.size(); ++verified)
+    {
+        auto const& wire = wires[verified];
+        if (wire.size() < headerSize + AUTH_MSG_MAC_SIZE ||
+            readBigEndian32(wire.data()) != 0)
+        {
+            CLOG(ERROR, "Overlay") << "received malformed message";
+            mDropInRecvMessageDecodeMeter.Mark();
+            dropCode = ERR_DATA;
+            dropReason = "received corrupt XDR";
+            break;
+        }
+        auto p = wire.data() + AUTH_MSG_PREFIX_SIZE;
+        uint64 sequence =
+            (uint64(readBigEndian32(p)) << 32) | readBigEndian32(p + 4);
+        auto type = static_cast<MessageType>(readBigEndian32(p + 8));
+        HmacSha256Mac mac;
+        std::copy(wire.end() - AUTH_MSG_MAC_SIZE, wire.end(), mac.mac.begin());
+        if (!checkMessageAuth(sequence, type, mac, macInputFromWire(wire),
+                              dropReason))
+        {
+            dropCode = ERR_AUTH;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < verified && !shouldAbort(); ++i)
+    {
+        auto const& wire = wires[i];
+        ByteSlice body(wire.data() + headerSize - 4,
+                       wire.size() - (headerSize - 4) - AUTH_MSG_MAC_SIZE);
+        auto type = static_cast<MessageType>(
+            readBigEndian32(wire.data() + headerSize - 4));
+
+        // A transaction we already flooded is only worth remembering the
+        // sender of; skip decoding it altogether. The hash is the same one
+        // Floodgate computes over the XDR of the StellarMessage. It still
+        // counts as a received transaction.
+        if (type == TRANSACTION)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (mApp.getOverlayManager().recvFloodedMsgHash(
+                    sha256(body), shared_from_this()))
+            {
+                mRecvTransactionTimer.Update(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start));
+                mSkipKnownFloodMeter.Mark();
+                continue;
+            }
+        }
+
+        StellarMessage msg;
+        try
+        {
+            xdr::xdr_get g(body.begin(), body.end());
+            xdr::xdr_argpack_archive(g, msg);
+        }
+        catch (xdr::xdr_runtime_error& e)
+        {
+            CLOG(ERROR, "Overlay") << "received corrupt xdr " << e.what();
+            mDropInRecvMessageDecodeMeter.Mark();
+            drop(ERR_DATA, "received corrupt XDR");
+            return;
+        }
+        recvMessage(msg);
+    }
+
+    if (verified < wires.size() && !shouldAbort())
+    {
+        drop(dropCode, dropReason);
+    }
 }
 
 void
@@ -721,12 +956,33 @@ Peer::recvMessage(StellarMessage const& stellarMsg)
         recvGetSCPState(stellarMsg);
     }
     break;
+
+    case FLOOD_ADVERT:
+    {
+        auto t = mRecvFloodAdvertTimer.TimeScope();
+        recvFloodAdvert(stellarMsg);
+    }
+    break;
+
+    case FLOOD_DEMAND:
+    {
+        auto t = mRecvFloodDemandTimer.TimeScope();
+        recvFloodDemand(stellarMsg);
+    }
+    break;
     }
 }
 
 void
 Peer::recvDontHave(StellarMessage const& msg)
 {
+    if (msg.dontHave().type == TRANSACTION)
+    {
+        // answer to one of our FLOOD_DEMANDs
+        mApp.getOverlayManager().recvTxDontHave(msg.dontHave().reqHash,
+                                                shared_from_this());
+        return;
+    }
     mApp.getHerder().peerDoesntHave(msg.dontHave().type, msg.dontHave().reqHash,
                                     shared_from_this());
 }
@@ -763,6 +1019,13 @@ Peer::recvTransaction(StellarMessage const& msg)
         mApp.getNetworkID(), msg.transaction());
     if (transaction)
     {
+        // under load, shed it before the Herder spends time validating it
+        if (!mApp.getOverlayManager().getLoadManager().admitTransaction(
+                mApp, mPeerID, transaction))
+        {
+            return;
+        }
+
         // add it to our current set
         // and make sure it is valid
         auto recvRes = mApp.getHerder().recvTransaction(transaction);
@@ -827,7 +1090,7 @@ Peer::recvSCPMessage(StellarMessage const& msg)
                                 ? mRecvSCPExternalizeTimer.TimeScope()
                                 : (mRecvSCPNominateTimer.TimeScope()))));
 
-    mApp.getHerder().recvSCPEnvelope(envelope);
+    mApp.getHerder().recvUnverifiedSCPEnvelope(envelope);
 }
 
 void
@@ -838,6 +1101,100 @@ Peer::recvGetSCPState(StellarMessage const& msg)
     mApp.getHerder().sendSCPStateToPeer(seq, shared_from_this());
 }
 
+void
+Peer::recvFloodAdvert(StellarMessage const& msg)
+{
+    mApp.getOverlayManager().recvFloodAdvert(msg.floodAdvert(),
+                                             shared_from_this());
+}
+
+void
+Peer::recvFloodDemand(StellarMessage const& msg)
+{
+    mApp.getOverlayManager().recvFloodDemand(msg.floodDemand(),
+                                             shared_from_this());
+}
+
+bool
+Peer::supportsPullMode() const
+{
+    return mRemoteOverlayVersion >= FIRST_OVERLAY_VERSION_WITH_PULL_MODE;
+}
+
+void
+Peer::queueTxAdvert(Hash const& msgHash)
+{
+    mTxAdvertQueue.emplace_back(msgHash);
+    if (mTxAdvertQueue.size() >= TX_ADVERT_VECTOR_MAX_SIZE)
+    {
+        flushFloodBatches();
+    }
+    else
+    {
+        scheduleFloodBatches();
+    }
+}
+
+void
+Peer::queueTxDemand(Hash const& msgHash)
+{
+    mTxDemandQueue.emplace_back(msgHash);
+    if (mTxDemandQueue.size() >= TX_DEMAND_VECTOR_MAX_SIZE)
+    {
+        flushFloodBatches();
+    }
+    else
+    {
+        scheduleFloodBatches();
+    }
+}
+
+void
+Peer::scheduleFloodBatches()
+{
+    if (mFloodBatchPending || shouldAbort())
+    {
+        return;
+    }
+    mFloodBatchPending = true;
+    auto self = shared_from_this();
+    mFloodBatchTimer.expires_from_now(FLOOD_BATCH_PERIOD);
+    mFloodBatchTimer.async_wait([self]() { self->flushFloodBatches(); },
+                                VirtualTimer::onFailureNoop);
+}
+
+void
+Peer::flushFloodBatches()
+{
+    mFloodBatchPending = false;
+    mFloodBatchTimer.cancel();
+    if (shouldAbort() || !isAuthenticated())
+    {
+        mTxAdvertQueue.clear();
+        mTxDemandQueue.clear();
+        return;
+    }
+
+    if (!mTxAdvertQueue.empty())
+    {
+        StellarMessage msg;
+        msg.type(FLOOD_ADVERT);
+        msg.floodAdvert().txHashes.assign(mTxAdvertQueue.begin(),
+                                          mTxAdvertQueue.end());
+        mTxAdvertQueue.clear();
+        sendMessage(msg);
+    }
+    if (!mTxDemandQueue.empty())
+    {
+        StellarMessage msg;
+        msg.type(FLOOD_DEMAND);
+        msg.floodDemand().txHashes.assign(mTxDemandQueue.begin(),
+                                          mTxDemandQueue.end());
+        mTxDemandQueue.clear();
+        sendMessage(msg);
+    }
+}
+
 void
 Peer::recvError(StellarMessage const& msg)
 {
@@ -932,10 +1289,10 @@ Peer::recvHello(Hello const& elo)
     mRecvNonce = elo.nonce;
     mSendMacSeq = 0;
     mRecvMacSeq = 0;
-    mSendMacKey = peerAuth.getSendingMacKey(elo.cert.pubkey, mSendNonce,
-                                            mRecvNonce, mRole);
-    mRecvMacKey = peerAuth.getReceivingMacKey(elo.cert.pubkey, mSendNonce,
-                                              mRecvNonce, mRole);
+    setMacKeys(peerAuth.getSendingMacKey(elo.cert.pubkey, mSendNonce,
+                                         mRecvNonce, mRole),
+               peerAuth.getReceivingMacKey(elo.cert.pubkey, mSendNonce,
+                                           mRecvNonce, mRole));
 
     mState = GOT_HELLO;
     CLOG(DEBUG, "Overlay") << "recvHello from " << toString();
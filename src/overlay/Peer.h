@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "util/asio.h"
+#include "crypto/SHA.h"
 #include "database/Database.h"
 #include "overlay/PeerBareAddress.h"
 #include "overlay/StellarXDR.h"
@@ -65,6 +66,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
 
     HmacSha256Key mSendMacKey;
     HmacSha256Key mRecvMacKey;
+    // Pre-keyed HMAC states for the two keys above; rebuilt whenever the
+    // keys change so per-message MACs skip the key schedule.
+    std::unique_ptr<HmacSha256> mSendMac;
+    std::unique_ptr<HmacSha256> mRecvMac;
     uint64_t mSendMacSeq{0};
     uint64_t mRecvMacSeq{0};
 
@@ -74,6 +79,13 @@ class Peer : public std::enable_shared_from_this<Peer>,
     PeerBareAddress mAddress;
 
     VirtualTimer mIdleTimer;
+
+    // Pull-mode flooding: hashes waiting to go out in the next FLOOD_ADVERT
+    // and FLOOD_DEMAND messages to this peer.
+    std::vector<Hash> mTxAdvertQueue;
+    std::vector<Hash> mTxDemandQueue;
+    VirtualTimer mFloodBatchTimer;
+    bool mFloodBatchPending{false};
     VirtualClock::time_point mLastRead;
     VirtualClock::time_point mLastWrite;
 
@@ -98,6 +110,8 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Timer& mRecvSCPQuorumSetTimer;
     medida::Timer& mRecvSCPMessageTimer;
     medida::Timer& mRecvGetSCPStateTimer;
+    medida::Timer& mRecvFloodAdvertTimer;
+    medida::Timer& mRecvFloodDemandTimer;
 
     medida::Timer& mRecvSCPPrepareTimer;
     medida::Timer& mRecvSCPConfirmTimer;
@@ -117,6 +131,8 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mSendSCPQuorumSetMeter;
     medida::Meter& mSendSCPMessageSetMeter;
     medida::Meter& mSendGetSCPStateMeter;
+    medida::Meter& mSendFloodAdvertMeter;
+    medida::Meter& mSendFloodDemandMeter;
 
     medida::Meter& mDropInConnectHandlerMeter;
     medida::Meter& mDropInRecvMessageDecodeMeter;
@@ -136,10 +152,28 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mDropInRecvAuthInvalidPeerMeter;
     medida::Meter& mDropInRecvErrorMeter;
 
+    medida::Meter& mSkipKnownFloodMeter;
+
     bool shouldAbort() const;
     void recvMessage(StellarMessage const& msg);
-    void recvMessage(AuthenticatedMessage const& msg);
+    // `wire` is the XDR encoding `msg` was decoded from; its MAC is checked
+    // against those bytes in place rather than against a re-marshaled copy.
+    void recvMessage(AuthenticatedMessage const& msg, ByteSlice const& wire);
     void recvMessage(xdr::msg_ptr const& xdrBytes);
+    // Receives a run of messages that arrived together (e.g. in one socket
+    // read), each given as its wire encoding. Once authenticated, sequence
+    // numbers and MACs are checked in place for the whole run before any
+    // message is decoded, and transactions we already know are not decoded
+    // at all.
+    void recvMessages(std::vector<ByteSlice> const& wires);
+    // Checks the sequence number and MAC of a received message. On failure
+    // marks the matching drop meter and sets error, but leaves dropping the
+    // peer to the caller.
+    bool checkMessageAuth(uint64 sequence, MessageType type,
+                          HmacSha256Mac const& mac, ByteSlice const& macInput,
+                          std::string& error);
+    void setMacKeys(HmacSha256Key const& sendKey,
+                    HmacSha256Key const& recvKey);
 
     virtual void recvError(StellarMessage const& msg);
     // returns false if we should drop this peer
@@ -157,12 +191,15 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void recvSCPQuorumSet(StellarMessage const& msg);
     void recvSCPMessage(StellarMessage const& msg);
     void recvGetSCPState(StellarMessage const& msg);
+    void recvFloodAdvert(StellarMessage const& msg);
+    void recvFloodDemand(StellarMessage const& msg);
 
     void sendHello();
     void sendAuth();
     void sendSCPQuorumSet(SCPQuorumSetPtr qSet);
-    void sendDontHave(MessageType type, uint256 const& itemID);
     void sendPeers();
+    void scheduleFloodBatches();
+    void flushFloodBatches();
 
     // NB: This is a move-argument because the write-buffer has to travel
     // with the write-request through the async IO system, and we might have
@@ -171,7 +208,15 @@ class Peer : public std::enable_shared_from_this<Peer>,
     // put in a reused/non-owned buffer without having to buffer/queue
     // messages somewhere else. The async write request will point _into_
     // this owned buffer. This is really the best we can do.
+    //
+    // Messages arrive here unsealed: implementations must call sealMessage
+    // on each one, in the order they put them on the wire.
     virtual void sendMessage(xdr::msg_ptr&& xdrBytes) = 0;
+    // Stamps the next send sequence number into a marshaled
+    // AuthenticatedMessage and MACs it (HELLO and ERROR_MSG stay unsealed).
+    void sealMessage(xdr::msg_ptr& xdrBytes);
+    // Type of the StellarMessage inside a marshaled AuthenticatedMessage.
+    static MessageType wireMessageType(xdr::msg_ptr const& xdrBytes);
     virtual void
     connected()
     {
@@ -200,9 +245,17 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendGetQuorumSet(uint256 const& setID);
     void sendGetPeers();
     void sendGetScpState(uint32 ledgerSeq);
+    void sendDontHave(MessageType type, uint256 const& itemID);
 
     void sendMessage(StellarMessage const& msg);
 
+    // Whether the remote end understands FLOOD_ADVERT / FLOOD_DEMAND.
+    bool supportsPullMode() const;
+    // Queue a flooded message hash for the next (batched) FLOOD_ADVERT or
+    // FLOOD_DEMAND to this peer.
+    void queueTxAdvert(Hash const& msgHash);
+    void queueTxDemand(Hash const& msgHash);
+
     PeerRole
     getRole() const
     {
@@ -260,12 +313,7 @@ class Peer : public std::enable_shared_from_this<Peer>,
     }
 
     virtual void
-    readHeaderHandler(asio::error_code const& error, size_t bytes_transferred)
-    {
-    }
-
-    virtual void
-    readBodyHandler(asio::error_code const& error, size_t bytes_transferred)
+    readHandler(asio::error_code const& error, size_t bytes_transferred)
     {
     }
 
@@ -8,6 +8,7 @@
 #include "main/Config.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/LoadManager.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/PeerRecord.h"
@@ -29,8 +30,43 @@ using namespace std;
 
 TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
                  std::shared_ptr<TCPPeer::SocketType> socket)
-    : Peer(app, role), mSocket(socket)
+    : Peer(app, role)
+    , mSocket(socket)
+    , mReadSyscallMeter(
+          app.getMetrics().NewMeter({"overlay", "read", "syscall"}, "read"))
+    , mReadSlabAllocMeter(app.getMetrics().NewMeter(
+          {"overlay", "read", "slab-alloc"}, "allocation"))
+    , mReadThrottleMeter(
+          app.getMetrics().NewMeter({"overlay", "read", "throttle"}, "read"))
 {
+    mSendLaneDelay[LANE_SCP] =
+        &app.getMetrics().NewTimer({"overlay", "send-lane", "scp"});
+    mSendLaneDelay[LANE_FETCH] =
+        &app.getMetrics().NewTimer({"overlay", "send-lane", "fetch"});
+    mSendLaneDelay[LANE_FLOOD] =
+        &app.getMetrics().NewTimer({"overlay", "send-lane", "flood"});
+}
+
+TCPPeer::SendLane
+TCPPeer::getSendLane(MessageType type)
+{
+    switch (type)
+    {
+    case GET_TX_SET:
+    case TX_SET:
+    case GET_SCP_QUORUMSET:
+    case SCP_QUORUMSET:
+    case DONT_HAVE:
+        return LANE_FETCH;
+    case TRANSACTION:
+    case FLOOD_ADVERT:
+    case FLOOD_DEMAND:
+        return LANE_FLOOD;
+    default:
+        // SCP_MESSAGE, GET_SCP_STATE, and the handshake and control messages
+        // that everything else has to follow
+        return LANE_SCP;
+    }
 }
 
 TCPPeer::pointer
@@ -143,12 +179,15 @@ TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
         CLOG(TRACE, "Overlay") << "TCPPeer:sendMessage to " << toString();
     assertThreadIsMain();
 
-    // places the buffer to write into the write queue
+    // places the buffer to write into its lane; it gets sealed when it
+    // leaves the lane, as lanes reorder messages
+    auto lane = getSendLane(wireMessageType(xdrBytes));
     auto buf = std::make_shared<xdr::msg_ptr>(std::move(xdrBytes));
 
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
 
-    self->mWriteQueue.emplace(buf);
+    self->mWriteQueues[lane].emplace_back(
+        QueuedMessage{buf, mApp.getClock().now()});
 
     if (!self->mWriting)
     {
@@ -216,6 +255,19 @@ TCPPeer::shutdown()
     });
 }
 
+bool
+TCPPeer::writeQueuesEmpty() const
+{
+    for (auto const& q : mWriteQueues)
+    {
+        if (!q.empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 void
 TCPPeer::messageSender()
 {
@@ -224,13 +276,13 @@ TCPPeer::messageSender()
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
 
     // if nothing to do, flush and return
-    if (mWriteQueue.empty())
+    if (writeQueuesEmpty())
     {
         mSocket->async_flush([self](asio::error_code const& ec, std::size_t) {
             self->writeHandler(ec, 0);
             if (!ec)
             {
-                if (!self->mWriteQueue.empty())
+                if (!self->writeQueuesEmpty())
                 {
                     self->messageSender();
                 }
@@ -249,16 +301,24 @@ TCPPeer::messageSender()
         return;
     }
 
-    // peek the buffer from the queue
-    // do not remove it yet as we need the buffer for the duration of the
-    // write operation
-    auto buf = mWriteQueue.front();
+    // take the oldest message of the most urgent lane; the write handler
+    // keeps the buffer alive for the duration of the write operation
+    size_t lane = 0;
+    while (mWriteQueues[lane].empty())
+    {
+        ++lane;
+    }
+    auto buf = mWriteQueues[lane].front().mBytes;
+    mSendLaneDelay[lane]->Update(mApp.getClock().now() -
+                                 mWriteQueues[lane].front().mEnqueuedAt);
+    mWriteQueues[lane].pop_front();
+    sealMessage(*buf);
 
     asio::async_write(*(mSocket.get()),
                       asio::buffer((*buf)->raw_data(), (*buf)->raw_size()),
-                      [self](asio::error_code const& ec, std::size_t length) {
+                      [self, buf](asio::error_code const& ec,
+                                  std::size_t length) {
                           self->writeHandler(ec, length);
-                          self->mWriteQueue.pop(); // done with front element
 
                           // continue processing the queue/flush
                           if (!ec)
@@ -315,34 +375,66 @@ TCPPeer::startRead()
 
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
 
-    assert(self->mIncomingHeader.size() == 0);
+    if (mReadSlab.empty())
+    {
+        mReadSlab.resize(READ_SLAB_SIZE);
+        mReadSlabAllocMeter.Mark();
+    }
+    // Make room at the back: slide any partial message to the front, and
+    // only if it alone fills the slab, grow the slab to fit it.
+    if (mReadEnd == mReadSlab.size())
+    {
+        if (mReadStart != 0)
+        {
+            std::copy(mReadSlab.begin() + mReadStart,
+                      mReadSlab.begin() + mReadEnd, mReadSlab.begin());
+            mReadEnd -= mReadStart;
+            mReadStart = 0;
+        }
+        if (mReadEnd == mReadSlab.size())
+        {
+            size_t needed = mReadSlab.size();
+            if (mReadEnd >= 4)
+            {
+                needed = 4 + size_t(getIncomingMsgLength(mReadSlab.data()));
+            }
+            if (needed <= mReadSlab.size())
+            {
+                // getIncomingMsgLength dropped us
+                return;
+            }
+            mReadSlab.resize(needed);
+            mReadSlabAllocMeter.Mark();
+        }
+    }
 
     if (Logging::logTrace("Overlay"))
         CLOG(TRACE, "Overlay") << "TCPPeer::startRead to " << self->toString();
 
-    self->mIncomingHeader.resize(4);
-    asio::async_read(*(self->mSocket.get()),
-                     asio::buffer(self->mIncomingHeader),
-                     [self](asio::error_code ec, std::size_t length) {
-                         if (Logging::logTrace("Overlay"))
-                             CLOG(TRACE, "Overlay")
-                                 << "TCPPeer::startRead calledback " << ec
-                                 << " length:" << length;
-                         self->readHeaderHandler(ec, length);
-                     });
+    mReadSyscallMeter.Mark();
+    // Read from the socket itself: going through the buffered stream would
+    // cost a copy out of its internal buffer.
+    mSocket->next_layer().async_read_some(
+        asio::buffer(mReadSlab.data() + mReadEnd, mReadSlab.size() - mReadEnd),
+        [self](asio::error_code ec, std::size_t length) {
+            if (Logging::logTrace("Overlay"))
+                CLOG(TRACE, "Overlay") << "TCPPeer::startRead calledback "
+                                       << ec << " length:" << length;
+            self->readHandler(ec, length);
+        });
 }
 
 int
-TCPPeer::getIncomingMsgLength()
+TCPPeer::getIncomingMsgLength(uint8_t const* header)
 {
-    int length = mIncomingHeader[0];
+    int length = header[0];
     length &= 0x7f; // clear the XDR 'continuation' bit
     length <<= 8;
-    length |= mIncomingHeader[1];
+    length |= header[1];
     length <<= 8;
-    length |= mIncomingHeader[2];
+    length |= header[2];
     length <<= 8;
-    length |= mIncomingHeader[3];
+    length |= header[3];
     if (length <= 0 ||
         (!isAuthenticated() && (length > MAX_UNAUTH_MESSAGE_SIZE)) ||
         length > MAX_MESSAGE_SIZE)
@@ -364,28 +456,16 @@ TCPPeer::connected()
 }
 
 void
-TCPPeer::readHeaderHandler(asio::error_code const& error,
-                           std::size_t bytes_transferred)
+TCPPeer::readHandler(asio::error_code const& error,
+                     std::size_t bytes_transferred)
 {
     assertThreadIsMain();
-    // LOG(DEBUG) << "TCPPeer::readHeaderHandler "
-    //     << "@" << mApp.getConfig().PEER_PORT
-    //     << " to " << mRemoteListeningPort
-    //     << (error ? "error " : "") << " bytes:" << bytes_transferred;
 
     if (!error)
     {
         receivedBytes(bytes_transferred, false);
-        int length = getIncomingMsgLength();
-        if (length != 0)
-        {
-            mIncomingBody.resize(length);
-            auto self = static_pointer_cast<TCPPeer>(shared_from_this());
-            asio::async_read(*mSocket.get(), asio::buffer(mIncomingBody),
-                             [self](asio::error_code ec, std::size_t length) {
-                                 self->readBodyHandler(ec, length);
-                             });
-        }
+        mReadEnd += bytes_transferred;
+        processSlab();
     }
     else
     {
@@ -395,7 +475,7 @@ TCPPeer::readHeaderHandler(asio::error_code const& error,
             // errors during shutdown or connection are common/expected.
             mErrorRead.Mark();
             CLOG(ERROR, "Overlay")
-                << "readHeaderHandler error: " << error.message() << " :"
+                << "readHandler error: " << error.message() << " :"
                 << toString();
         }
         drop();
@@ -403,54 +483,89 @@ TCPPeer::readHeaderHandler(asio::error_code const& error,
 }
 
 void
-TCPPeer::readBodyHandler(asio::error_code const& error,
-                         std::size_t bytes_transferred)
+TCPPeer::processSlab()
 {
     assertThreadIsMain();
-    // LOG(DEBUG) << "TCPPeer::readBodyHandler "
-    //     << "@" << mApp.getConfig().PEER_PORT
-    //     << " to " << mRemoteListeningPort
-    //     << (error ? "error " : "") << " bytes:" << bytes_transferred;
 
-    if (!error)
+    if (!recvSlabMessages())
     {
-        receivedBytes(bytes_transferred, true);
-        recvMessage();
-        mIncomingHeader.clear();
-        startRead();
+        // Out of credits: let other peers and timers have their turn before
+        // the rest of the slab, and don't read more from this peer until then.
+        mReadThrottleMeter.Mark();
+        auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+        mApp.getClock().getIOService().post([self]() { self->processSlab(); });
+        return;
     }
-    else
+    if (mReadStart == mReadEnd)
     {
-        if (isConnected())
+        mReadStart = mReadEnd = 0;
+    }
+    if (mReadSlab.size() > READ_SLAB_SIZE && !shouldAbort())
+    {
+        // The slab grew for an oversized message: once it is consumed, and
+        // unless the next one is oversized too, go back to the default size
+        // so that the memory is not held for the life of the connection.
+        size_t pending = mReadEnd - mReadStart;
+        bool oversized =
+            pending >= 4 &&
+            4 + size_t(getIncomingMsgLength(mReadSlab.data() + mReadStart)) >
+                READ_SLAB_SIZE;
+        if (!oversized && pending <= READ_SLAB_SIZE)
         {
-            // Only emit a warning if we have an error while connected;
-            // errors during shutdown or connection are common/expected.
-            mErrorRead.Mark();
-            CLOG(ERROR, "Overlay")
-                << "readBodyHandler error: " << error.message() << " :"
-                << toString();
+            std::vector<uint8_t> slab(READ_SLAB_SIZE);
+            std::copy(mReadSlab.begin() + mReadStart,
+                      mReadSlab.begin() + mReadEnd, slab.begin());
+            mReadSlab.swap(slab);
+            mReadStart = 0;
+            mReadEnd = pending;
+            mReadSlabAllocMeter.Mark();
         }
-        drop();
     }
+    startRead();
 }
 
-void
-TCPPeer::recvMessage()
+bool
+TCPPeer::recvSlabMessages()
 {
     assertThreadIsMain();
-    try
+
+    // Frame every complete message in the slab, up to READ_MESSAGE_CREDITS
+    // of them. Until authenticated, message size limits (and keys) depend on
+    // the messages before, so those go to Peer one at a time; afterwards the
+    // whole run goes as one batch.
+    std::vector<ByteSlice> wires;
+    int credits = READ_MESSAGE_CREDITS;
+    bool outOfCredits = false;
+    while (!shouldAbort() && mReadEnd - mReadStart >= 4)
     {
-        xdr::xdr_get g(mIncomingBody.data(),
-                       mIncomingBody.data() + mIncomingBody.size());
-        AuthenticatedMessage am;
-        xdr::xdr_argpack_archive(g, am);
-        Peer::recvMessage(am);
+        bool authenticated = isAuthenticated();
+        int length = getIncomingMsgLength(mReadSlab.data() + mReadStart);
+        if (length == 0 || mReadEnd - mReadStart < 4 + size_t(length))
+        {
+            break;
+        }
+        if (credits == 0)
+        {
+            outOfCredits = true;
+            break;
+        }
+        wires.emplace_back(mReadSlab.data() + mReadStart + 4, length);
+        mReadStart += 4 + length;
+        mMessageRead.Mark();
+        --credits;
+
+        if (!authenticated)
+        {
+            Peer::recvMessages(wires);
+            wires.clear();
+        }
     }
-    catch (xdr::xdr_runtime_error& e)
+
+    if (!wires.empty() && !shouldAbort())
     {
-        CLOG(ERROR, "Overlay") << "recvMessage got a corrupt xdr: " << e.what();
-        Peer::drop(ERR_DATA, "received corrupt XDR");
+        Peer::recvMessages(wires);
     }
+    return !outOfCredits || shouldAbort();
 }
 
 void
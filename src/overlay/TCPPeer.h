@@ -6,11 +6,13 @@
 
 #include "overlay/Peer.h"
 #include "util/Timer.h"
-#include <queue>
+#include <array>
+#include <deque>
 
 namespace medida
 {
 class Meter;
+class Timer;
 }
 
 namespace stellar
@@ -18,6 +20,13 @@ namespace stellar
 
 static auto const MAX_UNAUTH_MESSAGE_SIZE = 0x1000;
 static auto const MAX_MESSAGE_SIZE = 0x1000000;
+// Default size of the per-peer read slab; it only grows to fit a single
+// message larger than this, and shrinks back once that message is consumed.
+static auto const READ_SLAB_SIZE = 0x40000;
+// Messages handed to Peer per read before the peer has to wait for another
+// turn of the event loop. Until then nothing more is read from its socket,
+// so TCP pushes back on a peer that sends faster than we process.
+static auto const READ_MESSAGE_CREDITS = 256;
 
 // Peer that communicates via a TCP socket.
 class TCPPeer : public Peer
@@ -27,31 +36,59 @@ class TCPPeer : public Peer
 
   private:
     std::shared_ptr<SocketType> mSocket;
-    std::vector<uint8_t> mIncomingHeader;
-    std::vector<uint8_t> mIncomingBody;
 
-    std::queue<std::shared_ptr<xdr::msg_ptr>> mWriteQueue;
+    // Reads land in one slab that typically holds many messages; those are
+    // framed and handed to Peer in place, without per-message buffers.
+    // [mReadStart, mReadEnd) is the part not yet consumed.
+    std::vector<uint8_t> mReadSlab;
+    size_t mReadStart{0};
+    size_t mReadEnd{0};
+
+    // Outgoing messages wait in lanes of strictly decreasing priority, so
+    // that consensus traffic never queues behind a transaction backlog.
+    enum SendLane
+    {
+        LANE_SCP = 0, // SCP and connection control
+        LANE_FETCH,   // txsets, quorum sets
+        LANE_FLOOD,   // transactions, adverts, demands
+        LANE_COUNT
+    };
+    static SendLane getSendLane(MessageType type);
+
+    struct QueuedMessage
+    {
+        std::shared_ptr<xdr::msg_ptr> mBytes;
+        VirtualClock::time_point mEnqueuedAt;
+    };
+    std::array<std::deque<QueuedMessage>, LANE_COUNT> mWriteQueues;
     bool mWriting{false};
     bool mDelayedShutdown{false};
     bool mShutdownScheduled{false};
 
+    medida::Meter& mReadSyscallMeter;
+    medida::Meter& mReadSlabAllocMeter;
+    medida::Meter& mReadThrottleMeter;
+    // time spent in each send lane
+    std::array<medida::Timer*, LANE_COUNT> mSendLaneDelay;
+
     PeerBareAddress makeAddress(int remoteListeningPort) const override;
 
-    void recvMessage();
+    // returns false if it stopped for lack of read credits
+    bool recvSlabMessages();
+    void processSlab();
     void sendMessage(xdr::msg_ptr&& xdrBytes) override;
 
+    bool writeQueuesEmpty() const;
     void messageSender();
 
-    int getIncomingMsgLength();
+    int getIncomingMsgLength(uint8_t const* header);
     virtual void connected() override;
     void startRead();
 
     void writeHandler(asio::error_code const& error,
                       std::size_t bytes_transferred) override;
-    void readHeaderHandler(asio::error_code const& error,
-                           std::size_t bytes_transferred) override;
-    void readBodyHandler(asio::error_code const& error,
-                         std::size_t bytes_transferred) override;
+    void readHandler(asio::error_code const& error,
+                     std::size_t bytes_transferred) override;
     void shutdown();
 
   public:
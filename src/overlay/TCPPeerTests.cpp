@@ -14,6 +14,11 @@
 #include "util/Logging.h"
 #include "util/Timer.h"
 
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include "xdrpp/marshal.h"
+
 namespace stellar
 {
 
@@ -53,4 +58,208 @@ TEST_CASE("TCPPeer can communicate", "[overlay]")
     REQUIRE(p1->isAuthenticated());
     s->stopAllNodes();
 }
+
+TEST_CASE("TCPPeer reads bursts of messages in few reads", "[overlay]")
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer s =
+        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+
+    auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
+    auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
+
+    SCPQuorumSet n0_qset;
+    n0_qset.threshold = 1;
+    n0_qset.validators.push_back(v10SecretKey.getPublicKey());
+    auto n0 = s->addNode(v10SecretKey, n0_qset);
+
+    SCPQuorumSet n1_qset;
+    n1_qset.threshold = 1;
+    n1_qset.validators.push_back(v11SecretKey.getPublicKey());
+    auto n1 = s->addNode(v11SecretKey, n1_qset);
+
+    s->addPendingConnection(v10SecretKey.getPublicKey(),
+                            v11SecretKey.getPublicKey());
+    s->startAllNodes();
+    s->crankForAtLeast(std::chrono::seconds(1), false);
+
+    auto p0 = n0->getOverlayManager().getConnectedPeer(
+        PeerBareAddress{"127.0.0.1", n1->getConfig().PEER_PORT});
+    REQUIRE(p0);
+    REQUIRE(p0->isAuthenticated());
+
+    // Each GET_SCP_QUORUMSET for an unknown hash is answered by a DONT_HAVE.
+    size_t const n = 1000;
+    auto& dontHave =
+        n0->getMetrics().NewTimer({"overlay", "recv", "dont-have"});
+    auto& reads =
+        n1->getMetrics().NewMeter({"overlay", "read", "syscall"}, "read");
+    auto& allocs = n1->getMetrics().NewMeter(
+        {"overlay", "read", "slab-alloc"}, "allocation");
+    auto dontHaveBefore = dontHave.count();
+    auto readsBefore = reads.count();
+    auto allocsBefore = allocs.count();
+
+    uint256 qSetHash;
+    for (size_t i = 0; i < n; ++i)
+    {
+        qSetHash[i % qSetHash.size()]++;
+        p0->sendGetQuorumSet(qSetHash);
+    }
+    s->crankUntil([&]() { return dontHave.count() == dontHaveBefore + n; },
+                  std::chrono::seconds(10), false);
+
+    REQUIRE(dontHave.count() == dontHaveBefore + n);
+    REQUIRE(p0->isAuthenticated());
+    // messages get coalesced into slab reads, and the slab is reused
+    REQUIRE(reads.count() - readsBefore < n);
+    REQUIRE(allocs.count() == allocsBefore);
+    s->stopAllNodes();
+}
+
+TEST_CASE("TCPPeer releases the read slab after an oversized message",
+          "[overlay]")
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer s =
+        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+
+    auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
+    auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
+
+    SCPQuorumSet n0_qset;
+    n0_qset.threshold = 1;
+    n0_qset.validators.push_back(v10SecretKey.getPublicKey());
+    auto n0 = s->addNode(v10SecretKey, n0_qset);
+
+    SCPQuorumSet n1_qset;
+    n1_qset.threshold = 1;
+    n1_qset.validators.push_back(v11SecretKey.getPublicKey());
+    auto n1 = s->addNode(v11SecretKey, n1_qset);
+
+    s->addPendingConnection(v10SecretKey.getPublicKey(),
+                            v11SecretKey.getPublicKey());
+    s->startAllNodes();
+    s->crankForAtLeast(std::chrono::seconds(1), false);
+
+    auto p0 = n0->getOverlayManager().getConnectedPeer(
+        PeerBareAddress{"127.0.0.1", n1->getConfig().PEER_PORT});
+    REQUIRE(p0);
+    REQUIRE(p0->isAuthenticated());
+
+    auto& qSets = n1->getMetrics().NewTimer({"overlay", "recv", "scp-qset"});
+    auto& dontHave =
+        n0->getMetrics().NewTimer({"overlay", "recv", "dont-have"});
+    auto& allocs = n1->getMetrics().NewMeter(
+        {"overlay", "read", "slab-alloc"}, "allocation");
+    auto qSetsBefore = qSets.count();
+    auto dontHaveBefore = dontHave.count();
+    auto allocsBefore = allocs.count();
+
+    // a quorum set that does not fit the default slab, keys take 36 bytes
+    StellarMessage big;
+    big.type(SCP_QUORUMSET);
+    big.qSet().threshold = 1;
+    for (size_t i = 0; i <= READ_SLAB_SIZE / 36; ++i)
+    {
+        PublicKey key;
+        key.ed25519() = sha256(std::to_string(i));
+        big.qSet().validators.push_back(key);
+    }
+    REQUIRE(xdr::xdr_size(big) > READ_SLAB_SIZE);
+    p0->sendMessage(big);
+    s->crankUntil([&]() { return qSets.count() == qSetsBefore + 1; },
+                  std::chrono::seconds(10), false);
+    REQUIRE(qSets.count() == qSetsBefore + 1);
+
+    // the slab grew for it, then went back to the default size
+    REQUIRE(allocs.count() == allocsBefore + 2);
+
+    // and the connection keeps working from the small slab
+    size_t const n = 100;
+    uint256 qSetHash;
+    for (size_t i = 0; i < n; ++i)
+    {
+        qSetHash[i % qSetHash.size()]++;
+        p0->sendGetQuorumSet(qSetHash);
+    }
+    s->crankUntil([&]() { return dontHave.count() == dontHaveBefore + n; },
+                  std::chrono::seconds(10), false);
+    REQUIRE(dontHave.count() == dontHaveBefore + n);
+    REQUIRE(p0->isAuthenticated());
+    REQUIRE(allocs.count() == allocsBefore + 2);
+    s->stopAllNodes();
+}
+
+TEST_CASE("TCPPeer sends SCP traffic ahead of queued transactions",
+          "[overlay]")
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer s =
+        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+
+    auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
+    auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
+
+    SCPQuorumSet n0_qset;
+    n0_qset.threshold = 1;
+    n0_qset.validators.push_back(v10SecretKey.getPublicKey());
+    auto n0 = s->addNode(v10SecretKey, n0_qset);
+
+    SCPQuorumSet n1_qset;
+    n1_qset.threshold = 1;
+    n1_qset.validators.push_back(v11SecretKey.getPublicKey());
+    auto n1 = s->addNode(v11SecretKey, n1_qset);
+
+    s->addPendingConnection(v10SecretKey.getPublicKey(),
+                            v11SecretKey.getPublicKey());
+    s->startAllNodes();
+    s->crankForAtLeast(std::chrono::seconds(1), false);
+
+    auto p0 = n0->getOverlayManager().getConnectedPeer(
+        PeerBareAddress{"127.0.0.1", n1->getConfig().PEER_PORT});
+    REQUIRE(p0);
+    REQUIRE(p0->isAuthenticated());
+
+    auto& scpLane = n0->getMetrics().NewTimer({"overlay", "send-lane", "scp"});
+    auto& floodLane =
+        n0->getMetrics().NewTimer({"overlay", "send-lane", "flood"});
+    auto& recvTx =
+        n1->getMetrics().NewTimer({"overlay", "recv", "transaction"});
+    auto& recvScpState =
+        n1->getMetrics().NewTimer({"overlay", "recv", "get-scp-state"});
+    auto scpBefore = scpLane.count();
+    auto floodBefore = floodLane.count();
+    auto recvTxBefore = recvTx.count();
+    auto recvScpStateBefore = recvScpState.count();
+
+    // a transaction backlog, then one SCP request behind it
+    size_t const n = 2000;
+    StellarMessage tx;
+    tx.type(TRANSACTION);
+    for (size_t i = 0; i < n; ++i)
+    {
+        tx.transaction().tx.seqNum = i;
+        p0->sendMessage(tx);
+    }
+    p0->sendGetScpState(0);
+
+    s->crankUntil([&]() { return scpLane.count() == scpBefore + 1; },
+                  std::chrono::seconds(10), false);
+    REQUIRE(scpLane.count() == scpBefore + 1);
+    // the SCP request overtook (nearly) all of the backlog
+    REQUIRE(floodLane.count() - floodBefore < n / 2);
+
+    // reordering on the wire keeps the MAC sequence intact
+    s->crankUntil(
+        [&]() {
+            return recvTx.count() == recvTxBefore + n &&
+                   recvScpState.count() == recvScpStateBefore + 1;
+        },
+        std::chrono::seconds(20), false);
+    REQUIRE(recvTx.count() == recvTxBefore + n);
+    REQUIRE(recvScpState.count() == recvScpStateBefore + 1);
+    REQUIRE(p0->isAuthenticated());
+    s->stopAllNodes();
+}
 }
@@ -62,7 +62,11 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex)
             iter++;
         }
     }
-    if (!mWaitingEnvelopes.empty())
+    if (mLastAdvertSlotIndex < slotIndex)
+    {
+        mAdvertisingPeers.clear();
+    }
+    if (!mWaitingEnvelopes.empty() || !mAdvertisingPeers.empty())
     {
         return true;
     }
@@ -99,7 +103,8 @@ Tracker::tryNextPeer()
     // currently asking peers, build a new list
     if (mPeersToAsk.empty() && !mLastAskedPeer)
     {
-        std::set<std::shared_ptr<Peer>> peersWithEnvelope;
+        std::set<std::shared_ptr<Peer>> peersWithEnvelope(
+            mAdvertisingPeers.begin(), mAdvertisingPeers.end());
         for (auto const& e : mWaitingEnvelopes)
         {
             auto const& s = mApp.getOverlayManager().getPeersKnows(e.first);
@@ -107,7 +112,8 @@ Tracker::tryNextPeer()
         }
 
         // move the peers that have the envelope to the back,
-        // to be processed first
+        // to be processed first; if only adverts are waiting, nobody else
+        // claimed to have the item so only ask those
         for (auto const& p :
              mApp.getOverlayManager().getRandomAuthenticatedPeers())
         {
@@ -115,7 +121,7 @@ Tracker::tryNextPeer()
             {
                 mPeersToAsk.emplace_back(p);
             }
-            else
+            else if (!mWaitingEnvelopes.empty())
             {
                 mPeersToAsk.emplace_front(p);
             }
@@ -180,6 +186,21 @@ Tracker::listen(const SCPEnvelope& env)
         std::make_pair(sha256(xdr::xdr_to_opaque(m)), env));
 }
 
+void
+Tracker::listenAdvert(Peer::pointer peer, uint64 slotIndex)
+{
+    mLastSeenSlotIndex = std::max(slotIndex, mLastSeenSlotIndex);
+    mLastAdvertSlotIndex = std::max(slotIndex, mLastAdvertSlotIndex);
+    mAdvertisingPeers.insert(peer);
+}
+
+void
+Tracker::clearAdverts()
+{
+    mAdvertisingPeers.clear();
+    mLastAdvertSlotIndex = 0;
+}
+
 void
 Tracker::discard(const SCPEnvelope& env)
 {
@@ -18,6 +18,10 @@
  * fully resolved. When data is received each envelope is resend to Herder
  * so it can check if it has all required data and then process envelope.
  * @see listen(Peer::pointer) is used to add envelopes to that list.
+ *
+ * Alternatively (for pull-mode transaction flooding) a Tracker can be fed
+ * with peers that advertised the data, @see listenAdvert. Those peers are
+ * asked first and, if no envelope is waiting, exclusively.
  */
 
 #include "overlay/Peer.h"
@@ -25,6 +29,7 @@
 #include "xdr/Stellar-types.h"
 
 #include <functional>
+#include <set>
 #include <utility>
 #include <vector>
 
@@ -45,6 +50,8 @@ class Tracker
     std::deque<Peer::pointer> mPeersToAsk;
     VirtualTimer mTimer;
     std::vector<std::pair<Hash, SCPEnvelope>> mWaitingEnvelopes;
+    std::set<Peer::pointer> mAdvertisingPeers;
+    uint64 mLastAdvertSlotIndex{0};
     Hash mItemHash;
     medida::Meter& mTryNextPeerReset;
     medida::Meter& mTryNextPeer;
@@ -67,6 +74,16 @@ class Tracker
         return mWaitingEnvelopes.empty();
     }
 
+    /**
+     * Return true if some peer advertised the data and it was not received
+     * yet.
+     */
+    bool
+    hasAdverts() const
+    {
+        return !mAdvertisingPeers.empty();
+    }
+
     /**
      * Return list of envelopes this tracker is waiting for.
      */
@@ -92,9 +109,9 @@ class Tracker
 
     /**
      * Called periodically to remove old envelopes from list (with ledger id
-     * below some @p slotIndex).
+     * below some @p slotIndex), and adverts last seen below it.
      *
-     * Returns true if at least one envelope remained in list.
+     * Returns true if at least one envelope or advert remained.
      */
     bool clearEnvelopesBelow(uint64 slotIndex);
 
@@ -104,6 +121,16 @@ class Tracker
      */
     void listen(const SCPEnvelope& env);
 
+    /**
+     * Note that @p peer advertised the data during ledger @p slotIndex.
+     */
+    void listenAdvert(Peer::pointer peer, uint64 slotIndex);
+
+    /**
+     * Forget all adverts, the data was received.
+     */
+    void clearAdverts();
+
     /**
      * Stops tracking envelope @p env.
      */
@@ -419,6 +419,32 @@ TEST_CASE("Auto-calibrated single node load test", "[autoload][hide]")
     }
 }
 
+TEST_CASE("Open-loop single node load test", "[autoload][hide]")
+{
+    VirtualClock clock(VirtualClock::REAL_TIME);
+    auto appPtr = newLoadTestApp(clock);
+    auto& io = clock.getIOService();
+    asio::io_service::work mainWork(io);
+    auto& complete =
+        appPtr->getMetrics().NewMeter({"loadgen", "run", "complete"}, "run");
+
+    appPtr->generateLoad(1000, 100, 100, false);
+    while (!io.stopped() && complete.count() == 0)
+    {
+        clock.crank();
+    }
+
+    auto& lg = appPtr->getLoadGenerator();
+    REQUIRE(lg.generateOpenLoopLoad(*appPtr, 10000, 200));
+    while (!io.stopped() && complete.count() == 1)
+    {
+        clock.crank();
+    }
+    LOG(INFO) << lg.openLoopLatencyReport(*appPtr);
+    auto& latency = appPtr->getMetrics().NewTimer({"loadgen", "tx", "latency"});
+    REQUIRE(latency.count() > 0);
+}
+
 class ScaleReporter
 {
     std::vector<std::string> mColumns;
@@ -661,6 +687,22 @@ TEST_CASE("Mesh nodes vs. network traffic", "[scalability][hide]")
         });
 }
 
+TEST_CASE("Mesh nodes vs. network traffic, pull mode", "[scalability][hide]")
+{
+    netTopologyTest(
+        "meshpull", [&](int numNodes, int& cfgCount) -> Simulation::pointer {
+            return Topologies::core(
+                numNodes, 1.0, Simulation::OVER_LOOPBACK,
+                sha256(fmt::format("nodes-{:d}", numNodes)), [&]() -> Config {
+                    Config res = getTestConfig(cfgCount++);
+                    res.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = true;
+                    res.MAX_PEER_CONNECTIONS = 1000;
+                    res.FLOOD_TX_PULL_MODE = true;
+                    return res;
+                });
+        });
+}
+
 TEST_CASE("Cycle nodes vs. network traffic", "[scalability][hide]")
 {
     netTopologyTest(
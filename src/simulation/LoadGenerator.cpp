@@ -10,12 +10,15 @@
 #include "overlay/OverlayManager.h"
 #include "test/TestAccount.h"
 #include "test/TxTests.h"
+#include "util/LatencyHistogram.h"
 #include "util/Logging.h"
 #include "util/Math.h"
 #include "util/Timer.h"
 #include "util/make_unique.h"
+#include "util/format.h"
 #include "util/types.h"
 
+#include "crypto/Hex.h"
 #include "database/Database.h"
 
 #include "transactions/AllowTrustOpFrame.h"
@@ -31,10 +34,13 @@
 
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <set>
+#include <thread>
 
 namespace stellar
 {
@@ -54,7 +60,7 @@ static const uint64_t LOADGEN_TRUSTLINE_LIMIT = 1000 * LOADGEN_ACCOUNT_BALANCE;
 const uint32_t LoadGenerator::STEP_MSECS = 100;
 
 LoadGenerator::LoadGenerator(Hash const& networkID)
-    : mMinBalance(0), mLastSecond(0)
+    : mMinBalance(0), mLastSecond(0), mLastTxApplied(0)
 {
     // Root account gets enough XLM to create 10 million (10^7) accounts, which
     // thereby uses up 7 + 3 + 7 = 17 decimal digits. Luckily we have 2^63 =
@@ -231,6 +237,7 @@ LoadGenerator::clear()
     mAccounts.clear();
     mGateways.clear();
     mMarketMakers.clear();
+    mLastRateTime = VirtualClock::time_point();
 }
 
 // Generate one "step" worth of load (assuming 1 step per STEP_MSECS) at a
@@ -246,6 +253,16 @@ LoadGenerator::generateLoad(Application& app, uint32_t nAccounts, uint32_t nTxs,
 
     updateMinBalance(app);
 
+    // the first step of a run: the applied transaction rate is measured from
+    // here
+    if (mLastRateTime == VirtualClock::time_point())
+    {
+        mLastRateTime = app.getClock().now();
+        mLastTxApplied = app.getLatencyMetrics()
+                             .NewHistogram({"ledger", "transaction", "apply"})
+                             .count();
+    }
+
     if (txRate == 0)
     {
         txRate = 1;
@@ -436,23 +453,34 @@ LoadGenerator::generateLoad(Application& app, uint32_t nAccounts, uint32_t nTxs,
             using namespace std::chrono;
 
             auto& m = app.getMetrics();
-            auto& applyTx = m.NewTimer({"ledger", "transaction", "apply"});
+            auto& applyTx = app.getLatencyMetrics().NewHistogram(
+                {"ledger", "transaction", "apply"});
             auto& applyOp = m.NewTimer({"transaction", "op", "apply"});
 
             auto step1ms = duration_cast<milliseconds>(build).count();
             auto step2ms = duration_cast<milliseconds>(recv).count();
             auto totalms = duration_cast<milliseconds>(build + recv).count();
 
+            // applyTx keeps no rates, so take the one since the last message
+            auto txApplied = applyTx.count();
+            auto clockNow = app.getClock().now();
+            double elapsed =
+                duration<double>(clockNow - mLastRateTime).count();
+            double txApplyRate =
+                elapsed > 0 ? (txApplied - mLastTxApplied) / elapsed : 0;
+            mLastTxApplied = txApplied;
+            mLastRateTime = clockNow;
+
             uint32_t etaSecs = (uint32_t)(((double)(nTxs + nAccounts)) /
-                                          applyTx.one_minute_rate());
+                                          std::max(txApplyRate, 1.0));
             uint32_t etaHours = etaSecs / 3600;
             uint32_t etaMins = etaSecs % 60;
 
             CLOG(INFO, "LoadGen")
                 << "Tx/s: " << txRate << " target"
                 << (autoRate ? " (auto), " : ", ") << std::setprecision(3)
-                << applyTx.one_minute_rate() << "tx/"
-                << applyOp.one_minute_rate() << "op actual (1m EWMA)."
+                << txApplyRate << "tx actual, " << applyOp.one_minute_rate()
+                << "op actual (1m EWMA)."
                 << " Pending: " << nAccounts << " acct, " << nTxs << " tx."
                 << " ETA: " << etaHours << "h" << etaMins << "m";
 
@@ -471,6 +499,319 @@ LoadGenerator::generateLoad(Application& app, uint32_t nAccounts, uint32_t nTxs,
     }
 }
 
+LoadGenerator::OpenLoopState::OpenLoopState(VirtualClock& clock)
+    : mRun(0)
+    , mTxsLeft(0)
+    , mTxRate(0)
+    , mNextArrival(clock.now())
+    , mTimer(clock)
+    , mSigning(0)
+    , mChunksIssued(0)
+    , mNextChunk(0)
+    , mLastLedgerSeen(0)
+{
+}
+
+void
+LoadGenerator::OpenLoopState::addSignedChunk(uint64_t chunk,
+                                             std::vector<SignedTx> txs)
+{
+    mSigning -= txs.size();
+    mSignedChunks.emplace(chunk, std::move(txs));
+    for (auto it = mSignedChunks.begin();
+         it != mSignedChunks.end() && it->first == mNextChunk;
+         it = mSignedChunks.erase(it), ++mNextChunk)
+    {
+        for (auto& t : it->second)
+        {
+            mPool.emplace_back(std::move(t));
+        }
+    }
+}
+
+bool
+LoadGenerator::generateOpenLoopLoad(Application& app, uint32_t nTxs,
+                                    uint32_t txRate)
+{
+    if (mAccounts.size() < 2)
+    {
+        return false;
+    }
+    if (!mOpenLoop)
+    {
+        mOpenLoop = std::make_shared<OpenLoopState>(app.getClock());
+    }
+
+    auto& ol = *mOpenLoop;
+    ol.mRun++;
+    ol.mTxsLeft = nTxs;
+    ol.mTxRate = std::max(txRate, 1U);
+    ol.mNextArrival = app.getClock().now();
+    ol.mPool.clear();
+    ol.mSigning = 0;
+    ol.mChunksIssued = 0;
+    ol.mNextChunk = 0;
+    ol.mSignedChunks.clear();
+    ol.mLastLedgerSeen = app.getLedgerManager().getLastClosedLedgerNum();
+
+    CLOG(INFO, "LoadGen") << "Starting open-loop load: " << nTxs << " txs at "
+                          << ol.mTxRate << " tx/s";
+    refillOpenLoopPool(app);
+    stepOpenLoop(app);
+    return true;
+}
+
+// Keeps about a second worth of signed transactions ready. Envelopes are
+// built here, on the main thread, as they depend on loadgen account state and
+// the ledger's fee; hashing and signing them is what takes time, and that is
+// spread over the worker threads.
+void
+LoadGenerator::refillOpenLoopPool(Application& app)
+{
+    auto& ol = *mOpenLoop;
+    size_t target = std::max<size_t>(ol.mTxRate, 100);
+    size_t have = ol.mPool.size() + ol.mSigning;
+    if (have >= ol.mTxsLeft || have > target / 2)
+    {
+        return;
+    }
+    size_t n = std::min<size_t>(target, ol.mTxsLeft) - have;
+
+    uint32_t ledgerNum = app.getLedgerManager().getLedgerNum();
+    uint32_t fee = app.getLedgerManager().getTxFee();
+    std::vector<AccountInfoPtr> usable;
+    for (auto const& a : mAccounts)
+    {
+        if (a->canUseInLedger(ledgerNum))
+        {
+            usable.push_back(a);
+        }
+    }
+    if (usable.size() < 2)
+    {
+        return;
+    }
+
+    struct Unsigned
+    {
+        AccountInfoPtr mFrom;
+        SecretKey mKey;
+        TransactionEnvelope mEnvelope;
+    };
+    auto batch = std::make_shared<std::vector<Unsigned>>();
+    batch->reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto from = rand_element(usable);
+        auto to = from;
+        while (to == from)
+        {
+            to = rand_element(usable);
+        }
+        Unsigned u;
+        u.mFrom = from;
+        u.mKey = from->mKey;
+        u.mEnvelope.tx.sourceAccount = from->mKey.getPublicKey();
+        u.mEnvelope.tx.fee = fee;
+        u.mEnvelope.tx.seqNum = ++from->mSeq;
+        u.mEnvelope.tx.operations.push_back(
+            txtest::payment(to->mKey.getPublicKey(), rand_uniform(1, 100)));
+        batch->emplace_back(std::move(u));
+    }
+
+    size_t nWorkers = std::max(1U, std::thread::hardware_concurrency());
+    size_t chunk = (n + nWorkers - 1) / nWorkers;
+    auto run = ol.mRun;
+    auto networkID = app.getNetworkID();
+    auto& signTimer = app.getMetrics().NewTimer({"loadgen", "pool", "sign"});
+    auto& mainIO = app.getClock().getIOService();
+    std::weak_ptr<OpenLoopState> alive = mOpenLoop;
+    ol.mSigning += n;
+    for (size_t begin = 0; begin < n; begin += chunk)
+    {
+        size_t end = std::min(n, begin + chunk);
+        auto chunkIndex = ol.mChunksIssued++;
+        app.getWorkerIOService().post([&mainIO, &signTimer, alive, batch,
+                                       begin, end, chunkIndex, run,
+                                       networkID]() {
+            if (alive.expired())
+            {
+                return;
+            }
+            auto signScope = signTimer.TimeScope();
+            auto signedTxs =
+                std::make_shared<std::vector<OpenLoopState::SignedTx>>();
+            for (size_t i = begin; i < end; ++i)
+            {
+                auto& u = (*batch)[i];
+                auto tx = TransactionFrame::makeTransactionFromWire(
+                    networkID, u.mEnvelope);
+                tx->addSignature(u.mKey);
+                signedTxs->emplace_back(u.mFrom, tx);
+            }
+            signScope.Stop();
+            mainIO.post([alive, chunkIndex, run, signedTxs]() {
+                auto ol = alive.lock();
+                if (!ol || ol->mRun != run)
+                {
+                    return;
+                }
+                ol->addSignedChunk(chunkIndex, std::move(*signedTxs));
+            });
+        });
+    }
+}
+
+// Submits every transaction whose arrival time has passed. An arrival that
+// finds the pool empty is counted as an underrun and skipped rather than
+// delayed, so that the offered load stays independent of the node.
+void
+LoadGenerator::stepOpenLoop(Application& app)
+{
+    auto& ol = *mOpenLoop;
+    auto& m = app.getMetrics();
+    auto& submitted = m.NewMeter({"loadgen", "tx", "submitted"}, "tx");
+    auto& underrun = m.NewMeter({"loadgen", "pool", "underrun"}, "tx");
+    TxMetrics txm(m);
+
+    std::exponential_distribution<double> interArrival(ol.mTxRate);
+    auto now = app.getClock().now();
+    uint32_t ledgerNum = app.getLedgerManager().getLedgerNum();
+    while (ol.mTxsLeft > 0 && ol.mNextArrival <= now)
+    {
+        ol.mTxsLeft--;
+        ol.mNextArrival +=
+            std::chrono::duration_cast<VirtualClock::duration>(
+                std::chrono::duration<double>(interArrival(gRandomEngine)));
+        if (ol.mPool.empty())
+        {
+            underrun.Mark();
+            continue;
+        }
+
+        auto from = ol.mPool.front().first;
+        auto tx = ol.mPool.front().second;
+        ol.mPool.pop_front();
+        txm.mTxnAttempted.Mark();
+        submitted.Mark();
+        if (app.getHerder().recvTransaction(tx) == Herder::TX_STATUS_PENDING)
+        {
+            ol.mInFlight.emplace(tx->getContentsHash(),
+                                 std::make_pair(now, ledgerNum));
+        }
+        else
+        {
+            // later pooled transactions from this account are most likely
+            // lost too, but new ones will be built from its actual sequence
+            // number
+            txm.mTxnRejected.Mark();
+            loadAccount(app, from);
+        }
+    }
+
+    checkOpenLoopExternalized(app);
+
+    if (ol.mTxsLeft > 0)
+    {
+        refillOpenLoopPool(app);
+        VirtualClock::time_point soonest = now + std::chrono::milliseconds(1);
+        ol.mTimer.expires_at(std::max(ol.mNextArrival, soonest));
+    }
+    else if (!ol.mInFlight.empty())
+    {
+        ol.mTimer.expires_from_now(std::chrono::milliseconds(STEP_MSECS));
+    }
+    else
+    {
+        CLOG(INFO, "LoadGen") << "Open-loop load generation complete. "
+                              << openLoopLatencyReport(app);
+        m.NewMeter({"loadgen", "run", "complete"}, "run").Mark();
+        return;
+    }
+
+    auto run = ol.mRun;
+    ol.mTimer.async_wait([this, &app, run](asio::error_code const& error) {
+        if (!error && mOpenLoop && mOpenLoop->mRun == run)
+        {
+            stepOpenLoop(app);
+        }
+    });
+}
+
+// Matches newly closed ledgers against the in-flight transactions. The
+// latency is taken when the close is noticed here, which is at most one
+// arrival interval (or STEP_MSECS, once all transactions are out) late.
+void
+LoadGenerator::checkOpenLoopExternalized(Application& app)
+{
+    // transactions not in a ledger after this many closes are given up on
+    static const uint32_t MAX_LEDGERS_IN_FLIGHT = 10;
+
+    auto& ol = *mOpenLoop;
+    auto lcl = app.getLedgerManager().getLastClosedLedgerNum();
+    if (lcl == ol.mLastLedgerSeen)
+    {
+        return;
+    }
+
+    auto& m = app.getMetrics();
+    auto& latency = m.NewTimer({"loadgen", "tx", "latency"});
+    auto& lost = m.NewMeter({"loadgen", "tx", "lost"}, "tx");
+    auto now = app.getClock().now();
+    auto& db = app.getDatabase();
+
+    std::string txid;
+    for (uint32_t seq = ol.mLastLedgerSeen + 1; seq <= lcl; ++seq)
+    {
+        auto prep = db.getPreparedStatement(
+            "SELECT txid FROM txhistory WHERE ledgerseq = :seq");
+        auto& st = prep.statement();
+        st.exchange(soci::into(txid));
+        st.exchange(soci::use(seq));
+        st.define_and_bind();
+        {
+            auto timer = db.getSelectTimer("txhistory");
+            st.execute(true);
+        }
+        while (st.got_data())
+        {
+            auto it = ol.mInFlight.find(hexToBin256(txid));
+            if (it != ol.mInFlight.end())
+            {
+                latency.Update(now - it->second.first);
+                ol.mInFlight.erase(it);
+            }
+            st.fetch();
+        }
+    }
+    ol.mLastLedgerSeen = lcl;
+
+    for (auto it = ol.mInFlight.begin(); it != ol.mInFlight.end();)
+    {
+        if (it->second.second + MAX_LEDGERS_IN_FLIGHT < lcl)
+        {
+            lost.Mark();
+            it = ol.mInFlight.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+std::string
+LoadGenerator::openLoopLatencyReport(Application& app)
+{
+    auto& latency = app.getMetrics().NewTimer({"loadgen", "tx", "latency"});
+    auto snap = latency.GetSnapshot();
+    return fmt::format("Submit to externalize latency over {:d} txs: "
+                       "p50 {:.0f}ms, p90 {:.0f}ms, p99 {:.0f}ms, "
+                       "max {:.0f}ms",
+                       latency.count(), snap.getMedian(), snap.getValue(0.9),
+                       snap.get99thPercentile(), latency.max());
+}
+
 void
 LoadGenerator::updateMinBalance(Application& app)
 {
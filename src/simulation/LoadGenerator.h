@@ -7,7 +7,13 @@
 #include "crypto/SecretKey.h"
 #include "main/Application.h"
 #include "test/TxTests.h"
+#include "util/HashOfHash.h"
+#include "util/Timer.h"
 #include "xdr/Stellar-types.h"
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace medida
@@ -21,8 +27,6 @@ class Timer;
 namespace stellar
 {
 
-class VirtualTimer;
-
 class LoadGenerator
 {
   public:
@@ -49,6 +53,10 @@ class LoadGenerator
     std::unique_ptr<VirtualTimer> mLoadTimer;
     int64 mMinBalance;
     uint64_t mLastSecond;
+    // applied transaction count, and when it was taken, as of the last rate
+    // report; the time is unset between runs
+    uint64_t mLastTxApplied;
+    VirtualClock::time_point mLastRateTime;
 
     // Schedule a callback to generateLoad() STEP_MSECS miliseconds from now.
     void scheduleLoadGeneration(Application& app, uint32_t nAccounts,
@@ -61,6 +69,18 @@ class LoadGenerator
     void generateLoad(Application& app, uint32_t nAccounts, uint32_t nTxs,
                       uint32_t txRate, bool autoRate);
 
+    // Open-loop load: payments between existing loadgen accounts are built
+    // in pools ahead of time and signed on the worker threads, then submitted
+    // at Poisson-distributed arrival times averaging txRate per second, no
+    // matter how fast the node takes them. The time from submission to the
+    // ledger that includes each transaction goes to loadgen.tx.latency.
+    // Returns false if there are not enough loadgen accounts to pay between.
+    bool generateOpenLoopLoad(Application& app, uint32_t nTxs,
+                              uint32_t txRate);
+
+    // Percentiles of loadgen.tx.latency, for the http command.
+    std::string openLoopLatencyReport(Application& app);
+
     bool maybeCreateAccount(uint32_t ledgerNum, std::vector<TxInfo>& txs);
 
     std::vector<TxInfo> accountCreationTransactions(size_t n);
@@ -154,6 +174,45 @@ class LoadGenerator
         void report();
     };
 
+    struct OpenLoopState
+    {
+        OpenLoopState(VirtualClock& clock);
+
+        // Bumped on every run so that pools signed for a previous run are
+        // dropped when they come back from the worker threads.
+        uint32_t mRun;
+        uint32_t mTxsLeft;
+        uint32_t mTxRate;
+        VirtualClock::time_point mNextArrival;
+        VirtualTimer mTimer;
+
+        using SignedTx = std::pair<AccountInfoPtr, TransactionFramePtr>;
+        std::deque<SignedTx> mPool;
+        size_t mSigning;
+        // Chunks are numbered as they are handed to the workers, and join the
+        // pool in that order, so that transactions from one account are
+        // submitted in sequence number order whichever worker finishes first.
+        uint64_t mChunksIssued;
+        uint64_t mNextChunk;
+        std::map<uint64_t, std::vector<SignedTx>> mSignedChunks;
+
+        void addSignedChunk(uint64_t chunk, std::vector<SignedTx> txs);
+
+        // Submitted transactions by contents hash, with submission time and
+        // the ledger that was open at the time.
+        std::unordered_map<Hash,
+                           std::pair<VirtualClock::time_point, uint32_t>>
+            mInFlight;
+        uint32_t mLastLedgerSeen;
+    };
+    // shared so that signing posted to the worker threads can tell if the
+    // load generator is still around
+    std::shared_ptr<OpenLoopState> mOpenLoop;
+
+    void refillOpenLoopPool(Application& app);
+    void stepOpenLoop(Application& app);
+    void checkOpenLoopExternalized(Application& app);
+
     struct TxInfo
     {
         AccountInfoPtr mFrom;
@@ -1,4 +1,4 @@
 # This file was generated by make-mks; don't edit it by hand.
-SRC_H_FILES = bucket/Bucket.h bucket/BucketApplicator.h bucket/BucketInputIterator.h bucket/BucketList.h bucket/BucketManager.h bucket/BucketManagerImpl.h bucket/BucketOutputIterator.h bucket/FutureBucket.h bucket/LedgerCmp.h bucket/PublishQueueBuckets.h catchup/ApplyBucketsWork.h catchup/ApplyLedgerChainWork.h catchup/CatchupConfiguration.h catchup/CatchupManager.h catchup/CatchupManagerImpl.h catchup/CatchupWork.h catchup/CatchupWorkTests.h catchup/DownloadBucketsWork.h catchup/VerifyLedgerChainWork.h crypto/ByteSlice.h crypto/ECDH.h crypto/Hex.h crypto/KeyUtils.h crypto/Random.h crypto/SHA.h crypto/SecretKey.h crypto/SignerKey.h crypto/SignerKeyUtils.h crypto/StrKey.h database/Database.h database/DatabaseConnectionString.h database/DatabaseUtils.h herder/Herder.h herder/HerderImpl.h herder/HerderPersistence.h herder/HerderPersistenceImpl.h herder/HerderSCPDriver.h herder/HerderUtils.h herder/LedgerCloseData.h herder/PendingEnvelopes.h herder/TxSetFrame.h herder/Upgrades.h history/FileTransferInfo.h history/HistoryArchive.h history/HistoryManager.h history/HistoryManagerImpl.h history/HistoryTestsUtils.h history/InferredQuorum.h history/StateSnapshot.h historywork/BatchDownloadWork.h historywork/BucketDownloadWork.h historywork/FetchRecentQsetsWork.h historywork/GetAndUnzipRemoteFileWork.h historywork/GetHistoryArchiveStateWork.h historywork/GetRemoteFileWork.h historywork/GunzipFileWork.h historywork/GzipFileWork.h historywork/MakeRemoteDirWork.h historywork/Progress.h historywork/PublishWork.h historywork/PutHistoryArchiveStateWork.h historywork/PutRemoteFileWork.h historywork/PutSnapshotFilesWork.h historywork/RepairMissingBucketsWork.h historywork/ResolveSnapshotWork.h historywork/RunCommandWork.h historywork/VerifyBucketWork.h historywork/WriteSnapshotWork.h invariant/AccountSubEntriesCountIsValid.h invariant/BucketListIsConsistentWithDatabase.h invariant/CacheIsConsistentWithDatabase.h invariant/ConservationOfLumens.h invariant/Invariant.h invariant/InvariantDoesNotHold.h invariant/InvariantManager.h invariant/InvariantManagerImpl.h invariant/InvariantTestUtils.h invariant/LedgerEntryIsValid.h invariant/MinimumAccountBalance.h ledger/AccountFrame.h ledger/CheckpointRange.h ledger/DataFrame.h ledger/EntryFrame.h ledger/LedgerDelta.h ledger/LedgerHeaderFrame.h ledger/LedgerManager.h ledger/LedgerManagerImpl.h ledger/LedgerRange.h ledger/LedgerTestUtils.h ledger/OfferFrame.h ledger/SyncingLedgerChain.h ledger/TrustFrame.h main/Application.h main/ApplicationImpl.h main/CommandHandler.h main/Config.h main/ExternalQueue.h main/Maintainer.h main/ManagedDataCache.h main/NtpSynchronizationChecker.h main/PersistentState.h main/StellarCoreVersion.h main/Whitelist.h main/dumpxdr.h main/fuzz.h overlay/BanManager.h overlay/BanManagerImpl.h overlay/Floodgate.h overlay/ItemFetcher.h overlay/LoadManager.h overlay/LoopbackPeer.h overlay/OverlayManager.h overlay/OverlayManagerImpl.h overlay/Peer.h overlay/PeerAuth.h overlay/PeerBareAddress.h overlay/PeerDoor.h overlay/PeerRecord.h overlay/StellarXDR.h overlay/TCPPeer.h overlay/Tracker.h process/ProcessManager.h process/ProcessManagerImpl.h scp/BallotProtocol.h scp/LocalNode.h scp/NominationProtocol.h scp/QuorumSetUtils.h scp/SCP.h scp/SCPDriver.h scp/Slot.h simulation/LoadGenerator.h simulation/Simulation.h simulation/Topologies.h test/SimpleTestReporter.h test/TestAccount.h test/TestExceptions.h test/TestMarket.h test/TestPrinter.h test/TestUtils.h test/TxTests.h test/test.h transactions/AllowTrustOpFrame.h transactions/ChangeTrustOpFrame.h transactions/CreateAccountOpFrame.h transactions/CreatePassiveOfferOpFrame.h transactions/InflationOpFrame.h transactions/ManageDataOpFrame.h transactions/ManageOfferOpFrame.h transactions/MergeOpFrame.h transactions/OfferExchange.h transactions/OperationFrame.h transactions/PathPaymentOpFrame.h transactions/PaymentOpFrame.h transactions/SetOptionsOpFrame.h transactions/SignatureChecker.h transactions/SignatureUtils.h transactions/TransactionFrame.h util/Algoritm.h util/BitsetEnumerator.h util/Fs.h util/GlobalChecks.h util/HashOfHash.h util/Logging.h util/Math.h util/NonCopyable.h util/NtpClient.h util/NtpWork.h util/SecretValue.h util/SociNoWarnings.h util/StatusManager.h util/Timer.h util/TmpDir.h util/XDRStream.h util/asio.h util/make_unique.h util/must_use.h util/optional.h util/types.h work/Work.h work/WorkManager.h work/WorkManagerImpl.h work/WorkParent.h
-SRC_CXX_FILES = bucket/Bucket.cpp bucket/BucketApplicator.cpp bucket/BucketInputIterator.cpp bucket/BucketList.cpp bucket/BucketManagerImpl.cpp bucket/BucketOutputIterator.cpp bucket/BucketTests.cpp bucket/FutureBucket.cpp bucket/PublishQueueBuckets.cpp catchup/ApplyBucketsWork.cpp catchup/ApplyLedgerChainWork.cpp catchup/CatchupConfiguration.cpp catchup/CatchupManagerImpl.cpp catchup/CatchupWork.cpp catchup/CatchupWorkTests.cpp catchup/DownloadBucketsWork.cpp catchup/VerifyLedgerChainWork.cpp crypto/CryptoTests.cpp crypto/ECDH.cpp crypto/Hex.cpp crypto/KeyUtils.cpp crypto/Random.cpp crypto/SHA.cpp crypto/SecretKey.cpp crypto/SignerKey.cpp crypto/SignerKeyUtils.cpp crypto/StrKey.cpp database/Database.cpp database/DatabaseConnectionString.cpp database/DatabaseConnectionStringTest.cpp database/DatabaseTests.cpp database/DatabaseUtils.cpp herder/Herder.cpp herder/HerderImpl.cpp herder/HerderPersistenceImpl.cpp herder/HerderSCPDriver.cpp herder/HerderTests.cpp herder/HerderUtils.cpp herder/LedgerCloseData.cpp herder/PendingEnvelopes.cpp herder/PendingEnvelopesTests.cpp herder/TxSetFrame.cpp herder/Upgrades.cpp herder/UpgradesTests.cpp history/FileTransferInfo.cpp history/HistoryArchive.cpp history/HistoryManagerImpl.cpp history/HistoryTests.cpp history/HistoryTestsUtils.cpp history/InferredQuorum.cpp history/InferredQuorumTests.cpp history/SerializeTests.cpp history/StateSnapshot.cpp historywork/BatchDownloadWork.cpp historywork/BucketDownloadWork.cpp historywork/FetchRecentQsetsWork.cpp historywork/GetAndUnzipRemoteFileWork.cpp historywork/GetHistoryArchiveStateWork.cpp historywork/GetRemoteFileWork.cpp historywork/GunzipFileWork.cpp historywork/GzipFileWork.cpp historywork/MakeRemoteDirWork.cpp historywork/Progress.cpp historywork/PublishWork.cpp historywork/PutHistoryArchiveStateWork.cpp historywork/PutRemoteFileWork.cpp historywork/PutSnapshotFilesWork.cpp historywork/RepairMissingBucketsWork.cpp historywork/ResolveSnapshotWork.cpp historywork/RunCommandWork.cpp historywork/VerifyBucketWork.cpp historywork/WriteSnapshotWork.cpp invariant/AccountSubEntriesCountIsValid.cpp invariant/AccountSubEntriesCountIsValidTests.cpp invariant/BucketListIsConsistentWithDatabase.cpp invariant/BucketListIsConsistentWithDatabaseTests.cpp invariant/CacheIsConsistentWithDatabase.cpp invariant/CacheIsConsistentWithDatabaseTests.cpp invariant/ConservationOfLumens.cpp invariant/ConservationOfLumensTests.cpp invariant/InvariantDoesNotHold.cpp invariant/InvariantManagerImpl.cpp invariant/InvariantTestUtils.cpp invariant/InvariantTests.cpp invariant/LedgerEntryIsValid.cpp invariant/MinimumAccountBalance.cpp invariant/MinimumAccountBalanceTests.cpp ledger/AccountFrame.cpp ledger/CheckpointRange.cpp ledger/DataFrame.cpp ledger/EntryFrame.cpp ledger/LedgerDelta.cpp ledger/LedgerDeltaTests.cpp ledger/LedgerEntryTests.cpp ledger/LedgerHeaderFrame.cpp ledger/LedgerHeaderTests.cpp ledger/LedgerManagerImpl.cpp ledger/LedgerPerformanceTests.cpp ledger/LedgerRange.cpp ledger/LedgerTestUtils.cpp ledger/LedgerTests.cpp ledger/OfferFrame.cpp ledger/SyncingLedgerChain.cpp ledger/SyncingLedgerChainTests.cpp ledger/TrustFrame.cpp main/Application.cpp main/ApplicationImpl.cpp main/ApplicationTests.cpp main/CommandHandler.cpp main/Config.cpp main/ConfigTests.cpp main/ExternalQueue.cpp main/ExternalQueueTests.cpp main/LruCacheTests.cpp main/Maintainer.cpp main/ManagedDataCache.cpp main/NtpSynchronizationChecker.cpp main/PersistentState.cpp main/Whitelist.cpp main/dumpxdr.cpp main/fuzz.cpp main/main.cpp overlay/BanManagerImpl.cpp overlay/FloodTests.cpp overlay/Floodgate.cpp overlay/ItemFetcher.cpp overlay/ItemFetcherTests.cpp overlay/LoadManager.cpp overlay/LoadManagerTests.cpp overlay/LoopbackPeer.cpp overlay/OverlayManagerImpl.cpp overlay/OverlayManagerTests.cpp overlay/OverlayTests.cpp overlay/Peer.cpp overlay/PeerAuth.cpp overlay/PeerBareAddress.cpp overlay/PeerDoor.cpp overlay/PeerRecord.cpp overlay/PeerRecordTests.cpp overlay/TCPPeer.cpp overlay/TCPPeerTests.cpp overlay/Tracker.cpp overlay/TrackerTests.cpp process/ProcessManagerImpl.cpp process/ProcessTests.cpp scp/BallotProtocol.cpp scp/LocalNode.cpp scp/NominationProtocol.cpp scp/QuorumSetTests.cpp scp/QuorumSetUtils.cpp scp/SCP.cpp scp/SCPDriver.cpp scp/SCPTests.cpp scp/SCPUnitTests.cpp scp/Slot.cpp simulation/CoreTests.cpp simulation/LoadGenerator.cpp simulation/Simulation.cpp simulation/Topologies.cpp test/TestAccount.cpp test/TestExceptions.cpp test/TestMarket.cpp test/TestPrinter.cpp test/TestUtils.cpp test/TxTests.cpp test/test.cpp transactions/AllowTrustOpFrame.cpp transactions/AllowTrustTests.cpp transactions/ChangeTrustOpFrame.cpp transactions/ChangeTrustTests.cpp transactions/CreateAccountOpFrame.cpp transactions/CreatePassiveOfferOpFrame.cpp transactions/ExchangeTests.cpp transactions/InflationOpFrame.cpp transactions/InflationTests.cpp transactions/ManageDataOpFrame.cpp transactions/ManageDataTests.cpp transactions/ManageOfferOpFrame.cpp transactions/MergeOpFrame.cpp transactions/MergeTests.cpp transactions/OfferExchange.cpp transactions/OfferTests.cpp transactions/OperationFrame.cpp transactions/PathPaymentOpFrame.cpp transactions/PathPaymentTests.cpp transactions/PaymentOpFrame.cpp transactions/PaymentTests.cpp transactions/SetOptionsOpFrame.cpp transactions/SetOptionsTests.cpp transactions/SignatureChecker.cpp transactions/SignatureUtils.cpp transactions/SignatureUtilsTest.cpp transactions/TransactionFrame.cpp transactions/TxEnvelopeTests.cpp transactions/TxResultsTests.cpp util/BalanceTests.cpp util/BigDivideTests.cpp util/BitsetEnumerator.cpp util/BitsetEnumeratorTests.cpp util/Fs.cpp util/FsTests.cpp util/GlobalChecks.cpp util/HashOfHash.cpp util/Logging.cpp util/Math.cpp util/NtpClient.cpp util/NtpWork.cpp util/SecretValue.cpp util/StatusManager.cpp util/StatusManagerTest.cpp util/Timer.cpp util/TimerTests.cpp util/TmpDir.cpp util/Uint128Tests.cpp util/types.cpp work/Work.cpp work/WorkManagerImpl.cpp work/WorkParent.cpp work/WorkTests.cpp
+SRC_H_FILES = bucket/Bucket.h bucket/BucketApplicator.h bucket/BucketIndex.h bucket/BucketInputIterator.h bucket/BucketList.h bucket/BucketManager.h bucket/BucketManagerImpl.h bucket/BucketOutputIterator.h bucket/FutureBucket.h bucket/LedgerCmp.h bucket/PublishQueueBuckets.h catchup/ApplyBucketsWork.h catchup/ApplyLedgerChainWork.h catchup/CatchupConfiguration.h catchup/CatchupManager.h catchup/CatchupManagerImpl.h catchup/CatchupWork.h catchup/CatchupWorkTests.h catchup/DownloadBucketsWork.h catchup/VerifyLedgerChainWork.h crypto/ByteSlice.h crypto/ECDH.h crypto/Hex.h crypto/KeyUtils.h crypto/Random.h crypto/SHA.h crypto/SHA256Block.h crypto/SecretKey.h crypto/SignerKey.h crypto/SignerKeyUtils.h crypto/StrKey.h database/Database.h database/DatabaseConnectionString.h database/DatabaseUtils.h herder/Herder.h herder/HerderImpl.h herder/HerderPersistence.h herder/HerderPersistenceImpl.h herder/HerderSCPDriver.h herder/HerderUtils.h herder/LedgerCloseData.h herder/PendingEnvelopes.h herder/TxSetFrame.h herder/Upgrades.h history/FileTransferInfo.h history/HistoryArchive.h history/HistoryManager.h history/HistoryManagerImpl.h history/HistoryTestsUtils.h history/InferredQuorum.h history/StateSnapshot.h historywork/BatchDownloadWork.h historywork/BucketDownloadWork.h historywork/FetchRecentQsetsWork.h historywork/GetAndUnzipRemoteFileWork.h historywork/GetHistoryArchiveStateWork.h historywork/GetRemoteFileWork.h historywork/GunzipFileWork.h historywork/GzipFileWork.h historywork/MakeRemoteDirWork.h historywork/Progress.h historywork/PublishWork.h historywork/PutHistoryArchiveStateWork.h historywork/PutRemoteFileWork.h historywork/PutSnapshotFilesWork.h historywork/RepairMissingBucketsWork.h historywork/ResolveSnapshotWork.h historywork/RunCommandWork.h historywork/VerifyBucketWork.h historywork/WriteSnapshotWork.h invariant/AccountSubEntriesCountIsValid.h invariant/BucketListIsConsistentWithDatabase.h invariant/CacheIsConsistentWithDatabase.h invariant/ConservationOfLumens.h invariant/InflationVotesMatchAccounts.h invariant/Invariant.h invariant/InvariantDoesNotHold.h invariant/InvariantManager.h invariant/InvariantManagerImpl.h invariant/InvariantTestUtils.h invariant/LedgerEntryIsValid.h invariant/MinimumAccountBalance.h ledger/AccountFrame.h ledger/CheckpointRange.h ledger/DataFrame.h ledger/EntryFrame.h ledger/LedgerDelta.h ledger/LedgerHeaderFrame.h ledger/LedgerManager.h ledger/LedgerManagerImpl.h ledger/LedgerRange.h ledger/LedgerTestUtils.h ledger/OfferFrame.h ledger/SyncingLedgerChain.h ledger/TrustFrame.h main/Application.h main/ApplicationImpl.h main/CommandHandler.h main/Config.h main/ExternalQueue.h main/Maintainer.h main/ManagedDataCache.h main/MetricsExporter.h main/NtpSynchronizationChecker.h main/PersistentState.h main/StellarCoreVersion.h main/WarmRestart.h main/Whitelist.h main/dumpxdr.h main/fuzz.h overlay/BanManager.h overlay/BanManagerImpl.h overlay/Floodgate.h overlay/ItemFetcher.h overlay/LoadManager.h overlay/LoopbackPeer.h overlay/OverlayManager.h overlay/OverlayManagerImpl.h overlay/Peer.h overlay/PeerAuth.h overlay/PeerBareAddress.h overlay/PeerDoor.h overlay/PeerRecord.h overlay/StellarXDR.h overlay/TCPPeer.h overlay/Tracker.h process/ProcessManager.h process/ProcessManagerImpl.h scp/BallotProtocol.h scp/LocalNode.h scp/NominationProtocol.h scp/QuorumSetUtils.h scp/SCP.h scp/SCPDriver.h scp/Slot.h simulation/LoadGenerator.h simulation/Simulation.h simulation/Topologies.h test/Microbench.h test/SimpleTestReporter.h test/TestAccount.h test/TestExceptions.h test/TestMarket.h test/TestPrinter.h test/TestUtils.h test/TxTests.h test/test.h transactions/AllowTrustOpFrame.h transactions/ChangeTrustOpFrame.h transactions/CreateAccountOpFrame.h transactions/CreatePassiveOfferOpFrame.h transactions/InflationOpFrame.h transactions/ManageDataOpFrame.h transactions/ManageOfferOpFrame.h transactions/MergeOpFrame.h transactions/OfferExchange.h transactions/OperationFrame.h transactions/PathPaymentOpFrame.h transactions/PaymentOpFrame.h transactions/SetOptionsOpFrame.h transactions/SignatureChecker.h transactions/SignatureUtils.h transactions/TransactionFrame.h util/Algoritm.h util/BitsetEnumerator.h util/Fs.h util/GlobalChecks.h util/HashOfHash.h util/LatencyHistogram.h util/Logging.h util/Math.h util/NonCopyable.h util/NtpClient.h util/NtpWork.h util/SecretValue.h util/SociNoWarnings.h util/StatusManager.h util/Timer.h util/TmpDir.h util/XDRStream.h util/asio.h util/make_unique.h util/must_use.h util/optional.h util/types.h work/Work.h work/WorkManager.h work/WorkManagerImpl.h work/WorkParent.h
+SRC_CXX_FILES = bucket/Bucket.cpp bucket/BucketApplicator.cpp bucket/BucketIndex.cpp bucket/BucketInputIterator.cpp bucket/BucketList.cpp bucket/BucketManagerImpl.cpp bucket/BucketOutputIterator.cpp bucket/BucketTests.cpp bucket/FutureBucket.cpp bucket/PublishQueueBuckets.cpp catchup/ApplyBucketsWork.cpp catchup/ApplyLedgerChainWork.cpp catchup/CatchupConfiguration.cpp catchup/CatchupManagerImpl.cpp catchup/CatchupWork.cpp catchup/CatchupWorkTests.cpp catchup/DownloadBucketsWork.cpp catchup/VerifyLedgerChainWork.cpp crypto/CryptoTests.cpp crypto/ECDH.cpp crypto/Hex.cpp crypto/KeyUtils.cpp crypto/Random.cpp crypto/SHA.cpp crypto/SHA256Block.cpp crypto/SecretKey.cpp crypto/SignerKey.cpp crypto/SignerKeyUtils.cpp crypto/StrKey.cpp database/Database.cpp database/DatabaseConnectionString.cpp database/DatabaseConnectionStringTest.cpp database/DatabaseTests.cpp database/DatabaseUtils.cpp herder/Herder.cpp herder/HerderImpl.cpp herder/HerderPersistenceImpl.cpp herder/HerderSCPDriver.cpp herder/HerderTests.cpp herder/HerderUtils.cpp herder/LedgerCloseData.cpp herder/PendingEnvelopes.cpp herder/PendingEnvelopesTests.cpp herder/TxSetFrame.cpp herder/Upgrades.cpp herder/UpgradesTests.cpp history/FileTransferInfo.cpp history/HistoryArchive.cpp history/HistoryManagerImpl.cpp history/HistoryTests.cpp history/HistoryTestsUtils.cpp history/InferredQuorum.cpp history/InferredQuorumTests.cpp history/SerializeTests.cpp history/StateSnapshot.cpp historywork/BatchDownloadWork.cpp historywork/BucketDownloadWork.cpp historywork/FetchRecentQsetsWork.cpp historywork/GetAndUnzipRemoteFileWork.cpp historywork/GetHistoryArchiveStateWork.cpp historywork/GetRemoteFileWork.cpp historywork/GunzipFileWork.cpp historywork/GzipFileWork.cpp historywork/MakeRemoteDirWork.cpp historywork/Progress.cpp historywork/PublishWork.cpp historywork/PutHistoryArchiveStateWork.cpp historywork/PutRemoteFileWork.cpp historywork/PutSnapshotFilesWork.cpp historywork/RepairMissingBucketsWork.cpp historywork/ResolveSnapshotWork.cpp historywork/RunCommandWork.cpp historywork/VerifyBucketWork.cpp historywork/WriteSnapshotWork.cpp invariant/AccountSubEntriesCountIsValid.cpp invariant/AccountSubEntriesCountIsValidTests.cpp invariant/BucketListIsConsistentWithDatabase.cpp invariant/BucketListIsConsistentWithDatabaseTests.cpp invariant/CacheIsConsistentWithDatabase.cpp invariant/CacheIsConsistentWithDatabaseTests.cpp invariant/ConservationOfLumens.cpp invariant/ConservationOfLumensTests.cpp invariant/InflationVotesMatchAccounts.cpp invariant/InflationVotesMatchAccountsTests.cpp invariant/InvariantDoesNotHold.cpp invariant/InvariantManagerImpl.cpp invariant/InvariantTestUtils.cpp invariant/InvariantTests.cpp invariant/LedgerEntryIsValid.cpp invariant/MinimumAccountBalance.cpp invariant/MinimumAccountBalanceTests.cpp ledger/AccountFrame.cpp ledger/CheckpointRange.cpp ledger/DataFrame.cpp ledger/EntryFrame.cpp ledger/LedgerDelta.cpp ledger/LedgerDeltaTests.cpp ledger/LedgerEntryTests.cpp ledger/LedgerHeaderFrame.cpp ledger/LedgerHeaderTests.cpp ledger/LedgerManagerImpl.cpp ledger/LedgerPerformanceTests.cpp ledger/LedgerRange.cpp ledger/LedgerTestUtils.cpp ledger/LedgerTests.cpp ledger/OfferFrame.cpp ledger/SyncingLedgerChain.cpp ledger/SyncingLedgerChainTests.cpp ledger/TrustFrame.cpp main/Application.cpp main/ApplicationImpl.cpp main/ApplicationTests.cpp main/CommandHandler.cpp main/Config.cpp main/ConfigTests.cpp main/ExternalQueue.cpp main/ExternalQueueTests.cpp main/LruCacheTests.cpp main/Maintainer.cpp main/ManagedDataCache.cpp main/MetricsExporter.cpp main/NtpSynchronizationChecker.cpp main/PersistentState.cpp main/WarmRestart.cpp main/Whitelist.cpp main/dumpxdr.cpp main/fuzz.cpp main/main.cpp overlay/BanManagerImpl.cpp overlay/FloodTests.cpp overlay/Floodgate.cpp overlay/ItemFetcher.cpp overlay/ItemFetcherTests.cpp overlay/LoadManager.cpp overlay/LoadManagerTests.cpp overlay/LoopbackPeer.cpp overlay/OverlayManagerImpl.cpp overlay/OverlayManagerTests.cpp overlay/OverlayTests.cpp overlay/Peer.cpp overlay/PeerAuth.cpp overlay/PeerBareAddress.cpp overlay/PeerDoor.cpp overlay/PeerRecord.cpp overlay/PeerRecordTests.cpp overlay/TCPPeer.cpp overlay/TCPPeerTests.cpp overlay/Tracker.cpp overlay/TrackerTests.cpp process/ProcessManagerImpl.cpp process/ProcessTests.cpp scp/BallotProtocol.cpp scp/LocalNode.cpp scp/NominationProtocol.cpp scp/QuorumSetTests.cpp scp/QuorumSetUtils.cpp scp/SCP.cpp scp/SCPDriver.cpp scp/SCPTests.cpp scp/SCPUnitTests.cpp scp/Slot.cpp simulation/CoreTests.cpp simulation/LoadGenerator.cpp simulation/Simulation.cpp simulation/Topologies.cpp test/Microbench.cpp test/TestAccount.cpp test/TestExceptions.cpp test/TestMarket.cpp test/TestPrinter.cpp test/TestUtils.cpp test/TxTests.cpp test/test.cpp transactions/AllowTrustOpFrame.cpp transactions/AllowTrustTests.cpp transactions/ChangeTrustOpFrame.cpp transactions/ChangeTrustTests.cpp transactions/CreateAccountOpFrame.cpp transactions/CreatePassiveOfferOpFrame.cpp transactions/ExchangeTests.cpp transactions/InflationOpFrame.cpp transactions/InflationTests.cpp transactions/ManageDataOpFrame.cpp transactions/ManageDataTests.cpp transactions/ManageOfferOpFrame.cpp transactions/MergeOpFrame.cpp transactions/MergeTests.cpp transactions/OfferExchange.cpp transactions/OfferTests.cpp transactions/OperationFrame.cpp transactions/PathPaymentOpFrame.cpp transactions/PathPaymentTests.cpp transactions/PaymentOpFrame.cpp transactions/PaymentTests.cpp transactions/SetOptionsOpFrame.cpp transactions/SetOptionsTests.cpp transactions/SignatureChecker.cpp transactions/SignatureUtils.cpp transactions/SignatureUtilsTest.cpp transactions/TransactionFrame.cpp transactions/TxEnvelopeTests.cpp transactions/TxResultsTests.cpp util/BalanceTests.cpp util/BigDivideTests.cpp util/BitsetEnumerator.cpp util/BitsetEnumeratorTests.cpp util/Fs.cpp util/FsTests.cpp util/GlobalChecks.cpp util/HashOfHash.cpp util/LatencyHistogram.cpp util/LatencyHistogramTests.cpp util/Logging.cpp util/Math.cpp util/NtpClient.cpp util/NtpWork.cpp util/SecretValue.cpp util/StatusManager.cpp util/StatusManagerTest.cpp util/Timer.cpp util/TimerTests.cpp util/TmpDir.cpp util/Uint128Tests.cpp util/XDRStream.cpp util/XDRStreamTests.cpp util/types.cpp work/Work.cpp work/WorkManagerImpl.cpp work/WorkParent.cpp work/WorkTests.cpp
 SRC_X_FILES = xdr/Stellar-SCP.x xdr/Stellar-ledger-entries.x xdr/Stellar-ledger.x xdr/Stellar-overlay.x xdr/Stellar-transaction.x xdr/Stellar-types.x
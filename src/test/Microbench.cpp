@@ -0,0 +1,55 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "test/Microbench.h"
+#include "util/Logging.h"
+#include "util/format.h"
+#include <algorithm>
+#include <fstream>
+
+namespace stellar
+{
+
+void const* volatile Microbench::sSink = nullptr;
+
+Microbench::Microbench(std::string const& suite, size_t warmupRounds,
+                       size_t rounds)
+    : mSuite(suite), mWarmupRounds(warmupRounds), mRounds(rounds)
+{
+    mResults["suite"] = suite;
+    mResults["warmup_rounds"] = static_cast<Json::UInt64>(warmupRounds);
+    mResults["rounds"] = static_cast<Json::UInt64>(rounds);
+}
+
+Microbench::~Microbench()
+{
+    auto filename = fmt::format("microbench-{}.json", mSuite);
+    std::ofstream out(filename);
+    out << mResults.toStyledString();
+    LOG(INFO) << "Microbenchmark results written to " << filename;
+}
+
+void
+Microbench::record(std::string const& name, size_t iterations,
+                   std::vector<double> nsPerOp)
+{
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    double sum = 0;
+    for (auto ns : nsPerOp)
+    {
+        sum += ns;
+    }
+
+    auto& res = mResults["benchmarks"][name];
+    res["iterations"] = static_cast<Json::UInt64>(iterations);
+    res["min_ns"] = nsPerOp.front();
+    res["median_ns"] = nsPerOp[nsPerOp.size() / 2];
+    res["mean_ns"] = sum / nsPerOp.size();
+    res["max_ns"] = nsPerOp.back();
+
+    LOG(INFO) << fmt::format("{:<40} {:>12.1f} ns/op (min {:.1f}, max {:.1f})",
+                             name, nsPerOp[nsPerOp.size() / 2],
+                             nsPerOp.front(), nsPerOp.back());
+}
+}
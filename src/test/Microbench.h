@@ -0,0 +1,76 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/json/json.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * Minimal harness for the [microbench] tests. Each benchmark is a callable
+ * run `iterations` times per round; a few untimed warmup rounds come first,
+ * then `rounds` timed ones. Results are logged and, on destruction, written
+ * as JSON to microbench-<suite>.json so they can be compared across builds.
+ */
+class Microbench
+{
+  public:
+    explicit Microbench(std::string const& suite, size_t warmupRounds = 2,
+                        size_t rounds = 10);
+    ~Microbench();
+
+    template <typename F>
+    void
+    run(std::string const& name, size_t iterations, F&& fn)
+    {
+        for (size_t r = 0; r < mWarmupRounds; ++r)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                fn();
+            }
+        }
+
+        std::vector<double> nsPerOp;
+        nsPerOp.reserve(mRounds);
+        for (size_t r = 0; r < mRounds; ++r)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                fn();
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            nsPerOp.push_back(
+                std::chrono::duration<double, std::nano>(elapsed).count() /
+                iterations);
+        }
+        record(name, iterations, nsPerOp);
+    }
+
+    // Keeps the compiler from discarding the computation producing `v`.
+    template <typename T>
+    static void
+    keep(T const& v)
+    {
+        sSink = &v;
+    }
+
+  private:
+    void record(std::string const& name, size_t iterations,
+                std::vector<double> nsPerOp);
+
+    static void const* volatile sSink;
+
+    std::string mSuite;
+    size_t mWarmupRounds;
+    size_t mRounds;
+    Json::Value mResults;
+};
+}
@@ -84,10 +84,12 @@ getTestConfig(int instanceNumber, Config::TestDbMode mode)
                                        "BucketListIsConsistentWithDatabase",
                                        "CacheIsConsistentWithDatabase",
                                        "ConservationOfLumens",
+                                       "InflationVotesMatchAccounts",
                                        "LedgerEntryIsValid",
                                        "MinimumAccountBalance"};
 
         thisConfig.ALLOW_LOCALHOST_FOR_TESTING = true;
+        thisConfig.DISABLE_XDR_FSYNC = true;
 
         // this forces to pick up any other potential upgrades
         thisConfig.TESTING_UPGRADE_DATETIME = VirtualClock::from_time_t(1);
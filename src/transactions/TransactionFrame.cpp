@@ -60,6 +60,32 @@ TransactionFrame::getFullHash() const
     return (mFullHash);
 }
 
+void
+TransactionFrame::computeFullHashes(std::vector<TransactionFramePtr> const& txs)
+{
+    std::vector<TransactionFrame*> pending;
+    std::vector<xdr::opaque_vec<>> envelopes;
+    for (auto const& tx : txs)
+    {
+        if (isZero(tx->mFullHash))
+        {
+            pending.emplace_back(tx.get());
+            envelopes.emplace_back(xdr::xdr_to_opaque(tx->mEnvelope));
+        }
+    }
+    if (pending.size() < 2)
+    {
+        return;
+    }
+
+    std::vector<ByteSlice> slices(envelopes.begin(), envelopes.end());
+    auto hashes = sha256Batch(slices);
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        pending[i]->mFullHash = hashes[i];
+    }
+}
+
 Hash const&
 TransactionFrame::getContentsHash() const
 {
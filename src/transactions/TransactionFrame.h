@@ -86,6 +86,11 @@ class TransactionFrame
     Hash const& getFullHash() const;
     Hash const& getContentsHash() const;
 
+    // Fills in getFullHash() for every tx that has not computed it yet, with
+    // one sha256Batch call rather than one sha256 per tx.
+    static void
+    computeFullHashes(std::vector<TransactionFramePtr> const& txs);
+
     bool isWhitelisted(Application& app);
 
     std::vector<std::shared_ptr<OperationFrame>> const&
@@ -121,6 +121,13 @@ deltree(std::string const& d)
     }
 }
 
+void
+syncDirectory(std::string const& path)
+{
+    // directory entries can not be flushed on their own here; NTFS journals
+    // them along with the metadata of the files they name
+}
+
 std::vector<std::string>
 findfiles(std::string const& p,
           std::function<bool(std::string const& name)> predicate)
@@ -295,6 +302,25 @@ deltree(std::string const& d)
     }
 }
 
+void
+syncDirectory(std::string const& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error("unable to open directory " + path +
+                                 " to sync it: " + strerror(errno));
+    }
+    int r = fsync(fd);
+    int err = errno;
+    close(fd);
+    if (r != 0)
+    {
+        throw std::runtime_error("unable to sync directory " + path + ": " +
+                                 strerror(err));
+    }
+}
+
 std::vector<std::string>
 findfiles(std::string const& path,
           std::function<bool(std::string const& name)> predicate)
@@ -36,6 +36,10 @@ bool exists(std::string const& path);
 // Delete a path and everything inside it (if a dir)
 void deltree(std::string const& path);
 
+// Flush a directory's entries to disk, so that files created, renamed or
+// removed in it stay that way across a crash
+void syncDirectory(std::string const& path);
+
 // Make a single dir; not mkdir -p, i.e. non-recursive
 bool mkdir(std::string const& path);
 
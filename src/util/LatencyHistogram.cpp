@@ -0,0 +1,294 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/LatencyHistogram.h"
+#include "util/make_unique.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace stellar
+{
+
+namespace
+{
+
+// Number of bits needed to write v, which is not 0.
+size_t
+bitWidth(uint64_t v)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return index + 1;
+#else
+    return 64 - __builtin_clzll(v);
+#endif
+}
+
+// Threads take shards in turn as they first record something.
+size_t
+shardOfThisThread()
+{
+    static std::atomic<size_t> nextShard{0};
+    static thread_local size_t shard =
+        nextShard.fetch_add(1, std::memory_order_relaxed) %
+        LatencyHistogram::kShards;
+    return shard;
+}
+
+uint64_t
+toNanoseconds(std::chrono::nanoseconds d)
+{
+    return d.count() < 0 ? 0 : static_cast<uint64_t>(d.count());
+}
+}
+
+size_t const LatencyHistogram::kSubBucketBits;
+size_t const LatencyHistogram::kSubBuckets;
+size_t const LatencyHistogram::kMaxBits;
+size_t const LatencyHistogram::kBuckets;
+size_t const LatencyHistogram::kShards;
+
+LatencyHistogram::Shard::Shard()
+    : mCount(0), mSum(0), mMin(std::numeric_limits<uint64_t>::max()), mMax(0)
+{
+    for (auto& b : mBuckets)
+    {
+        b.store(0, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+}
+
+size_t
+LatencyHistogram::bucketIndex(uint64_t ns)
+{
+    if (ns < kSubBuckets)
+    {
+        return static_cast<size_t>(ns);
+    }
+    size_t bits = bitWidth(ns);
+    if (bits > kMaxBits)
+    {
+        return kBuckets - 1;
+    }
+    // ns >> shift is in [kSubBuckets, 2 * kSubBuckets)
+    size_t shift = bits - kSubBucketBits - 1;
+    return (shift + 1) * kSubBuckets +
+           static_cast<size_t>((ns >> shift) - kSubBuckets);
+}
+
+uint64_t
+LatencyHistogram::bucketLowerBound(size_t i)
+{
+    if (i < kSubBuckets)
+    {
+        return i;
+    }
+    size_t shift = i / kSubBuckets - 1;
+    return (kSubBuckets + i % kSubBuckets) << shift;
+}
+
+void
+LatencyHistogram::Update(std::chrono::nanoseconds duration)
+{
+    uint64_t ns = toNanoseconds(duration);
+    auto& shard = mShards[shardOfThisThread()];
+    shard.mBuckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    shard.mCount.fetch_add(1, std::memory_order_relaxed);
+    shard.mSum.fetch_add(ns, std::memory_order_relaxed);
+
+    auto min = shard.mMin.load(std::memory_order_relaxed);
+    while (ns < min && !shard.mMin.compare_exchange_weak(
+                           min, ns, std::memory_order_relaxed))
+    {
+    }
+    auto max = shard.mMax.load(std::memory_order_relaxed);
+    while (ns > max && !shard.mMax.compare_exchange_weak(
+                           max, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+LatencyHistogram::Scope
+LatencyHistogram::TimeScope()
+{
+    return Scope(*this);
+}
+
+LatencyHistogram::Snapshot
+LatencyHistogram::GetSnapshot() const
+{
+    std::vector<uint64_t> counts(kBuckets, 0);
+    uint64_t sum = 0;
+    uint64_t min = std::numeric_limits<uint64_t>::max();
+    uint64_t max = 0;
+    for (auto const& shard : mShards)
+    {
+        for (size_t i = 0; i < kBuckets; ++i)
+        {
+            counts[i] += shard.mBuckets[i].load(std::memory_order_relaxed);
+        }
+        sum += shard.mSum.load(std::memory_order_relaxed);
+        min = std::min(min, shard.mMin.load(std::memory_order_relaxed));
+        max = std::max(max, shard.mMax.load(std::memory_order_relaxed));
+    }
+    return Snapshot(std::move(counts), sum, min, max);
+}
+
+uint64_t
+LatencyHistogram::count() const
+{
+    uint64_t count = 0;
+    for (auto const& shard : mShards)
+    {
+        count += shard.mCount.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+std::chrono::nanoseconds
+LatencyHistogram::sum() const
+{
+    uint64_t sum = 0;
+    for (auto const& shard : mShards)
+    {
+        sum += shard.mSum.load(std::memory_order_relaxed);
+    }
+    return std::chrono::nanoseconds(sum);
+}
+
+LatencyHistogram::Snapshot::Snapshot(std::vector<uint64_t> counts,
+                                     uint64_t sum, uint64_t min, uint64_t max)
+    : mCounts(std::move(counts)), mCount(0), mSum(sum), mMin(min), mMax(max)
+{
+    for (auto c : mCounts)
+    {
+        mCount += c;
+    }
+    if (mCount == 0)
+    {
+        mMin = 0;
+    }
+}
+
+std::chrono::nanoseconds
+LatencyHistogram::Snapshot::sum() const
+{
+    return std::chrono::nanoseconds(mSum);
+}
+
+std::chrono::nanoseconds
+LatencyHistogram::Snapshot::min() const
+{
+    return std::chrono::nanoseconds(mMin);
+}
+
+std::chrono::nanoseconds
+LatencyHistogram::Snapshot::max() const
+{
+    return std::chrono::nanoseconds(mMax);
+}
+
+std::chrono::nanoseconds
+LatencyHistogram::Snapshot::mean() const
+{
+    return std::chrono::nanoseconds(mCount == 0 ? 0 : mSum / mCount);
+}
+
+std::chrono::nanoseconds
+LatencyHistogram::Snapshot::valueAt(double q) const
+{
+    if (mCount == 0)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    if (q <= 0)
+    {
+        return min();
+    }
+    auto rank =
+        static_cast<uint64_t>(std::ceil(q * static_cast<double>(mCount)));
+    if (rank >= mCount)
+    {
+        return max();
+    }
+    uint64_t seen = 0;
+    size_t i = 0;
+    for (; i + 1 < mCounts.size(); ++i)
+    {
+        seen += mCounts[i];
+        if (seen >= rank)
+        {
+            break;
+        }
+    }
+    // the middle of the bucket, though never outside what was recorded
+    auto lower = bucketLowerBound(i);
+    auto upper = i + 1 < kBuckets ? bucketLowerBound(i + 1)
+                                  : std::max(lower, mMax) + 1;
+    auto mid = lower + (upper - lower) / 2;
+    return std::chrono::nanoseconds(std::max(mMin, std::min(mMax, mid)));
+}
+
+LatencyHistogram::Scope::Scope(LatencyHistogram& histogram)
+    : mHistogram(&histogram), mStart(std::chrono::steady_clock::now())
+{
+}
+
+LatencyHistogram::Scope::Scope(Scope&& other)
+    : mHistogram(other.mHistogram), mStart(other.mStart)
+{
+    other.mHistogram = nullptr;
+}
+
+LatencyHistogram::Scope::~Scope()
+{
+    Stop();
+}
+
+std::chrono::nanoseconds
+LatencyHistogram::Scope::Stop()
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - mStart);
+    if (mHistogram)
+    {
+        mHistogram->Update(elapsed);
+        mHistogram = nullptr;
+    }
+    return elapsed;
+}
+
+LatencyHistogram&
+LatencyRegistry::NewHistogram(medida::MetricName const& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& h = mHistograms[name];
+    if (!h)
+    {
+        h = make_unique<LatencyHistogram>();
+    }
+    return *h;
+}
+
+std::vector<std::pair<medida::MetricName, LatencyHistogram const*>>
+LatencyRegistry::GetAllHistograms() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<std::pair<medida::MetricName, LatencyHistogram const*>> all;
+    for (auto const& kv : mHistograms)
+    {
+        all.emplace_back(kv.first, kv.second.get());
+    }
+    return all;
+}
+}
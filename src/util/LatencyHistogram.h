@@ -0,0 +1,139 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "medida/metric_name.h"
+#include "util/NonCopyable.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * Histogram of durations, cheap enough to update from hot paths on any thread.
+ *
+ * medida timers sample into a reservoir behind a lock and keep decaying rates
+ * up to date on every update. This instead counts durations into fixed
+ * log-linear buckets, as HdrHistogram does: every power of two of nanoseconds
+ * is split into kSubBuckets, so a duration is known to within 1/kSubBuckets of
+ * itself. An update is a few relaxed atomic operations on one of kShards
+ * copies of the counts, chosen per thread so that threads seldom write to the
+ * same cache lines; reading merges the copies.
+ */
+class LatencyHistogram : public NonMovableOrCopyable
+{
+  public:
+    static size_t const kSubBucketBits = 4;
+    static size_t const kSubBuckets = size_t(1) << kSubBucketBits;
+    // Durations of 2^kMaxBits ns (about 18 minutes) or more all land in the
+    // last bucket.
+    static size_t const kMaxBits = 40;
+    static size_t const kBuckets =
+        (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+    static size_t const kShards = 4;
+
+    // The counts of a histogram at some point, merged across its shards.
+    class Snapshot
+    {
+        std::vector<uint64_t> mCounts;
+        uint64_t mCount;
+        uint64_t mSum;
+        uint64_t mMin;
+        uint64_t mMax;
+
+      public:
+        Snapshot(std::vector<uint64_t> counts, uint64_t sum, uint64_t min,
+                 uint64_t max);
+
+        uint64_t
+        count() const
+        {
+            return mCount;
+        }
+
+        std::chrono::nanoseconds sum() const;
+        std::chrono::nanoseconds min() const;
+        std::chrono::nanoseconds max() const;
+        std::chrono::nanoseconds mean() const;
+
+        // The duration below which a fraction q of the durations fall, to
+        // within the width of the bucket it falls in.
+        std::chrono::nanoseconds valueAt(double q) const;
+    };
+
+    // Records the time it is alive for, like medida::TimerContext.
+    class Scope
+    {
+        LatencyHistogram* mHistogram;
+        std::chrono::steady_clock::time_point mStart;
+
+      public:
+        explicit Scope(LatencyHistogram& histogram);
+        Scope(Scope&& other);
+        ~Scope();
+
+        // Records the time since the scope started, if not done yet, and
+        // returns it.
+        std::chrono::nanoseconds Stop();
+    };
+
+    LatencyHistogram();
+
+    void Update(std::chrono::nanoseconds duration);
+    Scope TimeScope();
+
+    Snapshot GetSnapshot() const;
+
+    // Totals only, without merging the bucket counts.
+    uint64_t count() const;
+    std::chrono::nanoseconds sum() const;
+
+    static size_t bucketIndex(uint64_t ns);
+    // Smallest duration, in ns, that falls in bucket i.
+    static uint64_t bucketLowerBound(size_t i);
+
+  private:
+    struct Shard
+    {
+        std::atomic<uint64_t> mCount;
+        std::atomic<uint64_t> mSum;
+        std::atomic<uint64_t> mMin;
+        std::atomic<uint64_t> mMax;
+        std::array<std::atomic<uint64_t>, kBuckets> mBuckets;
+        // keeps the totals of the next shard off this one's last cache line
+        char mPadding[64];
+
+        Shard();
+    };
+
+    std::array<Shard, kShards> mShards;
+};
+
+/**
+ * Named LatencyHistograms, kept next to the application's medida registry and
+ * reported along with it (see MetricsExporter).
+ */
+class LatencyRegistry : public NonMovableOrCopyable
+{
+    mutable std::mutex mMutex;
+    std::map<medida::MetricName, std::unique_ptr<LatencyHistogram>>
+        mHistograms;
+
+  public:
+    // Returns the histogram with the given name, creating it on first use.
+    // The reference stays valid for as long as the registry does.
+    LatencyHistogram& NewHistogram(medida::MetricName const& name);
+
+    std::vector<std::pair<medida::MetricName, LatencyHistogram const*>>
+    GetAllHistograms() const;
+};
+}
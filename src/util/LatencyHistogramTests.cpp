@@ -0,0 +1,198 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "lib/json/json.h"
+#include "main/Application.h"
+#include "main/MetricsExporter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include "test/Microbench.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+#include "util/LatencyHistogram.h"
+#include "util/Timer.h"
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace stellar;
+using namespace std::chrono;
+
+TEST_CASE("latency histogram buckets", "[latencyhistogram]")
+{
+    // every bucket holds the values from its lower bound up to the next one,
+    // and is no wider than 1/kSubBuckets of them
+    for (size_t i = 0; i + 1 < LatencyHistogram::kBuckets; ++i)
+    {
+        auto lower = LatencyHistogram::bucketLowerBound(i);
+        auto upper = LatencyHistogram::bucketLowerBound(i + 1);
+        REQUIRE(lower < upper);
+        REQUIRE(LatencyHistogram::bucketIndex(lower) == i);
+        REQUIRE(LatencyHistogram::bucketIndex(upper - 1) == i);
+        REQUIRE((upper - lower) * LatencyHistogram::kSubBuckets <=
+                std::max<uint64_t>(lower, LatencyHistogram::kSubBuckets));
+    }
+    REQUIRE(LatencyHistogram::bucketIndex(UINT64_MAX) ==
+            LatencyHistogram::kBuckets - 1);
+}
+
+TEST_CASE("latency histogram statistics", "[latencyhistogram]")
+{
+    LatencyHistogram h;
+    SECTION("empty")
+    {
+        auto s = h.GetSnapshot();
+        REQUIRE(s.count() == 0);
+        REQUIRE(s.min() == nanoseconds(0));
+        REQUIRE(s.max() == nanoseconds(0));
+        REQUIRE(s.valueAt(0.5) == nanoseconds(0));
+    }
+
+    SECTION("uniform durations")
+    {
+        for (int i = 1; i <= 10000; ++i)
+        {
+            h.Update(microseconds(i));
+        }
+        auto s = h.GetSnapshot();
+        REQUIRE(s.count() == 10000);
+        REQUIRE(h.count() == 10000);
+        REQUIRE(s.sum() == microseconds(10000 * 10001 / 2));
+        REQUIRE(h.sum() == s.sum());
+        REQUIRE(s.min() == microseconds(1));
+        REQUIRE(s.max() == microseconds(10000));
+        REQUIRE(s.mean() == nanoseconds(5000500));
+
+        for (double q : {0.01, 0.5, 0.9, 0.99, 0.999})
+        {
+            double expected = q * 10000000.0;
+            double actual = static_cast<double>(s.valueAt(q).count());
+            REQUIRE(std::abs(actual - expected) <=
+                    expected / LatencyHistogram::kSubBuckets);
+        }
+        REQUIRE(s.valueAt(1.0) == s.max());
+        REQUIRE(s.valueAt(0.0) == s.min());
+    }
+
+    SECTION("scopes record once")
+    {
+        {
+            auto scope = h.TimeScope();
+            auto moved = std::move(scope);
+            moved.Stop();
+        }
+        REQUIRE(h.count() == 1);
+    }
+}
+
+TEST_CASE("latency histogram updated from several threads",
+          "[latencyhistogram]")
+{
+    LatencyHistogram h;
+    size_t const nThreads = 8;
+    size_t const perThread = 10000;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nThreads; ++t)
+    {
+        threads.emplace_back([&h, t]() {
+            for (size_t i = 0; i < perThread; ++i)
+            {
+                h.Update(nanoseconds(1000 * (t + 1)));
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    auto s = h.GetSnapshot();
+    REQUIRE(s.count() == nThreads * perThread);
+    REQUIRE(s.min() == nanoseconds(1000));
+    REQUIRE(s.max() == nanoseconds(1000 * nThreads));
+    REQUIRE(s.sum() ==
+            nanoseconds(1000 * perThread * nThreads * (nThreads + 1) / 2));
+}
+
+TEST_CASE("latency histograms are reported with the other metrics",
+          "[latencyhistogram]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    auto& h = app->getLatencyMetrics().NewHistogram({"test", "latency", "op"});
+    REQUIRE(&h ==
+            &app->getLatencyMetrics().NewHistogram({"test", "latency", "op"}));
+    h.Update(milliseconds(3));
+    app->getMetrics().NewTimer({"test", "medida", "op"}).Update(
+        milliseconds(5));
+
+    SECTION("as JSON")
+    {
+        Json::Value root;
+        Json::Reader reader;
+        REQUIRE(reader.parse(MetricsExporter::renderJson(
+                                 app->getMetrics(), app->getLatencyMetrics()),
+                             root));
+        auto const& metrics = root["metrics"];
+        REQUIRE(metrics["test.latency.op"]["count"].asUInt64() == 1);
+        REQUIRE(metrics["test.latency.op"]["max"].asDouble() == 3.0);
+        REQUIRE(metrics["test.medida.op"]["count"].asUInt64() == 1);
+    }
+
+    SECTION("in the Prometheus text format")
+    {
+        auto text = MetricsExporter::renderPrometheus(
+            app->getMetrics(), app->getLatencyMetrics());
+        auto has = [&](std::string const& line) {
+            return text.find(line + "\n") != std::string::npos;
+        };
+        REQUIRE(has("# TYPE stellar_core_test_latency_op summary"));
+        REQUIRE(has("stellar_core_test_latency_op_count 1"));
+        REQUIRE(has("stellar_core_test_latency_op_sum 0.003"));
+        REQUIRE(has("stellar_core_test_medida_op_count 1"));
+    }
+}
+
+TEST_CASE("latency histogram microbenchmarks",
+          "[latencyhistogram][microbench][bench][hide]")
+{
+    Microbench mb("latency-histogram");
+    size_t const n = 100000;
+
+    medida::Timer timer;
+    LatencyHistogram h;
+    auto d = nanoseconds(123456);
+    mb.run("update/medida-timer", n, [&]() { timer.Update(d); });
+    mb.run("update/latency-histogram", n, [&]() { h.Update(d); });
+    mb.run("scope/medida-timer", n, [&]() { timer.TimeScope(); });
+    mb.run("scope/latency-histogram", n, [&]() { h.TimeScope(); });
+
+    // contended: every thread updates the same timer
+    size_t const nThreads = 4;
+    auto contended = [&](std::function<void()> update) {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nThreads; ++t)
+        {
+            threads.emplace_back([&]() {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    update();
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+    };
+    mb.run("update-4-threads/medida-timer", 1,
+           [&]() { contended([&]() { timer.Update(d); }); });
+    mb.run("update-4-threads/latency-histogram", 1,
+           [&]() { contended([&]() { h.Update(d); }); });
+
+    mb.run("snapshot/medida-timer", 100,
+           [&]() { Microbench::keep(timer.GetSnapshot().getMedian()); });
+    mb.run("snapshot/latency-histogram", 100,
+           [&]() { Microbench::keep(h.GetSnapshot().valueAt(0.5)); });
+}
@@ -0,0 +1,433 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/XDRStream.h"
+#include "util/Fs.h"
+#include "util/make_unique.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace stellar
+{
+
+namespace
+{
+
+#ifdef _WIN32
+
+int
+openForWrite(std::string const& filename, bool directIO, bool& isDirectIO)
+{
+    isDirectIO = false;
+    return _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+}
+
+bool
+writeFully(int fd, char const* a, size_t an, char const* b, size_t bn)
+{
+    for (auto const& seg : {std::make_pair(a, an), std::make_pair(b, bn)})
+    {
+        char const* p = seg.first;
+        size_t left = seg.second;
+        while (left != 0)
+        {
+            int w = _write(fd, p, static_cast<unsigned int>(
+                                      std::min<size_t>(left, 1 << 30)));
+            if (w < 0)
+            {
+                return false;
+            }
+            p += w;
+            left -= w;
+        }
+    }
+    return true;
+}
+
+void
+clearDirectIO(int fd)
+{
+}
+
+int
+syncFile(int fd)
+{
+    return _commit(fd);
+}
+
+int
+closeFile(int fd)
+{
+    return _close(fd);
+}
+
+#else
+
+int
+openForWrite(std::string const& filename, bool directIO, bool& isDirectIO)
+{
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
+    isDirectIO = false;
+#ifdef O_DIRECT
+    if (directIO)
+    {
+        // not every filesystem takes O_DIRECT (tmpfs doesn't), in which
+        // case the file is written through the page cache after all
+        int fd = ::open(filename.c_str(), flags | O_DIRECT, mode);
+        if (fd != -1)
+        {
+            isDirectIO = true;
+            return fd;
+        }
+    }
+#endif
+    return ::open(filename.c_str(), flags, mode);
+}
+
+// Writes an, then bn bytes, in as few writev calls as the kernel allows.
+bool
+writeFully(int fd, char const* a, size_t an, char const* b, size_t bn)
+{
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<char*>(a);
+    iov[0].iov_len = an;
+    iov[1].iov_base = const_cast<char*>(b);
+    iov[1].iov_len = bn;
+    struct iovec* v = iov;
+    int count = bn != 0 ? 2 : 1;
+    while (count != 0)
+    {
+        ssize_t w = ::writev(fd, v, count);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        size_t done = static_cast<size_t>(w);
+        while (count != 0 && done >= v->iov_len)
+        {
+            done -= v->iov_len;
+            ++v;
+            --count;
+        }
+        if (count != 0)
+        {
+            v->iov_base = static_cast<char*>(v->iov_base) + done;
+            v->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+// Direct I/O needs aligned lengths, which the tail of a file rarely has.
+void
+clearDirectIO(int fd)
+{
+#ifdef O_DIRECT
+    int flags = fcntl(fd, F_GETFL);
+    if (flags != -1)
+    {
+        fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+}
+
+int
+syncFile(int fd)
+{
+    return fsync(fd);
+}
+
+int
+closeFile(int fd)
+{
+    return ::close(fd);
+}
+
+#endif
+
+std::string
+parentDirectory(std::string const& filename)
+{
+    auto slash = filename.find_last_of('/');
+    if (slash == std::string::npos)
+    {
+        return ".";
+    }
+    return slash == 0 ? "/" : filename.substr(0, slash);
+}
+}
+
+class XDROutputFileStream::Deflater
+{
+    z_stream mStream;
+    std::vector<char> mOut;
+
+  public:
+    Deflater() : mOut(64 * 1024)
+    {
+        std::memset(&mStream, 0, sizeof(mStream));
+        // 16 on top of the maximum window size asks for a gzip header and
+        // trailer rather than a zlib one, so the output is what gzip(1)
+        // itself would have produced.
+        if (deflateInit2(&mStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16,
+                         8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw std::runtime_error("failed to initialize zlib deflate");
+        }
+    }
+
+    ~Deflater()
+    {
+        deflateEnd(&mStream);
+    }
+
+    // Compresses size bytes of data, appending whatever output zlib produces
+    // to out; with finish set, also flushes the rest and the trailer.
+    bool
+    deflate(XDROutputFileStream& out, char const* data, size_t size,
+            bool finish)
+    {
+        mStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        mStream.avail_in = static_cast<uInt>(size);
+        int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+        int ret;
+        do
+        {
+            mStream.next_out = reinterpret_cast<Bytef*>(mOut.data());
+            mStream.avail_out = static_cast<uInt>(mOut.size());
+            ret = ::deflate(&mStream, flush);
+            if (ret == Z_STREAM_ERROR)
+            {
+                return false;
+            }
+            size_t have = mOut.size() - mStream.avail_out;
+            if (have != 0 && !out.append(mOut.data(), have))
+            {
+                return false;
+            }
+        } while (mStream.avail_out == 0 || (finish && ret != Z_STREAM_END));
+        return true;
+    }
+};
+
+size_t const XDROutputFileStream::kAlignment;
+size_t const XDROutputFileStream::kDefaultBufferSize;
+
+XDROutputFileStream::XDROutputFileStream(size_t bufferSize)
+    : mWriteBufSize(std::max<size_t>(
+          kAlignment, (bufferSize + kAlignment - 1) / kAlignment * kAlignment))
+{
+}
+
+XDROutputFileStream::~XDROutputFileStream()
+{
+    if (mFd != -1)
+    {
+        // whatever is still buffered goes out, and a gzip stream gets its
+        // trailer, so that what was written can at least be read back
+        try
+        {
+            close();
+        }
+        catch (std::exception& e)
+        {
+            CLOG(ERROR, "Fs") << e.what();
+        }
+    }
+}
+
+void
+XDROutputFileStream::finish(bool sync)
+{
+    if (mFd == -1)
+    {
+        mDeflater.reset();
+        return;
+    }
+    bool deflated = true;
+    if (mDeflater)
+    {
+        auto deflater = std::move(mDeflater);
+        deflated = deflater->deflate(*this, nullptr, 0, true);
+    }
+    int fd = mFd;
+    mFd = -1;
+    try
+    {
+        if (!deflated)
+        {
+            throw std::runtime_error("failed to finish gzip stream: " +
+                                     mFilename);
+        }
+        if (mDirectIO && mWriteBufFill % kAlignment != 0)
+        {
+            clearDirectIO(fd);
+        }
+        if (mFailed || (mWriteBufFill != 0 &&
+                        !writeFully(fd, mWriteBuf, mWriteBufFill, nullptr, 0)))
+        {
+            throw std::runtime_error("failed to write XDR file: " + mFilename +
+                                     ", reason: " + std::to_string(errno));
+        }
+        mWriteBufFill = 0;
+        if (sync && syncFile(fd) != 0)
+        {
+            throw std::runtime_error("failed to fsync XDR file: " +
+                                     mFilename + ", reason: " +
+                                     std::to_string(errno));
+        }
+    }
+    catch (...)
+    {
+        closeFile(fd);
+        throw;
+    }
+    if (closeFile(fd) != 0)
+    {
+        throw std::runtime_error("failed to close XDR file: " + mFilename);
+    }
+}
+
+void
+XDROutputFileStream::close()
+{
+    finish(false);
+}
+
+void
+XDROutputFileStream::durableClose(bool syncDir)
+{
+    if (mFd == -1)
+    {
+        throw std::runtime_error("XDR stream is not open");
+    }
+    finish(true);
+    if (syncDir)
+    {
+        fs::syncDirectory(parentDirectory(mFilename));
+    }
+}
+
+void
+XDROutputFileStream::open(std::string const& filename, bool gzip,
+                          bool directIO)
+{
+    close();
+    mFilename = filename;
+    mFailed = false;
+    mFd = openForWrite(filename, directIO, mDirectIO);
+    if (mFd == -1)
+    {
+        std::string msg("failed to open XDR file: ");
+        msg += filename;
+        msg += ", reason: ";
+        msg += std::to_string(errno);
+        CLOG(FATAL, "Fs") << msg;
+        throw std::runtime_error(msg);
+    }
+    if (!mWriteBuf)
+    {
+        mWriteBufStorage.resize(mWriteBufSize + kAlignment);
+        auto addr = reinterpret_cast<uintptr_t>(mWriteBufStorage.data());
+        addr = (addr + kAlignment - 1) / kAlignment * kAlignment;
+        mWriteBuf = reinterpret_cast<char*>(addr);
+    }
+    mWriteBufFill = 0;
+    mDeflater = gzip ? make_unique<Deflater>() : nullptr;
+}
+
+char*
+XDROutputFileStream::reserve(size_t n)
+{
+    if (!mDeflater && mWriteBuf && mWriteBufSize - mWriteBufFill >= n)
+    {
+        return mWriteBuf + mWriteBufFill;
+    }
+    if (mBuf.size() < n)
+    {
+        mBuf.resize(n);
+    }
+    return mBuf.data();
+}
+
+bool
+XDROutputFileStream::put(char const* data, size_t n)
+{
+    if (!*this)
+    {
+        return false;
+    }
+    if (mDeflater)
+    {
+        return mDeflater->deflate(*this, data, n, false);
+    }
+    if (data == mWriteBuf + mWriteBufFill)
+    {
+        // marshalled in place
+        mWriteBufFill += n;
+        return mWriteBufFill < mWriteBufSize || flush();
+    }
+    return append(data, n);
+}
+
+bool
+XDROutputFileStream::append(char const* data, size_t n)
+{
+    while (n != 0)
+    {
+        size_t room = mWriteBufSize - mWriteBufFill;
+        if (n > room && !mDirectIO)
+        {
+            // the buffer and the overflow go out in one call
+            return flush(data, n);
+        }
+        size_t chunk = std::min(n, room);
+        std::memcpy(mWriteBuf + mWriteBufFill, data, chunk);
+        mWriteBufFill += chunk;
+        data += chunk;
+        n -= chunk;
+        // in direct I/O mode, only whole (aligned) buffers are written
+        if (mWriteBufFill == mWriteBufSize && !flush())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+XDROutputFileStream::flush(char const* data, size_t n)
+{
+    if (!*this)
+    {
+        return false;
+    }
+    if (!writeFully(mFd, mWriteBuf, mWriteBufFill, data, n))
+    {
+        mFailed = true;
+        return false;
+    }
+    mWriteBufFill = 0;
+    return true;
+}
+}
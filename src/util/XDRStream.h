@@ -9,6 +9,7 @@
 #include "util/Logging.h"
 #include "xdrpp/marshal.h"
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -56,9 +57,25 @@ class XDRInputFileStream
         return mIn.good();
     }
 
+    // Offset of the next object to be read, for a later seek().
+    std::streamoff
+    pos()
+    {
+        return mIn.tellg();
+    }
+
+    void
+    seek(std::streamoff offset)
+    {
+        mIn.clear();
+        mIn.seekg(offset);
+    }
+
+    // Reads the next object into out. When bytesRead is given, the size of
+    // its record in the file is added to it.
     template <typename T>
     bool
-    readOne(T& out)
+    readOne(T& out, size_t* bytesRead = nullptr)
     {
         char szBuf[4];
         if (!mIn.read(szBuf, 4))
@@ -91,40 +108,95 @@ class XDRInputFileStream
         }
         xdr::xdr_get g(mBuf.data(), mBuf.data() + sz);
         xdr::xdr_argpack_archive(g, out);
+        if (bytesRead)
+        {
+            *bytesRead += 4 + sz;
+        }
         return true;
     }
 };
 
+/**
+ * Helper for writing a sequence of XDR objects to a file one at a time. The
+ * file can optionally be gzip-compressed as it is written, and the
+ * uncompressed contents hashed along the way.
+ *
+ * Output is gathered in a large, block-aligned buffer and handed to the
+ * kernel a buffer at a time, so that writing a big bucket costs a few
+ * thousand write calls rather than one per entry. Objects that do not fit
+ * in what is left of the buffer go out together with it in one writev. The
+ * stream can also be opened for direct I/O, bypassing the page cache, which
+ * keeps a large merge from evicting everything else the process has cached.
+ */
 class XDROutputFileStream
 {
-    std::ofstream mOut;
+    class Deflater;
+
+    std::string mFilename;
+    int mFd{-1};
+    bool mFailed{false};
+    bool mDirectIO{false};
+
+    // Write buffer, aligned to kAlignment within mWriteBufStorage.
+    size_t const mWriteBufSize;
+    std::vector<char> mWriteBufStorage;
+    char* mWriteBuf{nullptr};
+    size_t mWriteBufFill{0};
+
     std::vector<char> mBuf;
+    std::unique_ptr<Deflater> mDeflater;
+
+    // Where writeOne should marshal an object of n bytes: straight into the
+    // write buffer if it fits and nothing has to transform it on the way,
+    // else into mBuf.
+    char* reserve(size_t n);
+    // Takes n bytes marshalled at data, as returned by reserve().
+    bool put(char const* data, size_t n);
+    // Appends n bytes to the file, through the write buffer.
+    bool append(char const* data, size_t n);
+    // Writes out the whole buffer, and data after it if given.
+    bool flush(char const* data = nullptr, size_t n = 0);
+    // Writes out what is left, optionally fsyncs, and closes the file.
+    void finish(bool sync);
 
   public:
-    void
-    close()
-    {
-        mOut.close();
-    }
-
-    void
-    open(std::string const& filename)
+    // Alignment of the write buffer, and of every write in direct I/O mode.
+    static size_t const kAlignment = 4096;
+    static size_t const kDefaultBufferSize = 256 * 1024;
+
+    explicit XDROutputFileStream(size_t bufferSize = kDefaultBufferSize);
+    ~XDROutputFileStream();
+    XDROutputFileStream(XDROutputFileStream const&) = delete;
+    XDROutputFileStream& operator=(XDROutputFileStream const&) = delete;
+
+    // Flushes and, for a gzip stream, writes the gzip trailer. Throws if the
+    // data can not be written out.
+    void close();
+
+    // Like close(), but also fsyncs the file, so that its contents survive a
+    // crash once this returns. Its name only survives once its directory is
+    // synced as well: with syncDir set that is done here, otherwise a caller
+    // writing several files into one directory syncs it once for the batch
+    // with fs::syncDirectory.
+    void durableClose(bool syncDir = true);
+
+    // Opens filename for writing, truncating it. When gzip is set the file
+    // is written in gzip format. With directIO the file is written around
+    // the page cache where the platform and filesystem allow it, and through
+    // it otherwise.
+    void open(std::string const& filename, bool gzip = false,
+              bool directIO = false);
+
+    // Whether the stream is open and in direct I/O mode.
+    bool
+    isDirectIO() const
     {
-        mOut.open(filename, std::ofstream::binary | std::ofstream::trunc);
-        if (!mOut)
-        {
-            std::string msg("failed to open XDR file: ");
-            msg += filename;
-            msg += ", reason: ";
-            msg += std::to_string(errno);
-            CLOG(FATAL, "Fs") << msg;
-            throw std::runtime_error(msg);
-        }
+        return mDirectIO;
     }
 
     operator bool() const
     {
-        return mOut.good();
+        return mFd != -1 && !mFailed;
     }
 
     template <typename T>
@@ -134,28 +206,25 @@ class XDROutputFileStream
         uint32_t sz = (uint32_t)xdr::xdr_size(t);
         assert(sz < 0x80000000);
 
-        if (mBuf.size() < sz + 4)
-        {
-            mBuf.resize(sz + 4);
-        }
+        char* buf = reserve(sz + 4);
 
         // Write 4 bytes of size, big-endian, with XDR 'continuation' bit set on
         // high bit of high byte.
-        mBuf[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
-        mBuf[1] = static_cast<char>((sz >> 16) & 0xFF);
-        mBuf[2] = static_cast<char>((sz >> 8) & 0xFF);
-        mBuf[3] = static_cast<char>(sz & 0xFF);
+        buf[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
+        buf[1] = static_cast<char>((sz >> 16) & 0xFF);
+        buf[2] = static_cast<char>((sz >> 8) & 0xFF);
+        buf[3] = static_cast<char>(sz & 0xFF);
 
-        xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
+        xdr::xdr_put p(buf + 4, buf + 4 + sz);
         xdr_argpack_archive(p, t);
 
-        if (!mOut.write(mBuf.data(), sz + 4))
+        if (hasher)
         {
-            return false;
+            hasher->add(ByteSlice(buf, sz + 4));
         }
-        if (hasher)
+        if (!put(buf, sz + 4))
         {
-            hasher->add(ByteSlice(mBuf.data(), sz + 4));
+            return false;
         }
         if (bytesPut)
         {
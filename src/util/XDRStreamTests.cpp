@@ -0,0 +1,169 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SHA.h"
+#include "ledger/LedgerTestUtils.h"
+#include "lib/catch.hpp"
+#include "test/Microbench.h"
+#include "util/Fs.h"
+#include "util/TmpDir.h"
+#include "util/XDRStream.h"
+
+using namespace stellar;
+using xdr::operator==;
+
+namespace
+{
+
+std::vector<BucketEntry>
+randomBucketEntries(size_t n)
+{
+    std::vector<BucketEntry> entries(n);
+    auto live = LedgerTestUtils::generateValidLedgerEntries(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        entries[i].type(LIVEENTRY);
+        entries[i].liveEntry() = live[i];
+    }
+    return entries;
+}
+
+void
+checkReadBack(std::string const& filename,
+              std::vector<BucketEntry> const& entries)
+{
+    XDRInputFileStream in;
+    in.open(filename);
+    BucketEntry e;
+    size_t n = 0;
+    while (in.readOne(e))
+    {
+        REQUIRE(n < entries.size());
+        REQUIRE(e == entries[n++]);
+    }
+    REQUIRE(n == entries.size());
+}
+}
+
+TEST_CASE("XDROutputFileStream round trip", "[xdrstream]")
+{
+    TmpDir dir("xdrstream");
+    std::string filename = dir.getName() + "/entries.xdr";
+    auto entries = randomBucketEntries(500);
+
+    // with a single-block buffer, entries often straddle its end, so both
+    // ways into the file are taken: marshalled in place in the buffer, and
+    // written out in one go along with it
+    size_t bufferSize = 0;
+    bool directIO = false;
+    bool durable = false;
+    SECTION("small buffer")
+    {
+        bufferSize = 1;
+    }
+    SECTION("default buffer")
+    {
+        bufferSize = XDROutputFileStream::kDefaultBufferSize;
+    }
+    SECTION("direct I/O")
+    {
+        bufferSize = 1;
+        directIO = true;
+    }
+    SECTION("durable close")
+    {
+        bufferSize = XDROutputFileStream::kDefaultBufferSize;
+        durable = true;
+    }
+
+    auto hasher = SHA256::create();
+    size_t bytesPut = 0;
+    XDROutputFileStream out(bufferSize);
+    out.open(filename, false, directIO);
+    for (auto const& e : entries)
+    {
+        REQUIRE(out.writeOne(e, hasher.get(), &bytesPut));
+    }
+    if (durable)
+    {
+        out.durableClose();
+    }
+    else
+    {
+        out.close();
+    }
+    REQUIRE(!out);
+
+    std::ifstream in(filename, std::ifstream::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    REQUIRE(bytes.size() == bytesPut);
+    REQUIRE(sha256(bytes) == hasher->finish());
+    checkReadBack(filename, entries);
+}
+
+TEST_CASE("XDROutputFileStream flushes on destruction", "[xdrstream]")
+{
+    TmpDir dir("xdrstream");
+    std::string filename = dir.getName() + "/entries.xdr";
+    auto entries = randomBucketEntries(10);
+    {
+        XDROutputFileStream out;
+        out.open(filename);
+        for (auto const& e : entries)
+        {
+            REQUIRE(out.writeOne(e));
+        }
+    }
+    checkReadBack(filename, entries);
+}
+
+TEST_CASE("XDROutputFileStream write throughput", "[xdrstream][bench][hide]")
+{
+    TmpDir dir("xdrstream");
+    std::string filename = dir.getName() + "/entries.xdr";
+
+    // ~40MB of bucket entries, about what a deep level merge writes
+    size_t const n = 200000;
+    auto entries = randomBucketEntries(1000);
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bytes += xdr::xdr_size(entries[i % entries.size()]) + 4;
+    }
+
+    Microbench mb("xdr-output", 1, 3);
+    auto writeAll = [&](size_t bufferSize, bool directIO, bool durable) {
+        XDROutputFileStream out(bufferSize);
+        out.open(filename, false, directIO);
+        for (size_t i = 0; i < n; ++i)
+        {
+            out.writeOne(entries[i % entries.size()]);
+        }
+        if (durable)
+        {
+            out.durableClose();
+        }
+        else
+        {
+            out.close();
+        }
+    };
+
+    CLOG(INFO, "Fs") << "Writing " << n << " entries, " << bytes / 1024
+                     << " KiB per round";
+    for (size_t bufferSize : {size_t(4096), size_t(64 * 1024),
+                              XDROutputFileStream::kDefaultBufferSize,
+                              size_t(1024 * 1024)})
+    {
+        auto name = std::to_string(bufferSize / 1024) + "KiB";
+        mb.run("write/" + name, 1,
+               [&]() { writeAll(bufferSize, false, false); });
+        mb.run("write+fsync/" + name, 1,
+               [&]() { writeAll(bufferSize, false, true); });
+    }
+    mb.run("write+fsync/direct", 1, [&]() {
+        writeAll(XDROutputFileStream::kDefaultBufferSize, true, true);
+    });
+}
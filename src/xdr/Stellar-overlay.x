@@ -90,7 +90,11 @@ enum MessageType
     GET_SCP_STATE = 12,
 
     // new messages
-    HELLO = 13
+    HELLO = 13,
+
+    // pull-mode transaction flooding
+    FLOOD_ADVERT = 14,
+    FLOOD_DEMAND = 15
 };
 
 struct DontHave
@@ -99,6 +103,26 @@ struct DontHave
     uint256 reqHash;
 };
 
+const TX_ADVERT_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxAdvertVector<TX_ADVERT_VECTOR_MAX_SIZE>;
+
+// Hashes of flooded TRANSACTION messages (of the XDR of the whole
+// StellarMessage) the sender has and is willing to send on demand.
+struct FloodAdvert
+{
+    TxAdvertVector txHashes;
+};
+
+const TX_DEMAND_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxDemandVector<TX_DEMAND_VECTOR_MAX_SIZE>;
+
+// Hashes, out of earlier adverts, of the TRANSACTION messages the sender
+// wants in full.
+struct FloodDemand
+{
+    TxDemandVector txHashes;
+};
+
 union StellarMessage switch (MessageType type)
 {
 case ERROR_MSG:
@@ -131,6 +155,11 @@ case SCP_MESSAGE:
     SCPEnvelope envelope;
 case GET_SCP_STATE:
     uint32 getSCPLedgerSeq; // ledger seq requested ; if 0, requests the latest
+
+case FLOOD_ADVERT:
+    FloodAdvert floodAdvert;
+case FLOOD_DEMAND:
+    FloodDemand floodDemand;
 };
 
 union AuthenticatedMessage switch (uint32 v)